@@ -40,9 +40,12 @@
 #include "spdk/accel_engine.h"
 #include "spdk/crc32.h"
 #include "spdk/util.h"
+#include "spdk/histogram_data.h"
 
 #define DATA_PATTERN 0x5a
 #define ALIGN_4K 0x1000
+/* Engines a worker can tell apart in its latency data, including software */
+#define AP_MAX_ENGINES 8
 
 static uint64_t	g_tsc_rate;
 static uint64_t g_tsc_end;
@@ -57,15 +60,37 @@ static int g_threads_per_core = 1;
 static int g_time_in_sec = 5;
 static uint32_t g_crc32c_seed = 0;
 static uint32_t g_crc32c_chained_count = 1;
+static bool g_vary_iov_sizes = false;
+/* Operations per second submitted by each thread in open-loop mode, 0 for closed loop */
+static uint64_t g_target_rate = 0;
 static int g_fail_percent_goal = 0;
 static uint8_t g_fill_pattern = 255;
 static bool g_verify = false;
 static const char *g_workload_type = NULL;
-static enum accel_opcode g_workload_selection;
 static struct worker_thread *g_workers = NULL;
 static int g_num_workers = 0;
 static pthread_mutex_t g_workers_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* Opcodes of the workload mix, each picked with a probability proportional to its weight */
+struct ap_workload {
+	enum accel_opcode	opc;
+	uint32_t		weight;
+};
+static struct ap_workload g_workloads[ACCEL_OPC_LAST];
+static int g_num_workloads = 0;
+static uint32_t g_total_weight = 0;
+
+static const char *g_opc_names[ACCEL_OPC_LAST] = {
+	[ACCEL_OPC_COPY]	= "copy",
+	[ACCEL_OPC_FILL]	= "fill",
+	[ACCEL_OPC_DUALCAST]	= "dualcast",
+	[ACCEL_OPC_COMPARE]	= "compare",
+	[ACCEL_OPC_CRC32C]	= "crc32c",
+	[ACCEL_OPC_COPY_CRC32C]	= "copy_crc32c",
+};
+
+static const double g_latency_cutoffs[] = { 0.5, 0.99, 0.999 };
+
 struct worker_thread;
 static void accel_done(void *ref, int status);
 
@@ -78,9 +103,17 @@ struct ap_task {
 	void			*src;
 	struct iovec		*iovs;
 	uint32_t		iov_cnt;
+	uint64_t		iovs_len;
 	void			*dst;
 	void			*dst2;
+	/* Matches src unless a miscompare is injected */
+	void			*cmp;
 	uint32_t		crc_dst;
+	enum accel_opcode	op_code;
+	/* Index of the engine the operation went to in the worker's engine_names */
+	int			engine_idx;
+	/* Time the operation was submitted, or was due to be in open-loop mode */
+	uint64_t		submit_tsc;
 	struct worker_thread	*worker;
 	int			expected_status; /* used for the compare operation */
 	TAILQ_ENTRY(ap_task)	link;
@@ -89,6 +122,7 @@ struct ap_task {
 struct worker_thread {
 	struct spdk_io_channel		*ch;
 	uint64_t			xfer_completed;
+	uint64_t			bytes_completed;
 	uint64_t			xfer_failed;
 	uint64_t			injected_miscompares;
 	uint64_t			current_queue_depth;
@@ -99,32 +133,74 @@ struct worker_thread {
 	bool				is_draining;
 	struct spdk_poller		*is_draining_poller;
 	struct spdk_poller		*stop_poller;
+	struct spdk_poller		*rate_poller;
+	uint64_t			next_submit_tsc;
+	uint64_t			submit_interval;
+	unsigned int			seed;
 	void				*task_base;
 	struct display_info		display;
+	const char			*engine_names[AP_MAX_ENGINES];
+	int				num_engines;
+	struct spdk_histogram_data	*latency[ACCEL_OPC_LAST][AP_MAX_ENGINES];
 };
 
+static bool
+_workload_has(enum accel_opcode opc)
+{
+	int i;
+
+	for (i = 0; i < g_num_workloads; i++) {
+		if (g_workloads[i].opc == opc) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool
+_workload_has_vectors(void)
+{
+	return _workload_has(ACCEL_OPC_CRC32C) || _workload_has(ACCEL_OPC_COPY_CRC32C);
+}
+
 static void
 dump_user_config(struct spdk_app_opts *opts)
 {
+	int i;
+
 	printf("SPDK Configuration:\n");
 	printf("Core mask:      %s\n\n", opts->reactor_mask);
 	printf("Accel Perf Configuration:\n");
 	printf("Workload Type:  %s\n", g_workload_type);
-	if (g_workload_selection == ACCEL_OPC_CRC32C || g_workload_selection == ACCEL_OPC_COPY_CRC32C) {
+	if (g_num_workloads > 1) {
+		for (i = 0; i < g_num_workloads; i++) {
+			printf("  %-12s  %u%%\n", g_opc_names[g_workloads[i].opc],
+			       g_workloads[i].weight * 100 / g_total_weight);
+		}
+	}
+	if (_workload_has_vectors()) {
 		printf("CRC-32C seed:   %u\n", g_crc32c_seed);
 		printf("vector count    %u\n", g_crc32c_chained_count);
-	} else if (g_workload_selection == ACCEL_OPC_FILL) {
+		printf("Vector sizes:   %s\n", g_vary_iov_sizes ? "random" : "fixed");
+	}
+	if (_workload_has(ACCEL_OPC_FILL)) {
 		printf("Fill pattern:   0x%x\n", g_fill_pattern);
-	} else if ((g_workload_selection == ACCEL_OPC_COMPARE) && g_fail_percent_goal > 0) {
+	}
+	if (_workload_has(ACCEL_OPC_COMPARE) && g_fail_percent_goal > 0) {
 		printf("Failure inject: %u percent\n", g_fail_percent_goal);
 	}
-	if (g_workload_selection == ACCEL_OPC_COPY_CRC32C) {
+	if (_workload_has_vectors()) {
 		printf("Vector size:    %u bytes\n", g_xfer_size_bytes);
 		printf("Transfer size:  %u bytes\n", g_xfer_size_bytes * g_crc32c_chained_count);
 	} else {
 		printf("Transfer size:  %u bytes\n", g_xfer_size_bytes);
 	}
-	printf("Queue depth:    %u\n", g_queue_depth);
+	if (g_target_rate) {
+		printf("Target rate:    %" PRIu64 " ops/s per thread\n", g_target_rate);
+	} else {
+		printf("Queue depth:    %u\n", g_queue_depth);
+	}
 	printf("Allocate depth: %u\n", g_allocate_depth);
 	printf("# threads/core: %u\n", g_threads_per_core);
 	printf("Run time:       %u seconds\n", g_time_in_sec);
@@ -137,12 +213,16 @@ usage(void)
 	printf("accel_perf options:\n");
 	printf("\t[-h help message]\n");
 	printf("\t[-q queue depth per core]\n");
-	printf("\t[-C for crc32c workload, use this value to configure the io vector size to test (default 1)\n");
+	printf("\t[-C for crc32c workloads, use this value to configure the io vector size to test (default 1)\n");
+	printf("\t[-S for crc32c workloads, vary the size of each io vector, keeping their total the same]\n");
 	printf("\t[-T number of threads per core\n");
 	printf("\t[-n number of channels]\n");
 	printf("\t[-o transfer size in bytes]\n");
 	printf("\t[-t time in seconds]\n");
 	printf("\t[-w workload type must be one of these: copy, fill, crc32c, copy_crc32c, compare, dualcast\n");
+	printf("\t\tA comma separated list of types with optional weights mixes them, e.g. copy:3,crc32c:1\n");
+	printf("\t[-I submit this many operations per second per thread instead of keeping a queue depth]\n");
+	printf("\t\tLatencies are measured from the time the operation was due, -a limits the operations in flight.\n");
 	printf("\t[-s for crc32c workload, use this seed value (default 0)\n");
 	printf("\t[-P for compare workload, percentage of operations that should miscompare (percent, default 0)\n");
 	printf("\t[-f for fill workload, use this BYTE value (default 255)\n");
@@ -151,22 +231,73 @@ usage(void)
 	printf("\t\tCan be used to spread operations across a wider range of memory.\n");
 }
 
+static int
+parse_workload(const char *str)
+{
+	char *types, *type, *weight, *saveptr = NULL;
+	enum accel_opcode opc;
+	long val;
+	int i, rc = 0;
+
+	types = strdup(str);
+	if (types == NULL) {
+		return -ENOMEM;
+	}
+
+	g_num_workloads = 0;
+	g_total_weight = 0;
+	for (type = strtok_r(types, ",", &saveptr); type != NULL; type = strtok_r(NULL, ",", &saveptr)) {
+		weight = strchr(type, ':');
+		if (weight != NULL) {
+			*weight++ = '\0';
+		}
+
+		for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+			if (g_opc_names[opc] != NULL && strcmp(g_opc_names[opc], type) == 0) {
+				break;
+			}
+		}
+		if (opc == ACCEL_OPC_LAST || _workload_has(opc)) {
+			rc = -EINVAL;
+			break;
+		}
+
+		val = 1;
+		if (weight != NULL) {
+			val = spdk_strtol(weight, 10);
+			if (val <= 0) {
+				rc = -EINVAL;
+				break;
+			}
+		}
+
+		i = g_num_workloads++;
+		g_workloads[i].opc = opc;
+		g_workloads[i].weight = val;
+		g_total_weight += val;
+	}
+
+	free(types);
+	return g_num_workloads == 0 ? -EINVAL : rc;
+}
+
 static int
 parse_args(int argc, char *argv)
 {
-	int argval = 0;
+	long long argval = 0;
 
 	switch (argc) {
 	case 'a':
 	case 'C':
 	case 'f':
+	case 'I':
 	case 'T':
 	case 'o':
 	case 'P':
 	case 'q':
 	case 's':
 	case 't':
-		argval = spdk_strtol(optarg, 10);
+		argval = spdk_strtoll(optarg, 10);
 		if (argval < 0) {
 			fprintf(stderr, "-%c option must be non-negative.\n", argc);
 			usage();
@@ -187,6 +318,12 @@ parse_args(int argc, char *argv)
 	case 'f':
 		g_fill_pattern = (uint8_t)argval;
 		break;
+	case 'I':
+		g_target_rate = argval;
+		break;
+	case 'S':
+		g_vary_iov_sizes = true;
+		break;
 	case 'T':
 		g_threads_per_core = argval;
 		break;
@@ -210,18 +347,10 @@ parse_args(int argc, char *argv)
 		break;
 	case 'w':
 		g_workload_type = optarg;
-		if (!strcmp(g_workload_type, "copy")) {
-			g_workload_selection = ACCEL_OPC_COPY;
-		} else if (!strcmp(g_workload_type, "fill")) {
-			g_workload_selection = ACCEL_OPC_FILL;
-		} else if (!strcmp(g_workload_type, "crc32c")) {
-			g_workload_selection = ACCEL_OPC_CRC32C;
-		} else if (!strcmp(g_workload_type, "copy_crc32c")) {
-			g_workload_selection = ACCEL_OPC_COPY_CRC32C;
-		} else if (!strcmp(g_workload_type, "compare")) {
-			g_workload_selection = ACCEL_OPC_COMPARE;
-		} else if (!strcmp(g_workload_type, "dualcast")) {
-			g_workload_selection = ACCEL_OPC_DUALCAST;
+		if (parse_workload(g_workload_type)) {
+			fprintf(stderr, "Invalid workload type %s\n", g_workload_type);
+			usage();
+			return 1;
 		}
 		break;
 	default:
@@ -250,21 +379,44 @@ unregister_worker(void *arg1)
 	pthread_mutex_unlock(&g_workers_lock);
 }
 
+/* Split the vector total into iov_cnt lengths.  Random lengths average to the vector
+ * size, like the scatter-gather lists built from real I/O.
+ */
+static uint32_t
+_get_iov_len(struct worker_thread *worker, uint32_t i, uint32_t iov_cnt, uint64_t *remaining)
+{
+	uint64_t len, max;
+	uint32_t left = iov_cnt - i;
+
+	if (!g_vary_iov_sizes || left == 1) {
+		len = g_vary_iov_sizes ? *remaining : (uint64_t)g_xfer_size_bytes;
+	} else {
+		/* Leave at least one byte for each of the following vectors. */
+		max = *remaining - (left - 1);
+		len = 1 + rand_r(&worker->seed) % (2 * *remaining / left);
+		len = spdk_min(len, max);
+	}
+
+	*remaining -= len;
+	return len;
+}
+
 static int
 _get_task_data_bufs(struct ap_task *task)
 {
 	uint32_t align = 0;
 	uint32_t i = 0;
+	uint64_t remaining;
 	int dst_buff_len = g_xfer_size_bytes;
 
 	/* For dualcast, the DSA HW requires 4K alignment on destination addresses but
 	 * we do this for all engines to keep it simple.
 	 */
-	if (g_workload_selection == ACCEL_OPC_DUALCAST) {
+	if (_workload_has(ACCEL_OPC_DUALCAST)) {
 		align = ALIGN_4K;
 	}
 
-	if (g_workload_selection == ACCEL_OPC_CRC32C || g_workload_selection == ACCEL_OPC_COPY_CRC32C) {
+	if (_workload_has_vectors()) {
 		assert(g_crc32c_chained_count > 0);
 		task->iov_cnt = g_crc32c_chained_count;
 		task->iovs = calloc(task->iov_cnt, sizeof(struct iovec));
@@ -273,50 +425,46 @@ _get_task_data_bufs(struct ap_task *task)
 			return -ENOMEM;
 		}
 
-		if (g_workload_selection == ACCEL_OPC_COPY_CRC32C) {
+		if (_workload_has(ACCEL_OPC_COPY_CRC32C)) {
 			dst_buff_len = g_xfer_size_bytes * g_crc32c_chained_count;
 		}
 
+		remaining = (uint64_t)g_xfer_size_bytes * task->iov_cnt;
 		for (i = 0; i < task->iov_cnt; i++) {
-			task->iovs[i].iov_base = spdk_dma_zmalloc(g_xfer_size_bytes, 0, NULL);
+			task->iovs[i].iov_len = _get_iov_len(task->worker, i, task->iov_cnt, &remaining);
+			task->iovs[i].iov_base = spdk_dma_zmalloc(task->iovs[i].iov_len, 0, NULL);
 			if (task->iovs[i].iov_base == NULL) {
 				return -ENOMEM;
 			}
-			memset(task->iovs[i].iov_base, DATA_PATTERN, g_xfer_size_bytes);
-			task->iovs[i].iov_len = g_xfer_size_bytes;
-		}
-
-	} else {
-		task->src = spdk_dma_zmalloc(g_xfer_size_bytes, 0, NULL);
-		if (task->src == NULL) {
-			fprintf(stderr, "Unable to alloc src buffer\n");
-			return -ENOMEM;
+			memset(task->iovs[i].iov_base, DATA_PATTERN, task->iovs[i].iov_len);
+			task->iovs_len += task->iovs[i].iov_len;
 		}
+	}
 
-		/* For fill, set the entire src buffer so we can check if verify is enabled. */
-		if (g_workload_selection == ACCEL_OPC_FILL) {
-			memset(task->src, g_fill_pattern, g_xfer_size_bytes);
-		} else {
-			memset(task->src, DATA_PATTERN, g_xfer_size_bytes);
-		}
+	task->src = spdk_dma_zmalloc(g_xfer_size_bytes, 0, NULL);
+	if (task->src == NULL) {
+		fprintf(stderr, "Unable to alloc src buffer\n");
+		return -ENOMEM;
 	}
+	memset(task->src, DATA_PATTERN, g_xfer_size_bytes);
 
-	if (g_workload_selection != ACCEL_OPC_CRC32C) {
-		task->dst = spdk_dma_zmalloc(dst_buff_len, align, NULL);
-		if (task->dst == NULL) {
-			fprintf(stderr, "Unable to alloc dst buffer\n");
+	if (_workload_has(ACCEL_OPC_COMPARE)) {
+		task->cmp = spdk_dma_zmalloc(g_xfer_size_bytes, 0, NULL);
+		if (task->cmp == NULL) {
+			fprintf(stderr, "Unable to alloc compare buffer\n");
 			return -ENOMEM;
 		}
+		memset(task->cmp, DATA_PATTERN, g_xfer_size_bytes);
+	}
 
-		/* For compare we want the buffers to match, otherwise not. */
-		if (g_workload_selection == ACCEL_OPC_COMPARE) {
-			memset(task->dst, DATA_PATTERN, dst_buff_len);
-		} else {
-			memset(task->dst, ~DATA_PATTERN, dst_buff_len);
-		}
+	task->dst = spdk_dma_zmalloc(dst_buff_len, align, NULL);
+	if (task->dst == NULL) {
+		fprintf(stderr, "Unable to alloc dst buffer\n");
+		return -ENOMEM;
 	}
+	memset(task->dst, ~DATA_PATTERN, dst_buff_len);
 
-	if (g_workload_selection == ACCEL_OPC_DUALCAST) {
+	if (_workload_has(ACCEL_OPC_DUALCAST)) {
 		task->dst2 = spdk_dma_zmalloc(g_xfer_size_bytes, align, NULL);
 		if (task->dst2 == NULL) {
 			fprintf(stderr, "Unable to alloc dst buffer\n");
@@ -344,6 +492,46 @@ _get_task(struct worker_thread *worker)
 	return task;
 }
 
+static enum accel_opcode
+_pick_opcode(struct worker_thread *worker)
+{
+	uint32_t pick;
+	int i;
+
+	if (g_num_workloads == 1) {
+		return g_workloads[0].opc;
+	}
+
+	pick = rand_r(&worker->seed) % g_total_weight;
+	for (i = 0; i < g_num_workloads - 1; i++) {
+		if (pick < g_workloads[i].weight) {
+			break;
+		}
+		pick -= g_workloads[i].weight;
+	}
+
+	return g_workloads[i].opc;
+}
+
+static int
+_get_engine_idx(struct worker_thread *worker, const char *name)
+{
+	int i;
+
+	for (i = 0; i < worker->num_engines; i++) {
+		if (worker->engine_names[i] == name || strcmp(worker->engine_names[i], name) == 0) {
+			return i;
+		}
+	}
+
+	if (worker->num_engines == AP_MAX_ENGINES) {
+		return AP_MAX_ENGINES - 1;
+	}
+
+	worker->engine_names[worker->num_engines] = name;
+	return worker->num_engines++;
+}
+
 /* Submit one operation using the same ap task that just completed. */
 static void
 _submit_single(struct worker_thread *worker, struct ap_task *task)
@@ -354,14 +542,14 @@ _submit_single(struct worker_thread *worker, struct ap_task *task)
 
 	assert(worker);
 
-	switch (g_workload_selection) {
+	task->op_code = _pick_opcode(worker);
+	switch (task->op_code) {
 	case ACCEL_OPC_COPY:
 		rc = spdk_accel_submit_copy(worker->ch, task->dst, task->src,
 					    g_xfer_size_bytes, flags, accel_done, task);
 		break;
 	case ACCEL_OPC_FILL:
-		/* For fill use the first byte of the task->dst buffer */
-		rc = spdk_accel_submit_fill(worker->ch, task->dst, *(uint8_t *)task->src,
+		rc = spdk_accel_submit_fill(worker->ch, task->dst, g_fill_pattern,
 					    g_xfer_size_bytes, flags, accel_done, task);
 		break;
 	case ACCEL_OPC_CRC32C:
@@ -374,15 +562,15 @@ _submit_single(struct worker_thread *worker, struct ap_task *task)
 						    &task->crc_dst, g_crc32c_seed, flags, accel_done, task);
 		break;
 	case ACCEL_OPC_COMPARE:
-		random_num = rand() % 100;
+		random_num = rand_r(&worker->seed) % 100;
 		if (random_num < g_fail_percent_goal) {
 			task->expected_status = -EILSEQ;
-			*(uint8_t *)task->dst = ~DATA_PATTERN;
+			*(uint8_t *)task->cmp = ~DATA_PATTERN;
 		} else {
 			task->expected_status = 0;
-			*(uint8_t *)task->dst = DATA_PATTERN;
+			*(uint8_t *)task->cmp = DATA_PATTERN;
 		}
-		rc = spdk_accel_submit_compare(worker->ch, task->dst, task->src,
+		rc = spdk_accel_submit_compare(worker->ch, task->cmp, task->src,
 					       g_xfer_size_bytes, accel_done, task);
 		break;
 	case ACCEL_OPC_DUALCAST:
@@ -395,6 +583,7 @@ _submit_single(struct worker_thread *worker, struct ap_task *task)
 
 	}
 
+	task->engine_idx = _get_engine_idx(worker, spdk_accel_get_last_engine_name(worker->ch));
 	if (rc) {
 		accel_done(task, rc);
 	}
@@ -405,23 +594,19 @@ _free_task_buffers(struct ap_task *task)
 {
 	uint32_t i;
 
-	if (g_workload_selection == ACCEL_OPC_CRC32C || g_workload_selection == ACCEL_OPC_COPY_CRC32C) {
-		if (task->iovs) {
-			for (i = 0; i < task->iov_cnt; i++) {
-				if (task->iovs[i].iov_base) {
-					spdk_dma_free(task->iovs[i].iov_base);
-				}
+	if (task->iovs) {
+		for (i = 0; i < task->iov_cnt; i++) {
+			if (task->iovs[i].iov_base) {
+				spdk_dma_free(task->iovs[i].iov_base);
 			}
-			free(task->iovs);
 		}
-	} else {
-		spdk_dma_free(task->src);
+		free(task->iovs);
 	}
 
+	spdk_dma_free(task->src);
+	spdk_dma_free(task->cmp);
 	spdk_dma_free(task->dst);
-	if (g_workload_selection == ACCEL_OPC_DUALCAST) {
-		spdk_dma_free(task->dst2);
-	}
+	spdk_dma_free(task->dst2);
 }
 
 static int
@@ -446,6 +631,35 @@ _vector_memcmp(void *_dst, struct iovec *src_iovs, uint32_t iovcnt)
 	return 0;
 }
 
+static int
+_fill_memcmp(uint8_t *dst, uint8_t fill, uint64_t len)
+{
+	uint64_t i;
+
+	for (i = 0; i < len; i++) {
+		if (dst[i] != fill) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+_record_latency(struct worker_thread *worker, struct ap_task *task)
+{
+	struct spdk_histogram_data **histogram = &worker->latency[task->op_code][task->engine_idx];
+
+	if (*histogram == NULL) {
+		*histogram = spdk_histogram_data_alloc();
+		if (*histogram == NULL) {
+			return;
+		}
+	}
+
+	spdk_histogram_data_tally(*histogram, spdk_get_ticks() - task->submit_tsc);
+}
+
 static void
 accel_done(void *arg1, int status)
 {
@@ -456,8 +670,10 @@ accel_done(void *arg1, int status)
 	assert(worker);
 	assert(worker->current_queue_depth > 0);
 
+	_record_latency(worker, task);
+
 	if (g_verify && status == 0) {
-		switch (g_workload_selection) {
+		switch (task->op_code) {
 		case ACCEL_OPC_COPY_CRC32C:
 			sw_crc32c = spdk_crc32c_iov_update(task->iovs, task->iov_cnt, ~g_crc32c_seed);
 			if (task->crc_dst != sw_crc32c) {
@@ -493,7 +709,7 @@ accel_done(void *arg1, int status)
 			}
 			break;
 		case ACCEL_OPC_FILL:
-			if (memcmp(task->dst, task->src, g_xfer_size_bytes)) {
+			if (_fill_memcmp(task->dst, g_fill_pattern, g_xfer_size_bytes)) {
 				SPDK_NOTICELOG("Data miscompare\n");
 				worker->xfer_failed++;
 			}
@@ -506,7 +722,7 @@ accel_done(void *arg1, int status)
 		}
 	}
 
-	if (task->expected_status == -EILSEQ) {
+	if (task->op_code == ACCEL_OPC_COMPARE && task->expected_status == -EILSEQ) {
 		assert(status != 0);
 		worker->injected_miscompares++;
 	} else if (status) {
@@ -515,11 +731,18 @@ accel_done(void *arg1, int status)
 	}
 
 	worker->xfer_completed++;
+	if (task->op_code == ACCEL_OPC_CRC32C || task->op_code == ACCEL_OPC_COPY_CRC32C) {
+		worker->bytes_completed += task->iovs_len;
+	} else {
+		worker->bytes_completed += g_xfer_size_bytes;
+	}
 	worker->current_queue_depth--;
 
-	if (!worker->is_draining) {
+	/* In open-loop mode the rate poller submits the next operation. */
+	if (!worker->is_draining && g_target_rate == 0) {
 		TAILQ_INSERT_TAIL(&worker->tasks_pool, task, link);
 		task = _get_task(worker);
+		task->submit_tsc = spdk_get_ticks();
 		_submit_single(worker, task);
 		worker->current_queue_depth++;
 	} else {
@@ -527,10 +750,106 @@ accel_done(void *arg1, int status)
 	}
 }
 
+struct ap_latency {
+	double		us[SPDK_COUNTOF(g_latency_cutoffs)];
+	uint32_t	idx;
+	uint64_t	count;
+};
+
+static void
+check_cutoff(void *ctx, uint64_t start, uint64_t end, uint64_t count,
+	     uint64_t total, uint64_t so_far)
+{
+	struct ap_latency *lat = ctx;
+
+	lat->count = total;
+	if (count == 0) {
+		return;
+	}
+
+	while (lat->idx < SPDK_COUNTOF(g_latency_cutoffs) &&
+	       (double)so_far / total >= g_latency_cutoffs[lat->idx]) {
+		lat->us[lat->idx++] = (double)end * 1000 * 1000 / g_tsc_rate;
+	}
+}
+
+static void
+print_latency(const char *opc_name, const char *engine_name, struct spdk_histogram_data *histogram)
+{
+	struct ap_latency lat = {};
+
+	spdk_histogram_data_iterate(histogram, check_cutoff, &lat);
+	printf("%-12s %-10s %14" PRIu64 " %12.3f %12.3f %12.3f\n", opc_name, engine_name,
+	       lat.count, lat.us[0], lat.us[1], lat.us[2]);
+}
+
+/* Merge the latency data of all workers and print the percentiles of each opcode, for
+ * each of the engines that executed it and overall.
+ */
+static void
+dump_latency(void)
+{
+	struct spdk_histogram_data *total, *engine_total;
+	const char *engine_names[AP_MAX_ENGINES];
+	struct worker_thread *worker;
+	int opc, num_engines = 0, i, j;
+
+	for (worker = g_workers; worker != NULL; worker = worker->next) {
+		for (i = 0; i < worker->num_engines; i++) {
+			for (j = 0; j < num_engines; j++) {
+				if (strcmp(engine_names[j], worker->engine_names[i]) == 0) {
+					break;
+				}
+			}
+			if (j == num_engines && num_engines < AP_MAX_ENGINES) {
+				engine_names[num_engines++] = worker->engine_names[i];
+			}
+		}
+	}
+
+	total = spdk_histogram_data_alloc();
+	engine_total = spdk_histogram_data_alloc();
+	if (total == NULL || engine_total == NULL) {
+		goto out;
+	}
+
+	printf("Opcode       Engine         Operations     p50 (us)     p99 (us)   p99.9 (us)\n");
+	printf("--------------------------------------------------------------------------------\n");
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		if (!_workload_has(opc)) {
+			continue;
+		}
+
+		spdk_histogram_data_reset(total);
+		for (j = 0; j < num_engines; j++) {
+			spdk_histogram_data_reset(engine_total);
+			for (worker = g_workers; worker != NULL; worker = worker->next) {
+				for (i = 0; i < worker->num_engines; i++) {
+					if (strcmp(engine_names[j], worker->engine_names[i]) == 0 &&
+					    worker->latency[opc][i] != NULL) {
+						spdk_histogram_data_merge(engine_total, worker->latency[opc][i]);
+					}
+				}
+			}
+			spdk_histogram_data_merge(total, engine_total);
+			if (num_engines > 1) {
+				print_latency(g_opc_names[opc], engine_names[j], engine_total);
+			}
+		}
+		print_latency(g_opc_names[opc], num_engines > 1 ? "all" : engine_names[0], total);
+	}
+	printf("\n");
+
+out:
+	spdk_histogram_data_free(total);
+	spdk_histogram_data_free(engine_total);
+}
+
 static int
 dump_result(void)
 {
 	uint64_t total_completed = 0;
+	uint64_t total_bytes = 0;
 	uint64_t total_failed = 0;
 	uint64_t total_miscompared = 0;
 	uint64_t total_xfer_per_sec, total_bw_in_MiBps;
@@ -541,10 +860,11 @@ dump_result(void)
 	while (worker != NULL) {
 
 		uint64_t xfer_per_sec = worker->xfer_completed / g_time_in_sec;
-		uint64_t bw_in_MiBps = (worker->xfer_completed * g_xfer_size_bytes) /
+		uint64_t bw_in_MiBps = worker->bytes_completed /
 				       (g_time_in_sec * 1024 * 1024);
 
 		total_completed += worker->xfer_completed;
+		total_bytes += worker->bytes_completed;
 		total_failed += worker->xfer_failed;
 		total_miscompared += worker->injected_miscompares;
 
@@ -558,13 +878,16 @@ dump_result(void)
 	}
 
 	total_xfer_per_sec = total_completed / g_time_in_sec;
-	total_bw_in_MiBps = (total_completed * g_xfer_size_bytes) /
-			    (g_time_in_sec * 1024 * 1024);
+	total_bw_in_MiBps = total_bytes / (g_time_in_sec * 1024 * 1024);
 
 	printf("=========================================================================\n");
 	printf("Total:%15" PRIu64 "/s%9" PRIu64 " MiB/s%6" PRIu64 " %11" PRIu64"\n\n",
 	       total_xfer_per_sec, total_bw_in_MiBps, total_failed, total_miscompared);
 
+	if (total_completed) {
+		dump_latency();
+	}
+
 	return total_failed ? 1 : 0;
 }
 
@@ -604,6 +927,7 @@ _worker_stop(void *arg)
 	assert(worker);
 
 	spdk_poller_unregister(&worker->stop_poller);
+	spdk_poller_unregister(&worker->rate_poller);
 
 	/* now let the worker drain and check it's outstanding IO with a poller */
 	worker->is_draining = true;
@@ -612,6 +936,35 @@ _worker_stop(void *arg)
 	return SPDK_POLLER_BUSY;
 }
 
+/* Open-loop submission: operations are due at a fixed rate regardless of how fast the
+ * previous ones complete.  When all tasks are in flight the due operations wait for one,
+ * and their latency includes that wait.
+ */
+static int
+_worker_rate_poll(void *arg)
+{
+	struct worker_thread *worker = arg;
+	struct ap_task *task;
+	uint64_t now = spdk_get_ticks();
+	int submitted = 0;
+
+	while (worker->next_submit_tsc <= now) {
+		task = TAILQ_FIRST(&worker->tasks_pool);
+		if (task == NULL) {
+			break;
+		}
+		TAILQ_REMOVE(&worker->tasks_pool, task, link);
+
+		task->submit_tsc = worker->next_submit_tsc;
+		worker->next_submit_tsc += worker->submit_interval;
+		worker->current_queue_depth++;
+		_submit_single(worker, task);
+		submitted++;
+	}
+
+	return submitted > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 _init_thread(void *arg1)
 {
@@ -632,6 +985,7 @@ _init_thread(void *arg1)
 	free(display);
 	worker->core = spdk_env_get_current_core();
 	worker->thread = spdk_get_thread();
+	worker->seed = spdk_get_ticks() ^ (worker->core << 16 | worker->display.thread);
 	pthread_mutex_lock(&g_workers_lock);
 	g_num_workers++;
 	worker->next = g_workers;
@@ -662,6 +1016,13 @@ _init_thread(void *arg1)
 	worker->stop_poller = SPDK_POLLER_REGISTER(_worker_stop, worker,
 			      g_time_in_sec * 1000000ULL);
 
+	if (g_target_rate) {
+		worker->submit_interval = spdk_max(g_tsc_rate / g_target_rate, 1);
+		worker->next_submit_tsc = spdk_get_ticks();
+		worker->rate_poller = SPDK_POLLER_REGISTER(_worker_rate_poll, worker, 0);
+		return;
+	}
+
 	/* Load up queue depth worth of operations. */
 	for (i = 0; i < g_queue_depth; i++) {
 		task = _get_task(worker);
@@ -670,6 +1031,7 @@ _init_thread(void *arg1)
 			goto error;
 		}
 
+		task->submit_tsc = spdk_get_ticks();
 		_submit_single(worker, task);
 	}
 	return;
@@ -722,28 +1084,24 @@ main(int argc, char **argv)
 {
 	struct spdk_app_opts opts = {};
 	struct worker_thread *worker, *tmp;
+	int opc, i;
 
 	pthread_mutex_init(&g_workers_lock, NULL);
 	spdk_app_opts_init(&opts, sizeof(opts));
 	opts.reactor_mask = "0x1";
-	if (spdk_app_parse_args(argc, argv, &opts, "a:C:o:q:t:yw:P:f:T:", NULL, parse_args,
+	if (spdk_app_parse_args(argc, argv, &opts, "a:C:o:q:t:yw:P:f:T:I:S", NULL, parse_args,
 				usage) != SPDK_APP_PARSE_ARGS_SUCCESS) {
 		g_rc = -1;
 		goto cleanup;
 	}
 
-	if ((g_workload_selection != ACCEL_OPC_COPY) &&
-	    (g_workload_selection != ACCEL_OPC_FILL) &&
-	    (g_workload_selection != ACCEL_OPC_CRC32C) &&
-	    (g_workload_selection != ACCEL_OPC_COPY_CRC32C) &&
-	    (g_workload_selection != ACCEL_OPC_COMPARE) &&
-	    (g_workload_selection != ACCEL_OPC_DUALCAST)) {
+	if (g_num_workloads == 0) {
 		usage();
 		g_rc = -1;
 		goto cleanup;
 	}
 
-	if (g_allocate_depth > 0 && g_queue_depth > g_allocate_depth) {
+	if (g_target_rate == 0 && g_allocate_depth > 0 && g_queue_depth > g_allocate_depth) {
 		fprintf(stdout, "allocate depth must be at least as big as queue depth\n");
 		usage();
 		g_rc = -1;
@@ -754,8 +1112,7 @@ main(int argc, char **argv)
 		g_allocate_depth = g_queue_depth;
 	}
 
-	if ((g_workload_selection == ACCEL_OPC_CRC32C || g_workload_selection == ACCEL_OPC_COPY_CRC32C) &&
-	    g_crc32c_chained_count == 0) {
+	if (_workload_has_vectors() && g_crc32c_chained_count == 0) {
 		usage();
 		g_rc = -1;
 		goto cleanup;
@@ -772,6 +1129,11 @@ main(int argc, char **argv)
 	worker = g_workers;
 	while (worker) {
 		tmp = worker->next;
+		for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+			for (i = 0; i < AP_MAX_ENGINES; i++) {
+				spdk_histogram_data_free(worker->latency[opc][i]);
+			}
+		}
 		free(worker);
 		worker = tmp;
 	}
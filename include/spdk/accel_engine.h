@@ -54,7 +54,11 @@ enum accel_opcode {
 	ACCEL_OPC_COMPARE		= 3,
 	ACCEL_OPC_CRC32C		= 4,
 	ACCEL_OPC_COPY_CRC32C		= 5,
-	ACCEL_OPC_LAST			= 6,
+	ACCEL_OPC_COMPRESS		= 6,
+	ACCEL_OPC_DECOMPRESS		= 7,
+	ACCEL_OPC_ENCRYPT		= 8,
+	ACCEL_OPC_DECRYPT		= 9,
+	ACCEL_OPC_LAST			= 10,
 };
 
 /**
@@ -101,6 +105,18 @@ void spdk_accel_engine_module_finish(void);
  */
 struct spdk_io_channel *spdk_accel_engine_get_io_channel(void);
 
+/**
+ * Get the name of the engine the last operation submitted on a channel was routed to.
+ *
+ * This lets tools attribute the operations they submit to an engine, e.g. to measure
+ * the latency of each engine. It has to be called right after the submission.
+ *
+ * \param ch I/O channel the operation was submitted on.
+ *
+ * \return the engine name, "software" when the operation was not offloaded.
+ */
+const char *spdk_accel_get_last_engine_name(struct spdk_io_channel *ch);
+
 /**
  * Submit a copy request.
  *
@@ -246,6 +262,222 @@ int spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct
 				   uint32_t iovcnt, uint32_t *crc_dst, uint32_t seed,
 				   int flags, spdk_accel_completion_cb cb_fn, void *cb_arg);
 
+/**
+ * Submit a compression request.
+ *
+ * The data is compressed into a raw DEFLATE stream.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs The io vector array to write the compressed data to.
+ * \param dst_iovcnt The size of the destination io vectors.
+ * \param src_iovs The io vector array which stores the src data and len.
+ * \param src_iovcnt The size of the source io vectors.
+ * \param output_size The size of the compressed data, written on success. Optional.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called when this compress operation completes. -ENOSPC is reported
+ * if the compressed data doesn't fit into the destination.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_compress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+			       uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+			       uint32_t *output_size, int flags,
+			       spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a decompression request.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs The io vector array to write the decompressed data to.
+ * \param dst_iovcnt The size of the destination io vectors.
+ * \param src_iovs The io vector array which stores the compressed data and len.
+ * \param src_iovcnt The size of the source io vectors.
+ * \param output_size The size of the decompressed data, written on success. Optional.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called when this decompress operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_decompress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+				 uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+				 uint32_t *output_size, int flags,
+				 spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+struct spdk_accel_crypto_key;
+
+/**
+ * Create an AES-XTS key.
+ *
+ * \param key The data key.
+ * \param key2 The tweak key, which has to differ from the data key.
+ * \param key_size Size of each of the keys in bytes, 16 for AES-128-XTS or 32 for
+ * AES-256-XTS.
+ * \param _key On success, the created key.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_crypto_key_create(const void *key, const void *key2, size_t key_size,
+				 struct spdk_accel_crypto_key **_key);
+
+/**
+ * Destroy a key created by spdk_accel_crypto_key_create().
+ *
+ * The key must not be used by any outstanding operation.
+ *
+ * \param key The key to destroy.
+ */
+void spdk_accel_crypto_key_destroy(struct spdk_accel_crypto_key *key);
+
+/**
+ * Submit an AES-XTS encryption request.
+ *
+ * The data is encrypted in units of block_size bytes.  The tweak of the first unit is
+ * iv and it is incremented by one for each following unit, so passing the LBA of the
+ * first block as iv encrypts each block with its own LBA.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param key The key to encrypt with.
+ * \param dst_iovs The io vector array to write the encrypted data to.  It may be the
+ * same as the source.
+ * \param dst_iovcnt The size of the destination io vectors.
+ * \param src_iovs The io vector array which stores the src data and len.
+ * \param src_iovcnt The size of the source io vectors.
+ * \param iv The tweak of the first block.
+ * \param block_size Size of the encryption unit in bytes.  The source and destination
+ * lengths have to be equal and a multiple of it.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called when this encrypt operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_encrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			      struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			      struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint64_t iv, uint32_t block_size, int flags,
+			      spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit an AES-XTS decryption request.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param key The key to decrypt with.
+ * \param dst_iovs The io vector array to write the decrypted data to.  It may be the
+ * same as the source.
+ * \param dst_iovcnt The size of the destination io vectors.
+ * \param src_iovs The io vector array which stores the encrypted data and len.
+ * \param src_iovcnt The size of the source io vectors.
+ * \param iv The tweak of the first block.
+ * \param block_size Size of the encryption unit in bytes.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called when this decrypt operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_decrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			      struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			      struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint64_t iv, uint32_t block_size, int flags,
+			      spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Opaque handle to a sequence of accel operations.
+ *
+ * The operations of a sequence are executed in the order they were appended and
+ * the sequence completes once, after the last of them.  Adjacent operations may be
+ * merged into a single one where that gives the same result, e.g. a copy followed
+ * by a CRC-32C of the same data is executed as a copy + CRC-32C.
+ */
+struct spdk_accel_sequence;
+
+/**
+ * Append a copy operation to a sequence.
+ *
+ * \param seq Sequence to append the operation to.  If *seq is NULL, a new sequence
+ * is allocated and returned in *seq.
+ * \param ch I/O channel associated with this call.  All operations of a sequence
+ * have to be appended using the same channel.
+ * \param dst Destination to copy to.
+ * \param src Source to copy from.
+ * \param nbytes Length in bytes to copy.
+ * \param flags Accel framework flags for operations.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_copy(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			   void *dst, void *src, uint64_t nbytes, int flags);
+
+/**
+ * Append a fill operation to a sequence.
+ *
+ * \param seq Sequence to append the operation to.  If *seq is NULL, a new sequence
+ * is allocated and returned in *seq.
+ * \param ch I/O channel associated with this call.
+ * \param dst Destination to fill.
+ * \param fill Constant byte to fill to the destination.
+ * \param nbytes Length in bytes to fill.
+ * \param flags Accel framework flags for operations.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_fill(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			   void *dst, uint8_t fill, uint64_t nbytes, int flags);
+
+/**
+ * Append a CRC-32C calculation to a sequence.
+ *
+ * \param seq Sequence to append the operation to.  If *seq is NULL, a new sequence
+ * is allocated and returned in *seq.
+ * \param ch I/O channel associated with this call.
+ * \param crc_dst Destination to write the CRC-32C to.
+ * \param src The source address for the data.
+ * \param seed Four byte seed value.
+ * \param nbytes Length in bytes.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_crc32c(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			     uint32_t *crc_dst, void *src, uint32_t seed, uint64_t nbytes);
+
+/**
+ * Append a chained CRC-32C calculation to a sequence.
+ *
+ * \param seq Sequence to append the operation to.  If *seq is NULL, a new sequence
+ * is allocated and returned in *seq.
+ * \param ch I/O channel associated with this call.
+ * \param crc_dst Destination to write the CRC-32C to.
+ * \param iovs The io vector array which stores the src data and len.
+ * \param iovcnt The size of the iov.
+ * \param seed Four byte seed value.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_crc32cv(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			      uint32_t *crc_dst, struct iovec *iovs, uint32_t iovcnt, uint32_t seed);
+
+/**
+ * Execute the operations of a sequence.
+ *
+ * The sequence is freed once it completes.  If one of the operations fails, the
+ * remaining ones are not executed and the callback is called with its status.
+ *
+ * \param seq Sequence to execute.
+ * \param cb_fn Called when the whole sequence completes.
+ * \param cb_arg Callback argument.
+ */
+void spdk_accel_sequence_finish(struct spdk_accel_sequence *seq,
+				spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Free a sequence without executing any of its operations.
+ *
+ * \param seq Sequence to abort.
+ */
+void spdk_accel_sequence_abort(struct spdk_accel_sequence *seq);
+
 
 struct spdk_json_write_ctx;
 
@@ -131,6 +131,18 @@ bool spdk_bit_pool_is_allocated(const struct spdk_bit_pool *pool, uint32_t bit_i
  */
 uint32_t spdk_bit_pool_allocate_bit(struct spdk_bit_pool *pool);
 
+/**
+ * Allocate a bit from the bit pool, preferring the first free bit at or after
+ * the hint.
+ *
+ * \param pool Bit pool to allocate a bit from
+ * \param hint Index of the bit to start looking for a free bit from. If there is
+ * no free bit at or after it, the lowest free bit is allocated.
+ *
+ * \return index of the allocated bit, UINT32_MAX if no free bits exist
+ */
+uint32_t spdk_bit_pool_allocate_bit_hint(struct spdk_bit_pool *pool, uint32_t hint);
+
 /**
  * Free a bit back to the bit pool.
  *
@@ -69,6 +69,8 @@ extern "C" {
 
 typedef uint64_t spdk_blob_id;
 #define SPDK_BLOBID_INVALID	(uint64_t)-1
+/** Parent id reported for blobs whose clusters are backed by an external snapshot. */
+#define SPDK_BLOBID_EXTERNAL_SNAPSHOT	(SPDK_BLOBID_INVALID - 1)
 #define SPDK_BLOBSTORE_TYPE_LENGTH 16
 
 enum blob_clear_method {
@@ -198,6 +200,25 @@ struct spdk_bs_dev {
 	uint32_t	blocklen; /* In bytes */
 };
 
+/**
+ * Create the read-only device backing an external snapshot clone.
+ *
+ * Called by the blobstore each time a blob created with spdk_blob_opts.esnap_id
+ * is opened. The returned device is used to read clusters the blob has not yet
+ * allocated and is destroyed through its destroy() callback when the blob is closed.
+ *
+ * \param bs_ctx Context passed in spdk_bs_opts.esnap_ctx.
+ * \param blob The blob being opened.
+ * \param esnap_id Identifier of the external snapshot, as passed at creation time.
+ * \param id_len Length of esnap_id in bytes.
+ * \param bs_dev Output parameter for the created device.
+ *
+ * \return 0 on success, negative errno on failure. A failure fails the blob open.
+ */
+typedef int (*spdk_bs_esnap_dev_create)(void *bs_ctx, struct spdk_blob *blob,
+					const void *esnap_id, uint32_t id_len,
+					struct spdk_bs_dev **bs_dev);
+
 struct spdk_bs_type {
 	char bstype[SPDK_BLOBSTORE_TYPE_LENGTH];
 };
@@ -237,6 +258,23 @@ struct spdk_bs_opts {
 
 	/** Force recovery during import. This is a uint64_t for padding reasons, treated as a bool. */
 	uint64_t force_recover;
+
+	/**
+	 * Number of free clusters each channel reserves at once for allocations of thin
+	 * provisioned blobs, and the number of such allocations a channel may have in
+	 * progress. Reserved clusters are not reported by spdk_bs_free_cluster_count()
+	 * and are returned when the channel is freed. 0 disables the reservation.
+	 */
+	uint32_t channel_reserved_clusters;
+
+	/**
+	 * Callback creating the device that backs an external snapshot clone. Blobs
+	 * created with spdk_blob_opts.esnap_id fail to open when it is not set.
+	 */
+	spdk_bs_esnap_dev_create esnap_bs_dev_create;
+
+	/** Context passed to esnap_bs_dev_create. */
+	void *esnap_ctx;
 };
 
 /**
@@ -410,6 +448,26 @@ uint64_t spdk_blob_get_num_io_units(struct spdk_blob *blob);
  */
 uint64_t spdk_blob_get_num_clusters(struct spdk_blob *blob);
 
+struct spdk_blob_fragmentation {
+	/** Number of clusters of the blob that are allocated on disk */
+	uint64_t num_allocated_clusters;
+
+	/**
+	 * Number of extents the allocated clusters form. An extent is a run of clusters
+	 * that are consecutive both in the blob and on disk, so a blob that is not
+	 * fragmented has a single extent for each range of allocated clusters.
+	 */
+	uint64_t num_extents;
+};
+
+/**
+ * Get fragmentation of the clusters allocated to the blob.
+ *
+ * \param blob Blob struct to query.
+ * \param frag Fragmentation of the blob.
+ */
+void spdk_blob_get_fragmentation(struct spdk_blob *blob, struct spdk_blob_fragmentation *frag);
+
 struct spdk_blob_xattr_opts {
 	/* Number of attributes */
 	size_t	count;
@@ -438,6 +496,17 @@ struct spdk_blob_opts {
 	 * New added fields should be put at the end of the struct.
 	 */
 	size_t opts_size;
+
+	/**
+	 * Identifier of an external snapshot. When set, the blob is created thin
+	 * provisioned as a clone of the external snapshot: clusters it has not allocated
+	 * are read from the device returned by spdk_bs_opts.esnap_bs_dev_create, and the
+	 * first write to such a cluster copies it into the blobstore.
+	 */
+	const void *esnap_id;
+
+	/** Length of esnap_id in bytes. */
+	uint64_t esnap_id_len;
 };
 
 /**
@@ -563,6 +632,48 @@ bool spdk_blob_is_snapshot(struct spdk_blob *blob);
  */
 bool spdk_blob_is_clone(struct spdk_blob *blob);
 
+/**
+ * Check if blob is a clone of an external snapshot.
+ *
+ * \param blob Blob.
+ *
+ * \return true if blob is an external snapshot clone.
+ */
+bool spdk_blob_is_esnap_clone(const struct spdk_blob *blob);
+
+/**
+ * Get the identifier of the external snapshot backing a blob.
+ *
+ * \param blob Blob.
+ * \param id Output parameter for the identifier. Owned by the blob.
+ * \param len Output parameter for the length of the identifier in bytes.
+ *
+ * \return 0 on success, -EINVAL if the blob is not an external snapshot clone.
+ */
+int spdk_blob_get_esnap_id(struct spdk_blob *blob, const void **id, size_t *len);
+
+/**
+ * Detach the external snapshot device of an external snapshot clone, e.g. when the
+ * bdev backing it is being removed. The device is destroyed once no channel uses it.
+ * Reads of clusters that are not allocated in the blob, or in its clones, fail with
+ * -EIO afterwards.
+ *
+ * \param blob External snapshot clone.
+ * \param cb_fn Called when the device was destroyed.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_blob_remove_esnap_dev(struct spdk_blob *blob, spdk_blob_op_complete cb_fn,
+				void *cb_arg);
+
+/**
+ * Check if the external snapshot at the end of the snapshot chain of a blob was removed.
+ *
+ * \param blob Blob.
+ *
+ * \return true if unallocated clusters of the blob can no longer be read.
+ */
+bool spdk_blob_is_degraded(struct spdk_blob *blob);
+
 /**
  * Check if blob is thin-provisioned.
  *
@@ -616,6 +727,96 @@ void spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *ch
 void spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
 				  spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Shallow copy progress callback.
+ *
+ * \param copied_clusters Number of clusters copied so far.
+ * \param total_clusters Number of clusters to copy in total.
+ * \param cb_arg Argument passed to function status_cb_fn.
+ */
+typedef void (*spdk_blob_shallow_copy_status)(uint64_t copied_clusters, uint64_t total_clusters,
+		void *cb_arg);
+
+/**
+ * Copy the clusters allocated by a blob to an external device.
+ *
+ * Only clusters allocated in the blob itself are copied, clusters of its
+ * parents and unallocated clusters are skipped. Each cluster is written at
+ * the same offset on ext_dev as it has in the blob. Several clusters are
+ * copied in parallel.
+ *
+ * The blob must be read-only and ext_dev must be at least as large as the
+ * blob, with a block size that divides the cluster size.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to read the blob.
+ * \param blobid The id of the blob.
+ * \param ext_dev The device to copy to. It is not destroyed by this call.
+ * \param status_cb_fn Called each time a cluster has been copied. Optional.
+ * \param status_cb_arg Argument passed to function status_cb_fn.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_blob_shallow_copy(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			       spdk_blob_id blobid, struct spdk_bs_dev *ext_dev,
+			       spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+			       spdk_blob_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Changed clusters callback.
+ *
+ * \param cb_arg Argument passed to function extent_cb_fn.
+ * \param start_cluster First cluster of a range of changed clusters.
+ * \param num_clusters Number of clusters in the range.
+ */
+typedef void (*spdk_blob_changed_clusters_cb)(void *cb_arg, uint64_t start_cluster,
+		uint64_t num_clusters);
+
+/**
+ * Find the clusters of a blob that changed since one of its ancestor snapshots.
+ *
+ * A cluster has changed if it is allocated in the blob or in any snapshot
+ * between the blob and base_id, base_id itself excluded. The changed clusters
+ * are reported as ranges in ascending order through extent_cb_fn, before
+ * cb_fn is called. Clusters copied by inflate or decouple of a blob are
+ * reported as changed as well.
+ *
+ * \param bs blobstore.
+ * \param base_id The id of an ancestor snapshot of the blob, or
+ * SPDK_BLOBID_INVALID to report every cluster allocated in the whole chain.
+ * \param blobid The id of the blob.
+ * \param extent_cb_fn Called for each range of changed clusters.
+ * \param extent_cb_arg Argument passed to function extent_cb_fn.
+ * \param cb_fn Called when the operation is complete. -EINVAL is reported if
+ * base_id is not an ancestor of the blob.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_get_changed_clusters(struct spdk_blob_store *bs, spdk_blob_id base_id,
+				  spdk_blob_id blobid, spdk_blob_changed_clusters_cb extent_cb_fn,
+				  void *extent_cb_arg, spdk_blob_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Release the clusters of a thin provisioned blob that hold the same data as
+ * its backing device.
+ *
+ * Each allocated cluster of the blob is compared with the data the blob would
+ * read from its parent snapshot, external snapshot or zeroes device if the
+ * cluster was not allocated. Identical clusters are released, so that reads
+ * of them are served from the backing device and the data is stored once.
+ * I/O to the blob is frozen, and the I/O already in flight is waited for, while
+ * a batch of clusters is compared. Snapshots cannot be deduplicated, as their
+ * clusters are read by their clones.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to compare the clusters.
+ * \param blobid The id of the blob.
+ * \param cb_fn Called when the operation is complete. -EINVAL is reported if
+ * the blob is not thin provisioned, -EPERM if it is a snapshot.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg);
+
 struct spdk_blob_open_opts {
 	enum blob_clear_method  clear_method;
 
@@ -663,6 +864,8 @@ void spdk_bs_open_blob_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
  * Resize a blob to 'sz' clusters. These changes are not persisted to disk until
  * spdk_bs_md_sync_blob() is called.
  * If called before previous resize finish, it will fail with errno -EBUSY
+ * External snapshot clones cannot grow past the size of their external snapshot,
+ * such resize fails with -EINVAL.
  *
  * \param blob Blob to resize.
  * \param sz The new number of clusters.
@@ -673,6 +876,24 @@ void spdk_bs_open_blob_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
 void spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_fn,
 		      void *cb_arg);
 
+/**
+ * Allocate the unallocated clusters in a range of a thin provisioned blob.
+ *
+ * Clusters are allocated next to each other and to the allocated clusters around
+ * the range where possible, so that the blob stays sequential on disk. The clusters
+ * are zeroed before they are added to the blob and the blob metadata is persisted.
+ * Clusters allocated meanwhile by writes to the blob are kept. Blobs backed by
+ * a snapshot are not supported, use spdk_bs_inflate_blob() for them instead.
+ *
+ * \param blob Blob to allocate clusters of.
+ * \param offset Index of the first cluster of the range.
+ * \param length Number of clusters in the range.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_blob_preallocate(struct spdk_blob *blob, uint64_t offset, uint64_t length,
+			   spdk_blob_op_complete cb_fn, void *cb_arg);
+
 /**
  * Set blob as read only.
  *
@@ -62,6 +62,23 @@ struct spdk_bdev_module;
 int spdk_bdev_create_bs_dev_ext(const char *bdev_name, spdk_bdev_event_cb_t event_cb,
 				void *event_ctx, struct spdk_bs_dev **bs_dev);
 
+/**
+ * Create a read-only blobstore block device from a bdev.
+ *
+ * The bdev is opened without write access. Writes, write zeroes and unmaps
+ * submitted to the device fail with -EPERM. Such devices are suitable as
+ * external snapshots of blobs.
+ *
+ * \param bdev_name Name of the bdev to use.
+ * \param event_cb Called when the bdev triggers asynchronous event.
+ * \param event_ctx Argument passed to function event_cb.
+ * \param bs_dev Output parameter for a pointer to the blobstore block device.
+ *
+ * \return 0 if operation is successful, or suitable errno value otherwise.
+ */
+int spdk_bdev_create_bs_dev_ro(const char *bdev_name, spdk_bdev_event_cb_t event_cb,
+			       void *event_ctx, struct spdk_bs_dev **bs_dev);
+
 /**
  * Claim the bdev module for the given blobstore.
  *
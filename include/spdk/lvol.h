@@ -73,6 +73,20 @@ struct spdk_lvs_opts {
 	uint32_t		cluster_sz;
 	enum lvs_clear_method	clear_method;
 	char			name[SPDK_LVS_NAME_MAX];
+
+	/**
+	 * Number of clusters each I/O channel reserves at once for thin provisioned
+	 * allocations. 0 disables the reservation. Not stored on disk, so it has to
+	 * be passed again every time the lvolstore is loaded.
+	 */
+	uint32_t		channel_reserved_clusters;
+
+	/**
+	 * Creates the device backing an external snapshot clone when it is opened.
+	 * The lvolstore is passed as the bs_ctx argument. Required to open lvolstores
+	 * containing external snapshot clones.
+	 */
+	spdk_bs_esnap_dev_create esnap_bs_dev_create;
 };
 
 /**
@@ -199,6 +213,26 @@ int spdk_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 void spdk_lvol_create_snapshot(struct spdk_lvol *lvol, const char *snapshot_name,
 			       spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
 
+/**
+ * Create a clone of an external snapshot.
+ *
+ * The clone is thin provisioned. Clusters it has not written yet are read from
+ * the device created by spdk_lvs_opts.esnap_bs_dev_create for esnap_id.
+ *
+ * \param esnap_id Identifier of the external snapshot, passed to esnap_bs_dev_create.
+ * \param id_len Length of esnap_id in bytes.
+ * \param size_bytes Size of the clone in bytes, a multiple of the lvolstore cluster size.
+ * \param lvs Handle to lvolstore.
+ * \param clone_name Name of created clone.
+ * \param cb_fn Completion callback.
+ * \param cb_arg Completion callback custom arguments.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_lvol_create_esnap_clone(const void *esnap_id, uint32_t id_len, uint64_t size_bytes,
+				 struct spdk_lvol_store *lvs, const char *clone_name,
+				 spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
+
 /**
  * Create clone of given snapshot.
  *
@@ -265,6 +299,19 @@ struct spdk_io_channel *spdk_lvol_get_io_channel(struct spdk_lvol *lvol);
 void spdk_lvs_load(struct spdk_bs_dev *bs_dev, spdk_lvs_op_with_handle_complete cb_fn,
 		   void *cb_arg);
 
+/**
+ * Load lvolstore from the given blobstore device with options.
+ *
+ * Only esnap_bs_dev_create is used from the options.
+ *
+ * \param bs_dev Pointer to the blobstore device.
+ * \param opts Options for lvolstore, may be NULL.
+ * \param cb_fn Completion callback.
+ * \param cb_arg Completion callback custom arguments.
+ */
+void spdk_lvs_load_ext(struct spdk_bs_dev *bs_dev, const struct spdk_lvs_opts *opts,
+		       spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg);
+
 /**
  * Open a lvol.
  *
@@ -292,6 +339,47 @@ void spdk_lvol_inflate(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void
  */
 void spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Copy the clusters allocated by the lvol itself to an external device
+ *
+ * Clusters that belong to parents of the lvol are not copied. The lvol must
+ * be read-only, e.g. a snapshot.
+ *
+ * \param lvol Handle to lvol
+ * \param ext_dev The device to copy to
+ * \param status_cb_fn Called each time a cluster has been copied, may be NULL
+ * \param status_cb_arg Argument passed to function status_cb_fn
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ */
+void spdk_lvol_shallow_copy(struct spdk_lvol *lvol, struct spdk_bs_dev *ext_dev,
+			    spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+			    spdk_lvol_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Find the clusters of an lvol that changed since one of its ancestor snapshots
+ *
+ * \param base Handle to an ancestor snapshot of lvol, or NULL to report all
+ * clusters allocated in lvol and its ancestors
+ * \param lvol Handle to lvol
+ * \param extent_cb_fn Called for each range of changed clusters, in ascending order
+ * \param extent_cb_arg Argument passed to function extent_cb_fn
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ */
+void spdk_lvol_get_changed_clusters(struct spdk_lvol *base, struct spdk_lvol *lvol,
+				    spdk_blob_changed_clusters_cb extent_cb_fn, void *extent_cb_arg,
+				    spdk_lvol_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Release the clusters of a thin provisioned lvol that hold the same data as its parent
+ *
+ * \param lvol Handle to lvol
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ */
+void spdk_lvol_dedup(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,6 +46,7 @@ extern "C" {
 #endif
 
 #include "spdk/env.h"
+#include "spdk/histogram_data.h"
 #include "spdk/nvme_spec.h"
 #include "spdk/nvmf_spec.h"
 
@@ -513,6 +514,18 @@ struct spdk_nvme_pcie_stat {
 	uint64_t sq_shadow_doorbell_updates;
 };
 
+/**
+ * Doorbell statistics of a single PCIe I/O queue pair.
+ */
+struct spdk_nvme_pcie_qpair_doorbell_stat {
+	uint64_t sq_mmio_doorbell_updates;
+	uint64_t sq_shadow_doorbell_updates;
+	uint64_t cq_mmio_doorbell_updates;
+	uint64_t cq_shadow_doorbell_updates;
+	/* Commands whose submission queue doorbell write was deferred to a later poll. */
+	uint64_t delayed_submissions;
+};
+
 struct spdk_nvme_tcp_stat {
 	uint64_t polls;
 	uint64_t idle_polls;
@@ -534,9 +547,44 @@ struct spdk_nvme_transport_poll_group_stat {
 	};
 };
 
+/**
+ * One of the slowest commands completed on a queue pair with latency tracking enabled.
+ */
+struct spdk_nvme_latency_outlier {
+	/* Ticks between submission to the transport and completion. */
+	uint64_t latency_ticks;
+	/* Starting LBA and number of blocks, or 0 for commands without an LBA range. */
+	uint64_t lba;
+	uint32_t lba_count;
+	uint32_t nsid;
+	uint16_t cid;
+	uint8_t opc;
+	uint8_t sct;
+	uint8_t sc;
+};
+
+struct spdk_nvme_ns_latency_stat {
+	uint32_t nsid;
+	/* Histogram of completion latencies in ticks. */
+	struct spdk_histogram_data *histogram;
+};
+
+struct spdk_nvme_qpair_latency_stat {
+	struct spdk_nvme_qpair *qpair;
+	uint16_t qid;
+	uint32_t num_ns;
+	struct spdk_nvme_ns_latency_stat *ns_stats;
+	/* Sorted from the slowest command. */
+	uint32_t num_outliers;
+	struct spdk_nvme_latency_outlier *outliers;
+};
+
 struct spdk_nvme_poll_group_stat {
 	uint32_t num_transports;
 	struct spdk_nvme_transport_poll_group_stat **transport_stat;
+	/* Only qpairs with latency tracking enabled are reported. */
+	uint32_t num_qpair_latency_stats;
+	struct spdk_nvme_qpair_latency_stat *qpair_latency_stats;
 };
 
 /*
@@ -1564,6 +1612,20 @@ struct spdk_nvme_io_qpair_opts {
 	 * false to create io qpair synchronously.
 	 */
 	bool async_mode;
+
+	/**
+	 * Adaptive doorbell threshold for delay_cmd_submit. If delay_cmd_submit is set
+	 * and this is not zero, the submission queue doorbell is rung immediately while
+	 * fewer than this number of commands were submitted since the last call to
+	 * spdk_nvme_qpair_process_completions(). Commands beyond that are batched and
+	 * the doorbell is rung once in the next spdk_nvme_qpair_process_completions().
+	 *
+	 * This keeps the latency of low queue depth workloads while still saving
+	 * doorbell writes at high queue depth. 0 means all commands are batched.
+	 *
+	 * This only applies to the PCIe transport.
+	 */
+	uint16_t delay_cmd_submit_threshold;
 };
 
 /**
@@ -1827,6 +1889,33 @@ int32_t spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair,
  */
 spdk_nvme_qp_failure_reason spdk_nvme_qpair_get_failure_reason(struct spdk_nvme_qpair *qpair);
 
+/**
+ * Maximum number of slowest commands that can be recorded per queue pair.
+ */
+#define SPDK_NVME_QPAIR_MAX_LATENCY_OUTLIERS	1024
+
+/**
+ * Enable or disable command latency tracking on a queue pair.
+ *
+ * When enabled, the time from submission of each command to the transport until
+ * its completion is recorded into a histogram per namespace, and the slowest
+ * num_outliers commands are kept along with their opcode, LBA range and CID.
+ * The collected data is reported by spdk_nvme_poll_group_get_stats().
+ *
+ * Enabling tracking on a queue pair that already has it enabled discards the
+ * collected data. This function must be called from the thread that owns the
+ * queue pair.
+ *
+ * \param qpair Queue pair to configure.
+ * \param enable true to enable tracking, false to disable it and free its data.
+ * \param num_outliers Number of slowest commands to record. May be 0.
+ *
+ * \return 0 on success, -EINVAL if num_outliers exceeds
+ * SPDK_NVME_QPAIR_MAX_LATENCY_OUTLIERS or -ENOMEM on allocation failure.
+ */
+int spdk_nvme_qpair_set_latency_tracking(struct spdk_nvme_qpair *qpair, bool enable,
+		uint32_t num_outliers);
+
 /**
  * Send the given admin command to the NVMe controller.
  *
@@ -2648,7 +2737,8 @@ int64_t spdk_nvme_poll_group_process_completions(struct spdk_nvme_poll_group *gr
 void *spdk_nvme_poll_group_get_ctx(struct spdk_nvme_poll_group *group);
 
 /**
- * Retrieves transport statistics for the given poll group.
+ * Retrieves transport statistics for the given poll group, along with the
+ * latency data of its queue pairs that have latency tracking enabled.
  *
  * Note: the structure returned by this function should later be freed with
  * @b spdk_nvme_poll_group_free_stats function
@@ -2669,6 +2759,20 @@ int spdk_nvme_poll_group_get_stats(struct spdk_nvme_poll_group *group,
 void spdk_nvme_poll_group_free_stats(struct spdk_nvme_poll_group *group,
 				     struct spdk_nvme_poll_group_stat *stat);
 
+/**
+ * Get the doorbell statistics of a PCIe I/O queue pair.
+ *
+ * Unlike the statistics returned by spdk_nvme_poll_group_get_stats(), these are
+ * kept per queue pair even if the queue pair is added to a poll group.
+ *
+ * \param qpair I/O queue pair of a PCIe or vfio-user controller.
+ * \param stat Statistics to fill in.
+ *
+ * \return 0 on success, -EINVAL if the qpair does not use the PCIe transport.
+ */
+int spdk_nvme_pcie_qpair_get_doorbell_stat(struct spdk_nvme_qpair *qpair,
+		struct spdk_nvme_pcie_qpair_doorbell_stat *stat);
+
 /**
  * Get the identify namespace data as defined by the NVMe specification.
  *
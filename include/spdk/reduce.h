@@ -82,6 +82,15 @@ struct spdk_reduce_vol_params {
 	 *  of the chunk size.
 	 */
 	uint64_t		vol_size;
+
+	/**
+	 * Pack the partial last backing io unit of each compressed chunk
+	 *  into backing io units shared with other chunks, instead of
+	 *  padding every compressed chunk out to whole backing io units.
+	 *  Space left behind in shared io units when chunks are
+	 *  overwritten is reclaimed by spdk_reduce_vol_compact().
+	 */
+	bool			packed;
 };
 
 struct spdk_reduce_vol;
@@ -108,6 +117,10 @@ typedef void (*spdk_reduce_dev_cpl)(void *cb_arg, int reduce_errno);
 struct spdk_reduce_vol_cb_args {
 	spdk_reduce_dev_cpl	cb_fn;
 	void			*cb_arg;
+	/* Filled in by backing devices that report the size of the (de)compressed data
+	 * separately from the completion, e.g. through accel.
+	 */
+	uint32_t		output_size;
 };
 
 struct spdk_reduce_backing_dev {
@@ -151,7 +164,9 @@ const struct spdk_uuid *spdk_reduce_vol_get_uuid(struct spdk_reduce_vol *vol);
  * \param backing_dev Structure describing the backing device to use for the new volume.
  * \param pm_file_dir Directory to use for creation of the persistent memory file to
  *                    use for the new volume.  This function will append the UUID as
- *		      the filename to create in this directory.
+ *		      the filename to create in this directory.  If NULL, no persistent
+ *		      memory file is used - the volume's metadata is kept in DRAM and
+ *		      every update to it is journaled at the end of the backing device.
  * \param cb_fn Callback function to signal completion of the initialization process.
  * \param cb_arg Argument to pass to the callback function.
  */
@@ -202,8 +217,9 @@ void spdk_reduce_vol_destroy(struct spdk_reduce_backing_dev *backing_dev,
 /**
  * Read data from a libreduce compressed volume.
  *
- * This function will only read from logical blocks on the comparessed volume that
- * fall within the same chunk.
+ * Requests spanning several chunks are split at the chunk boundaries and the
+ * chunks are processed concurrently.  The callback is invoked once all of them
+ * have completed.
  *
  * \param vol Volume to read data.
  * \param iov iovec array describing the data to be read
@@ -220,8 +236,9 @@ void spdk_reduce_vol_readv(struct spdk_reduce_vol *vol,
 /**
  * Write data to a libreduce compressed volume.
  *
- * This function will only write to logical blocks on the comparessed volume that
- * fall within the same chunk.
+ * Requests spanning several chunks are split at the chunk boundaries and the
+ * chunks are processed concurrently.  The callback is invoked once all of them
+ * have completed.
  *
  * \param vol Volume to write data.
  * \param iov iovec array describing the data to be written
@@ -235,6 +252,23 @@ void spdk_reduce_vol_writev(struct spdk_reduce_vol *vol,
 			    struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
 			    spdk_reduce_vol_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Reclaim free space in the backing io units shared by compressed chunks of a
+ *  packed volume.
+ *
+ * Chunks whose packed data lives in a shared io unit that is at most half full
+ * are moved into the io unit currently being filled, so that sparsely used
+ * io units can be freed.  Chunks with outstanding I/O are skipped.  When all
+ * of the volume's requests are in use, compaction waits for one to be
+ * completed.  The volume must not be unloaded before cb_fn is called.
+ *
+ * \param vol Volume to compact.  Must have been initialized with params.packed set.
+ * \param cb_fn Callback function to signal completion of the compaction.
+ * \param cb_arg Argument to pass to the callback function.
+ */
+void spdk_reduce_vol_compact(struct spdk_reduce_vol *vol,
+			     spdk_reduce_vol_op_complete cb_fn, void *cb_arg);
+
 /**
  * Get the params structure for a libreduce compressed volume.
  *
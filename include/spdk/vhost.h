@@ -213,6 +213,34 @@ int spdk_vhost_set_coalescing(struct spdk_vhost_dev *vdev, uint32_t delay_base_u
 void spdk_vhost_get_coalescing(struct spdk_vhost_dev *vdev, uint32_t *delay_base_us,
 			       uint32_t *iops_threshold);
 
+/**
+ * Make coalescing adapt the delay of each virtqueue to its load.
+ *
+ * Every virtqueue then picks the delay that lets each event report a few
+ * completions at its current IOPS, up to the delay base set with
+ * spdk_vhost_set_coalescing(), and halves it when delayed events don't
+ * merge completions. Events are only delayed while other requests of the
+ * virtqueue are still in flight, so requests submitted one at a time see
+ * no added latency. Virtqueues below the IOPS threshold are not coalesced.
+ * Coalescing stays disabled while the delay base is 0, adaptive or not.
+ *
+ * \param vdev vhost device.
+ * \param adaptive true to adapt the delay, false to use the formula of
+ * spdk_vhost_set_coalescing().
+ */
+void spdk_vhost_set_adaptive_coalescing(struct spdk_vhost_dev *vdev, bool adaptive);
+
+/**
+ * Check whether coalescing adapts to the load of each virtqueue.
+ *
+ * \see spdk_vhost_set_adaptive_coalescing
+ *
+ * \param vdev vhost device.
+ *
+ * \return true if coalescing is adaptive.
+ */
+bool spdk_vhost_get_adaptive_coalescing(struct spdk_vhost_dev *vdev);
+
 /**
  * Construct an empty vhost SCSI device.  This will create a
  * Unix domain socket together with a vhost-user slave server waiting
@@ -317,6 +345,9 @@ int spdk_vhost_scsi_dev_remove_tgt(struct spdk_vhost_dev *vdev, unsigned scsi_tg
  * \c VIRTIO_BLK_S_IOERR error code.
  * packed_ring this controller supports packed ring if set.
  * packed_ring_recovery
+ * queue_threads number of threads the virtqueues of each session are spread
+ * over, each pinned to one core of \c cpumask. If 0, all virtqueues are polled
+ * on the controller thread.
  *
  * \return 0 on success, negative errno on error.
  */
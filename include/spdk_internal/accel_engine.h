@@ -40,20 +40,60 @@
 #include "spdk/queue.h"
 
 struct spdk_accel_task;
+struct spdk_accel_sequence;
 
 void spdk_accel_task_complete(struct spdk_accel_task *task, int status);
 
-struct accel_io_channel {
+/* Maximum number of hardware engines that can be registered at the same time */
+#define ACCEL_MAX_HW_ENGINES	4
+
+struct accel_engine_channel {
 	struct spdk_accel_engine	*engine;
-	struct spdk_io_channel		*engine_ch;
+	/* NULL if the engine had no channel left for this thread */
+	struct spdk_io_channel		*ch;
+	/* Tasks submitted to the engine and not completed yet */
+	uint32_t			outstanding;
+};
+
+struct accel_opcode_stats {
+	/* Tasks executed by each hardware engine, in registration order */
+	uint64_t			hw_ops[ACCEL_MAX_HW_ENGINES];
+	/* Tasks executed in software */
+	uint64_t			sw_ops;
+	/* Software tasks that would have been offloaded if an engine wasn't saturated */
+	uint64_t			spilled_ops;
+	/* Software tasks that weren't offloaded because of buffers not registered with SPDK */
+	uint64_t			unregistered_ops;
+};
+
+struct accel_io_channel {
+	struct accel_engine_channel	hw_chs[ACCEL_MAX_HW_ENGINES];
+	uint32_t			num_hw_chs;
 	struct spdk_io_channel		*sw_engine_ch;
 	void				*task_pool_base;
 	TAILQ_HEAD(, spdk_accel_task)	task_pool;
+	void				*seq_pool_base;
+	TAILQ_HEAD(, spdk_accel_sequence)	seq_pool;
+	struct accel_opcode_stats	stats[ACCEL_OPC_LAST];
+	/* Engine the last task was routed to, NULL for software */
+	struct spdk_accel_engine	*last_engine;
 };
 
 struct sw_accel_io_channel {
 	struct spdk_poller		*completion_poller;
 	TAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
+	/* ISA-L compression state, allocated on first use */
+	struct sw_accel_isal		*isal;
+	/* AES-XTS cipher state, allocated on first use */
+	struct sw_accel_crypto		*crypto;
+};
+
+struct spdk_accel_crypto_key {
+	/* Unique for each key created, so cached key schedules can be matched */
+	uint64_t			id;
+	size_t				key_size;
+	/* Data key followed by the tweak key, key_size bytes each */
+	uint8_t				key[64];
 };
 
 struct spdk_accel_task {
@@ -70,21 +110,37 @@ struct spdk_accel_task {
 	union {
 		void			*dst;
 		void			*src2;
+		struct {
+			struct iovec		*iovs; /* dst iovs passed by the caller */
+			uint32_t		iovcnt; /* dst iovcnt passed by the caller */
+		} d;
 	};
 	union {
 		void				*dst2;
 		uint32_t			seed;
 		uint64_t			fill_pattern;
+		uint64_t			iv;
+	};
+	union {
+		uint32_t		*crc_dst;
+		uint32_t		*output_size;
+		struct spdk_accel_crypto_key	*crypto_key;
 	};
-	uint32_t			*crc_dst;
+	uint32_t			block_size;
+	/* Engine channel the task was submitted to, NULL when executed in software */
+	struct accel_engine_channel	*hw_ch;
 	enum accel_opcode		op_code;
 	uint64_t			nbytes;
 	int				flags;
 	int				status;
 	TAILQ_ENTRY(spdk_accel_task)	link;
+	/* Used to link the tasks of a sequence */
+	TAILQ_ENTRY(spdk_accel_task)	seq_link;
 };
 
 struct spdk_accel_engine {
+	/* Name used to route opcodes to the engine */
+	const char *name;
 	bool (*supports_opcode)(enum accel_opcode);
 	struct spdk_io_channel *(*get_io_channel)(void);
 	int (*submit_tasks)(struct spdk_io_channel *ch, struct spdk_accel_task *accel_task);
@@ -34,6 +34,7 @@
 #include "spdk/stdinc.h"
 
 #include "spdk_internal/accel_engine.h"
+#include "accel_internal.h"
 
 #include "spdk/env.h"
 #include "spdk/likely.h"
@@ -42,11 +43,25 @@
 #include "spdk/json.h"
 #include "spdk/crc32.h"
 #include "spdk/util.h"
+#include "spdk/endian.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
 
 #ifdef SPDK_CONFIG_PMDK
 #include "libpmem.h"
 #endif
 
+#ifdef SPDK_CONFIG_ISAL
+#include <isa-l/include/igzip_lib.h>
+
+struct sw_accel_isal {
+	struct isal_zstream	stream;
+	struct inflate_state	state;
+	uint8_t			level_buf[ISAL_DEF_LVL1_DEFAULT];
+};
+#endif
+
 /* Accelerator Engine Framework: The following provides a top level
  * generic API for the accelerator functions defined here. Modules,
  * such as the one in /module/accel/ioat, supply the implementation
@@ -56,13 +71,68 @@
 
 #define ALIGN_4K			0x1000
 #define MAX_TASKS_PER_CHANNEL		0x800
+#define MAX_SEQUENCES_PER_CHANNEL	0x400
+#define AES_XTS_TWEAK_SIZE		16
+#define ACCEL_DEFAULT_HW_QUEUE_DEPTH	256
+#define ACCEL_SW_ENGINE_NAME		"software"
+
+struct accel_route {
+	/* Engine the opcode is pinned to, NULL to use any engine supporting it */
+	struct spdk_accel_engine	*engine;
+	/* Name of the pinned engine, kept until the engines have registered */
+	char				engine_name[32];
+	/* Tasks smaller than this are executed in software */
+	uint64_t			min_hw_size;
+	/* Tasks a channel may have outstanding on an engine before spilling over to
+	 * software, 0 for the default */
+	uint32_t			hw_queue_depth;
+};
+
+static const char *g_accel_opcode_names[ACCEL_OPC_LAST] = {
+	[ACCEL_OPC_COPY]	= "copy",
+	[ACCEL_OPC_FILL]	= "fill",
+	[ACCEL_OPC_DUALCAST]	= "dualcast",
+	[ACCEL_OPC_COMPARE]	= "compare",
+	[ACCEL_OPC_CRC32C]	= "crc32c",
+	[ACCEL_OPC_COPY_CRC32C]	= "copy_crc32c",
+	[ACCEL_OPC_COMPRESS]	= "compress",
+	[ACCEL_OPC_DECOMPRESS]	= "decompress",
+	[ACCEL_OPC_ENCRYPT]	= "encrypt",
+	[ACCEL_OPC_DECRYPT]	= "decrypt",
+};
+
+struct sw_accel_crypto {
+	EVP_CIPHER_CTX	*ctx;
+	/* Key and direction the context is currently initialized with */
+	uint64_t	key_id;
+	int		enc;
+	/* Staging for blocks that straddle iovecs */
+	uint8_t		*bounce;
+	uint32_t	bounce_size;
+};
+
+struct spdk_accel_sequence {
+	struct accel_io_channel			*accel_ch;
+	TAILQ_HEAD(, spdk_accel_task)		tasks;
+	spdk_accel_completion_cb		cb_fn;
+	void					*cb_arg;
+	TAILQ_ENTRY(spdk_accel_sequence)	link;
+};
 
 /* Largest context size for all accel modules */
 static size_t g_max_accel_module_size = 0;
 
-static struct spdk_accel_engine *g_hw_accel_engine = NULL;
+static struct spdk_accel_engine *g_hw_accel_engines[ACCEL_MAX_HW_ENGINES];
+static uint32_t g_num_hw_accel_engines = 0;
 static struct spdk_accel_engine *g_sw_accel_engine = NULL;
+static struct accel_route g_accel_routes[ACCEL_OPC_LAST];
+/* Stats of the channels that have been destroyed */
+static struct accel_opcode_stats g_accel_stats[ACCEL_OPC_LAST];
+/* Memory registered with SPDK, i.e. pinned, translated to 1 */
+static struct spdk_mem_map *g_accel_mem_map = NULL;
+static pthread_mutex_t g_accel_stats_lock = PTHREAD_MUTEX_INITIALIZER;
 static struct spdk_accel_module_if *g_accel_engine_module = NULL;
+static uint64_t g_crypto_key_id = 0;
 static spdk_accel_fini_cb g_fini_cb_fn = NULL;
 static void *g_fini_cb_arg = NULL;
 
@@ -77,16 +147,30 @@ static int _sw_accel_compare(void *src1, void *src2, size_t nbytes);
 static void _sw_accel_fill(void *dst, uint8_t fill, size_t nbytes, int flags);
 static void _sw_accel_crc32c(uint32_t *dst, void *src, uint32_t seed, size_t nbytes);
 static void _sw_accel_crc32cv(uint32_t *dst, struct iovec *iov, uint32_t iovcnt, uint32_t seed);
+static int _sw_accel_compress(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task);
+static int _sw_accel_crypto(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task);
+static int _sw_accel_decompress(struct accel_io_channel *accel_ch,
+				struct spdk_accel_task *accel_task);
 
-/* Registration of hw modules (currently supports only 1 at a time) */
+/* Registration of hw modules, each opcode is routed to one of them or to software. */
 void
 spdk_accel_hw_engine_register(struct spdk_accel_engine *accel_engine)
 {
-	if (g_hw_accel_engine == NULL) {
-		g_hw_accel_engine = accel_engine;
-	} else {
-		SPDK_NOTICELOG("Hardware offload engine already enabled\n");
+	uint32_t i;
+
+	for (i = 0; i < g_num_hw_accel_engines; i++) {
+		if (g_hw_accel_engines[i] == accel_engine) {
+			SPDK_NOTICELOG("Hardware offload engine already enabled\n");
+			return;
+		}
 	}
+
+	if (g_num_hw_accel_engines == ACCEL_MAX_HW_ENGINES) {
+		SPDK_ERRLOG("Too many hardware offload engines, not enabling %s\n", accel_engine->name);
+		return;
+	}
+
+	g_hw_accel_engines[g_num_hw_accel_engines++] = accel_engine;
 }
 
 /* Registration of sw modules (currently supports only 1) */
@@ -112,6 +196,200 @@ _is_supported(struct spdk_accel_engine *engine, enum accel_opcode operation)
 	return (engine->supports_opcode(operation));
 }
 
+/* Whether the SW engine can execute an opcode at all, i.e. whether it may take over
+ * the tasks of a saturated hw engine.
+ */
+static bool
+_sw_can_execute(enum accel_opcode opc)
+{
+	switch (opc) {
+	case ACCEL_OPC_COMPRESS:
+	case ACCEL_OPC_DECOMPRESS:
+#ifdef SPDK_CONFIG_ISAL
+		return true;
+#else
+		return false;
+#endif
+	default:
+		return true;
+	}
+}
+
+static int
+accel_mem_map_notify_cb(void *cb_ctx, struct spdk_mem_map *map,
+			enum spdk_mem_map_notify_action action,
+			void *vaddr, size_t size)
+{
+	switch (action) {
+	case SPDK_MEM_MAP_NOTIFY_REGISTER:
+		return spdk_mem_map_set_translation(map, (uint64_t)vaddr, size, 1);
+	case SPDK_MEM_MAP_NOTIFY_UNREGISTER:
+		return spdk_mem_map_clear_translation(map, (uint64_t)vaddr, size);
+	default:
+		return 0;
+	}
+}
+
+static bool
+_buf_is_registered(void *buf, uint64_t len)
+{
+	uint64_t addr = (uint64_t)buf;
+	uint64_t size;
+
+	while (len > 0) {
+		size = len;
+		if (spdk_mem_map_translate(g_accel_mem_map, addr, &size) == 0) {
+			return false;
+		}
+		addr += size;
+		len -= size;
+	}
+
+	return true;
+}
+
+static bool
+_iovs_are_registered(struct iovec *iovs, uint32_t iovcnt)
+{
+	uint32_t i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (!_buf_is_registered(iovs[i].iov_base, iovs[i].iov_len)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Whether all the buffers of a task are registered with SPDK.  Engines access them
+ * by DMA, and pages that aren't pinned can fault on the device, which is much slower
+ * than doing the operation in software.
+ */
+static bool
+_task_bufs_are_registered(struct spdk_accel_task *accel_task, uint64_t nbytes)
+{
+	if (g_accel_mem_map == NULL) {
+		return true;
+	}
+
+	switch (accel_task->op_code) {
+	case ACCEL_OPC_COPY:
+		return _buf_is_registered(accel_task->src, nbytes) &&
+		       _buf_is_registered(accel_task->dst, nbytes);
+	case ACCEL_OPC_FILL:
+		return _buf_is_registered(accel_task->dst, nbytes);
+	case ACCEL_OPC_DUALCAST:
+		return _buf_is_registered(accel_task->src, nbytes) &&
+		       _buf_is_registered(accel_task->dst, nbytes) &&
+		       _buf_is_registered(accel_task->dst2, nbytes);
+	case ACCEL_OPC_COMPARE:
+		return _buf_is_registered(accel_task->src, nbytes) &&
+		       _buf_is_registered(accel_task->src2, nbytes);
+	case ACCEL_OPC_CRC32C:
+		if (accel_task->v.iovcnt == 0) {
+			return _buf_is_registered(accel_task->src, nbytes);
+		}
+		return _iovs_are_registered(accel_task->v.iovs, accel_task->v.iovcnt);
+	case ACCEL_OPC_COPY_CRC32C:
+		if (accel_task->v.iovcnt == 0) {
+			return _buf_is_registered(accel_task->src, nbytes) &&
+			       _buf_is_registered(accel_task->dst, nbytes);
+		}
+		return _iovs_are_registered(accel_task->v.iovs, accel_task->v.iovcnt) &&
+		       _buf_is_registered(accel_task->dst, nbytes);
+	case ACCEL_OPC_COMPRESS:
+	case ACCEL_OPC_DECOMPRESS:
+	case ACCEL_OPC_ENCRYPT:
+	case ACCEL_OPC_DECRYPT:
+		return _iovs_are_registered(accel_task->v.iovs, accel_task->v.iovcnt) &&
+		       _iovs_are_registered(accel_task->d.iovs, accel_task->d.iovcnt);
+	default:
+		return true;
+	}
+}
+
+/* Pick the hw engine channel a task is offloaded to, or NULL to execute it in software.
+ * Engines are tried in registration order, skipping the ones that already have as many
+ * tasks outstanding on this channel as the route allows, so the load spreads over all
+ * engines supporting the opcode before it spills over to software.  Tasks with buffers
+ * that aren't registered with SPDK are executed in software.
+ */
+static struct accel_engine_channel *
+_select_engine(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task,
+	       uint64_t nbytes)
+{
+	enum accel_opcode opc = accel_task->op_code;
+	struct accel_route *route = &g_accel_routes[opc];
+	struct accel_opcode_stats *stats = &accel_ch->stats[opc];
+	struct accel_engine_channel *hw_ch;
+	uint32_t i, queue_depth;
+	bool saturated = false;
+
+	accel_ch->last_engine = NULL;
+	if ((route->engine != NULL && route->engine == g_sw_accel_engine) ||
+	    nbytes < route->min_hw_size) {
+		stats->sw_ops++;
+		return NULL;
+	}
+
+	queue_depth = route->hw_queue_depth ? route->hw_queue_depth : ACCEL_DEFAULT_HW_QUEUE_DEPTH;
+	for (i = 0; i < accel_ch->num_hw_chs; i++) {
+		hw_ch = &accel_ch->hw_chs[i];
+		if (hw_ch->ch == NULL || (route->engine != NULL && route->engine != hw_ch->engine) ||
+		    !_is_supported(hw_ch->engine, opc)) {
+			continue;
+		}
+		if (hw_ch->outstanding >= queue_depth && _sw_can_execute(opc)) {
+			saturated = true;
+			continue;
+		}
+		if (_sw_can_execute(opc) && !_task_bufs_are_registered(accel_task, nbytes)) {
+			stats->sw_ops++;
+			stats->unregistered_ops++;
+			return NULL;
+		}
+		stats->hw_ops[i]++;
+		accel_ch->last_engine = hw_ch->engine;
+		return hw_ch;
+	}
+
+	stats->sw_ops++;
+	if (saturated) {
+		stats->spilled_ops++;
+	}
+	return NULL;
+}
+
+static int
+_submit_hw(struct accel_engine_channel *hw_ch, struct spdk_accel_task *accel_task)
+{
+	int rc;
+
+	accel_task->hw_ch = hw_ch;
+	hw_ch->outstanding++;
+	rc = hw_ch->engine->submit_tasks(hw_ch->ch, accel_task);
+	if (rc != 0) {
+		hw_ch->outstanding--;
+		accel_task->hw_ch = NULL;
+	}
+
+	return rc;
+}
+
+static uint64_t
+_get_iovs_len(struct iovec *iovs, uint32_t iovcnt)
+{
+	uint64_t len = 0;
+	uint32_t i;
+
+	for (i = 0; i < iovcnt; i++) {
+		len += iovs[i].iov_len;
+	}
+
+	return len;
+}
+
 void
 spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 {
@@ -119,6 +397,12 @@ spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 	spdk_accel_completion_cb	cb_fn = accel_task->cb_fn;
 	void				*cb_arg = accel_task->cb_arg;
 
+	if (accel_task->hw_ch != NULL) {
+		assert(accel_task->hw_ch->outstanding > 0);
+		accel_task->hw_ch->outstanding--;
+		accel_task->hw_ch = NULL;
+	}
+
 	/* We should put the accel_task into the list firstly in order to avoid
 	 * the accel task list is exhausted when there is recursive call to
 	 * allocate accel_task in user's call back function (cb_fn)
@@ -145,6 +429,7 @@ _get_task(struct accel_io_channel *accel_ch, spdk_accel_completion_cb cb_fn, voi
 	accel_task->cb_fn = cb_fn;
 	accel_task->cb_arg = cb_arg;
 	accel_task->accel_ch = accel_ch;
+	accel_task->hw_ch = NULL;
 
 	return accel_task;
 }
@@ -181,6 +466,7 @@ spdk_accel_submit_copy(struct spdk_io_channel *ch, void *dst, void *src, uint64_
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 	int rc;
 
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
@@ -194,8 +480,9 @@ spdk_accel_submit_copy(struct spdk_io_channel *ch, void *dst, void *src, uint64_
 	accel_task->nbytes = nbytes;
 	accel_task->flags = flags;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_COPY)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		rc = _check_flags(flags);
 		if (rc) {
@@ -214,6 +501,7 @@ spdk_accel_submit_dualcast(struct spdk_io_channel *ch, void *dst1, void *dst2, v
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 	int rc;
 
 	if ((uintptr_t)dst1 & (ALIGN_4K - 1) || (uintptr_t)dst2 & (ALIGN_4K - 1)) {
@@ -233,8 +521,9 @@ spdk_accel_submit_dualcast(struct spdk_io_channel *ch, void *dst1, void *dst2, v
 	accel_task->flags = flags;
 	accel_task->op_code = ACCEL_OPC_DUALCAST;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_DUALCAST)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		rc = _check_flags(flags);
 		if (rc) {
@@ -253,6 +542,7 @@ spdk_accel_submit_compare(struct spdk_io_channel *ch, void *src1, void *src2, ui
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 	int rc;
 
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
@@ -265,8 +555,9 @@ spdk_accel_submit_compare(struct spdk_io_channel *ch, void *src1, void *src2, ui
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPC_COMPARE;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_COMPARE)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		rc = _sw_accel_compare(src1, src2, (size_t)nbytes);
 		_add_to_comp_list(accel_ch, accel_task, rc);
@@ -281,6 +572,7 @@ spdk_accel_submit_fill(struct spdk_io_channel *ch, void *dst, uint8_t fill, uint
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 	int rc;
 
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
@@ -294,8 +586,9 @@ spdk_accel_submit_fill(struct spdk_io_channel *ch, void *dst, uint8_t fill, uint
 	accel_task->flags = flags;
 	accel_task->op_code = ACCEL_OPC_FILL;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_FILL)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		rc = _check_flags(flags);
 		if (rc) {
@@ -314,6 +607,7 @@ spdk_accel_submit_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst, void *sr
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
 	if (accel_task == NULL) {
@@ -327,8 +621,9 @@ spdk_accel_submit_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst, void *sr
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPC_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_CRC32C)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		_sw_accel_crc32c(crc_dst, src, seed, (size_t)nbytes);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -343,6 +638,7 @@ spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct
 {
 	struct accel_io_channel *accel_ch;
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 
 	if (iov == NULL) {
 		SPDK_ERRLOG("iov should not be NULL");
@@ -368,8 +664,9 @@ spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct
 	accel_task->seed = seed;
 	accel_task->op_code = ACCEL_OPC_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_CRC32C)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, _get_iovs_len(iov, iov_cnt));
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		_sw_accel_crc32cv(crc_dst, iov, iov_cnt, seed);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -385,6 +682,7 @@ spdk_accel_submit_copy_crc32c(struct spdk_io_channel *ch, void *dst, void *src,
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 	int rc;
 
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
@@ -401,8 +699,9 @@ spdk_accel_submit_copy_crc32c(struct spdk_io_channel *ch, void *dst, void *src,
 	accel_task->flags = flags;
 	accel_task->op_code = ACCEL_OPC_COPY_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_COPY_CRC32C)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		rc = _check_flags(flags);
 		if (rc) {
@@ -423,6 +722,7 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iov
 {
 	struct accel_io_channel *accel_ch;
 	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
 	int rc;
 
 	if (src_iovs == NULL) {
@@ -451,8 +751,9 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iov
 	accel_task->flags = flags;
 	accel_task->op_code = ACCEL_OPC_COPY_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_OPC_COPY_CRC32C)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	hw_ch = _select_engine(accel_ch, accel_task, _get_iovs_len(src_iovs, iov_cnt));
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	} else {
 		rc = _check_flags(flags);
 		if (rc) {
@@ -465,185 +766,993 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iov
 	}
 }
 
-/* Helper function when when accel modules register with the framework. */
-void spdk_accel_module_list_add(struct spdk_accel_module_if *accel_module)
-{
-	TAILQ_INSERT_TAIL(&spdk_accel_module_list, accel_module, tailq);
-	if (accel_module->get_ctx_size && accel_module->get_ctx_size() > g_max_accel_module_size) {
-		g_max_accel_module_size = accel_module->get_ctx_size();
-	}
-}
-
-/* Framework level channel create callback. */
 static int
-accel_engine_create_cb(void *io_device, void *ctx_buf)
+_accel_submit_compress_op(struct spdk_io_channel *ch, enum accel_opcode op_code,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size,
+			  int flags, spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	struct accel_io_channel	*accel_ch = ctx_buf;
+	struct accel_io_channel *accel_ch;
 	struct spdk_accel_task *accel_task;
-	uint8_t *task_mem;
-	int i;
+	struct accel_engine_channel *hw_ch;
+	int rc;
 
-	accel_ch->task_pool_base = calloc(MAX_TASKS_PER_CHANNEL, g_max_accel_module_size);
-	if (accel_ch->task_pool_base == NULL) {
-		return -ENOMEM;
+	if (dst_iovs == NULL || dst_iovcnt == 0 || src_iovs == NULL || src_iovcnt == 0) {
+		SPDK_ERRLOG("iovs should not be NULL or empty\n");
+		return -EINVAL;
 	}
 
-	TAILQ_INIT(&accel_ch->task_pool);
-	task_mem = accel_ch->task_pool_base;
-	for (i = 0 ; i < MAX_TASKS_PER_CHANNEL; i++) {
-		accel_task = (struct spdk_accel_task *)task_mem;
-		TAILQ_INSERT_TAIL(&accel_ch->task_pool, accel_task, link);
-		task_mem += g_max_accel_module_size;
+	accel_ch = spdk_io_channel_get_ctx(ch);
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
 	}
 
-	/* Set sw engine channel for operations where hw engine does not support. */
-	accel_ch->sw_engine_ch = g_sw_accel_engine->get_io_channel();
-	assert(accel_ch->sw_engine_ch != NULL);
+	accel_task->v.iovs = src_iovs;
+	accel_task->v.iovcnt = src_iovcnt;
+	accel_task->d.iovs = dst_iovs;
+	accel_task->d.iovcnt = dst_iovcnt;
+	accel_task->output_size = output_size;
+	accel_task->flags = flags;
+	accel_task->op_code = op_code;
 
-	if (g_hw_accel_engine != NULL) {
-		accel_ch->engine_ch = g_hw_accel_engine->get_io_channel();
-		accel_ch->engine = g_hw_accel_engine;
-	} else {
-		/* No hw engine enabled, use sw. */
-		accel_ch->engine_ch = accel_ch->sw_engine_ch;
-		accel_ch->engine = g_sw_accel_engine;
+	hw_ch = _select_engine(accel_ch, accel_task, _get_iovs_len(src_iovs, src_iovcnt));
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
 	}
-	assert(accel_ch->engine_ch != NULL);
 
+	if (op_code == ACCEL_OPC_COMPRESS) {
+		rc = _sw_accel_compress(accel_ch, accel_task);
+	} else {
+		rc = _sw_accel_decompress(accel_ch, accel_task);
+	}
+	if (rc == -ENOTSUP) {
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, accel_task, link);
+		return rc;
+	}
+	_add_to_comp_list(accel_ch, accel_task, rc);
 	return 0;
 }
 
-/* Framework level channel destroy callback. */
-static void
-accel_engine_destroy_cb(void *io_device, void *ctx_buf)
+/* Accel framework public API for compress function */
+int
+spdk_accel_submit_compress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+			   uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+			   uint32_t *output_size, int flags,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	struct accel_io_channel	*accel_ch = ctx_buf;
-
-	if (accel_ch->sw_engine_ch != accel_ch->engine_ch) {
-		spdk_put_io_channel(accel_ch->sw_engine_ch);
-	}
-	spdk_put_io_channel(accel_ch->engine_ch);
-	free(accel_ch->task_pool_base);
+	return _accel_submit_compress_op(ch, ACCEL_OPC_COMPRESS, dst_iovs, dst_iovcnt,
+					 src_iovs, src_iovcnt, output_size, flags, cb_fn, cb_arg);
 }
 
-struct spdk_io_channel *
-spdk_accel_engine_get_io_channel(void)
+/* Accel framework public API for decompress function */
+int
+spdk_accel_submit_decompress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+			     uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+			     uint32_t *output_size, int flags,
+			     spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	return spdk_get_io_channel(&spdk_accel_module_list);
+	return _accel_submit_compress_op(ch, ACCEL_OPC_DECOMPRESS, dst_iovs, dst_iovcnt,
+					 src_iovs, src_iovcnt, output_size, flags, cb_fn, cb_arg);
 }
 
-static void
-accel_engine_module_initialize(void)
+int
+spdk_accel_crypto_key_create(const void *key, const void *key2, size_t key_size,
+			     struct spdk_accel_crypto_key **_key)
 {
-	struct spdk_accel_module_if *accel_engine_module;
+	struct spdk_accel_crypto_key *crypto_key;
 
-	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
-		accel_engine_module->module_init();
+	if (key == NULL || key2 == NULL || _key == NULL) {
+		return -EINVAL;
 	}
-}
 
-int
-spdk_accel_engine_initialize(void)
-{
-	SPDK_NOTICELOG("Accel engine initialized to use software engine.\n");
-	accel_engine_module_initialize();
+	if (key_size != 16 && key_size != 32) {
+		SPDK_ERRLOG("Unsupported AES-XTS key size %zu\n", key_size);
+		return -EINVAL;
+	}
 
-	/*
-	 * We need a unique identifier for the accel engine framework, so use the
-	 *  spdk_accel_module_list address for this purpose.
-	 */
-	spdk_io_device_register(&spdk_accel_module_list, accel_engine_create_cb, accel_engine_destroy_cb,
-				sizeof(struct accel_io_channel), "accel_module");
+	/* XTS is only secure when the data and tweak keys are different. */
+	if (memcmp(key, key2, key_size) == 0) {
+		SPDK_ERRLOG("AES-XTS data and tweak keys must not be identical\n");
+		return -EINVAL;
+	}
+
+	crypto_key = calloc(1, sizeof(*crypto_key));
+	if (crypto_key == NULL) {
+		return -ENOMEM;
+	}
 
+	crypto_key->id = __atomic_add_fetch(&g_crypto_key_id, 1, __ATOMIC_RELAXED);
+	crypto_key->key_size = key_size;
+	memcpy(crypto_key->key, key, key_size);
+	memcpy(crypto_key->key + key_size, key2, key_size);
+
+	*_key = crypto_key;
 	return 0;
 }
 
-static void
-accel_engine_module_finish_cb(void)
+void
+spdk_accel_crypto_key_destroy(struct spdk_accel_crypto_key *key)
 {
-	spdk_accel_fini_cb cb_fn = g_fini_cb_fn;
+	if (key == NULL) {
+		return;
+	}
 
-	cb_fn(g_fini_cb_arg);
-	g_fini_cb_fn = NULL;
-	g_fini_cb_arg = NULL;
+	OPENSSL_cleanse(key->key, sizeof(key->key));
+	free(key);
 }
 
-void
-spdk_accel_write_config_json(struct spdk_json_write_ctx *w)
+static int
+_accel_submit_crypto_op(struct spdk_io_channel *ch, enum accel_opcode op_code,
+			struct spdk_accel_crypto_key *key,
+			struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			struct iovec *src_iovs, uint32_t src_iovcnt,
+			uint64_t iv, uint32_t block_size, int flags,
+			spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	struct spdk_accel_module_if *accel_engine_module;
+	struct accel_io_channel *accel_ch;
+	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
+	uint64_t nbytes;
+	int rc;
 
-	/*
-	 * The accel fw has no config, there may be some in
-	 * the engines/modules though.
-	 */
-	spdk_json_write_array_begin(w);
-	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
-		if (accel_engine_module->write_config_json) {
-			accel_engine_module->write_config_json(w);
-		}
+	if (key == NULL || dst_iovs == NULL || dst_iovcnt == 0 ||
+	    src_iovs == NULL || src_iovcnt == 0) {
+		SPDK_ERRLOG("key and iovs should not be NULL or empty\n");
+		return -EINVAL;
 	}
-	spdk_json_write_array_end(w);
-}
 
-void
-spdk_accel_engine_module_finish(void)
-{
-	if (!g_accel_engine_module) {
-		g_accel_engine_module = TAILQ_FIRST(&spdk_accel_module_list);
-	} else {
-		g_accel_engine_module = TAILQ_NEXT(g_accel_engine_module, tailq);
+	/* AES-XTS needs at least one full AES block per data unit. */
+	if (block_size < AES_XTS_TWEAK_SIZE) {
+		SPDK_ERRLOG("Invalid crypto block size %u\n", block_size);
+		return -EINVAL;
 	}
 
-	if (!g_accel_engine_module) {
-		accel_engine_module_finish_cb();
-		return;
+	nbytes = _get_iovs_len(src_iovs, src_iovcnt);
+	if (nbytes == 0 || nbytes % block_size != 0 ||
+	    nbytes != _get_iovs_len(dst_iovs, dst_iovcnt)) {
+		SPDK_ERRLOG("Crypto buffers must be equal multiples of the block size\n");
+		return -EINVAL;
 	}
 
-	if (g_accel_engine_module->module_fini) {
-		spdk_thread_send_msg(spdk_get_thread(), g_accel_engine_module->module_fini, NULL);
-	} else {
-		spdk_accel_engine_module_finish();
+	accel_ch = spdk_io_channel_get_ctx(ch);
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
 	}
-}
 
-void
-spdk_accel_engine_finish(spdk_accel_fini_cb cb_fn, void *cb_arg)
-{
-	assert(cb_fn != NULL);
+	accel_task->v.iovs = src_iovs;
+	accel_task->v.iovcnt = src_iovcnt;
+	accel_task->d.iovs = dst_iovs;
+	accel_task->d.iovcnt = dst_iovcnt;
+	accel_task->crypto_key = key;
+	accel_task->iv = iv;
+	accel_task->block_size = block_size;
+	accel_task->nbytes = nbytes;
+	accel_task->flags = flags;
+	accel_task->op_code = op_code;
 
-	g_fini_cb_fn = cb_fn;
-	g_fini_cb_arg = cb_arg;
+	hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+	if (hw_ch != NULL) {
+		return _submit_hw(hw_ch, accel_task);
+	}
 
-	spdk_io_device_unregister(&spdk_accel_module_list, NULL);
-	spdk_accel_engine_module_finish();
+	rc = _sw_accel_crypto(accel_ch, accel_task);
+	_add_to_comp_list(accel_ch, accel_task, rc);
+	return 0;
 }
 
-/*
- * The SW Accelerator module is "built in" here (rest of file)
- */
-static bool
-sw_accel_supports_opcode(enum accel_opcode opc)
+/* Accel framework public API for AES-XTS encrypt function */
+int
+spdk_accel_submit_encrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	return false;
+	return _accel_submit_crypto_op(ch, ACCEL_OPC_ENCRYPT, key, dst_iovs, dst_iovcnt,
+				       src_iovs, src_iovcnt, iv, block_size, flags, cb_fn, cb_arg);
 }
 
-static inline void
-_pmem_memcpy(void *dst, const void *src, size_t len)
+/* Accel framework public API for AES-XTS decrypt function */
+int
+spdk_accel_submit_decrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-#ifdef SPDK_CONFIG_PMDK
-	int is_pmem = pmem_is_pmem(dst, len);
-
-	if (is_pmem) {
-		pmem_memcpy_persist(dst, src, len);
-	} else {
-		memcpy(dst, src, len);
-		pmem_msync(dst, len);
-	}
-#else
-	SPDK_ERRLOG("Function not defined without SPDK_CONFIG_PMDK enabled.\n");
-	assert(0);
-#endif
+	return _accel_submit_crypto_op(ch, ACCEL_OPC_DECRYPT, key, dst_iovs, dst_iovcnt,
+				       src_iovs, src_iovcnt, iv, block_size, flags, cb_fn, cb_arg);
+}
+
+static struct spdk_accel_task *
+accel_sequence_get_task(struct accel_io_channel *accel_ch, struct spdk_accel_sequence **pseq)
+{
+	struct spdk_accel_sequence *seq = *pseq;
+	struct spdk_accel_task *accel_task;
+
+	if (seq == NULL) {
+		seq = TAILQ_FIRST(&accel_ch->seq_pool);
+		if (seq == NULL) {
+			return NULL;
+		}
+		TAILQ_REMOVE(&accel_ch->seq_pool, seq, link);
+		TAILQ_INIT(&seq->tasks);
+		seq->accel_ch = accel_ch;
+		seq->cb_fn = NULL;
+		seq->cb_arg = NULL;
+	}
+	assert(seq->accel_ch == accel_ch);
+
+	accel_task = _get_task(accel_ch, NULL, NULL);
+	if (accel_task == NULL) {
+		if (*pseq == NULL) {
+			TAILQ_INSERT_HEAD(&accel_ch->seq_pool, seq, link);
+		}
+		return NULL;
+	}
+
+	accel_task->flags = 0;
+	TAILQ_INSERT_TAIL(&seq->tasks, accel_task, seq_link);
+	*pseq = seq;
+
+	return accel_task;
+}
+
+/* Accel framework public API for appending a copy to a sequence */
+int
+spdk_accel_append_copy(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+		       void *dst, void *src, uint64_t nbytes, int flags)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = accel_sequence_get_task(accel_ch, seq);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->dst = dst;
+	accel_task->src = src;
+	accel_task->op_code = ACCEL_OPC_COPY;
+	accel_task->nbytes = nbytes;
+	accel_task->flags = flags;
+
+	return 0;
+}
+
+/* Accel framework public API for appending a fill to a sequence */
+int
+spdk_accel_append_fill(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+		       void *dst, uint8_t fill, uint64_t nbytes, int flags)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = accel_sequence_get_task(accel_ch, seq);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->dst = dst;
+	memset(&accel_task->fill_pattern, fill, sizeof(uint64_t));
+	accel_task->op_code = ACCEL_OPC_FILL;
+	accel_task->nbytes = nbytes;
+	accel_task->flags = flags;
+
+	return 0;
+}
+
+/* Accel framework public API for appending a CRC-32C to a sequence */
+int
+spdk_accel_append_crc32c(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			 uint32_t *crc_dst, void *src, uint32_t seed, uint64_t nbytes)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = accel_sequence_get_task(accel_ch, seq);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->crc_dst = crc_dst;
+	accel_task->src = src;
+	accel_task->v.iovcnt = 0;
+	accel_task->seed = seed;
+	accel_task->nbytes = nbytes;
+	accel_task->op_code = ACCEL_OPC_CRC32C;
+
+	return 0;
+}
+
+/* Accel framework public API for appending a chained CRC-32C to a sequence */
+int
+spdk_accel_append_crc32cv(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			  uint32_t *crc_dst, struct iovec *iovs, uint32_t iovcnt, uint32_t seed)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	if (iovs == NULL || iovcnt == 0) {
+		SPDK_ERRLOG("iovs should not be NULL or empty\n");
+		return -EINVAL;
+	}
+
+	accel_task = accel_sequence_get_task(accel_ch, seq);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->crc_dst = crc_dst;
+	accel_task->v.iovs = iovs;
+	accel_task->v.iovcnt = iovcnt;
+	accel_task->seed = seed;
+	accel_task->op_code = ACCEL_OPC_CRC32C;
+
+	return 0;
+}
+
+static void
+accel_sequence_put_tasks(struct spdk_accel_sequence *seq)
+{
+	struct accel_io_channel *accel_ch = seq->accel_ch;
+	struct spdk_accel_task *accel_task;
+
+	while ((accel_task = TAILQ_FIRST(&seq->tasks)) != NULL) {
+		TAILQ_REMOVE(&seq->tasks, accel_task, seq_link);
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, accel_task, link);
+	}
+}
+
+void
+spdk_accel_sequence_abort(struct spdk_accel_sequence *seq)
+{
+	if (seq == NULL) {
+		return;
+	}
+
+	accel_sequence_put_tasks(seq);
+	TAILQ_INSERT_HEAD(&seq->accel_ch->seq_pool, seq, link);
+}
+
+static void
+accel_sequence_complete(struct spdk_accel_sequence *seq, int status)
+{
+	spdk_accel_completion_cb cb_fn = seq->cb_fn;
+	void *cb_arg = seq->cb_arg;
+
+	/* Same as for tasks, put the sequence back first so that the callback can reuse it. */
+	spdk_accel_sequence_abort(seq);
+
+	cb_fn(cb_arg, status);
+}
+
+/* Merge a copy and a CRC-32C of the same data that directly follows it into a single
+ * copy + CRC-32C.  This saves a pass over the data and a completion.
+ */
+static void
+accel_sequence_merge(struct spdk_accel_sequence *seq)
+{
+	struct accel_io_channel *accel_ch = seq->accel_ch;
+	struct spdk_accel_task *task, *next;
+
+	TAILQ_FOREACH(task, &seq->tasks, seq_link) {
+		next = TAILQ_NEXT(task, seq_link);
+		if (next == NULL) {
+			break;
+		}
+		if (task->op_code != ACCEL_OPC_COPY || next->op_code != ACCEL_OPC_CRC32C ||
+		    next->v.iovcnt != 0 || next->nbytes != task->nbytes ||
+		    (next->src != task->src && next->src != task->dst)) {
+			continue;
+		}
+
+		task->op_code = ACCEL_OPC_COPY_CRC32C;
+		task->crc_dst = next->crc_dst;
+		task->seed = next->seed;
+		task->v.iovcnt = 0;
+
+		TAILQ_REMOVE(&seq->tasks, next, seq_link);
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, next, link);
+	}
+}
+
+/* Execute a task with the SW engine, returning its status. */
+static int
+_sw_accel_execute(struct spdk_accel_task *accel_task)
+{
+	int rc;
+
+	switch (accel_task->op_code) {
+	case ACCEL_OPC_COPY:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
+			_sw_accel_copy(accel_task->dst, accel_task->src, (size_t)accel_task->nbytes,
+				       accel_task->flags);
+		}
+		return rc;
+	case ACCEL_OPC_FILL:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
+			_sw_accel_fill(accel_task->dst, (uint8_t)accel_task->fill_pattern,
+				       (size_t)accel_task->nbytes, accel_task->flags);
+		}
+		return rc;
+	case ACCEL_OPC_CRC32C:
+		if (accel_task->v.iovcnt == 0) {
+			_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed,
+					 (size_t)accel_task->nbytes);
+		} else {
+			_sw_accel_crc32cv(accel_task->crc_dst, accel_task->v.iovs, accel_task->v.iovcnt,
+					  accel_task->seed);
+		}
+		return 0;
+	case ACCEL_OPC_COPY_CRC32C:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
+			_sw_accel_copy(accel_task->dst, accel_task->src, (size_t)accel_task->nbytes,
+				       accel_task->flags);
+			_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed,
+					 (size_t)accel_task->nbytes);
+		}
+		return rc;
+	default:
+		assert(0);
+		return -EINVAL;
+	}
+}
+
+static void accel_sequence_process(struct spdk_accel_sequence *seq);
+
+static void
+accel_sequence_task_cpl(void *cb_arg, int status)
+{
+	struct spdk_accel_sequence *seq = cb_arg;
+
+	if (status != 0 || TAILQ_EMPTY(&seq->tasks)) {
+		accel_sequence_complete(seq, status);
+		return;
+	}
+
+	accel_sequence_process(seq);
+}
+
+/* Run the tasks of a sequence in order.  Tasks the engine supports are submitted to it
+ * and the sequence continues from their completion.  The others are executed in place,
+ * one after the other, and only the last of them is completed through the SW engine's
+ * completion list, so that the sequence never completes on the caller's stack.
+ */
+static void
+accel_sequence_process(struct spdk_accel_sequence *seq)
+{
+	struct accel_io_channel *accel_ch = seq->accel_ch;
+	struct spdk_accel_task *accel_task;
+	struct accel_engine_channel *hw_ch;
+	struct accel_opcode_stats *stats;
+	uint64_t nbytes;
+	int rc;
+
+	while ((accel_task = TAILQ_FIRST(&seq->tasks)) != NULL) {
+		TAILQ_REMOVE(&seq->tasks, accel_task, seq_link);
+		accel_task->cb_fn = accel_sequence_task_cpl;
+		accel_task->cb_arg = seq;
+
+		nbytes = accel_task->nbytes;
+		if (accel_task->op_code == ACCEL_OPC_CRC32C && accel_task->v.iovcnt != 0) {
+			nbytes = _get_iovs_len(accel_task->v.iovs, accel_task->v.iovcnt);
+		}
+
+		hw_ch = _select_engine(accel_ch, accel_task, nbytes);
+		if (hw_ch != NULL) {
+			rc = _submit_hw(hw_ch, accel_task);
+			if (rc == 0) {
+				return;
+			}
+			if (!_sw_can_execute(accel_task->op_code)) {
+				_add_to_comp_list(accel_ch, accel_task, rc);
+				return;
+			}
+
+			/* The engine couldn't take the task, e.g. its ring is full.  Execute it in
+			 * software rather than fail the steps of the sequence already done.
+			 */
+			stats = &accel_ch->stats[accel_task->op_code];
+			stats->hw_ops[hw_ch - accel_ch->hw_chs]--;
+			stats->sw_ops++;
+			stats->spilled_ops++;
+			accel_ch->last_engine = NULL;
+		}
+
+		rc = _sw_accel_execute(accel_task);
+		if (rc != 0 || TAILQ_EMPTY(&seq->tasks)) {
+			_add_to_comp_list(accel_ch, accel_task, rc);
+			return;
+		}
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, accel_task, link);
+	}
+}
+
+void
+spdk_accel_sequence_finish(struct spdk_accel_sequence *seq,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	assert(seq != NULL && !TAILQ_EMPTY(&seq->tasks));
+
+	seq->cb_fn = cb_fn;
+	seq->cb_arg = cb_arg;
+
+	accel_sequence_merge(seq);
+	accel_sequence_process(seq);
+}
+
+/* Helper function when when accel modules register with the framework. */
+void spdk_accel_module_list_add(struct spdk_accel_module_if *accel_module)
+{
+	TAILQ_INSERT_TAIL(&spdk_accel_module_list, accel_module, tailq);
+	if (accel_module->get_ctx_size && accel_module->get_ctx_size() > g_max_accel_module_size) {
+		g_max_accel_module_size = accel_module->get_ctx_size();
+	}
+}
+
+/* Framework level channel create callback. */
+static int
+accel_engine_create_cb(void *io_device, void *ctx_buf)
+{
+	struct accel_io_channel	*accel_ch = ctx_buf;
+	struct accel_engine_channel *hw_ch;
+	struct spdk_accel_task *accel_task;
+	uint8_t *task_mem;
+	int i;
+
+	accel_ch->task_pool_base = calloc(MAX_TASKS_PER_CHANNEL, g_max_accel_module_size);
+	if (accel_ch->task_pool_base == NULL) {
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&accel_ch->task_pool);
+	task_mem = accel_ch->task_pool_base;
+	for (i = 0 ; i < MAX_TASKS_PER_CHANNEL; i++) {
+		accel_task = (struct spdk_accel_task *)task_mem;
+		TAILQ_INSERT_TAIL(&accel_ch->task_pool, accel_task, link);
+		task_mem += g_max_accel_module_size;
+	}
+
+	accel_ch->seq_pool_base = calloc(MAX_SEQUENCES_PER_CHANNEL, sizeof(struct spdk_accel_sequence));
+	if (accel_ch->seq_pool_base == NULL) {
+		free(accel_ch->task_pool_base);
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&accel_ch->seq_pool);
+	for (i = 0; i < MAX_SEQUENCES_PER_CHANNEL; i++) {
+		TAILQ_INSERT_TAIL(&accel_ch->seq_pool,
+				  &((struct spdk_accel_sequence *)accel_ch->seq_pool_base)[i], link);
+	}
+
+	/* Set sw engine channel for operations where hw engine does not support. */
+	accel_ch->sw_engine_ch = g_sw_accel_engine->get_io_channel();
+	assert(accel_ch->sw_engine_ch != NULL);
+
+	for (i = 0; i < (int)g_num_hw_accel_engines; i++) {
+		hw_ch = &accel_ch->hw_chs[i];
+		hw_ch->engine = g_hw_accel_engines[i];
+		hw_ch->ch = hw_ch->engine->get_io_channel();
+		if (hw_ch->ch == NULL) {
+			/* Engines such as DSA have a limited number of channels, the tasks
+			 * routed to it are executed in software on this thread instead. */
+			SPDK_NOTICELOG("No %s channel available, using software instead\n",
+				       hw_ch->engine->name);
+		}
+	}
+	accel_ch->num_hw_chs = g_num_hw_accel_engines;
+
+	return 0;
+}
+
+static void
+accel_add_stats(struct accel_opcode_stats *total, const struct accel_opcode_stats *stats)
+{
+	int opc;
+	uint32_t i;
+
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		for (i = 0; i < ACCEL_MAX_HW_ENGINES; i++) {
+			total[opc].hw_ops[i] += stats[opc].hw_ops[i];
+		}
+		total[opc].sw_ops += stats[opc].sw_ops;
+		total[opc].spilled_ops += stats[opc].spilled_ops;
+		total[opc].unregistered_ops += stats[opc].unregistered_ops;
+	}
+}
+
+/* Framework level channel destroy callback. */
+static void
+accel_engine_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct accel_io_channel	*accel_ch = ctx_buf;
+	uint32_t i;
+
+	for (i = 0; i < accel_ch->num_hw_chs; i++) {
+		if (accel_ch->hw_chs[i].ch != NULL) {
+			spdk_put_io_channel(accel_ch->hw_chs[i].ch);
+		}
+	}
+	spdk_put_io_channel(accel_ch->sw_engine_ch);
+
+	/* Keep the stats of the channel for accel_get_stats. */
+	pthread_mutex_lock(&g_accel_stats_lock);
+	accel_add_stats(g_accel_stats, accel_ch->stats);
+	pthread_mutex_unlock(&g_accel_stats_lock);
+
+	free(accel_ch->task_pool_base);
+	free(accel_ch->seq_pool_base);
+}
+
+const char *
+accel_get_opcode_name(enum accel_opcode opc)
+{
+	if (opc < 0 || opc >= ACCEL_OPC_LAST) {
+		return NULL;
+	}
+
+	return g_accel_opcode_names[opc];
+}
+
+static int
+accel_get_opcode_by_name(const char *name)
+{
+	int opc;
+
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		if (strcmp(g_accel_opcode_names[opc], name) == 0) {
+			return opc;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+accel_get_hw_engine_name(uint32_t idx)
+{
+	if (idx >= g_num_hw_accel_engines) {
+		return NULL;
+	}
+
+	return g_hw_accel_engines[idx]->name;
+}
+
+static struct spdk_accel_engine *
+accel_find_engine(const char *name)
+{
+	uint32_t i;
+
+	if (g_sw_accel_engine != NULL && strcmp(name, ACCEL_SW_ENGINE_NAME) == 0) {
+		return g_sw_accel_engine;
+	}
+
+	for (i = 0; i < g_num_hw_accel_engines; i++) {
+		if (strcmp(g_hw_accel_engines[i]->name, name) == 0) {
+			return g_hw_accel_engines[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Look up the engine a route is pinned to.  Returns false if it isn't registered. */
+static bool
+accel_route_resolve(struct accel_route *route)
+{
+	route->engine = NULL;
+	if (route->engine_name[0] == '\0') {
+		return true;
+	}
+
+	route->engine = accel_find_engine(route->engine_name);
+	return route->engine != NULL;
+}
+
+int
+accel_set_route(const char *opcode, const char *engine, uint64_t min_hw_size,
+		uint32_t hw_queue_depth)
+{
+	struct accel_route route = {};
+	int opc;
+
+	opc = accel_get_opcode_by_name(opcode);
+	if (opc < 0) {
+		SPDK_ERRLOG("Unknown accel opcode %s\n", opcode);
+		return -EINVAL;
+	}
+
+	if (engine != NULL && strcmp(engine, "auto") != 0) {
+		if (strlen(engine) >= sizeof(route.engine_name)) {
+			return -EINVAL;
+		}
+		snprintf(route.engine_name, sizeof(route.engine_name), "%s", engine);
+	}
+	route.min_hw_size = min_hw_size;
+	route.hw_queue_depth = hw_queue_depth;
+
+	/* Before the framework is initialized the engines haven't registered yet, the
+	 * route is resolved once they have. */
+	if (g_sw_accel_engine != NULL && !accel_route_resolve(&route)) {
+		SPDK_ERRLOG("Accel engine %s not found\n", engine);
+		return -ENODEV;
+	}
+
+	g_accel_routes[opc] = route;
+	return 0;
+}
+
+/* The engine tasks of an opcode are offloaded to when nothing is saturated. */
+static const char *
+accel_route_get_engine_name(enum accel_opcode opc)
+{
+	struct accel_route *route = &g_accel_routes[opc];
+	uint32_t i;
+
+	if (route->engine == g_sw_accel_engine && g_sw_accel_engine != NULL) {
+		return ACCEL_SW_ENGINE_NAME;
+	}
+
+	for (i = 0; i < g_num_hw_accel_engines; i++) {
+		if ((route->engine == NULL || route->engine == g_hw_accel_engines[i]) &&
+		    _is_supported(g_hw_accel_engines[i], opc)) {
+			return g_hw_accel_engines[i]->name;
+		}
+	}
+
+	return ACCEL_SW_ENGINE_NAME;
+}
+
+void
+accel_write_routes_json(struct spdk_json_write_ctx *w)
+{
+	struct accel_route *route;
+	int opc;
+
+	spdk_json_write_array_begin(w);
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		route = &g_accel_routes[opc];
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "opcode", g_accel_opcode_names[opc]);
+		spdk_json_write_named_string(w, "engine", accel_route_get_engine_name(opc));
+		spdk_json_write_named_bool(w, "pinned", route->engine_name[0] != '\0');
+		spdk_json_write_named_uint64(w, "min_hw_size", route->min_hw_size);
+		spdk_json_write_named_uint32(w, "hw_queue_depth", route->hw_queue_depth ?
+					     route->hw_queue_depth : ACCEL_DEFAULT_HW_QUEUE_DEPTH);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+}
+
+struct accel_get_stats_ctx {
+	struct accel_opcode_stats	stats[ACCEL_OPC_LAST];
+	accel_get_stats_cb		cb_fn;
+	void				*cb_arg;
+};
+
+static void
+accel_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct accel_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+
+	accel_add_stats(ctx->stats, accel_ch->stats);
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+accel_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct accel_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->stats, ctx->cb_arg);
+	free(ctx);
+}
+
+int
+accel_get_stats(accel_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct accel_get_stats_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	pthread_mutex_lock(&g_accel_stats_lock);
+	accel_add_stats(ctx->stats, g_accel_stats);
+	pthread_mutex_unlock(&g_accel_stats_lock);
+
+	spdk_for_each_channel(&spdk_accel_module_list, accel_get_stats_channel, ctx,
+			      accel_get_stats_done);
+	return 0;
+}
+
+const char *
+spdk_accel_get_last_engine_name(struct spdk_io_channel *ch)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+
+	if (accel_ch->last_engine == NULL) {
+		return ACCEL_SW_ENGINE_NAME;
+	}
+
+	return accel_ch->last_engine->name;
+}
+
+struct spdk_io_channel *
+spdk_accel_engine_get_io_channel(void)
+{
+	return spdk_get_io_channel(&spdk_accel_module_list);
+}
+
+static void
+accel_engine_module_initialize(void)
+{
+	struct spdk_accel_module_if *accel_engine_module;
+
+	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
+		accel_engine_module->module_init();
+	}
+}
+
+int
+spdk_accel_engine_initialize(void)
+{
+	const struct spdk_mem_map_ops accel_mem_map_ops = {
+		.notify_cb = accel_mem_map_notify_cb,
+		.are_contiguous = NULL
+	};
+	int opc;
+
+	SPDK_NOTICELOG("Accel engine initialized to use software engine.\n");
+	accel_engine_module_initialize();
+
+	/* Track the registered memory to keep unpinned buffers away from the engines. */
+	if (g_num_hw_accel_engines > 0) {
+		g_accel_mem_map = spdk_mem_map_alloc(0, &accel_mem_map_ops, NULL);
+		if (g_accel_mem_map == NULL) {
+			SPDK_ERRLOG("Failed to allocate the accel memory map\n");
+			return -ENOMEM;
+		}
+	}
+
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		if (!accel_route_resolve(&g_accel_routes[opc])) {
+			SPDK_ERRLOG("Accel engine %s not found, routing %s to any engine\n",
+				    g_accel_routes[opc].engine_name, g_accel_opcode_names[opc]);
+		}
+	}
+
+	/*
+	 * We need a unique identifier for the accel engine framework, so use the
+	 *  spdk_accel_module_list address for this purpose.
+	 */
+	spdk_io_device_register(&spdk_accel_module_list, accel_engine_create_cb, accel_engine_destroy_cb,
+				sizeof(struct accel_io_channel), "accel_module");
+
+	return 0;
+}
+
+static void
+accel_engine_module_finish_cb(void)
+{
+	spdk_accel_fini_cb cb_fn = g_fini_cb_fn;
+
+	cb_fn(g_fini_cb_arg);
+	g_fini_cb_fn = NULL;
+	g_fini_cb_arg = NULL;
+}
+
+void
+spdk_accel_write_config_json(struct spdk_json_write_ctx *w)
+{
+	struct spdk_accel_module_if *accel_engine_module;
+	struct accel_route *route;
+	int opc;
+
+	/*
+	 * The accel fw itself only has the opcode routes as config, there may
+	 * be more in the engines/modules.
+	 */
+	spdk_json_write_array_begin(w);
+	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
+		if (accel_engine_module->write_config_json) {
+			accel_engine_module->write_config_json(w);
+		}
+	}
+
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		route = &g_accel_routes[opc];
+		if (route->engine_name[0] == '\0' && route->min_hw_size == 0 &&
+		    route->hw_queue_depth == 0) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "accel_set_route");
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "opcode", g_accel_opcode_names[opc]);
+		if (route->engine_name[0] != '\0') {
+			spdk_json_write_named_string(w, "engine", route->engine_name);
+		}
+		spdk_json_write_named_uint64(w, "min_hw_size", route->min_hw_size);
+		spdk_json_write_named_uint32(w, "hw_queue_depth", route->hw_queue_depth);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+}
+
+void
+spdk_accel_engine_module_finish(void)
+{
+	if (!g_accel_engine_module) {
+		g_accel_engine_module = TAILQ_FIRST(&spdk_accel_module_list);
+	} else {
+		g_accel_engine_module = TAILQ_NEXT(g_accel_engine_module, tailq);
+	}
+
+	if (!g_accel_engine_module) {
+		accel_engine_module_finish_cb();
+		return;
+	}
+
+	if (g_accel_engine_module->module_fini) {
+		spdk_thread_send_msg(spdk_get_thread(), g_accel_engine_module->module_fini, NULL);
+	} else {
+		spdk_accel_engine_module_finish();
+	}
+}
+
+void
+spdk_accel_engine_finish(spdk_accel_fini_cb cb_fn, void *cb_arg)
+{
+	assert(cb_fn != NULL);
+
+	g_fini_cb_fn = cb_fn;
+	g_fini_cb_arg = cb_arg;
+
+	spdk_io_device_unregister(&spdk_accel_module_list, NULL);
+	spdk_mem_map_free(&g_accel_mem_map);
+	spdk_accel_engine_module_finish();
+}
+
+/*
+ * The SW Accelerator module is "built in" here (rest of file)
+ */
+static bool
+sw_accel_supports_opcode(enum accel_opcode opc)
+{
+	return false;
+}
+
+static inline void
+_pmem_memcpy(void *dst, const void *src, size_t len)
+{
+#ifdef SPDK_CONFIG_PMDK
+	int is_pmem = pmem_is_pmem(dst, len);
+
+	if (is_pmem) {
+		pmem_memcpy_persist(dst, src, len);
+	} else {
+		memcpy(dst, src, len);
+		pmem_msync(dst, len);
+	}
+#else
+	SPDK_ERRLOG("Function not defined without SPDK_CONFIG_PMDK enabled.\n");
+	assert(0);
+#endif
 }
 
 static void
@@ -725,10 +1834,303 @@ _sw_accel_crc32cv(uint32_t *crc_dst, struct iovec *iov, uint32_t iovcnt, uint32_
 	*crc_dst = spdk_crc32c_iov_update(iov, iovcnt, ~seed);
 }
 
+#ifdef SPDK_CONFIG_ISAL
+static struct sw_accel_isal *
+_sw_accel_get_isal(struct accel_io_channel *accel_ch)
+{
+	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(accel_ch->sw_engine_ch);
+
+	if (sw_ch->isal == NULL) {
+		sw_ch->isal = calloc(1, sizeof(*sw_ch->isal));
+	}
+
+	return sw_ch->isal;
+}
+#endif
+
+/* Compress into a raw DEFLATE stream, the same format the DPDK compressdev PMDs produce. */
+static int
+_sw_accel_compress(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task)
+{
+#ifdef SPDK_CONFIG_ISAL
+	struct sw_accel_isal *isal = _sw_accel_get_isal(accel_ch);
+	struct isal_zstream *stream;
+	struct iovec *siov = accel_task->v.iovs;
+	struct iovec *diov = accel_task->d.iovs;
+	uint32_t s = 0, d = 0;
+	int rc;
+
+	if (isal == NULL) {
+		return -ENOMEM;
+	}
+
+	stream = &isal->stream;
+	isal_deflate_init(stream);
+	stream->level = 1;
+	stream->level_buf = isal->level_buf;
+	stream->level_buf_size = sizeof(isal->level_buf);
+	stream->next_in = siov[0].iov_base;
+	stream->avail_in = siov[0].iov_len;
+	stream->next_out = diov[0].iov_base;
+	stream->avail_out = diov[0].iov_len;
+	stream->end_of_stream = accel_task->v.iovcnt == 1;
+
+	while (stream->internal_state.state != ZSTATE_END) {
+		if (stream->avail_in == 0 && s + 1 < accel_task->v.iovcnt) {
+			s++;
+			stream->next_in = siov[s].iov_base;
+			stream->avail_in = siov[s].iov_len;
+			stream->end_of_stream = s + 1 == accel_task->v.iovcnt;
+		}
+		if (stream->avail_out == 0) {
+			if (d + 1 == accel_task->d.iovcnt) {
+				return -ENOSPC;
+			}
+			d++;
+			stream->next_out = diov[d].iov_base;
+			stream->avail_out = diov[d].iov_len;
+		}
+
+		rc = isal_deflate(stream);
+		if (rc != COMP_OK) {
+			SPDK_ERRLOG("isal_deflate returned error %d\n", rc);
+			return -EIO;
+		}
+	}
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = stream->total_out;
+	}
+
+	return 0;
+#else
+	SPDK_ERRLOG("ISA-L is required for software compression\n");
+	return -ENOTSUP;
+#endif
+}
+
+static int
+_sw_accel_decompress(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task)
+{
+#ifdef SPDK_CONFIG_ISAL
+	struct sw_accel_isal *isal = _sw_accel_get_isal(accel_ch);
+	struct inflate_state *state;
+	struct iovec *siov = accel_task->v.iovs;
+	struct iovec *diov = accel_task->d.iovs;
+	uint32_t s = 0, d = 0, avail_in, total_out;
+	int rc;
+
+	if (isal == NULL) {
+		return -ENOMEM;
+	}
+
+	state = &isal->state;
+	isal_inflate_init(state);
+	state->next_in = siov[0].iov_base;
+	state->avail_in = siov[0].iov_len;
+	state->next_out = diov[0].iov_base;
+	state->avail_out = diov[0].iov_len;
+
+	do {
+		if (state->avail_in == 0 && s + 1 < accel_task->v.iovcnt) {
+			s++;
+			state->next_in = siov[s].iov_base;
+			state->avail_in = siov[s].iov_len;
+		}
+		if (state->avail_out == 0) {
+			if (d + 1 == accel_task->d.iovcnt) {
+				return -ENOSPC;
+			}
+			d++;
+			state->next_out = diov[d].iov_base;
+			state->avail_out = diov[d].iov_len;
+		}
+
+		avail_in = state->avail_in;
+		total_out = state->total_out;
+		rc = isal_inflate(state);
+		if (rc < 0) {
+			SPDK_ERRLOG("isal_inflate returned error %d\n", rc);
+			return -EIO;
+		}
+		if (state->block_state != ISAL_BLOCK_FINISH &&
+		    state->avail_in == avail_in && state->total_out == total_out) {
+			/* The input ended before the end of the stream. */
+			return -EINVAL;
+		}
+	} while (state->block_state != ISAL_BLOCK_FINISH);
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = state->total_out;
+	}
+
+	return 0;
+#else
+	SPDK_ERRLOG("ISA-L is required for software decompression\n");
+	return -ENOTSUP;
+#endif
+}
+
+struct sw_accel_iov_cursor {
+	struct iovec	*iovs;
+	uint32_t	iovcnt;
+	uint32_t	idx;
+	size_t		off;
+};
+
+/* Return a pointer to the next len bytes if they are contiguous, NULL otherwise. */
+static uint8_t *
+_sw_accel_iov_cursor_peek(struct sw_accel_iov_cursor *cur, size_t len)
+{
+	struct iovec *iov = &cur->iovs[cur->idx];
+
+	if (iov->iov_len - cur->off < len) {
+		return NULL;
+	}
+
+	return (uint8_t *)iov->iov_base + cur->off;
+}
+
+/* Advance the cursor by len bytes, copying them into or out of buf if it is given. */
+static void
+_sw_accel_iov_cursor_advance(struct sw_accel_iov_cursor *cur, uint8_t *buf, size_t len,
+			     bool to_buf)
+{
+	struct iovec *iov;
+	size_t n;
+
+	while (len > 0) {
+		iov = &cur->iovs[cur->idx];
+		n = spdk_min(len, iov->iov_len - cur->off);
+		if (buf != NULL) {
+			if (to_buf) {
+				memcpy(buf, (uint8_t *)iov->iov_base + cur->off, n);
+			} else {
+				memcpy((uint8_t *)iov->iov_base + cur->off, buf, n);
+			}
+			buf += n;
+		}
+		len -= n;
+		cur->off += n;
+		if (cur->off == iov->iov_len && cur->idx + 1 < cur->iovcnt) {
+			cur->idx++;
+			cur->off = 0;
+		}
+	}
+}
+
+static struct sw_accel_crypto *
+_sw_accel_get_crypto(struct accel_io_channel *accel_ch, uint32_t block_size)
+{
+	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(accel_ch->sw_engine_ch);
+	struct sw_accel_crypto *crypto = sw_ch->crypto;
+	uint8_t *bounce;
+
+	if (crypto == NULL) {
+		crypto = calloc(1, sizeof(*crypto));
+		if (crypto == NULL) {
+			return NULL;
+		}
+		crypto->ctx = EVP_CIPHER_CTX_new();
+		if (crypto->ctx == NULL) {
+			free(crypto);
+			return NULL;
+		}
+		sw_ch->crypto = crypto;
+	}
+
+	if (crypto->bounce_size < block_size) {
+		bounce = realloc(crypto->bounce, block_size);
+		if (bounce == NULL) {
+			return NULL;
+		}
+		crypto->bounce = bounce;
+		crypto->bounce_size = block_size;
+	}
+
+	return crypto;
+}
+
+/*
+ * AES-XTS in software.  Each block_size unit is a separate XTS data unit whose tweak is
+ * the little-endian block number, the same layout the DPDK crypto PMDs use for the LBA
+ * based IV.  The key schedule is kept in the channel and only rebuilt when the key or
+ * the direction changes.
+ */
+static int
+_sw_accel_crypto(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task)
+{
+	struct spdk_accel_crypto_key *key = accel_task->crypto_key;
+	uint32_t block_size = accel_task->block_size;
+	int enc = accel_task->op_code == ACCEL_OPC_ENCRYPT ? 1 : 0;
+	struct sw_accel_iov_cursor src, dst;
+	struct sw_accel_crypto *crypto;
+	const EVP_CIPHER *cipher;
+	uint8_t tweak[AES_XTS_TWEAK_SIZE] = {};
+	uint8_t *in, *out;
+	uint64_t i, num_blocks;
+	int outl;
+
+	crypto = _sw_accel_get_crypto(accel_ch, block_size);
+	if (crypto == NULL) {
+		return -ENOMEM;
+	}
+
+	if (crypto->key_id != key->id || crypto->enc != enc) {
+		cipher = key->key_size == 16 ? EVP_aes_128_xts() : EVP_aes_256_xts();
+		if (EVP_CipherInit_ex(crypto->ctx, cipher, NULL, key->key, NULL, enc) != 1) {
+			crypto->key_id = 0;
+			return -EINVAL;
+		}
+		crypto->key_id = key->id;
+		crypto->enc = enc;
+	}
+
+	src = (struct sw_accel_iov_cursor) {
+		.iovs = accel_task->v.iovs, .iovcnt = accel_task->v.iovcnt
+	};
+	dst = (struct sw_accel_iov_cursor) {
+		.iovs = accel_task->d.iovs, .iovcnt = accel_task->d.iovcnt
+	};
+	num_blocks = accel_task->nbytes / block_size;
+
+	for (i = 0; i < num_blocks; i++) {
+		to_le64(tweak, accel_task->iv + i);
+		if (EVP_CipherInit_ex(crypto->ctx, NULL, NULL, NULL, tweak, -1) != 1) {
+			return -EIO;
+		}
+
+		in = _sw_accel_iov_cursor_peek(&src, block_size);
+		if (in == NULL) {
+			in = crypto->bounce;
+			_sw_accel_iov_cursor_advance(&src, in, block_size, true);
+		} else {
+			_sw_accel_iov_cursor_advance(&src, NULL, block_size, true);
+		}
+
+		out = _sw_accel_iov_cursor_peek(&dst, block_size);
+		if (out == NULL) {
+			/* XTS can work in place, so the bounce buffer may be both in and out. */
+			if (EVP_CipherUpdate(crypto->ctx, crypto->bounce, &outl, in, block_size) != 1) {
+				return -EIO;
+			}
+			_sw_accel_iov_cursor_advance(&dst, crypto->bounce, block_size, false);
+		} else {
+			if (EVP_CipherUpdate(crypto->ctx, out, &outl, in, block_size) != 1) {
+				return -EIO;
+			}
+			_sw_accel_iov_cursor_advance(&dst, NULL, block_size, false);
+		}
+	}
+
+	return 0;
+}
+
 static struct spdk_io_channel *sw_accel_get_io_channel(void);
 
 
 static struct spdk_accel_engine sw_accel_engine = {
+	.name			= ACCEL_SW_ENGINE_NAME,
 	.supports_opcode	= sw_accel_supports_opcode,
 	.get_io_channel		= sw_accel_get_io_channel,
 };
@@ -762,6 +2164,8 @@ sw_accel_create_cb(void *io_device, void *ctx_buf)
 
 	TAILQ_INIT(&sw_ch->tasks_to_complete);
 	sw_ch->completion_poller = SPDK_POLLER_REGISTER(accel_comp_poll, sw_ch, 0);
+	sw_ch->isal = NULL;
+	sw_ch->crypto = NULL;
 
 	return 0;
 }
@@ -772,6 +2176,12 @@ sw_accel_destroy_cb(void *io_device, void *ctx_buf)
 	struct sw_accel_io_channel *sw_ch = ctx_buf;
 
 	spdk_poller_unregister(&sw_ch->completion_poller);
+	free(sw_ch->isal);
+	if (sw_ch->crypto != NULL) {
+		EVP_CIPHER_CTX_free(sw_ch->crypto->ctx);
+		free(sw_ch->crypto->bounce);
+		free(sw_ch->crypto);
+	}
 }
 
 static struct spdk_io_channel *sw_accel_get_io_channel(void)
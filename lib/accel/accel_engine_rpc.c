@@ -0,0 +1,152 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "accel_internal.h"
+
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_accel_set_route {
+	char *opcode;
+	char *engine;
+	uint64_t min_hw_size;
+	uint32_t hw_queue_depth;
+};
+
+static void
+free_rpc_accel_set_route(struct rpc_accel_set_route *r)
+{
+	free(r->opcode);
+	free(r->engine);
+}
+
+static const struct spdk_json_object_decoder rpc_accel_set_route_decoders[] = {
+	{"opcode", offsetof(struct rpc_accel_set_route, opcode), spdk_json_decode_string},
+	{"engine", offsetof(struct rpc_accel_set_route, engine), spdk_json_decode_string, true},
+	{"min_hw_size", offsetof(struct rpc_accel_set_route, min_hw_size), spdk_json_decode_uint64, true},
+	{"hw_queue_depth", offsetof(struct rpc_accel_set_route, hw_queue_depth), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_accel_set_route(struct spdk_jsonrpc_request *request,
+		    const struct spdk_json_val *params)
+{
+	struct rpc_accel_set_route req = {};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_accel_set_route_decoders,
+				    SPDK_COUNTOF(rpc_accel_set_route_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object() failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = accel_set_route(req.opcode, req.engine, req.min_hw_size, req.hw_queue_depth);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_accel_set_route(&req);
+}
+SPDK_RPC_REGISTER("accel_set_route", rpc_accel_set_route, SPDK_RPC_STARTUP)
+
+static void
+rpc_accel_get_routes(struct spdk_jsonrpc_request *request,
+		     const struct spdk_json_val *params)
+{
+	struct spdk_json_write_ctx *w;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "accel_get_routes requires no parameters");
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	accel_write_routes_json(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+SPDK_RPC_REGISTER("accel_get_routes", rpc_accel_get_routes, SPDK_RPC_RUNTIME)
+
+static void
+rpc_accel_get_stats_done(const struct accel_opcode_stats *stats, void *cb_arg)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+	const char *name;
+	int opc;
+	uint32_t i;
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+	for (opc = 0; opc < ACCEL_OPC_LAST; opc++) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "opcode", accel_get_opcode_name(opc));
+		spdk_json_write_named_uint64(w, "software", stats[opc].sw_ops);
+		spdk_json_write_named_uint64(w, "spilled", stats[opc].spilled_ops);
+		spdk_json_write_named_uint64(w, "unregistered", stats[opc].unregistered_ops);
+		for (i = 0; (name = accel_get_hw_engine_name(i)) != NULL; i++) {
+			spdk_json_write_named_uint64(w, name, stats[opc].hw_ops[i]);
+		}
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_accel_get_stats(struct spdk_jsonrpc_request *request,
+		    const struct spdk_json_val *params)
+{
+	int rc;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "accel_get_stats requires no parameters");
+		return;
+	}
+
+	rc = accel_get_stats(rpc_accel_get_stats_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+SPDK_RPC_REGISTER("accel_get_stats", rpc_accel_get_stats, SPDK_RPC_RUNTIME)
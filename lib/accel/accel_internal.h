@@ -0,0 +1,76 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPDK_ACCEL_INTERNAL_H
+#define SPDK_ACCEL_INTERNAL_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk_internal/accel_engine.h"
+
+struct spdk_json_write_ctx;
+
+typedef void (*accel_get_stats_cb)(const struct accel_opcode_stats *stats, void *cb_arg);
+
+const char *accel_get_opcode_name(enum accel_opcode opc);
+const char *accel_get_hw_engine_name(uint32_t idx);
+
+/**
+ * Route an opcode.  The routes are read without locking on every submission, so this
+ * must be called before any accel channel exists.
+ *
+ * \param opcode Name of the opcode, e.g. "copy".
+ * \param engine Name of the engine to pin the opcode to, "software" to never offload it,
+ * NULL or "auto" to use the first engine supporting it.
+ * \param min_hw_size Tasks smaller than this are executed in software.
+ * \param hw_queue_depth Tasks a channel may have outstanding on an engine before the
+ * following ones are executed in software, 0 for the default.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int accel_set_route(const char *opcode, const char *engine, uint64_t min_hw_size,
+		    uint32_t hw_queue_depth);
+
+void accel_write_routes_json(struct spdk_json_write_ctx *w);
+
+/**
+ * Sum up the stats of all channels, including the ones already destroyed.
+ *
+ * \param cb_fn Called with the stats of each opcode, indexed by opcode.
+ * \param cb_arg Argument passed to cb_fn.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int accel_get_stats(accel_get_stats_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_ACCEL_INTERNAL_H */
@@ -34,6 +34,7 @@
 #include "spdk/stdinc.h"
 #include "spdk/blob.h"
 #include "spdk/log.h"
+#include "spdk/thread.h"
 #include "blobstore.h"
 
 static void
@@ -81,12 +82,67 @@ blob_bs_dev_read_cpl(void *cb_arg, int bserrno)
 	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, bserrno);
 }
 
+/* Read a range within one cluster of the snapshot directly from the blob of the
+ * chain that has the cluster allocated, instead of recursing through each level. */
+static bool
+blob_bs_dev_read_chain(struct spdk_blob_bs_dev *b, struct spdk_io_channel *channel,
+		       void *payload, struct iovec *iov, int iovcnt,
+		       uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	struct spdk_blob *blob = b->blob;
+	struct spdk_bs_channel *ch;
+	struct spdk_bs_dev *dev;
+	struct spdk_io_channel *dev_channel;
+	uint64_t io_units_per_cluster, cluster, cluster_lba;
+	uint32_t io_unit_size = blob->bs->io_unit_size;
+
+	if (blob->chain_map == NULL || blob->frozen_refcnt != 0 || lba_count == 0) {
+		return false;
+	}
+
+	io_units_per_cluster = bs_io_unit_per_page(blob->bs) * blob->bs->pages_per_cluster;
+	cluster = lba / io_units_per_cluster;
+	if (cluster >= blob->chain_map_len || (lba + lba_count - 1) / io_units_per_cluster != cluster) {
+		return false;
+	}
+
+	ch = spdk_io_channel_get_ctx(channel);
+	cluster_lba = blob->chain_map[cluster];
+	if (cluster_lba != 0) {
+		dev = ch->dev;
+		dev_channel = ch->dev_channel;
+		lba = cluster_lba + lba % io_units_per_cluster;
+	} else {
+		dev = blob->chain_end_dev;
+		if (dev == NULL || io_unit_size % dev->blocklen != 0) {
+			return false;
+		}
+		dev_channel = bs_back_dev_channel(ch, dev);
+		if (dev_channel == NULL) {
+			return false;
+		}
+		lba *= io_unit_size / dev->blocklen;
+		lba_count *= io_unit_size / dev->blocklen;
+	}
+
+	if (iov == NULL) {
+		dev->read(dev, dev_channel, payload, lba, lba_count, cb_args);
+	} else {
+		dev->readv(dev, dev_channel, iov, iovcnt, lba, lba_count, cb_args);
+	}
+	return true;
+}
+
 static inline void
 blob_bs_dev_read(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
 		 uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
 {
 	struct spdk_blob_bs_dev *b = (struct spdk_blob_bs_dev *)dev;
 
+	if (blob_bs_dev_read_chain(b, channel, payload, NULL, 0, lba, lba_count, cb_args)) {
+		return;
+	}
+
 	spdk_blob_io_read(b->blob, channel, payload, lba, lba_count,
 			  blob_bs_dev_read_cpl, cb_args);
 }
@@ -98,6 +154,10 @@ blob_bs_dev_readv(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
 {
 	struct spdk_blob_bs_dev *b = (struct spdk_blob_bs_dev *)dev;
 
+	if (blob_bs_dev_read_chain(b, channel, NULL, iov, iovcnt, lba, lba_count, cb_args)) {
+		return;
+	}
+
 	spdk_blob_io_readv(b->blob, channel, iov, iovcnt, lba, lba_count,
 			   blob_bs_dev_read_cpl, cb_args);
 }
@@ -146,5 +206,7 @@ bs_create_blob_bs_dev(struct spdk_blob *blob)
 	b->bs_dev.unmap = blob_bs_dev_unmap;
 	b->blob = blob;
 
+	blob_chain_map_init(blob);
+
 	return &b->bs_dev;
 }
@@ -75,6 +75,16 @@ blob_id_cmp(struct spdk_blob *blob1, struct spdk_blob *blob2)
 
 RB_GENERATE_STATIC(spdk_blob_tree, spdk_blob, link, blob_id_cmp);
 
+static int
+blob_esnap_channel_cmp(struct blob_esnap_channel *ch1, struct blob_esnap_channel *ch2)
+{
+	uintptr_t dev1 = (uintptr_t)ch1->dev, dev2 = (uintptr_t)ch2->dev;
+
+	return (dev1 < dev2 ? -1 : dev1 > dev2);
+}
+
+RB_GENERATE_STATIC(blob_esnap_channel_tree, blob_esnap_channel, node, blob_esnap_channel_cmp);
+
 static void
 blob_verify_md_op(struct spdk_blob *blob)
 {
@@ -115,16 +125,31 @@ bs_release_md_page(struct spdk_blob_store *bs, uint32_t page)
 	spdk_bit_array_clear(bs->used_md_pages, page);
 }
 
+/* Distance kept between the first clusters of blobs that start allocating clusters,
+ * so that blobs written at the same time can grow without interleaving on disk. */
+#define BS_FIRST_CLUSTER_SPACING	64
+
+/* Claim a free cluster, starting the search at the hint. A hint of UINT32_MAX
+ * claims the first cluster of a blob. */
 static uint32_t
-bs_claim_cluster(struct spdk_blob_store *bs)
+bs_claim_cluster(struct spdk_blob_store *bs, uint32_t hint)
 {
 	uint32_t cluster_num;
+	bool first_cluster = hint == UINT32_MAX;
+
+	if (first_cluster) {
+		hint = bs->first_cluster_hint;
+	}
 
-	cluster_num = spdk_bit_pool_allocate_bit(bs->used_clusters);
+	cluster_num = spdk_bit_pool_allocate_bit_hint(bs->used_clusters, hint);
 	if (cluster_num == UINT32_MAX) {
 		return UINT32_MAX;
 	}
 
+	if (first_cluster) {
+		bs->first_cluster_hint = cluster_num + BS_FIRST_CLUSTER_SPACING;
+	}
+
 	SPDK_DEBUGLOG(blob, "Claiming cluster %u\n", cluster_num);
 	bs->num_free_clusters--;
 
@@ -159,34 +184,81 @@ blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t clust
 	return 0;
 }
 
+/* Number of entries in the cluster map on each side of a cluster that are looked at
+ * to find where the neighbouring data of the blob is placed on disk. */
+#define BS_CLUSTER_HINT_SEARCH_DEPTH	32
+
+/* Returns the cluster on disk where cluster_num of the blob would be contiguous with
+ * its nearest allocated neighbour in the blob, so that the blob stays sequential on disk.
+ * Without allocated neighbours, the cluster after the last one allocated for the blob
+ * is returned, or UINT32_MAX if none was allocated yet. */
+static uint32_t
+bs_blob_cluster_hint(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t i, first, end, cluster;
+
+	first = cluster_num > BS_CLUSTER_HINT_SEARCH_DEPTH ? cluster_num - BS_CLUSTER_HINT_SEARCH_DEPTH : 0;
+	for (i = cluster_num; i > first; i--) {
+		if (blob->active.clusters[i - 1] != 0) {
+			cluster = bs_lba_to_cluster(bs, blob->active.clusters[i - 1]) + cluster_num - (i - 1);
+			return spdk_min(cluster, UINT32_MAX - 1);
+		}
+	}
+
+	end = spdk_min(cluster_num + BS_CLUSTER_HINT_SEARCH_DEPTH, blob->active.num_clusters);
+	for (i = cluster_num + 1; i < end; i++) {
+		if (blob->active.clusters[i] != 0) {
+			cluster = bs_lba_to_cluster(bs, blob->active.clusters[i]);
+			if (cluster >= i - cluster_num) {
+				return cluster - (i - cluster_num);
+			}
+			break;
+		}
+	}
+
+	return blob->next_cluster_hint;
+}
+
+static int
+bs_claim_extent_page(struct spdk_blob_store *bs, uint32_t *lowest_free_md_page)
+{
+	/* Extent page shall never occupy md_page so start the search from 1 */
+	if (*lowest_free_md_page == 0) {
+		*lowest_free_md_page = 1;
+	}
+	/* No extent_page is allocated for the cluster */
+	*lowest_free_md_page = spdk_bit_array_find_first_clear(bs->used_md_pages,
+			       *lowest_free_md_page);
+	if (*lowest_free_md_page == UINT32_MAX) {
+		/* No more free md pages. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+	bs_claim_md_page(bs, *lowest_free_md_page);
+
+	return 0;
+}
+
 static int
 bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 		    uint64_t *cluster, uint32_t *lowest_free_md_page, bool update_map)
 {
 	uint32_t *extent_page = 0;
 
-	*cluster = bs_claim_cluster(blob->bs);
+	*cluster = bs_claim_cluster(blob->bs, bs_blob_cluster_hint(blob, cluster_num));
 	if (*cluster == UINT32_MAX) {
 		/* No more free clusters. Cannot satisfy the request */
 		return -ENOSPC;
 	}
+	blob->next_cluster_hint = *cluster + 1;
 
 	if (blob->use_extent_table) {
 		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
 		if (*extent_page == 0) {
-			/* Extent page shall never occupy md_page so start the search from 1 */
-			if (*lowest_free_md_page == 0) {
-				*lowest_free_md_page = 1;
-			}
-			/* No extent_page is allocated for the cluster */
-			*lowest_free_md_page = spdk_bit_array_find_first_clear(blob->bs->used_md_pages,
-					       *lowest_free_md_page);
-			if (*lowest_free_md_page == UINT32_MAX) {
-				/* No more free md pages. Cannot satisfy the request */
+			if (bs_claim_extent_page(blob->bs, lowest_free_md_page) != 0) {
 				bs_release_cluster(blob->bs, *cluster);
 				return -ENOSPC;
 			}
-			bs_claim_md_page(blob->bs, *lowest_free_md_page);
 		}
 	}
 
@@ -202,6 +274,103 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 	return 0;
 }
 
+/* Channels reserve a single cluster at a time once there are fewer than this many
+ * free clusters per reserved one, so that reservations held by one channel do not
+ * make allocations on other channels fail early. */
+#define BS_RESERVED_CLUSTERS_FREE_RATIO	16
+
+static uint32_t
+bs_channel_claim_cluster(struct spdk_bs_channel *ch, uint32_t hint)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	uint32_t batch, cluster;
+
+	if (ch->reserved_clusters_head == ch->num_reserved_clusters) {
+		ch->reserved_clusters_head = 0;
+		ch->num_reserved_clusters = 0;
+
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		batch = bs->channel_reserved_clusters;
+		if (bs->num_free_clusters < (uint64_t)batch * BS_RESERVED_CLUSTERS_FREE_RATIO) {
+			batch = 1;
+		}
+		/* Reserve the batch starting at the hint, to keep it contiguous on disk */
+		while (ch->num_reserved_clusters < batch) {
+			cluster = bs_claim_cluster(bs, hint);
+			if (cluster == UINT32_MAX) {
+				break;
+			}
+			ch->reserved_clusters[ch->num_reserved_clusters++] = cluster;
+			hint = cluster + 1;
+		}
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+		if (ch->num_reserved_clusters == 0) {
+			return UINT32_MAX;
+		}
+	}
+
+	return ch->reserved_clusters[ch->reserved_clusters_head++];
+}
+
+static void
+bs_channel_release_reserved_clusters(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+
+	if (ch->reserved_clusters_head == ch->num_reserved_clusters) {
+		return;
+	}
+
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	while (ch->reserved_clusters_head < ch->num_reserved_clusters) {
+		bs_release_cluster(bs, ch->reserved_clusters[ch->reserved_clusters_head++]);
+	}
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+	ch->reserved_clusters_head = 0;
+	ch->num_reserved_clusters = 0;
+}
+
+/* Allocate a cluster for a thin provisioned blob from the channel reservation.
+ * The cluster map is updated later on the md thread. */
+static int
+bs_channel_allocate_cluster(struct spdk_bs_channel *ch, struct spdk_blob *blob,
+			    uint32_t cluster_num, uint64_t *cluster, uint32_t *lowest_free_md_page)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	int rc = 0;
+
+	if (bs->channel_reserved_clusters == 0) {
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		rc = bs_allocate_cluster(blob, cluster_num, cluster, lowest_free_md_page, false);
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+		return rc;
+	}
+
+	*cluster = bs_channel_claim_cluster(ch, bs_blob_cluster_hint(blob, cluster_num));
+	if (*cluster == UINT32_MAX) {
+		/* No more free clusters. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+	blob->next_cluster_hint = *cluster + 1;
+
+	if (blob->use_extent_table && *bs_cluster_to_extent_page(blob, cluster_num) == 0) {
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		rc = bs_claim_extent_page(bs, lowest_free_md_page);
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+		if (rc != 0) {
+			/* Keep the cluster for the next allocation on this channel */
+			ch->reserved_clusters_head--;
+			return rc;
+		}
+	}
+
+	SPDK_DEBUGLOG(blob, "Claiming cluster %" PRIu64 " for blob %" PRIu64 "\n", *cluster, blob->id);
+
+	return 0;
+}
+
 static void
 blob_xattrs_init(struct spdk_blob_xattr_opts *xattrs)
 {
@@ -244,6 +413,8 @@ spdk_blob_opts_init(struct spdk_blob_opts *opts, size_t opts_size)
 	}
 
 	SET_FIELD(use_extent_table, true);
+	SET_FIELD(esnap_id, NULL);
+	SET_FIELD(esnap_id_len, 0);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -310,6 +481,8 @@ blob_alloc(struct spdk_blob_store *bs, spdk_blob_id id)
 	TAILQ_INIT(&blob->xattrs_internal);
 	TAILQ_INIT(&blob->pending_persists);
 	TAILQ_INIT(&blob->persists_to_complete);
+	TAILQ_INIT(&blob->extent_page_updates);
+	blob->next_cluster_hint = UINT32_MAX;
 
 	return blob;
 }
@@ -333,6 +506,7 @@ blob_free(struct spdk_blob *blob)
 	assert(blob != NULL);
 	assert(TAILQ_EMPTY(&blob->pending_persists));
 	assert(TAILQ_EMPTY(&blob->persists_to_complete));
+	assert(TAILQ_EMPTY(&blob->extent_page_updates));
 
 	free(blob->active.extent_pages);
 	free(blob->clean.extent_pages);
@@ -340,6 +514,7 @@ blob_free(struct spdk_blob *blob)
 	free(blob->clean.clusters);
 	free(blob->active.pages);
 	free(blob->clean.pages);
+	free(blob->chain_map);
 
 	xattrs_free(&blob->xattrs);
 	xattrs_free(&blob->xattrs_internal);
@@ -1355,6 +1530,60 @@ blob_load_snapshot_cpl(void *cb_arg, struct spdk_blob *snapshot, int bserrno)
 
 static void blob_update_clear_method(struct spdk_blob *blob);
 
+static int
+blob_create_esnap_dev(struct spdk_blob *blob, const void *esnap_id, size_t id_len,
+		      struct spdk_bs_dev **_bs_dev)
+{
+	struct spdk_blob_store	*bs = blob->bs;
+	struct spdk_bs_dev	*bs_dev = NULL;
+	int			rc;
+
+	if (bs->esnap_bs_dev_create == NULL) {
+		SPDK_ERRLOG("Blob 0x%" PRIx64 " is an external snapshot clone, but no external "
+			    "snapshot device callback was provided\n", blob->id);
+		return -EINVAL;
+	}
+
+	rc = bs->esnap_bs_dev_create(bs->esnap_ctx, blob, esnap_id, id_len, &bs_dev);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to create external snapshot device for blob 0x%" PRIx64 ": %d\n",
+			    blob->id, rc);
+		return rc;
+	}
+
+	if (bs->io_unit_size % bs_dev->blocklen != 0) {
+		SPDK_ERRLOG("External snapshot block size %" PRIu32 " does not divide blobstore "
+			    "io unit size %" PRIu32 "\n", bs_dev->blocklen, bs->io_unit_size);
+		bs_dev->destroy(bs_dev);
+		return -EINVAL;
+	}
+
+	*_bs_dev = bs_dev;
+	return 0;
+}
+
+static int
+blob_load_esnap_dev(struct spdk_blob *blob)
+{
+	const void	*esnap_id;
+	size_t		id_len;
+	int		rc;
+
+	rc = blob_get_xattr_value(blob, BLOB_EXTERNAL_SNAPSHOT_ID, &esnap_id, &id_len, true);
+	if (rc != 0) {
+		SPDK_ERRLOG("Blob 0x%" PRIx64 " has no external snapshot id\n", blob->id);
+		return -EINVAL;
+	}
+
+	rc = blob_create_esnap_dev(blob, esnap_id, id_len, &blob->back_bs_dev);
+	if (rc != 0) {
+		return rc;
+	}
+
+	blob->parent_id = SPDK_BLOBID_EXTERNAL_SNAPSHOT;
+	return 0;
+}
+
 static void
 blob_load_backing_dev(void *cb_arg)
 {
@@ -1364,7 +1593,11 @@ blob_load_backing_dev(void *cb_arg)
 	size_t				len;
 	int				rc;
 
-	if (spdk_blob_is_thin_provisioned(blob)) {
+	if (blob->invalid_flags & SPDK_BLOB_EXTERNAL_SNAPSHOT) {
+		rc = blob_load_esnap_dev(blob);
+		blob_load_final(ctx, rc);
+		return;
+	} else if (spdk_blob_is_thin_provisioned(blob)) {
 		rc = blob_get_xattr_value(blob, BLOB_SNAPSHOT, &value, &len, true);
 		if (rc == 0) {
 			if (len != sizeof(spdk_blob_id)) {
@@ -1846,6 +2079,21 @@ blob_persist_clear_clusters(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ct
 	bs_batch_close(batch);
 }
 
+/* Number of consecutive md pages starting at pages[start] */
+static size_t
+bs_md_page_run_len(const uint32_t *pages, size_t start, size_t num_pages)
+{
+	size_t i;
+
+	for (i = start + 1; i < num_pages; i++) {
+		if (pages[i] != pages[i - 1] + 1) {
+			break;
+		}
+	}
+
+	return i - start;
+}
+
 static void
 blob_persist_zero_pages_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
@@ -1887,7 +2135,7 @@ blob_persist_zero_pages(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	uint64_t			lba;
 	uint64_t			lba_count;
 	spdk_bs_batch_t			*batch;
-	size_t				i;
+	size_t				i, num_pages;
 
 	if (bserrno != 0) {
 		blob_persist_complete(seq, ctx, bserrno);
@@ -1902,10 +2150,11 @@ blob_persist_zero_pages(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	 * below. The pages (except the first) are never written in place,
 	 * so any pages in the clean list must be zeroed.
 	 */
-	for (i = 1; i < blob->clean.num_pages; i++) {
+	for (i = 1; i < blob->clean.num_pages; i += num_pages) {
+		num_pages = bs_md_page_run_len(blob->clean.pages, i, blob->clean.num_pages);
 		lba = bs_md_page_to_lba(bs, blob->clean.pages[i]);
 
-		bs_batch_write_zeroes_dev(batch, lba, lba_count);
+		bs_batch_write_zeroes_dev(batch, lba, lba_count * num_pages);
 	}
 
 	/* The first page will only be zeroed if this is a delete. */
@@ -1962,7 +2211,7 @@ blob_persist_write_page_chain(spdk_bs_sequence_t *seq, struct spdk_blob_persist_
 	uint32_t			lba_count;
 	struct spdk_blob_md_page	*page;
 	spdk_bs_batch_t			*batch;
-	size_t				i;
+	size_t				i, num_pages;
 
 	/* Clusters don't move around in blobs. The list shrinks or grows
 	 * at the end, but no changes ever occur in the middle of the list.
@@ -1973,15 +2222,17 @@ blob_persist_write_page_chain(spdk_bs_sequence_t *seq, struct spdk_blob_persist_
 	batch = bs_sequence_to_batch(seq, blob_persist_write_page_root, ctx);
 
 	/* This starts at 1. The root page is not written until
-	 * all of the others are finished
+	 * all of the others are finished. Pages that landed next to each
+	 * other in the md region are written with a single I/O.
 	 */
-	for (i = 1; i < blob->active.num_pages; i++) {
+	for (i = 1; i < blob->active.num_pages; i += num_pages) {
 		page = &ctx->pages[i];
 		assert(page->sequence_num == i);
 
+		num_pages = bs_md_page_run_len(blob->active.pages, i, blob->active.num_pages);
 		lba = bs_md_page_to_lba(bs, blob->active.pages[i]);
 
-		bs_batch_write_dev(batch, page, lba, lba_count);
+		bs_batch_write_dev(batch, page, lba, lba_count * num_pages);
 	}
 
 	bs_batch_close(batch);
@@ -2329,7 +2580,11 @@ struct spdk_blob_copy_cluster_ctx {
 	uint64_t page;
 	uint64_t new_cluster;
 	uint32_t new_extent_page;
+	uint32_t cluster_number;
 	spdk_bs_sequence_t *seq;
+	/* User ops waiting for this cluster allocation */
+	TAILQ_HEAD(, spdk_bs_request_set) ops;
+	TAILQ_ENTRY(spdk_blob_copy_cluster_ctx) link;
 };
 
 static void
@@ -2337,15 +2592,17 @@ blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
 {
 	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
 	struct spdk_bs_request_set *set = (struct spdk_bs_request_set *)ctx->seq;
+	struct spdk_bs_channel *ch = set->channel;
 	TAILQ_HEAD(, spdk_bs_request_set) requests;
 	spdk_bs_user_op_t *op;
 
-	TAILQ_INIT(&requests);
-	TAILQ_SWAP(&set->channel->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+	TAILQ_REMOVE(&ch->cluster_allocs, ctx, link);
+	assert(ch->num_cluster_allocs > 0);
+	ch->num_cluster_allocs--;
 
-	while (!TAILQ_EMPTY(&requests)) {
-		op = TAILQ_FIRST(&requests);
-		TAILQ_REMOVE(&requests, op, link);
+	while (!TAILQ_EMPTY(&ctx->ops)) {
+		op = TAILQ_FIRST(&ctx->ops);
+		TAILQ_REMOVE(&ctx->ops, op, link);
 		if (bserrno == 0) {
 			bs_user_op_execute(op);
 		} else {
@@ -2353,10 +2610,34 @@ blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
 		}
 	}
 
+	/* Ops queued behind the allocation limit are resubmitted and either
+	 * find their cluster allocated or start a new allocation. */
+	TAILQ_INIT(&requests);
+	TAILQ_SWAP(&ch->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+
+	while (!TAILQ_EMPTY(&requests)) {
+		op = TAILQ_FIRST(&requests);
+		TAILQ_REMOVE(&requests, op, link);
+		bs_user_op_execute(op);
+	}
+
 	spdk_free(ctx->buf);
 	free(ctx);
 }
 
+static void
+blob_copy_cluster_release(struct spdk_blob_copy_cluster_ctx *ctx)
+{
+	struct spdk_blob_store *bs = ctx->blob->bs;
+
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	bs_release_cluster(bs, ctx->new_cluster);
+	if (ctx->new_extent_page != 0) {
+		bs_release_md_page(bs, ctx->new_extent_page);
+	}
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+}
+
 static void
 blob_insert_cluster_cpl(void *cb_arg, int bserrno)
 {
@@ -2369,12 +2650,10 @@ blob_insert_cluster_cpl(void *cb_arg, int bserrno)
 			 * but continue without error. */
 			bserrno = 0;
 		}
+		/* The extent page, if any, was already released on md thread. */
 		pthread_mutex_lock(&ctx->blob->bs->used_clusters_mutex);
 		bs_release_cluster(ctx->blob->bs, ctx->new_cluster);
 		pthread_mutex_unlock(&ctx->blob->bs->used_clusters_mutex);
-		if (ctx->new_extent_page != 0) {
-			bs_release_md_page(ctx->blob->bs, ctx->new_extent_page);
-		}
 	}
 
 	bs_sequence_finish(ctx->seq, bserrno);
@@ -2384,17 +2663,15 @@ static void
 blob_write_copy_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
 	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
-	uint32_t cluster_number;
 
 	if (bserrno) {
 		/* The write failed, so jump to the final completion handler */
+		blob_copy_cluster_release(ctx);
 		bs_sequence_finish(seq, bserrno);
 		return;
 	}
 
-	cluster_number = bs_page_to_cluster(ctx->blob->bs, ctx->page);
-
-	blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
+	blob_insert_cluster_on_md_thread(ctx->blob, ctx->cluster_number, ctx->new_cluster,
 					 ctx->new_extent_page, blob_insert_cluster_cpl, ctx);
 }
 
@@ -2405,6 +2682,7 @@ blob_write_copy(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 
 	if (bserrno != 0) {
 		/* The read failed, so jump to the final completion handler */
+		blob_copy_cluster_release(ctx);
 		bs_sequence_finish(seq, bserrno);
 		return;
 	}
@@ -2430,14 +2708,6 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 
 	ch = spdk_io_channel_get_ctx(_ch);
 
-	if (!TAILQ_EMPTY(&ch->need_cluster_alloc)) {
-		/* There are already operations pending. Queue this user op
-		 * and return because it will be re-executed when the outstanding
-		 * cluster allocation completes. */
-		TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
-		return;
-	}
-
 	/* Round the io_unit offset down to the first page in the cluster */
 	cluster_start_page = bs_io_unit_to_cluster_start(blob, io_unit);
 
@@ -2445,6 +2715,27 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	 * cluster is supposed to be at. */
 	cluster_number = bs_io_unit_to_cluster_number(blob, io_unit);
 
+	TAILQ_FOREACH(ctx, &ch->cluster_allocs, link) {
+		if (ctx->blob == blob && ctx->cluster_number == cluster_number) {
+			/* The cluster is already being allocated. Queue this user op
+			 * and return because it will be re-executed when that
+			 * allocation completes. */
+			TAILQ_INSERT_TAIL(&ctx->ops, op, link);
+			return;
+		}
+	}
+
+	/* With channel cluster reservation enabled, allocations of different clusters
+	 * proceed in parallel, up to the number of clusters reserved per channel. */
+	if (!TAILQ_EMPTY(&ch->need_cluster_alloc) ||
+	    ch->num_cluster_allocs >= spdk_max(1, blob->bs->channel_reserved_clusters)) {
+		/* There are already operations pending. Queue this user op
+		 * and return because it will be re-executed when the outstanding
+		 * cluster allocation completes. */
+		TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+		return;
+	}
+
 	ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
 		bs_user_op_abort(op, -ENOMEM);
@@ -2455,6 +2746,8 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 
 	ctx->blob = blob;
 	ctx->page = cluster_start_page;
+	ctx->cluster_number = cluster_number;
+	TAILQ_INIT(&ctx->ops);
 
 	if (blob->parent_id != SPDK_BLOBID_INVALID) {
 		ctx->buf = spdk_malloc(blob->bs->cluster_sz, blob->back_bs_dev->blocklen,
@@ -2468,10 +2761,8 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 		}
 	}
 
-	pthread_mutex_lock(&blob->bs->used_clusters_mutex);
-	rc = bs_allocate_cluster(blob, cluster_number, &ctx->new_cluster, &ctx->new_extent_page,
-				 false);
-	pthread_mutex_unlock(&blob->bs->used_clusters_mutex);
+	rc = bs_channel_allocate_cluster(ch, blob, cluster_number, &ctx->new_cluster,
+					 &ctx->new_extent_page);
 	if (rc != 0) {
 		spdk_free(ctx->buf);
 		free(ctx);
@@ -2485,17 +2776,17 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 
 	ctx->seq = bs_sequence_start(_ch, &cpl);
 	if (!ctx->seq) {
-		pthread_mutex_lock(&blob->bs->used_clusters_mutex);
-		bs_release_cluster(blob->bs, ctx->new_cluster);
-		pthread_mutex_unlock(&blob->bs->used_clusters_mutex);
+		blob_copy_cluster_release(ctx);
 		spdk_free(ctx->buf);
 		free(ctx);
 		bs_user_op_abort(op, -ENOMEM);
 		return;
 	}
 
-	/* Queue the user op to block other incoming operations */
-	TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+	/* Queue the user op to block other incoming operations to this cluster */
+	TAILQ_INSERT_TAIL(&ctx->ops, op, link);
+	TAILQ_INSERT_TAIL(&ch->cluster_allocs, ctx, link);
+	ch->num_cluster_allocs++;
 
 	if (blob->parent_id != SPDK_BLOBID_INVALID) {
 		/* Read cluster from backing device */
@@ -2726,6 +3017,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			cb_fn(cb_arg, -ENOMEM);
 			return;
 		}
+		batch->blob = blob;
 
 		if (is_allocated) {
 			/* Read from the blob */
@@ -2754,6 +3046,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
+			batch->blob = blob;
 
 			if (op_type == SPDK_BLOB_WRITE) {
 				bs_batch_write_dev(batch, payload, lba, lba_count);
@@ -2784,6 +3077,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			cb_fn(cb_arg, -ENOMEM);
 			return;
 		}
+		batch->blob = blob;
 
 		if (is_allocated) {
 			bs_batch_unmap_dev(batch, lba, lba_count);
@@ -2996,6 +3290,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
+			seq->blob = blob;
 
 			if (is_allocated) {
 				bs_sequence_readv_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
@@ -3012,6 +3307,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 					cb_fn(cb_arg, -ENOMEM);
 					return;
 				}
+				seq->blob = blob;
 
 				bs_sequence_writev_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
 			} else {
@@ -3073,7 +3369,8 @@ blob_get_snapshot_and_clone_entries(struct spdk_blob *blob,
 	*snapshot_entry = NULL;
 	*clone_entry = NULL;
 
-	if (blob->parent_id == SPDK_BLOBID_INVALID) {
+	if (blob->parent_id == SPDK_BLOBID_INVALID ||
+	    blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
 		return;
 	}
 
@@ -3110,6 +3407,14 @@ bs_channel_create(void *io_device, void *ctx_buf)
 		return -1;
 	}
 
+	if (bs->channel_reserved_clusters != 0) {
+		channel->reserved_clusters = calloc(bs->channel_reserved_clusters, sizeof(uint32_t));
+		if (!channel->reserved_clusters) {
+			free(channel->req_mem);
+			return -1;
+		}
+	}
+
 	TAILQ_INIT(&channel->reqs);
 
 	for (i = 0; i < max_ops; i++) {
@@ -3122,83 +3427,271 @@ bs_channel_create(void *io_device, void *ctx_buf)
 
 	if (!channel->dev_channel) {
 		SPDK_ERRLOG("Failed to create device channel.\n");
+		free(channel->reserved_clusters);
 		free(channel->req_mem);
 		return -1;
 	}
 
 	TAILQ_INIT(&channel->need_cluster_alloc);
 	TAILQ_INIT(&channel->queued_io);
+	TAILQ_INIT(&channel->cluster_allocs);
+	RB_INIT(&channel->esnap_channels);
 
 	return 0;
 }
 
 static void
-bs_channel_destroy(void *io_device, void *ctx_buf)
+bs_channel_destroy_esnap_channel(struct spdk_bs_channel *channel,
+				 struct blob_esnap_channel *esnap_ch)
 {
-	struct spdk_bs_channel *channel = ctx_buf;
-	spdk_bs_user_op_t *op;
+	RB_REMOVE(blob_esnap_channel_tree, &channel->esnap_channels, esnap_ch);
+	esnap_ch->dev->destroy_channel(esnap_ch->dev, esnap_ch->channel);
+	free(esnap_ch);
+}
 
-	while (!TAILQ_EMPTY(&channel->need_cluster_alloc)) {
-		op = TAILQ_FIRST(&channel->need_cluster_alloc);
-		TAILQ_REMOVE(&channel->need_cluster_alloc, op, link);
-		bs_user_op_abort(op, -EIO);
+struct spdk_io_channel *
+bs_back_dev_channel(struct spdk_bs_channel *channel, struct spdk_bs_dev *bs_dev)
+{
+	struct blob_esnap_channel find = {};
+	struct blob_esnap_channel *esnap_ch;
+
+	if (bs_dev->create_channel == NULL) {
+		/* Snapshots and the zeroes device are read through the blobstore channel */
+		return spdk_io_channel_from_ctx(channel);
 	}
 
-	while (!TAILQ_EMPTY(&channel->queued_io)) {
-		op = TAILQ_FIRST(&channel->queued_io);
-		TAILQ_REMOVE(&channel->queued_io, op, link);
-		bs_user_op_abort(op, -EIO);
+	find.dev = bs_dev;
+	esnap_ch = RB_FIND(blob_esnap_channel_tree, &channel->esnap_channels, &find);
+	if (esnap_ch != NULL) {
+		return esnap_ch->channel;
 	}
 
-	free(channel->req_mem);
-	channel->dev->destroy_channel(channel->dev, channel->dev_channel);
+	esnap_ch = calloc(1, sizeof(*esnap_ch));
+	if (esnap_ch == NULL) {
+		return NULL;
+	}
+
+	esnap_ch->channel = bs_dev->create_channel(bs_dev);
+	if (esnap_ch->channel == NULL) {
+		SPDK_ERRLOG("Failed to create external snapshot device channel.\n");
+		free(esnap_ch);
+		return NULL;
+	}
+
+	esnap_ch->dev = bs_dev;
+	RB_INSERT(blob_esnap_channel_tree, &channel->esnap_channels, esnap_ch);
+
+	return esnap_ch->channel;
+}
+
+static inline struct spdk_blob *
+blob_chain_parent(struct spdk_blob *blob)
+{
+	if (blob->parent_id == SPDK_BLOBID_INVALID ||
+	    blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT ||
+	    blob->back_bs_dev == NULL) {
+		return NULL;
+	}
+
+	return ((struct spdk_blob_bs_dev *)blob->back_bs_dev)->blob;
 }
 
 static void
-bs_dev_destroy(void *io_device)
+blob_chain_map_update(struct spdk_blob *blob)
 {
-	struct spdk_blob_store *bs = io_device;
-	struct spdk_blob	*blob, *blob_tmp;
+	struct spdk_blob *b, *end;
+	uint64_t i, lba;
 
-	bs->dev->destroy(bs->dev);
+	/* Entries are updated one by one, as clones may be reading the map on other
+	 * threads. Both the old and the new LBA of a cluster hold the same data until
+	 * the chain change that triggered the update completes. */
+	for (i = 0; i < blob->chain_map_len; i++) {
+		lba = 0;
+		for (b = blob; b != NULL; b = blob_chain_parent(b)) {
+			if (i < b->active.num_clusters && b->active.clusters[i] != 0) {
+				lba = b->active.clusters[i];
+				break;
+			}
+		}
+		blob->chain_map[i] = lba;
+	}
 
-	RB_FOREACH_SAFE(blob, spdk_blob_tree, &bs->open_blobs, blob_tmp) {
-		RB_REMOVE(spdk_blob_tree, &bs->open_blobs, blob);
-		spdk_bit_array_clear(bs->open_blobids, blob->id);
-		blob_free(blob);
+	for (end = blob; blob_chain_parent(end) != NULL; end = blob_chain_parent(end)) {
 	}
+	blob->chain_end_dev = end->back_bs_dev;
+}
 
-	pthread_mutex_destroy(&bs->used_clusters_mutex);
+void
+blob_chain_map_init(struct spdk_blob *blob)
+{
+	if (blob->chain_map != NULL || blob_chain_parent(blob) == NULL) {
+		/* Reads of a snapshot without parent blob take a single step already */
+		return;
+	}
 
-	spdk_bit_array_free(&bs->open_blobids);
-	spdk_bit_array_free(&bs->used_blobids);
-	spdk_bit_array_free(&bs->used_md_pages);
-	spdk_bit_pool_free(&bs->used_clusters);
-	/*
-	 * If this function is called for any reason except a successful unload,
-	 * the unload_cpl type will be NONE and this will be a nop.
-	 */
-	bs_call_cpl(&bs->unload_cpl, bs->unload_err);
+	blob->chain_map = calloc(blob->active.num_clusters, sizeof(*blob->chain_map));
+	if (blob->chain_map == NULL) {
+		/* Clones keep reading through each level of the chain */
+		return;
+	}
+	blob->chain_map_len = blob->active.num_clusters;
 
-	free(bs);
+	blob_chain_map_update(blob);
 }
 
-static int
-bs_blob_list_add(struct spdk_blob *blob)
+/* Called on the md thread after the clusters or the parent of a blob that may
+ * be part of a snapshot chain changed. */
+static void
+bs_chain_maps_update(struct spdk_blob_store *bs)
 {
-	spdk_blob_id snapshot_id;
-	struct spdk_blob_list *snapshot_entry = NULL;
-	struct spdk_blob_list *clone_entry = NULL;
-
-	assert(blob != NULL);
+	struct spdk_blob *blob;
 
-	snapshot_id = blob->parent_id;
-	if (snapshot_id == SPDK_BLOBID_INVALID) {
-		return 0;
+	RB_FOREACH(blob, spdk_blob_tree, &bs->open_blobs) {
+		if (blob->chain_map != NULL) {
+			blob_chain_map_update(blob);
+		}
 	}
+}
 
-	snapshot_entry = bs_get_snapshot_entry(blob->bs, snapshot_id);
-	if (snapshot_entry == NULL) {
+struct blob_esnap_destroy_ctx {
+	struct spdk_blob			*blob;
+	struct spdk_bs_dev			*dev;
+	spdk_blob_op_with_handle_complete	cb_fn;
+	void					*cb_arg;
+};
+
+static void
+blob_esnap_destroy_channel(struct spdk_io_channel_iter *i)
+{
+	struct blob_esnap_destroy_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_bs_channel *channel = spdk_io_channel_get_ctx(spdk_io_channel_iter_get_channel(i));
+	struct blob_esnap_channel find = {};
+	struct blob_esnap_channel *esnap_ch;
+
+	find.dev = ctx->dev;
+	esnap_ch = RB_FIND(blob_esnap_channel_tree, &channel->esnap_channels, &find);
+	if (esnap_ch != NULL) {
+		bs_channel_destroy_esnap_channel(channel, esnap_ch);
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+blob_esnap_destroy_channels_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct blob_esnap_destroy_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->cb_arg, ctx->blob, status);
+	free(ctx);
+}
+
+/*
+ * Release the channels every bs channel holds to the external snapshot device
+ *  of the blob, which must be done before that device is destroyed.
+ */
+static void
+blob_esnap_destroy_channels(struct spdk_blob *blob, struct spdk_bs_dev *dev,
+			    spdk_blob_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	struct blob_esnap_destroy_ctx *ctx;
+
+	if (dev == NULL || dev->create_channel == NULL) {
+		cb_fn(cb_arg, blob, 0);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, blob, -ENOMEM);
+		return;
+	}
+
+	ctx->blob = blob;
+	ctx->dev = dev;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(blob->bs, blob_esnap_destroy_channel, ctx,
+			      blob_esnap_destroy_channels_done);
+}
+
+static void
+bs_channel_destroy(void *io_device, void *ctx_buf)
+{
+	struct spdk_bs_channel *channel = ctx_buf;
+	spdk_bs_user_op_t *op;
+
+	while (!TAILQ_EMPTY(&channel->need_cluster_alloc)) {
+		op = TAILQ_FIRST(&channel->need_cluster_alloc);
+		TAILQ_REMOVE(&channel->need_cluster_alloc, op, link);
+		bs_user_op_abort(op, -EIO);
+	}
+
+	while (!TAILQ_EMPTY(&channel->queued_io)) {
+		op = TAILQ_FIRST(&channel->queued_io);
+		TAILQ_REMOVE(&channel->queued_io, op, link);
+		bs_user_op_abort(op, -EIO);
+	}
+
+	bs_channel_release_reserved_clusters(channel);
+	free(channel->reserved_clusters);
+
+	while (!RB_EMPTY(&channel->esnap_channels)) {
+		bs_channel_destroy_esnap_channel(channel, RB_MIN(blob_esnap_channel_tree,
+						 &channel->esnap_channels));
+	}
+
+	free(channel->req_mem);
+	channel->dev->destroy_channel(channel->dev, channel->dev_channel);
+}
+
+static void
+bs_dev_destroy(void *io_device)
+{
+	struct spdk_blob_store *bs = io_device;
+	struct spdk_blob	*blob, *blob_tmp;
+
+	bs->dev->destroy(bs->dev);
+
+	RB_FOREACH_SAFE(blob, spdk_blob_tree, &bs->open_blobs, blob_tmp) {
+		RB_REMOVE(spdk_blob_tree, &bs->open_blobs, blob);
+		spdk_bit_array_clear(bs->open_blobids, blob->id);
+		blob_free(blob);
+	}
+
+	pthread_mutex_destroy(&bs->used_clusters_mutex);
+
+	spdk_bit_array_free(&bs->open_blobids);
+	spdk_bit_array_free(&bs->used_blobids);
+	spdk_bit_array_free(&bs->used_md_pages);
+	spdk_bit_pool_free(&bs->used_clusters);
+	/*
+	 * If this function is called for any reason except a successful unload,
+	 * the unload_cpl type will be NONE and this will be a nop.
+	 */
+	bs_call_cpl(&bs->unload_cpl, bs->unload_err);
+
+	free(bs);
+}
+
+static int
+bs_blob_list_add(struct spdk_blob *blob)
+{
+	spdk_blob_id snapshot_id;
+	struct spdk_blob_list *snapshot_entry = NULL;
+	struct spdk_blob_list *clone_entry = NULL;
+
+	assert(blob != NULL);
+
+	snapshot_id = blob->parent_id;
+	if (snapshot_id == SPDK_BLOBID_INVALID ||
+	    snapshot_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		return 0;
+	}
+
+	snapshot_entry = bs_get_snapshot_entry(blob->bs, snapshot_id);
+	if (snapshot_entry == NULL) {
 		/* Snapshot not found */
 		snapshot_entry = calloc(1, sizeof(struct spdk_blob_list));
 		if (snapshot_entry == NULL) {
@@ -3316,6 +3809,9 @@ spdk_bs_opts_init(struct spdk_bs_opts *opts, size_t opts_size)
 	SET_FIELD(iter_cb_fn, NULL);
 	SET_FIELD(iter_cb_arg, NULL);
 	SET_FIELD(force_recover, false);
+	SET_FIELD(channel_reserved_clusters, 0);
+	SET_FIELD(esnap_bs_dev_create, NULL);
+	SET_FIELD(esnap_ctx, NULL);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -3337,6 +3833,9 @@ bs_opts_verify(struct spdk_bs_opts *opts)
 
 /* spdk_bs_load_ctx is used for init, load, unload and dump code paths. */
 
+/* Number of md pages read at once while recovering a dirty blobstore */
+#define BS_LOAD_REPLAY_WINDOW_PAGES	256
+
 struct spdk_bs_load_ctx {
 	struct spdk_blob_store		*bs;
 	struct spdk_bs_super_block	*super;
@@ -3347,6 +3846,13 @@ struct spdk_bs_load_ctx {
 	uint32_t			cur_page;
 	struct spdk_blob_md_page	*page;
 
+	/* Metadata pages read ahead during recovery */
+	struct spdk_blob_md_page	*replay_window;
+	uint32_t			replay_window_start;
+	uint32_t			replay_window_len;
+	bool				in_replay_loop;
+	bool				replay_next;
+
 	uint64_t			num_extent_pages;
 	uint32_t			*extent_page_num;
 	struct spdk_blob_md_page	*extent_pages;
@@ -3441,6 +3947,9 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	bs->io_unit_size = dev->blocklen;
 
 	bs->max_channel_ops = opts->max_channel_ops;
+	bs->channel_reserved_clusters = opts->channel_reserved_clusters;
+	bs->esnap_bs_dev_create = opts->esnap_bs_dev_create;
+	bs->esnap_ctx = opts->esnap_ctx;
 	bs->super_blob = SPDK_BLOBID_INVALID;
 	memcpy(&bs->bstype, &opts->bstype, sizeof(opts->bstype));
 
@@ -3478,6 +3987,12 @@ bs_load_ctx_fail(struct spdk_bs_load_ctx *ctx, int bserrno)
 {
 	assert(bserrno != 0);
 
+	/* Buffers of the md replay, if it was in progress */
+	spdk_free(ctx->page);
+	spdk_free(ctx->replay_window);
+	spdk_free(ctx->extent_pages);
+	free(ctx->extent_page_num);
+
 	spdk_free(ctx->super);
 	bs_sequence_finish(ctx->seq, bserrno);
 	bs_free(ctx->bs);
@@ -4211,6 +4726,9 @@ bs_load_replay_md_chain_cpl(struct spdk_bs_load_ctx *ctx)
 		}
 		ctx->bs->num_free_clusters -= num_md_clusters;
 		spdk_free(ctx->page);
+		ctx->page = NULL;
+		spdk_free(ctx->replay_window);
+		ctx->replay_window = NULL;
 		bs_load_write_used_md(ctx);
 	}
 }
@@ -4223,7 +4741,6 @@ bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrn
 	uint64_t i;
 
 	if (bserrno != 0) {
-		spdk_free(ctx->extent_pages);
 		bs_load_ctx_fail(ctx, bserrno);
 		return;
 	}
@@ -4232,7 +4749,6 @@ bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrn
 		/* Extent pages are only read when present within in chain md.
 		 * Integrity of md is not right if that page was not a valid extent page. */
 		if (bs_load_cur_extent_page_valid(&ctx->extent_pages[i]) != true) {
-			spdk_free(ctx->extent_pages);
 			bs_load_ctx_fail(ctx, -EILSEQ);
 			return;
 		}
@@ -4240,13 +4756,13 @@ bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrn
 		page_num = ctx->extent_page_num[i];
 		spdk_bit_array_set(ctx->bs->used_md_pages, page_num);
 		if (bs_load_replay_md_parse_page(ctx, &ctx->extent_pages[i])) {
-			spdk_free(ctx->extent_pages);
 			bs_load_ctx_fail(ctx, -EILSEQ);
 			return;
 		}
 	}
 
 	spdk_free(ctx->extent_pages);
+	ctx->extent_pages = NULL;
 	free(ctx->extent_page_num);
 	ctx->extent_page_num = NULL;
 	ctx->num_extent_pages = 0;
@@ -4322,16 +4838,60 @@ bs_load_replay_md_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	bs_load_replay_md_chain_cpl(ctx);
 }
 
+static void
+bs_load_replay_window_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_bs_load_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		bs_load_ctx_fail(ctx, bserrno);
+		return;
+	}
+
+	ctx->replay_window_start = ctx->cur_page;
+	ctx->replay_window_len = spdk_min(BS_LOAD_REPLAY_WINDOW_PAGES,
+					  ctx->super->md_len - ctx->cur_page);
+	bs_load_replay_cur_md_page(ctx);
+}
+
 static void
 bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx)
 {
 	uint64_t lba;
+	uint32_t num_pages;
 
-	assert(ctx->cur_page < ctx->super->md_len);
-	lba = bs_md_page_to_lba(ctx->bs, ctx->cur_page);
-	bs_sequence_read_dev(ctx->seq, ctx->page, lba,
-			     bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
-			     bs_load_replay_md_cpl, ctx);
+	/* Pages found in the read-ahead window are replayed without any I/O.
+	 * Loop instead of recursing, so long runs of such pages do not grow the stack. */
+	if (ctx->in_replay_loop) {
+		ctx->replay_next = true;
+		return;
+	}
+
+	ctx->in_replay_loop = true;
+	do {
+		ctx->replay_next = false;
+
+		assert(ctx->cur_page < ctx->super->md_len);
+		if (ctx->cur_page >= ctx->replay_window_start &&
+		    ctx->cur_page < ctx->replay_window_start + ctx->replay_window_len) {
+			memcpy(ctx->page, &ctx->replay_window[ctx->cur_page - ctx->replay_window_start],
+			       SPDK_BS_PAGE_SIZE);
+			bs_load_replay_md_cpl(ctx->seq, ctx, 0);
+		} else if (!ctx->in_page_chain) {
+			/* Scanning for the next blob, read ahead a whole window of the md region */
+			num_pages = spdk_min(BS_LOAD_REPLAY_WINDOW_PAGES, ctx->super->md_len - ctx->cur_page);
+			lba = bs_md_page_to_lba(ctx->bs, ctx->cur_page);
+			bs_sequence_read_dev(ctx->seq, ctx->replay_window, lba,
+					     bs_byte_to_lba(ctx->bs, (uint64_t)num_pages * SPDK_BS_PAGE_SIZE),
+					     bs_load_replay_window_cpl, ctx);
+		} else {
+			lba = bs_md_page_to_lba(ctx->bs, ctx->cur_page);
+			bs_sequence_read_dev(ctx->seq, ctx->page, lba,
+					     bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
+					     bs_load_replay_md_cpl, ctx);
+		}
+	} while (ctx->replay_next);
+	ctx->in_replay_loop = false;
 }
 
 static void
@@ -4345,6 +4905,12 @@ bs_load_replay_md(struct spdk_bs_load_ctx *ctx)
 		bs_load_ctx_fail(ctx, -ENOMEM);
 		return;
 	}
+	ctx->replay_window = spdk_zmalloc((uint64_t)BS_LOAD_REPLAY_WINDOW_PAGES * SPDK_BS_PAGE_SIZE, 0,
+					  NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	if (!ctx->replay_window) {
+		bs_load_ctx_fail(ctx, -ENOMEM);
+		return;
+	}
 	bs_load_replay_cur_md_page(ctx);
 }
 
@@ -4509,12 +5075,15 @@ bs_opts_copy(struct spdk_bs_opts *src, struct spdk_bs_opts *dst)
 	SET_FIELD(iter_cb_fn);
 	SET_FIELD(iter_cb_arg);
 	SET_FIELD(force_recover);
+	SET_FIELD(channel_reserved_clusters);
+	SET_FIELD(esnap_bs_dev_create);
+	SET_FIELD(esnap_ctx);
 
 	dst->opts_size = src->opts_size;
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 72, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 96, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -5361,6 +5930,9 @@ spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_a
 		return;
 	}
 
+	/* Return clusters reserved by the md channel, so they are persisted as free */
+	bs_channel_release_reserved_clusters(spdk_io_channel_get_ctx(bs->md_channel));
+
 	ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
 		cb_fn(cb_arg, -ENOMEM);
@@ -5573,6 +6145,32 @@ uint64_t spdk_blob_get_num_clusters(struct spdk_blob *blob)
 	return blob->active.num_clusters;
 }
 
+void
+spdk_blob_get_fragmentation(struct spdk_blob *blob, struct spdk_blob_fragmentation *frag)
+{
+	uint64_t lba_per_cluster;
+	uint64_t prev_lba = 0;
+	uint64_t lba;
+	uint64_t i;
+
+	assert(blob != NULL);
+	assert(frag != NULL);
+
+	memset(frag, 0, sizeof(*frag));
+	lba_per_cluster = bs_cluster_to_lba(blob->bs, 1);
+
+	for (i = 0; i < blob->active.num_clusters; i++) {
+		lba = blob->active.clusters[i];
+		if (lba != 0) {
+			frag->num_allocated_clusters++;
+			if (prev_lba == 0 || lba != prev_lba + lba_per_cluster) {
+				frag->num_extents++;
+			}
+		}
+		prev_lba = lba;
+	}
+}
+
 /* START spdk_bs_create_blob */
 
 static void
@@ -5635,12 +6233,14 @@ blob_opts_copy(const struct spdk_blob_opts *src, struct spdk_blob_opts *dst)
 	}
 
 	SET_FIELD(use_extent_table);
+	SET_FIELD(esnap_id);
+	SET_FIELD(esnap_id_len);
 
 	dst->opts_size = src->opts_size;
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 64, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 80, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -5720,6 +6320,27 @@ bs_create_blob(struct spdk_blob_store *bs,
 		blob_set_thin_provision(blob);
 	}
 
+	if (opts_local.esnap_id != NULL) {
+		if (opts_local.esnap_id_len == 0 || opts_local.esnap_id_len > UINT16_MAX) {
+			rc = -EINVAL;
+		} else {
+			rc = blob_set_xattr(blob, BLOB_EXTERNAL_SNAPSHOT_ID, opts_local.esnap_id,
+					    opts_local.esnap_id_len, true);
+		}
+		if (rc < 0) {
+			blob_free(blob);
+			spdk_bit_array_clear(bs->used_blobids, page_idx);
+			bs_release_md_page(bs, page_idx);
+			cb_fn(cb_arg, 0, rc);
+			return;
+		}
+
+		/* Clusters not yet allocated are read from the external snapshot */
+		blob->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
+		blob->parent_id = SPDK_BLOBID_EXTERNAL_SNAPSHOT;
+		blob_set_thin_provision(blob);
+	}
+
 	blob_set_clear_method(blob, opts_local.clear_method);
 
 	rc = blob_resize(blob, opts_local.num_clusters);
@@ -5880,6 +6501,11 @@ bs_clone_snapshot_newblob_cleanup(struct spdk_clone_snapshot_ctx *ctx, int bserr
 		}
 	}
 
+	if (ctx->original.blob != NULL && newblob->back_bs_dev == ctx->original.blob->back_bs_dev) {
+		/* Back device was lent by the original blob, which still uses it */
+		newblob->back_bs_dev = NULL;
+	}
+
 	ctx->new.id = newblob->id;
 	spdk_blob_close(newblob, bs_clone_snapshot_origblob_cleanup, ctx);
 }
@@ -5975,6 +6601,12 @@ bs_snapshot_newblob_sync_cpl(void *cb_arg, int bserrno)
 		return;
 	}
 
+	if (origblob->invalid_flags & SPDK_BLOB_EXTERNAL_SNAPSHOT) {
+		/* Original blob is now a clone of the new snapshot only */
+		blob_remove_xattr(origblob, BLOB_EXTERNAL_SNAPSHOT_ID, true);
+		origblob->invalid_flags &= ~SPDK_BLOB_EXTERNAL_SNAPSHOT;
+	}
+
 	bs_blob_list_remove(origblob);
 	origblob->parent_id = newblob->id;
 	/* set clone blob as thin provisioned */
@@ -5992,6 +6624,8 @@ bs_snapshot_freeze_cpl(void *cb_arg, int rc)
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
 	struct spdk_blob *origblob = ctx->original.blob;
 	struct spdk_blob *newblob = ctx->new.blob;
+	const void *esnap_id;
+	size_t esnap_id_len;
 	int bserrno;
 
 	if (rc != 0) {
@@ -6008,7 +6642,18 @@ bs_snapshot_freeze_cpl(void *cb_arg, int rc)
 
 	/* inherit parent from original blob if set */
 	newblob->parent_id = origblob->parent_id;
-	if (origblob->parent_id != SPDK_BLOBID_INVALID) {
+	if (origblob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		/* The external snapshot moves under the new snapshot */
+		bserrno = blob_get_xattr_value(origblob, BLOB_EXTERNAL_SNAPSHOT_ID, &esnap_id, &esnap_id_len,
+					       true);
+		if (bserrno == 0) {
+			bserrno = blob_set_xattr(newblob, BLOB_EXTERNAL_SNAPSHOT_ID, esnap_id, esnap_id_len, true);
+		}
+		if (bserrno != 0) {
+			bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+			return;
+		}
+	} else if (origblob->parent_id != SPDK_BLOBID_INVALID) {
 		/* Set internal xattr for snapshot id */
 		bserrno = blob_set_xattr(newblob, BLOB_SNAPSHOT,
 					 &origblob->parent_id, sizeof(spdk_blob_id), true);
@@ -6269,6 +6914,17 @@ void spdk_bs_create_clone(struct spdk_blob_store *bs, spdk_blob_id blobid,
 
 /* START spdk_bs_inflate_blob */
 
+static void
+bs_inflate_blob_sync_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+
+	/* Clones of the blob must no longer read through its former parent */
+	bs_chain_maps_update(ctx->original.blob->bs);
+
+	bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+}
+
 static void
 bs_inflate_blob_set_parent_cpl(void *cb_arg, struct spdk_blob *_parent, int bserrno)
 {
@@ -6298,7 +6954,68 @@ bs_inflate_blob_set_parent_cpl(void *cb_arg, struct spdk_blob *_parent, int bser
 	_blob->back_bs_dev = bs_create_blob_bs_dev(_parent);
 	bs_blob_list_add(_blob);
 
-	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
+	spdk_blob_sync_md(_blob, bs_inflate_blob_sync_cpl, ctx);
+}
+
+static void
+bs_inflate_blob_set_esnap_parent(struct spdk_clone_snapshot_ctx *ctx, struct spdk_blob *_parent)
+{
+	struct spdk_blob *_blob = ctx->original.blob;
+	struct spdk_bs_dev *esnap_dev;
+	const void *esnap_id;
+	size_t esnap_id_len;
+	int bserrno;
+
+	bserrno = blob_get_xattr_value(_parent, BLOB_EXTERNAL_SNAPSHOT_ID, &esnap_id, &esnap_id_len,
+				       true);
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
+	}
+
+	bserrno = blob_create_esnap_dev(_blob, esnap_id, esnap_id_len, &esnap_dev);
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
+	}
+
+	/* Temporarily override md_ro flag for MD modification */
+	_blob->md_ro = false;
+
+	bserrno = blob_set_xattr(_blob, BLOB_EXTERNAL_SNAPSHOT_ID, esnap_id, esnap_id_len, true);
+	if (bserrno != 0) {
+		esnap_dev->destroy(esnap_dev);
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
+	}
+
+	bs_blob_list_remove(_blob);
+	blob_remove_xattr(_blob, BLOB_SNAPSHOT, true);
+	_blob->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
+	_blob->parent_id = SPDK_BLOBID_EXTERNAL_SNAPSHOT;
+
+	_blob->back_bs_dev->destroy(_blob->back_bs_dev);
+	_blob->back_bs_dev = esnap_dev;
+
+	spdk_blob_sync_md(_blob, bs_inflate_blob_sync_cpl, ctx);
+}
+
+static void bs_inflate_blob_done(struct spdk_clone_snapshot_ctx *ctx);
+
+static void
+bs_inflate_blob_esnap_channels_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
+	}
+
+	blob_remove_xattr(_blob, BLOB_EXTERNAL_SNAPSHOT_ID, true);
+	_blob->invalid_flags &= ~SPDK_BLOB_EXTERNAL_SNAPSHOT;
+
+	bs_inflate_blob_done(ctx);
 }
 
 static void
@@ -6307,6 +7024,17 @@ bs_inflate_blob_done(struct spdk_clone_snapshot_ctx *ctx)
 	struct spdk_blob *_blob = ctx->original.blob;
 	struct spdk_blob *_parent;
 
+	/* Point the chain maps at the copied clusters before the parent is released */
+	bs_chain_maps_update(_blob->bs);
+
+	if (_blob->invalid_flags & SPDK_BLOB_EXTERNAL_SNAPSHOT) {
+		/* All clusters were copied, the external snapshot is no longer needed */
+		assert(ctx->allocate_all);
+		blob_esnap_destroy_channels(_blob, _blob->back_bs_dev,
+					    bs_inflate_blob_esnap_channels_cpl, ctx);
+		return;
+	}
+
 	if (ctx->allocate_all) {
 		/* remove thin provisioning */
 		bs_blob_list_remove(_blob);
@@ -6317,7 +7045,11 @@ bs_inflate_blob_done(struct spdk_clone_snapshot_ctx *ctx)
 		_blob->parent_id = SPDK_BLOBID_INVALID;
 	} else {
 		_parent = ((struct spdk_blob_bs_dev *)(_blob->back_bs_dev))->blob;
-		if (_parent->parent_id != SPDK_BLOBID_INVALID) {
+		if (_parent->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+			/* Blob becomes a clone of the external snapshot its parent was created from */
+			bs_inflate_blob_set_esnap_parent(ctx, _parent);
+			return;
+		} else if (_parent->parent_id != SPDK_BLOBID_INVALID) {
 			/* We must change the parent of the inflated blob */
 			spdk_bs_open_blob(_blob->bs, _parent->parent_id,
 					  bs_inflate_blob_set_parent_cpl, ctx);
@@ -6335,7 +7067,7 @@ bs_inflate_blob_done(struct spdk_clone_snapshot_ctx *ctx)
 	_blob->md_ro = false;
 	_blob->state = SPDK_BLOB_STATE_DIRTY;
 
-	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
+	spdk_blob_sync_md(_blob, bs_inflate_blob_sync_cpl, ctx);
 }
 
 /* Check if cluster needs allocation */
@@ -6351,7 +7083,8 @@ bs_cluster_needs_allocation(struct spdk_blob *blob, uint64_t cluster, bool alloc
 		return false;
 	}
 
-	if (blob->parent_id == SPDK_BLOBID_INVALID) {
+	if (blob->parent_id == SPDK_BLOBID_INVALID ||
+	    blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
 		/* Blob have no parent blob */
 		return allocate_all;
 	}
@@ -6441,6 +7174,12 @@ bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 		return;
 	}
 
+	if (_blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		/* External snapshot data is not in the blobstore, so decoupling
+		 * from it requires copying every cluster, just like inflate. */
+		ctx->allocate_all = true;
+	}
+
 	/* Do two passes - one to verify that we can obtain enough clusters
 	 * and another to actually claim them.
 	 */
@@ -6497,32 +7236,895 @@ spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel
 }
 /* END spdk_bs_inflate_blob */
 
-/* START spdk_blob_resize */
-struct spdk_bs_resize_ctx {
-	spdk_blob_op_complete cb_fn;
-	void *cb_arg;
-	struct spdk_blob *blob;
-	uint64_t sz;
-	int rc;
+/* START spdk_bs_blob_shallow_copy */
+
+/* Number of clusters copied in parallel by a shallow copy */
+#define BS_SHALLOW_COPY_MAX_OUTSTANDING 4
+
+struct shallow_copy_ctx;
+
+struct shallow_copy_io {
+	struct shallow_copy_ctx		*ctx;
+	void				*buf;
+	uint64_t			cluster;
+	struct spdk_bs_dev_cb_args	cb_args;
+};
+
+struct shallow_copy_ctx {
+	struct spdk_bs_cpl		cpl;
+	int				bserrno;
+
+	struct spdk_blob		*blob;
+	struct spdk_io_channel		*blob_channel;
+	struct spdk_bs_dev		*ext_dev;
+	struct spdk_io_channel		*ext_channel;
+
+	uint64_t			next_cluster;
+	uint64_t			copied_clusters;
+	uint64_t			total_clusters;
+
+	spdk_blob_shallow_copy_status	status_cb_fn;
+	void				*status_cb_arg;
+
+	uint32_t			num_ios;
+	uint32_t			outstanding;
+	struct shallow_copy_io		*free_ios[BS_SHALLOW_COPY_MAX_OUTSTANDING];
+	struct shallow_copy_io		ios[BS_SHALLOW_COPY_MAX_OUTSTANDING];
 };
 
+static void bs_shallow_copy_submit(struct shallow_copy_ctx *ctx);
+
 static void
-bs_resize_unfreeze_cpl(void *cb_arg, int rc)
+bs_shallow_copy_free(struct shallow_copy_ctx *ctx)
 {
-	struct spdk_bs_resize_ctx *ctx = (struct spdk_bs_resize_ctx *)cb_arg;
+	uint32_t i;
 
-	if (rc != 0) {
-		SPDK_ERRLOG("Unfreeze failed, rc=%d\n", rc);
+	for (i = 0; i < ctx->num_ios; i++) {
+		spdk_free(ctx->ios[i].buf);
 	}
 
-	if (ctx->rc != 0) {
-		SPDK_ERRLOG("Unfreeze failed, ctx->rc=%d\n", ctx->rc);
-		rc = ctx->rc;
+	if (ctx->ext_channel != NULL) {
+		ctx->ext_dev->destroy_channel(ctx->ext_dev, ctx->ext_channel);
 	}
 
-	ctx->blob->locked_operation_in_progress = false;
-
-	ctx->cb_fn(ctx->cb_arg, rc);
+	free(ctx);
+}
+
+static void
+bs_shallow_copy_close_cpl(void *cb_arg, int bserrno)
+{
+	struct shallow_copy_ctx *ctx = cb_arg;
+
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	bs_call_cpl(&ctx->cpl, ctx->bserrno);
+	bs_shallow_copy_free(ctx);
+}
+
+static void
+bs_shallow_copy_finish(struct shallow_copy_ctx *ctx, int bserrno)
+{
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	spdk_blob_close(ctx->blob, bs_shallow_copy_close_cpl, ctx);
+}
+
+static void
+bs_shallow_copy_io_done(struct shallow_copy_io *io, int bserrno)
+{
+	struct shallow_copy_ctx *ctx = io->ctx;
+
+	assert(ctx->outstanding > 0);
+	ctx->outstanding--;
+	ctx->free_ios[ctx->num_ios - ctx->outstanding - 1] = io;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Shallow copy of cluster %" PRIu64 " of blob 0x%" PRIx64 " failed: %d\n",
+			    io->cluster, ctx->blob->id, bserrno);
+		if (ctx->bserrno == 0) {
+			ctx->bserrno = bserrno;
+		}
+	} else {
+		ctx->copied_clusters++;
+		if (ctx->status_cb_fn != NULL) {
+			ctx->status_cb_fn(ctx->copied_clusters, ctx->total_clusters, ctx->status_cb_arg);
+		}
+	}
+
+	bs_shallow_copy_submit(ctx);
+}
+
+static void
+bs_shallow_copy_write_cpl(struct spdk_io_channel *channel, void *cb_arg, int bserrno)
+{
+	bs_shallow_copy_io_done(cb_arg, bserrno);
+}
+
+static void
+bs_shallow_copy_read_cpl(void *cb_arg, int bserrno)
+{
+	struct shallow_copy_io *io = cb_arg;
+	struct shallow_copy_ctx *ctx = io->ctx;
+	struct spdk_bs_dev *ext_dev = ctx->ext_dev;
+	uint64_t lba_count;
+
+	if (bserrno != 0) {
+		bs_shallow_copy_io_done(io, bserrno);
+		return;
+	}
+
+	lba_count = ctx->blob->bs->cluster_sz / ext_dev->blocklen;
+	io->cb_args.cb_fn = bs_shallow_copy_write_cpl;
+	io->cb_args.channel = ctx->ext_channel;
+	io->cb_args.cb_arg = io;
+
+	ext_dev->write(ext_dev, ctx->ext_channel, io->buf, io->cluster * lba_count, lba_count,
+		       &io->cb_args);
+}
+
+static void
+bs_shallow_copy_submit(struct shallow_copy_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t io_units_per_cluster = bs_io_unit_per_page(blob->bs) * blob->bs->pages_per_cluster;
+	struct shallow_copy_io *io;
+
+	while (ctx->bserrno == 0 && ctx->outstanding < ctx->num_ios) {
+		while (ctx->next_cluster < blob->active.num_clusters &&
+		       blob->active.clusters[ctx->next_cluster] == 0) {
+			ctx->next_cluster++;
+		}
+		if (ctx->next_cluster == blob->active.num_clusters) {
+			break;
+		}
+
+		io = ctx->free_ios[ctx->num_ios - ctx->outstanding - 1];
+		io->cluster = ctx->next_cluster++;
+		ctx->outstanding++;
+
+		spdk_blob_io_read(blob, ctx->blob_channel, io->buf, io->cluster * io_units_per_cluster,
+				  io_units_per_cluster, bs_shallow_copy_read_cpl, io);
+	}
+
+	if (ctx->outstanding == 0) {
+		bs_shallow_copy_finish(ctx, 0);
+	}
+}
+
+static void
+bs_shallow_copy_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+{
+	struct shallow_copy_ctx *ctx = cb_arg;
+	struct spdk_bs_dev *ext_dev = ctx->ext_dev;
+	uint64_t i;
+
+	if (bserrno != 0) {
+		bs_call_cpl(&ctx->cpl, bserrno);
+		bs_shallow_copy_free(ctx);
+		return;
+	}
+
+	ctx->blob = _blob;
+
+	if (!spdk_blob_is_read_only(_blob)) {
+		SPDK_ERRLOG("Blob 0x%" PRIx64 " must be read-only for a shallow copy\n", _blob->id);
+		bs_shallow_copy_finish(ctx, -EPERM);
+		return;
+	}
+
+	if (_blob->bs->cluster_sz % ext_dev->blocklen != 0 ||
+	    ext_dev->blockcnt * ext_dev->blocklen < _blob->active.num_clusters * _blob->bs->cluster_sz) {
+		SPDK_ERRLOG("Device of %" PRIu64 " blocks of %" PRIu32 " bytes cannot hold a shallow "
+			    "copy of blob 0x%" PRIx64 "\n", ext_dev->blockcnt, ext_dev->blocklen, _blob->id);
+		bs_shallow_copy_finish(ctx, -EINVAL);
+		return;
+	}
+
+	for (i = 0; i < _blob->active.num_clusters; i++) {
+		if (_blob->active.clusters[i] != 0) {
+			ctx->total_clusters++;
+		}
+	}
+
+	ctx->ext_channel = ext_dev->create_channel(ext_dev);
+	if (ctx->ext_channel == NULL) {
+		bs_shallow_copy_finish(ctx, -ENOMEM);
+		return;
+	}
+
+	while (ctx->num_ios < spdk_min(ctx->total_clusters, BS_SHALLOW_COPY_MAX_OUTSTANDING)) {
+		struct shallow_copy_io *io = &ctx->ios[ctx->num_ios];
+
+		io->buf = spdk_malloc(_blob->bs->cluster_sz, ext_dev->blocklen, NULL,
+				      SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+		if (io->buf == NULL) {
+			bs_shallow_copy_finish(ctx, -ENOMEM);
+			return;
+		}
+		io->ctx = ctx;
+		ctx->free_ios[ctx->num_ios++] = io;
+	}
+
+	bs_shallow_copy_submit(ctx);
+}
+
+void
+spdk_bs_blob_shallow_copy(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			  spdk_blob_id blobid, struct spdk_bs_dev *ext_dev,
+			  spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+			  spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct shallow_copy_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	ctx->cpl.u.blob_basic.cb_fn = cb_fn;
+	ctx->cpl.u.blob_basic.cb_arg = cb_arg;
+	ctx->blob_channel = channel;
+	ctx->ext_dev = ext_dev;
+	ctx->status_cb_fn = status_cb_fn;
+	ctx->status_cb_arg = status_cb_arg;
+
+	spdk_bs_open_blob(bs, blobid, bs_shallow_copy_blob_open_cpl, ctx);
+}
+/* END spdk_bs_blob_shallow_copy */
+
+/* START spdk_bs_get_changed_clusters */
+
+/* Number of clusters compared before yielding to other messages on the thread */
+#define BS_CHANGED_CLUSTERS_BATCH (64 * 1024)
+
+struct changed_clusters_ctx {
+	struct spdk_bs_cpl		cpl;
+	int				bserrno;
+
+	struct spdk_blob_store		*bs;
+	spdk_blob_id			base_id;
+	spdk_blob_changed_clusters_cb	extent_cb_fn;
+	void				*extent_cb_arg;
+
+	/* Blobs from the requested blob up to, but excluding, the base snapshot */
+	struct spdk_blob		**chain;
+	uint32_t			chain_len;
+	uint32_t			chain_size;
+
+	uint64_t			cluster;
+	uint64_t			extent_start;
+	uint64_t			extent_len;
+};
+
+static void
+bs_changed_clusters_close_cpl(void *cb_arg, int bserrno)
+{
+	struct changed_clusters_ctx *ctx = cb_arg;
+
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	if (ctx->chain_len > 0) {
+		spdk_blob_close(ctx->chain[--ctx->chain_len], bs_changed_clusters_close_cpl, ctx);
+		return;
+	}
+
+	bs_call_cpl(&ctx->cpl, ctx->bserrno);
+	free(ctx->chain);
+	free(ctx);
+}
+
+static void
+bs_changed_clusters_finish(struct changed_clusters_ctx *ctx, int bserrno)
+{
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	bs_changed_clusters_close_cpl(ctx, 0);
+}
+
+static bool
+bs_changed_clusters_is_changed(struct changed_clusters_ctx *ctx, uint64_t cluster)
+{
+	struct spdk_blob *blob;
+	uint32_t i;
+
+	for (i = 0; i < ctx->chain_len; i++) {
+		blob = ctx->chain[i];
+		if (cluster < blob->active.num_clusters && blob->active.clusters[cluster] != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+bs_changed_clusters_compare(void *arg)
+{
+	struct changed_clusters_ctx *ctx = arg;
+	uint64_t num_clusters = ctx->chain[0]->active.num_clusters;
+	uint64_t end = spdk_min(num_clusters, ctx->cluster + BS_CHANGED_CLUSTERS_BATCH);
+
+	for (; ctx->cluster < end; ctx->cluster++) {
+		if (bs_changed_clusters_is_changed(ctx, ctx->cluster)) {
+			if (ctx->extent_len == 0) {
+				ctx->extent_start = ctx->cluster;
+			}
+			ctx->extent_len++;
+		} else if (ctx->extent_len != 0) {
+			ctx->extent_cb_fn(ctx->extent_cb_arg, ctx->extent_start, ctx->extent_len);
+			ctx->extent_len = 0;
+		}
+	}
+
+	if (ctx->cluster < num_clusters) {
+		spdk_thread_send_msg(spdk_get_thread(), bs_changed_clusters_compare, ctx);
+		return;
+	}
+
+	if (ctx->extent_len != 0) {
+		ctx->extent_cb_fn(ctx->extent_cb_arg, ctx->extent_start, ctx->extent_len);
+	}
+
+	bs_changed_clusters_finish(ctx, 0);
+}
+
+static void
+bs_changed_clusters_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+{
+	struct changed_clusters_ctx *ctx = cb_arg;
+	struct spdk_blob **chain;
+
+	if (bserrno != 0) {
+		bs_changed_clusters_finish(ctx, bserrno);
+		return;
+	}
+
+	if (ctx->chain_len == ctx->chain_size) {
+		chain = realloc(ctx->chain, sizeof(*chain) * (ctx->chain_size + 8));
+		if (chain == NULL) {
+			ctx->bserrno = -ENOMEM;
+			spdk_blob_close(_blob, bs_changed_clusters_close_cpl, ctx);
+			return;
+		}
+		ctx->chain = chain;
+		ctx->chain_size += 8;
+	}
+	ctx->chain[ctx->chain_len++] = _blob;
+
+	if (_blob->parent_id == ctx->base_id) {
+		bs_changed_clusters_compare(ctx);
+		return;
+	}
+
+	if (_blob->parent_id == SPDK_BLOBID_INVALID ||
+	    _blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		if (ctx->base_id != SPDK_BLOBID_INVALID) {
+			SPDK_ERRLOG("Blob 0x%" PRIx64 " is not an ancestor of blob 0x%" PRIx64 "\n",
+				    ctx->base_id, ctx->chain[0]->id);
+			bs_changed_clusters_finish(ctx, -EINVAL);
+			return;
+		}
+		bs_changed_clusters_compare(ctx);
+		return;
+	}
+
+	spdk_bs_open_blob(ctx->bs, _blob->parent_id, bs_changed_clusters_open_cpl, ctx);
+}
+
+void
+spdk_bs_get_changed_clusters(struct spdk_blob_store *bs, spdk_blob_id base_id,
+			     spdk_blob_id blobid, spdk_blob_changed_clusters_cb extent_cb_fn,
+			     void *extent_cb_arg, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct changed_clusters_ctx *ctx;
+
+	if (base_id == blobid) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	ctx->cpl.u.blob_basic.cb_fn = cb_fn;
+	ctx->cpl.u.blob_basic.cb_arg = cb_arg;
+	ctx->bs = bs;
+	ctx->base_id = base_id;
+	ctx->extent_cb_fn = extent_cb_fn;
+	ctx->extent_cb_arg = extent_cb_arg;
+
+	spdk_bs_open_blob(bs, blobid, bs_changed_clusters_open_cpl, ctx);
+}
+/* END spdk_bs_get_changed_clusters */
+
+/* START blob_drain_io */
+
+/* How often a channel is checked for I/O still in flight to a frozen blob */
+#define BLOB_DRAIN_IO_POLL_PERIOD_US	100
+
+struct drain_io_ctx {
+	struct spdk_blob		*blob;
+	struct spdk_io_channel_iter	*iter;
+	struct spdk_poller		*poller;
+	spdk_blob_op_complete		cb_fn;
+	void				*cb_arg;
+};
+
+static bool
+bs_channel_blob_io_outstanding(struct spdk_bs_channel *ch, struct spdk_blob *blob)
+{
+	struct spdk_blob_copy_cluster_ctx *alloc;
+	uint32_t i;
+
+	for (i = 0; i < ch->bs->max_channel_ops; i++) {
+		if (ch->req_mem[i].blob == blob) {
+			return true;
+		}
+	}
+
+	TAILQ_FOREACH(alloc, &ch->cluster_allocs, link) {
+		if (alloc->blob == blob) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int
+blob_drain_io_poll(void *arg)
+{
+	struct drain_io_ctx *ctx = arg;
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(ctx->iter);
+
+	if (bs_channel_blob_io_outstanding(spdk_io_channel_get_ctx(_ch), ctx->blob)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&ctx->poller);
+	spdk_for_each_channel_continue(ctx->iter, 0);
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+blob_drain_io_iter(struct spdk_io_channel_iter *i)
+{
+	struct drain_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+
+	if (!bs_channel_blob_io_outstanding(spdk_io_channel_get_ctx(_ch), ctx->blob)) {
+		spdk_for_each_channel_continue(i, 0);
+		return;
+	}
+
+	ctx->iter = i;
+	ctx->poller = SPDK_POLLER_REGISTER(blob_drain_io_poll, ctx, BLOB_DRAIN_IO_POLL_PERIOD_US);
+}
+
+static void
+blob_drain_io_cpl(struct spdk_io_channel_iter *i, int status)
+{
+	struct drain_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+	free(ctx);
+}
+
+/*
+ * Wait for the I/O to a frozen blob that was submitted before the freeze to complete.
+ * blob_freeze_io() only holds back new I/O.
+ */
+static void
+blob_drain_io(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct drain_io_ctx *ctx;
+
+	assert(blob->frozen_refcnt > 0);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->blob = blob;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(blob->bs, blob_drain_io_iter, ctx, blob_drain_io_cpl);
+}
+
+/* END blob_drain_io */
+
+/* START spdk_bs_blob_dedup */
+
+/* Number of clusters compared while I/O to the blob is frozen */
+#define BS_DEDUP_BATCH_CLUSTERS 32
+
+struct blob_dedup_ctx {
+	struct spdk_bs_cpl		cpl;
+	int				bserrno;
+
+	struct spdk_blob		*blob;
+	struct spdk_io_channel		*channel;
+	bool				md_ro;
+
+	void				*buf;
+	void				*back_buf;
+
+	uint64_t			next_cluster;
+	uint64_t			batch_end;
+	uint32_t			next_released;
+	uint32_t			num_released;
+	/* Indices of the clusters of the blob released in the current batch */
+	uint64_t			released[BS_DEDUP_BATCH_CLUSTERS];
+	/* Matching cluster numbers on the blobstore device */
+	uint32_t			released_clusters[BS_DEDUP_BATCH_CLUSTERS];
+};
+
+static void bs_dedup_next_batch(struct blob_dedup_ctx *ctx);
+static void bs_dedup_compare_next(struct blob_dedup_ctx *ctx);
+
+static void
+bs_dedup_close_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	bs_call_cpl(&ctx->cpl, ctx->bserrno);
+	free(ctx);
+}
+
+static void
+bs_dedup_finish(struct blob_dedup_ctx *ctx, int bserrno)
+{
+	struct spdk_blob *blob = ctx->blob;
+
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	spdk_free(ctx->buf);
+	spdk_free(ctx->back_buf);
+
+	blob->md_ro = ctx->md_ro;
+	blob->locked_operation_in_progress = false;
+
+	spdk_blob_close(blob, bs_dedup_close_cpl, ctx);
+}
+
+static void
+bs_dedup_unfreeze_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+
+	if (ctx->bserrno != 0 || bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	bs_dedup_next_batch(ctx);
+}
+
+static void
+bs_dedup_sync_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob_store *bs = ctx->blob->bs;
+	uint32_t i;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to persist released clusters of blob 0x%" PRIx64 ": %d\n",
+			    ctx->blob->id, bserrno);
+		if (ctx->bserrno == 0) {
+			ctx->bserrno = bserrno;
+		}
+	} else {
+		/* The metadata no longer references the clusters, so they can be reused */
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		for (i = 0; i < ctx->num_released; i++) {
+			bs_release_cluster(bs, ctx->released_clusters[i]);
+		}
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+	}
+
+	blob_unfreeze_io(ctx->blob, bs_dedup_unfreeze_cpl, ctx);
+}
+
+static void
+bs_dedup_write_extent_pages(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t extent_page;
+
+	if (bserrno != 0) {
+		bs_dedup_sync_cpl(ctx, bserrno);
+		return;
+	}
+
+	/* Released clusters are in ascending order, write each extent page holding them once */
+	while (ctx->next_released < ctx->num_released) {
+		extent_page = ctx->released[ctx->next_released] / SPDK_EXTENTS_PER_EP;
+		while (ctx->next_released < ctx->num_released &&
+		       ctx->released[ctx->next_released] / SPDK_EXTENTS_PER_EP == extent_page) {
+			ctx->next_released++;
+		}
+
+		assert(blob->active.extent_pages[extent_page] != 0);
+		blob_write_extent_page(blob, blob->active.extent_pages[extent_page],
+				       extent_page * SPDK_EXTENTS_PER_EP, bs_dedup_write_extent_pages, ctx);
+		return;
+	}
+
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+	spdk_blob_sync_md(blob, bs_dedup_sync_cpl, ctx);
+}
+
+static void
+bs_dedup_persist(struct blob_dedup_ctx *ctx)
+{
+	if (ctx->num_released == 0) {
+		blob_unfreeze_io(ctx->blob, bs_dedup_unfreeze_cpl, ctx);
+		return;
+	}
+
+	/* Without extent table the cluster map is only stored in the blob metadata */
+	ctx->next_released = ctx->blob->use_extent_table ? 0 : ctx->num_released;
+	bs_dedup_write_extent_pages(ctx, 0);
+}
+
+static void
+bs_dedup_compare_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t cluster = ctx->next_cluster;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to compare cluster %" PRIu64 " of blob 0x%" PRIx64 ": %d\n",
+			    cluster, blob->id, bserrno);
+		ctx->bserrno = bserrno;
+		/* Persist the clusters already released in this batch */
+		bs_dedup_persist(ctx);
+		return;
+	}
+
+	if (memcmp(ctx->buf, ctx->back_buf, blob->bs->cluster_sz) == 0) {
+		/* I/O is frozen, so reads of the cluster go to the backing device from now on */
+		ctx->released[ctx->num_released] = cluster;
+		ctx->released_clusters[ctx->num_released] = bs_lba_to_cluster(blob->bs,
+				blob->active.clusters[cluster]);
+		ctx->num_released++;
+		blob->active.clusters[cluster] = 0;
+	}
+
+	ctx->next_cluster++;
+	bs_dedup_compare_next(ctx);
+}
+
+static void
+bs_dedup_read_back_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	bs_sequence_finish(seq, bserrno);
+}
+
+static void
+bs_dedup_read_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t page = ctx->next_cluster * blob->bs->pages_per_cluster;
+
+	if (bserrno != 0) {
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	bs_sequence_read_bs_dev(seq, blob->back_bs_dev, ctx->back_buf,
+				bs_dev_page_to_lba(blob->back_bs_dev, page),
+				bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz),
+				bs_dedup_read_back_cpl, ctx);
+}
+
+static void
+bs_dedup_compare_next(struct blob_dedup_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+
+	while (ctx->next_cluster < ctx->batch_end && blob->active.clusters[ctx->next_cluster] == 0) {
+		ctx->next_cluster++;
+	}
+
+	if (ctx->next_cluster == ctx->batch_end) {
+		bs_dedup_persist(ctx);
+		return;
+	}
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = bs_dedup_compare_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	seq = bs_sequence_start(ctx->channel, &cpl);
+	if (!seq) {
+		ctx->bserrno = -ENOMEM;
+		bs_dedup_persist(ctx);
+		return;
+	}
+
+	bs_sequence_read_dev(seq, ctx->buf, blob->active.clusters[ctx->next_cluster],
+			     bs_cluster_to_lba(blob->bs, 1), bs_dedup_read_cpl, ctx);
+}
+
+static void
+bs_dedup_drain_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		ctx->bserrno = bserrno;
+		blob_unfreeze_io(ctx->blob, bs_dedup_unfreeze_cpl, ctx);
+		return;
+	}
+
+	ctx->batch_end = spdk_min(ctx->next_cluster + BS_DEDUP_BATCH_CLUSTERS,
+				  ctx->blob->active.num_clusters);
+	ctx->num_released = 0;
+	bs_dedup_compare_next(ctx);
+}
+
+static void
+bs_dedup_freeze_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	/* Writes issued before the freeze may still land on the clusters being compared */
+	blob_drain_io(ctx->blob, bs_dedup_drain_cpl, ctx);
+}
+
+static void
+bs_dedup_next_batch(struct blob_dedup_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+
+	while (ctx->next_cluster < blob->active.num_clusters &&
+	       blob->active.clusters[ctx->next_cluster] == 0) {
+		ctx->next_cluster++;
+	}
+
+	if (ctx->next_cluster == blob->active.num_clusters) {
+		bs_dedup_finish(ctx, 0);
+		return;
+	}
+
+	blob_freeze_io(blob, bs_dedup_freeze_cpl, ctx);
+}
+
+static void
+bs_dedup_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+{
+	struct blob_dedup_ctx *ctx = cb_arg;
+	uint32_t blocklen;
+
+	if (bserrno != 0) {
+		bs_call_cpl(&ctx->cpl, bserrno);
+		free(ctx);
+		return;
+	}
+
+	ctx->blob = _blob;
+
+	if (_blob->locked_operation_in_progress) {
+		SPDK_DEBUGLOG(blob, "Cannot deduplicate blob - another operation in progress\n");
+		ctx->bserrno = -EBUSY;
+		spdk_blob_close(_blob, bs_dedup_close_cpl, ctx);
+		return;
+	}
+
+	if (!spdk_blob_is_thin_provisioned(_blob)) {
+		SPDK_ERRLOG("Blob 0x%" PRIx64 " is not thin provisioned\n", _blob->id);
+		ctx->bserrno = -EINVAL;
+		spdk_blob_close(_blob, bs_dedup_close_cpl, ctx);
+		return;
+	}
+
+	if (spdk_blob_is_snapshot(_blob)) {
+		SPDK_ERRLOG("Cannot deduplicate snapshot 0x%" PRIx64 "\n", _blob->id);
+		ctx->bserrno = -EPERM;
+		spdk_blob_close(_blob, bs_dedup_close_cpl, ctx);
+		return;
+	}
+
+	_blob->locked_operation_in_progress = true;
+
+	/* Temporarily override md_ro flag for MD modification */
+	ctx->md_ro = _blob->md_ro;
+	_blob->md_ro = false;
+
+	blocklen = spdk_max(_blob->bs->dev->blocklen, _blob->back_bs_dev->blocklen);
+	ctx->buf = spdk_malloc(_blob->bs->cluster_sz, blocklen, NULL,
+			       SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->back_buf = spdk_malloc(_blob->bs->cluster_sz, blocklen, NULL,
+				    SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (ctx->buf == NULL || ctx->back_buf == NULL) {
+		bs_dedup_finish(ctx, -ENOMEM);
+		return;
+	}
+
+	bs_dedup_next_batch(ctx);
+}
+
+void
+spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		   spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct blob_dedup_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	ctx->cpl.u.blob_basic.cb_fn = cb_fn;
+	ctx->cpl.u.blob_basic.cb_arg = cb_arg;
+	ctx->channel = channel;
+
+	spdk_bs_open_blob(bs, blobid, bs_dedup_open_cpl, ctx);
+}
+/* END spdk_bs_blob_dedup */
+
+/* START spdk_blob_resize */
+struct spdk_bs_resize_ctx {
+	spdk_blob_op_complete cb_fn;
+	void *cb_arg;
+	struct spdk_blob *blob;
+	uint64_t sz;
+	int rc;
+};
+
+static void
+bs_resize_unfreeze_cpl(void *cb_arg, int rc)
+{
+	struct spdk_bs_resize_ctx *ctx = (struct spdk_bs_resize_ctx *)cb_arg;
+
+	if (rc != 0) {
+		SPDK_ERRLOG("Unfreeze failed, rc=%d\n", rc);
+	}
+
+	if (ctx->rc != 0) {
+		SPDK_ERRLOG("Unfreeze failed, ctx->rc=%d\n", ctx->rc);
+		rc = ctx->rc;
+	}
+
+	ctx->blob->locked_operation_in_progress = false;
+
+	ctx->cb_fn(ctx->cb_arg, rc);
 	free(ctx);
 }
 
@@ -6547,6 +8149,7 @@ void
 spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_bs_resize_ctx *ctx;
+	struct spdk_bs_dev *esnap_dev;
 
 	blob_verify_md_op(blob);
 
@@ -6562,6 +8165,14 @@ spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_f
 		return;
 	}
 
+	esnap_dev = blob->back_bs_dev;
+	if (spdk_blob_is_esnap_clone(blob) && esnap_dev != NULL && sz > blob->active.num_clusters &&
+	    sz > esnap_dev->blockcnt / bs_dev_byte_to_lba(esnap_dev, blob->bs->cluster_sz)) {
+		/* Unallocated clusters past the end of the external snapshot could not be read */
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
 	if (blob->locked_operation_in_progress) {
 		cb_fn(cb_arg, -EBUSY);
 		return;
@@ -6727,7 +8338,8 @@ delete_snapshot_sync_snapshot_cpl(void *cb_arg, int bserrno)
 	snapshot_entry->clone_count--;
 	assert(TAILQ_EMPTY(&snapshot_entry->clones));
 
-	if (ctx->snapshot->parent_id != SPDK_BLOBID_INVALID) {
+	if (ctx->snapshot->parent_id != SPDK_BLOBID_INVALID &&
+	    ctx->snapshot->parent_id != SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
 		/* This snapshot is at the same time a clone of another snapshot - we need to
 		 * update parent snapshot (remove current clone, add new one inherited from
 		 * the snapshot that is being removed) */
@@ -6782,6 +8394,7 @@ delete_snapshot_sync_clone_cpl(void *cb_arg, int bserrno)
 			ctx->snapshot->active.clusters[i] = 0;
 		}
 	}
+	bs_chain_maps_update(ctx->clone->bs);
 	for (i = 0; i < ctx->snapshot->active.num_extent_pages &&
 	     i < ctx->clone->active.num_extent_pages; i++) {
 		if (ctx->clone->active.extent_pages[i] == ctx->snapshot->active.extent_pages[i]) {
@@ -6792,7 +8405,9 @@ delete_snapshot_sync_clone_cpl(void *cb_arg, int bserrno)
 	blob_set_thin_provision(ctx->snapshot);
 	ctx->snapshot->state = SPDK_BLOB_STATE_DIRTY;
 
-	if (ctx->parent_snapshot_entry != NULL) {
+	if (ctx->parent_snapshot_entry != NULL ||
+	    ctx->snapshot->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		/* Back device was handed over to the clone */
 		ctx->snapshot->back_bs_dev = NULL;
 	}
 
@@ -6802,6 +8417,9 @@ delete_snapshot_sync_clone_cpl(void *cb_arg, int bserrno)
 static void
 delete_snapshot_update_extent_pages_cpl(struct delete_snapshot_ctx *ctx)
 {
+	const void *esnap_id;
+	size_t esnap_id_len;
+
 	/* Delete old backing bs_dev from clone (related to snapshot that will be removed) */
 	ctx->clone->back_bs_dev->destroy(ctx->clone->back_bs_dev);
 
@@ -6813,6 +8431,16 @@ delete_snapshot_update_extent_pages_cpl(struct delete_snapshot_ctx *ctx)
 		blob_set_xattr(ctx->clone, BLOB_SNAPSHOT, &ctx->parent_snapshot_entry->id,
 			       sizeof(spdk_blob_id),
 			       true);
+	} else if (ctx->snapshot->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		/* ...to the external snapshot of the snapshot */
+		ctx->clone->parent_id = SPDK_BLOBID_EXTERNAL_SNAPSHOT;
+		ctx->clone->back_bs_dev = ctx->snapshot->back_bs_dev;
+		ctx->clone->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
+		if (blob_get_xattr_value(ctx->snapshot, BLOB_EXTERNAL_SNAPSHOT_ID, &esnap_id,
+					 &esnap_id_len, true) == 0) {
+			blob_set_xattr(ctx->clone, BLOB_EXTERNAL_SNAPSHOT_ID, esnap_id, esnap_id_len, true);
+		}
+		blob_remove_xattr(ctx->clone, BLOB_SNAPSHOT, true);
 	} else {
 		/* ...to blobid invalid and zeroes dev */
 		ctx->clone->parent_id = SPDK_BLOBID_INVALID;
@@ -7329,36 +8957,121 @@ struct spdk_blob_insert_cluster_ctx {
 	int			rc;
 	spdk_blob_op_complete	cb_fn;
 	void			*cb_arg;
+	TAILQ_ENTRY(spdk_blob_insert_cluster_ctx) link;
 };
 
+/* Tracks an extent page write on the md thread. Cluster inserts that land in the
+ * same extent page while the write is outstanding wait here and are persisted
+ * together by a single rewrite of the page. */
+struct spdk_blob_extent_page_update {
+	struct spdk_blob					*blob;
+	uint64_t						extent_table_id;
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx)		in_flight;
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx)		waiting;
+	TAILQ_ENTRY(spdk_blob_extent_page_update)		link;
+};
+
+static void
+blob_insert_cluster_release_extent_page(struct spdk_blob_insert_cluster_ctx *ctx)
+{
+	struct spdk_blob_store *bs = ctx->blob->bs;
+
+	if (ctx->extent_page == 0) {
+		return;
+	}
+
+	assert(spdk_bit_array_get(bs->used_md_pages, ctx->extent_page) == true);
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	bs_release_md_page(bs, ctx->extent_page);
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+	ctx->extent_page = 0;
+}
+
 static void
 blob_insert_cluster_msg_cpl(void *arg)
 {
 	struct spdk_blob_insert_cluster_ctx *ctx = arg;
 
-	ctx->cb_fn(ctx->cb_arg, ctx->rc);
-	free(ctx);
+	ctx->cb_fn(ctx->cb_arg, ctx->rc);
+	free(ctx);
+}
+
+static void
+blob_insert_cluster_msg_cb(void *arg, int bserrno)
+{
+	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+
+	ctx->rc = bserrno;
+	spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
+}
+
+static void blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster_num,
+				   spdk_blob_op_complete cb_fn, void *cb_arg);
+
+static void
+blob_extent_page_update_cpl(void *arg, int bserrno)
+{
+	struct spdk_blob_extent_page_update *update = arg;
+	struct spdk_blob_insert_cluster_ctx *ctx;
+	uint32_t *extent_page;
+
+	while (!TAILQ_EMPTY(&update->in_flight)) {
+		ctx = TAILQ_FIRST(&update->in_flight);
+		TAILQ_REMOVE(&update->in_flight, ctx, link);
+		blob_insert_cluster_msg_cb(ctx, bserrno);
+	}
+
+	if (TAILQ_EMPTY(&update->waiting)) {
+		TAILQ_REMOVE(&update->blob->extent_page_updates, update, link);
+		free(update);
+		return;
+	}
+
+	if (bserrno != 0) {
+		while (!TAILQ_EMPTY(&update->waiting)) {
+			ctx = TAILQ_FIRST(&update->waiting);
+			TAILQ_REMOVE(&update->waiting, ctx, link);
+			blob_insert_cluster_msg_cb(ctx, bserrno);
+		}
+		TAILQ_REMOVE(&update->blob->extent_page_updates, update, link);
+		free(update);
+		return;
+	}
+
+	/* Persist all clusters inserted in the meantime with a single write */
+	TAILQ_SWAP(&update->in_flight, &update->waiting, spdk_blob_insert_cluster_ctx, link);
+	ctx = TAILQ_FIRST(&update->in_flight);
+	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
+	assert(*extent_page != 0);
+	blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num,
+			       blob_extent_page_update_cpl, update);
 }
 
 static void
-blob_insert_cluster_msg_cb(void *arg, int bserrno)
+blob_insert_new_ep_sync_cb(void *arg, int bserrno)
 {
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+	struct spdk_blob_extent_page_update *update = arg;
 
-	ctx->rc = bserrno;
-	spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
+	blob_extent_page_update_cpl(update, bserrno);
 }
 
 static void
 blob_insert_new_ep_cb(void *arg, int bserrno)
 {
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+	struct spdk_blob_extent_page_update *update = arg;
+	struct spdk_blob_insert_cluster_ctx *ctx = TAILQ_FIRST(&update->in_flight);
 	uint32_t *extent_page;
 
+	if (bserrno != 0) {
+		blob_insert_cluster_release_extent_page(ctx);
+		blob_extent_page_update_cpl(update, bserrno);
+		return;
+	}
+
 	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
 	*extent_page = ctx->extent_page;
 	ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-	blob_sync_md(ctx->blob, blob_insert_cluster_msg_cb, ctx);
+	blob_sync_md(ctx->blob, blob_insert_new_ep_sync_cb, update);
 }
 
 static void
@@ -7412,8 +9125,12 @@ blob_insert_cluster_msg(void *arg)
 	struct spdk_blob_insert_cluster_ctx *ctx = arg;
 	uint32_t *extent_page;
 
+	struct spdk_blob_extent_page_update *update;
+	uint64_t extent_table_id;
+
 	ctx->rc = blob_insert_cluster(ctx->blob, ctx->cluster_num, ctx->cluster);
 	if (ctx->rc != 0) {
+		blob_insert_cluster_release_extent_page(ctx);
 		spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
 		return;
 	}
@@ -7425,6 +9142,32 @@ blob_insert_cluster_msg(void *arg)
 		return;
 	}
 
+	extent_table_id = bs_cluster_to_extent_table_id(ctx->cluster_num);
+	TAILQ_FOREACH(update, &ctx->blob->extent_page_updates, link) {
+		if (update->extent_table_id == extent_table_id) {
+			/* A write of this extent page is already outstanding. It either
+			 * allocates the extent page or updates it, so the one possibly
+			 * claimed for this cluster is not needed. The cluster will be
+			 * persisted by rewriting the page once the outstanding write is done. */
+			blob_insert_cluster_release_extent_page(ctx);
+			TAILQ_INSERT_TAIL(&update->waiting, ctx, link);
+			return;
+		}
+	}
+
+	update = calloc(1, sizeof(*update));
+	if (update == NULL) {
+		blob_insert_cluster_release_extent_page(ctx);
+		blob_insert_cluster_msg_cb(ctx, -ENOMEM);
+		return;
+	}
+	update->blob = ctx->blob;
+	update->extent_table_id = extent_table_id;
+	TAILQ_INIT(&update->in_flight);
+	TAILQ_INIT(&update->waiting);
+	TAILQ_INSERT_TAIL(&update->in_flight, ctx, link);
+	TAILQ_INSERT_TAIL(&ctx->blob->extent_page_updates, update, link);
+
 	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
 	if (*extent_page == 0) {
 		/* Extent page requires allocation.
@@ -7432,20 +9175,16 @@ blob_insert_cluster_msg(void *arg)
 		assert(ctx->extent_page != 0);
 		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
 		blob_write_extent_page(ctx->blob, ctx->extent_page, ctx->cluster_num,
-				       blob_insert_new_ep_cb, ctx);
+				       blob_insert_new_ep_cb, update);
 	} else {
 		/* It is possible for original thread to allocate extent page for
 		 * different cluster in the same extent page. In such case proceed with
 		 * updating the existing extent page, but release the additional one. */
-		if (ctx->extent_page != 0) {
-			assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-			bs_release_md_page(ctx->blob->bs, ctx->extent_page);
-			ctx->extent_page = 0;
-		}
+		blob_insert_cluster_release_extent_page(ctx);
 		/* Extent page already allocated.
 		 * Every cluster allocation, requires just an update of single extent page. */
 		blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num,
-				       blob_insert_cluster_msg_cb, ctx);
+				       blob_extent_page_update_cpl, update);
 	}
 }
 
@@ -7472,6 +9211,288 @@ blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
 	spdk_thread_send_msg(blob->bs->md_thread, blob_insert_cluster_msg, ctx);
 }
 
+/* START spdk_blob_preallocate */
+
+struct spdk_blob_preallocate_ctx;
+
+struct spdk_blob_preallocate_cluster {
+	struct spdk_blob_preallocate_ctx	*ctx;
+	/* Cluster claimed on disk, UINT32_MAX if the blob cluster was already allocated */
+	uint32_t				cluster;
+};
+
+struct spdk_blob_preallocate_ctx {
+	struct spdk_blob			*blob;
+	uint64_t				offset;
+	uint64_t				length;
+	struct spdk_blob_preallocate_cluster	*clusters;
+	uint64_t				outstanding_inserts;
+	int					rc;
+	spdk_blob_op_complete			cb_fn;
+	void					*cb_arg;
+};
+
+static void
+blob_preallocate_finish(struct spdk_blob_preallocate_ctx *ctx, int bserrno)
+{
+	ctx->blob->locked_operation_in_progress = false;
+	ctx->cb_fn(ctx->cb_arg, bserrno);
+	free(ctx->clusters);
+	free(ctx);
+}
+
+static bool
+blob_extent_page_update_pending(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	struct spdk_blob_extent_page_update *update;
+	uint64_t extent_table_id = bs_cluster_to_extent_table_id(cluster_num);
+
+	TAILQ_FOREACH(update, &blob->extent_page_updates, link) {
+		if (update->extent_table_id == extent_table_id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+blob_preallocate_insert_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_preallocate_cluster *cluster = cb_arg;
+	struct spdk_blob_preallocate_ctx *ctx = cluster->ctx;
+	struct spdk_blob_store *bs = ctx->blob->bs;
+
+	if (bserrno != 0) {
+		/* The extent page, if any, was already released on md thread. */
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		bs_release_cluster(bs, cluster->cluster);
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+		if (bserrno != -EEXIST && ctx->rc == 0) {
+			ctx->rc = bserrno;
+		}
+		/* Otherwise the cluster was allocated by a write meanwhile */
+	}
+
+	assert(ctx->outstanding_inserts > 0);
+	if (--ctx->outstanding_inserts == 0) {
+		blob_preallocate_finish(ctx, ctx->rc);
+	}
+}
+
+static void
+blob_preallocate_zeroes_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_preallocate_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t cluster_num;
+	uint64_t extent_table_id;
+	uint64_t last_extent_table_id = UINT64_MAX;
+	uint32_t extent_page;
+	uint32_t lfmd = 0;
+	uint64_t i;
+
+	if (bserrno != 0) {
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		for (i = 0; i < ctx->length; i++) {
+			if (ctx->clusters[i].cluster != UINT32_MAX) {
+				bs_release_cluster(bs, ctx->clusters[i].cluster);
+			}
+		}
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+		blob_preallocate_finish(ctx, bserrno);
+		return;
+	}
+
+	/* Insert the clusters the same way as ones allocated by writes, so that
+	 * updates of the same extent page are coalesced on md thread. */
+	ctx->outstanding_inserts = 1;
+	for (i = 0; i < ctx->length; i++) {
+		if (ctx->clusters[i].cluster == UINT32_MAX) {
+			continue;
+		}
+
+		cluster_num = ctx->offset + i;
+		extent_table_id = bs_cluster_to_extent_table_id(cluster_num);
+		extent_page = 0;
+		/* Only the first insert into a missing extent page needs a md page. The inserts
+		 * that follow into the same page find its update outstanding on md thread. */
+		if (blob->use_extent_table && *bs_cluster_to_extent_page(blob, cluster_num) == 0 &&
+		    extent_table_id != last_extent_table_id &&
+		    !blob_extent_page_update_pending(blob, cluster_num)) {
+			last_extent_table_id = extent_table_id;
+			pthread_mutex_lock(&bs->used_clusters_mutex);
+			if (bs_claim_extent_page(bs, &lfmd) != 0) {
+				bs_release_cluster(bs, ctx->clusters[i].cluster);
+				pthread_mutex_unlock(&bs->used_clusters_mutex);
+				ctx->rc = -ENOSPC;
+				continue;
+			}
+			pthread_mutex_unlock(&bs->used_clusters_mutex);
+			extent_page = lfmd;
+		}
+
+		ctx->outstanding_inserts++;
+		blob_insert_cluster_on_md_thread(blob, cluster_num, ctx->clusters[i].cluster, extent_page,
+						 blob_preallocate_insert_cpl, &ctx->clusters[i]);
+	}
+
+	if (--ctx->outstanding_inserts == 0) {
+		blob_preallocate_finish(ctx, ctx->rc);
+	}
+}
+
+static void
+blob_preallocate_zero_clusters(struct spdk_blob_preallocate_ctx *ctx)
+{
+	struct spdk_blob_store *bs = ctx->blob->bs;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_batch_t *batch;
+	uint32_t start = UINT32_MAX;
+	uint32_t count = 0;
+	uint64_t i;
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = blob_preallocate_zeroes_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	batch = bs_batch_open(bs->md_channel, &cpl);
+	if (!batch) {
+		blob_preallocate_zeroes_cpl(ctx, -ENOMEM);
+		return;
+	}
+
+	/* Zero each run of clusters that are contiguous on disk with a single request */
+	for (i = 0; i < ctx->length; i++) {
+		if (ctx->clusters[i].cluster == UINT32_MAX) {
+			continue;
+		}
+		if (count != 0 && ctx->clusters[i].cluster == start + count) {
+			count++;
+			continue;
+		}
+		if (count != 0) {
+			bs_batch_write_zeroes_dev(batch, bs_cluster_to_lba(bs, start),
+						  bs_cluster_to_lba(bs, count));
+		}
+		start = ctx->clusters[i].cluster;
+		count = 1;
+	}
+	if (count != 0) {
+		bs_batch_write_zeroes_dev(batch, bs_cluster_to_lba(bs, start),
+					  bs_cluster_to_lba(bs, count));
+	}
+
+	bs_batch_close(batch);
+}
+
+void
+spdk_blob_preallocate(struct spdk_blob *blob, uint64_t offset, uint64_t length,
+		      spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_blob_preallocate_ctx *ctx;
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t num_unallocated = 0;
+	uint32_t hint;
+	uint64_t i;
+
+	blob_verify_md_op(blob);
+
+	SPDK_DEBUGLOG(blob, "Preallocating %" PRIu64 " clusters at %" PRIu64 " of blob %" PRIu64 "\n",
+		      length, offset, blob->id);
+
+	if (blob->md_ro || blob->data_ro) {
+		cb_fn(cb_arg, -EPERM);
+		return;
+	}
+
+	if (blob->parent_id != SPDK_BLOBID_INVALID ||
+	    offset > blob->active.num_clusters || length > blob->active.num_clusters - offset) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	if (blob->locked_operation_in_progress) {
+		cb_fn(cb_arg, -EBUSY);
+		return;
+	}
+
+	for (i = offset; i < offset + length; i++) {
+		if (blob->active.clusters[i] == 0) {
+			num_unallocated++;
+		}
+	}
+
+	if (num_unallocated == 0) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
+	if (num_unallocated > bs->num_free_clusters) {
+		cb_fn(cb_arg, -ENOSPC);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->clusters = calloc(length, sizeof(*ctx->clusters));
+	if (!ctx->clusters) {
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	blob->locked_operation_in_progress = true;
+	ctx->blob = blob;
+	ctx->offset = offset;
+	ctx->length = length;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	/* Clusters are only claimed here. They are added to the blob after zeroing,
+	 * so that reads of the range keep returning zeroes meanwhile. */
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	hint = UINT32_MAX;
+	for (i = 0; i < length; i++) {
+		ctx->clusters[i].ctx = ctx;
+		if (blob->active.clusters[offset + i] != 0) {
+			ctx->clusters[i].cluster = UINT32_MAX;
+			hint = UINT32_MAX;
+			continue;
+		}
+		if (hint == UINT32_MAX) {
+			hint = bs_blob_cluster_hint(blob, offset + i);
+		}
+		ctx->clusters[i].cluster = bs_claim_cluster(bs, hint);
+		if (ctx->clusters[i].cluster == UINT32_MAX) {
+			/* Clusters were claimed by other threads meanwhile */
+			break;
+		}
+		hint = ctx->clusters[i].cluster + 1;
+		blob->next_cluster_hint = hint;
+	}
+	if (i < length) {
+		while (i-- > 0) {
+			if (ctx->clusters[i].cluster != UINT32_MAX) {
+				bs_release_cluster(bs, ctx->clusters[i].cluster);
+			}
+		}
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+		blob_preallocate_finish(ctx, -ENOSPC);
+		return;
+	}
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+	blob_preallocate_zero_clusters(ctx);
+}
+
+/* END spdk_blob_preallocate */
+
 /* START spdk_blob_close */
 
 static void
@@ -7499,6 +9520,20 @@ blob_close_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	bs_sequence_finish(seq, bserrno);
 }
 
+static void
+blob_close_esnap_channels_cpl(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	spdk_bs_sequence_t *seq = cb_arg;
+
+	if (bserrno != 0) {
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	/* Sync metadata */
+	blob_persist(seq, blob, blob_close_cpl, blob);
+}
+
 void spdk_blob_close(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_bs_cpl	cpl;
@@ -7523,6 +9558,13 @@ void spdk_blob_close(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *
 		return;
 	}
 
+	if (blob->open_ref == 1) {
+		/* Last reference, channels to the external snapshot device go away with it */
+		blob_esnap_destroy_channels(blob, blob->back_bs_dev, blob_close_esnap_channels_cpl,
+					    seq);
+		return;
+	}
+
 	/* Sync metadata */
 	blob_persist(seq, blob, blob_close_cpl, blob);
 }
@@ -7912,7 +9954,8 @@ spdk_blob_is_clone(struct spdk_blob *blob)
 {
 	assert(blob != NULL);
 
-	if (blob->parent_id != SPDK_BLOBID_INVALID) {
+	if (blob->parent_id != SPDK_BLOBID_INVALID &&
+	    blob->parent_id != SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
 		assert(spdk_blob_is_thin_provisioned(blob));
 		return true;
 	}
@@ -7920,6 +9963,128 @@ spdk_blob_is_clone(struct spdk_blob *blob)
 	return false;
 }
 
+bool
+spdk_blob_is_esnap_clone(const struct spdk_blob *blob)
+{
+	assert(blob != NULL);
+
+	return !!(blob->invalid_flags & SPDK_BLOB_EXTERNAL_SNAPSHOT);
+}
+
+int
+spdk_blob_get_esnap_id(struct spdk_blob *blob, const void **id, size_t *len)
+{
+	assert(blob != NULL);
+
+	if (!spdk_blob_is_esnap_clone(blob)) {
+		return -EINVAL;
+	}
+
+	return blob_get_xattr_value(blob, BLOB_EXTERNAL_SNAPSHOT_ID, id, len, true);
+}
+
+static void
+esnap_missing_destroy(struct spdk_bs_dev *bs_dev)
+{
+	return;
+}
+
+static void
+esnap_missing_read(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
+		   uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -EIO);
+}
+
+static void
+esnap_missing_readv(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
+		    struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count,
+		    struct spdk_bs_dev_cb_args *cb_args)
+{
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -EIO);
+}
+
+/* Backs esnap clones whose external snapshot went away. Reads of clusters that
+ * are not allocated in the clone fail. */
+static struct spdk_bs_dev g_esnap_missing_bs_dev = {
+	.blockcnt = UINT64_MAX,
+	.blocklen = 512,
+	.create_channel = NULL,
+	.destroy_channel = NULL,
+	.destroy = esnap_missing_destroy,
+	.read = esnap_missing_read,
+	.readv = esnap_missing_readv,
+};
+
+struct blob_remove_esnap_dev_ctx {
+	struct spdk_bs_dev	*esnap_dev;
+	spdk_blob_op_complete	cb_fn;
+	void			*cb_arg;
+};
+
+static void
+blob_remove_esnap_dev_cpl(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	struct blob_remove_esnap_dev_ctx *ctx = cb_arg;
+
+	/* No channel refers to the device anymore */
+	ctx->esnap_dev->destroy(ctx->esnap_dev);
+	ctx->cb_fn(ctx->cb_arg, bserrno);
+	free(ctx);
+}
+
+void
+spdk_blob_remove_esnap_dev(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct blob_remove_esnap_dev_ctx *ctx;
+
+	blob_verify_md_op(blob);
+
+	if (!spdk_blob_is_esnap_clone(blob) || blob->back_bs_dev == NULL) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	if (blob->back_bs_dev == &g_esnap_missing_bs_dev) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->esnap_dev = blob->back_bs_dev;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	SPDK_NOTICELOG("External snapshot of blob 0x%" PRIx64 " removed, blob is degraded\n",
+		       blob->id);
+
+	/* New reads go to the missing device right away, then the channels to the
+	 * removed one are released on each thread before it is destroyed. */
+	blob->back_bs_dev = &g_esnap_missing_bs_dev;
+	bs_chain_maps_update(blob->bs);
+	blob_esnap_destroy_channels(blob, ctx->esnap_dev, blob_remove_esnap_dev_cpl, ctx);
+}
+
+bool
+spdk_blob_is_degraded(struct spdk_blob *blob)
+{
+	struct spdk_blob *b;
+
+	assert(blob != NULL);
+
+	for (b = blob; b != NULL; b = blob_chain_parent(b)) {
+		if (b->back_bs_dev == &g_esnap_missing_bs_dev) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 bool
 spdk_blob_is_thin_provisioned(struct spdk_blob *blob)
 {
@@ -171,9 +171,24 @@ struct spdk_blob {
 	TAILQ_HEAD(, spdk_blob_persist_ctx) pending_persists;
 	TAILQ_HEAD(, spdk_blob_persist_ctx) persists_to_complete;
 
+	/* Extent page writes in progress on the md thread for cluster inserts */
+	TAILQ_HEAD(, spdk_blob_extent_page_update) extent_page_updates;
+
 	/* Number of data clusters retrieved from extent table,
 	 * that many have to be read from extent pages. */
 	uint64_t	remaining_clusters_in_et;
+
+	/* Cluster on disk to try first when allocating a cluster that has
+	 * no allocated neighbours in the blob, UINT32_MAX if none was allocated yet. */
+	uint32_t	next_cluster_hint;
+
+	/* Set up for a snapshot once its clones read through it. For each cluster, the
+	 * LBA of the cluster in the nearest blob of the snapshot chain that has it
+	 * allocated, or 0 if the cluster is read from chain_end_dev. Kept up to date
+	 * on the md thread when the chain changes. */
+	uint64_t	*chain_map;
+	uint64_t	chain_map_len;
+	struct spdk_bs_dev *chain_end_dev;
 };
 
 struct spdk_blob_store {
@@ -182,6 +197,13 @@ struct spdk_blob_store {
 
 	struct spdk_io_channel		*md_channel;
 	uint32_t			max_channel_ops;
+	uint32_t			channel_reserved_clusters;
+
+	/* Cluster to try first for the first cluster of a blob. Protected by used_clusters_mutex. */
+	uint32_t			first_cluster_hint;
+
+	spdk_bs_esnap_dev_create	esnap_bs_dev_create;
+	void				*esnap_ctx;
 
 	struct spdk_thread		*md_thread;
 
@@ -214,6 +236,13 @@ struct spdk_blob_store {
 	bool				clean;
 };
 
+/* I/O channel of an external snapshot device, created on first use by a bs channel */
+struct blob_esnap_channel {
+	RB_ENTRY(blob_esnap_channel)	node;
+	struct spdk_bs_dev		*dev;
+	struct spdk_io_channel		*channel;
+};
+
 struct spdk_bs_channel {
 	struct spdk_bs_request_set	*req_mem;
 	TAILQ_HEAD(, spdk_bs_request_set) reqs;
@@ -225,6 +254,19 @@ struct spdk_bs_channel {
 
 	TAILQ_HEAD(, spdk_bs_request_set) need_cluster_alloc;
 	TAILQ_HEAD(, spdk_bs_request_set) queued_io;
+
+	/* Cluster allocations in progress on this channel */
+	TAILQ_HEAD(, spdk_blob_copy_cluster_ctx) cluster_allocs;
+	uint32_t			num_cluster_allocs;
+
+	/* Clusters claimed from the blobstore for allocations on this channel,
+	 * the ones from reserved_clusters_head to num_reserved_clusters are unused. */
+	uint32_t			*reserved_clusters;
+	uint32_t			reserved_clusters_head;
+	uint32_t			num_reserved_clusters;
+
+	/* Channels to external snapshot devices, keyed by device */
+	RB_HEAD(blob_esnap_channel_tree, blob_esnap_channel) esnap_channels;
 };
 
 /** operation type */
@@ -242,6 +284,7 @@ enum spdk_blob_op_type {
 #define BLOB_SNAPSHOT "SNAP"
 #define SNAPSHOT_IN_PROGRESS "SNAPTMP"
 #define SNAPSHOT_PENDING_REMOVAL "SNAPRM"
+#define BLOB_EXTERNAL_SNAPSHOT_ID "EXTSNAP"
 
 struct spdk_blob_bs_dev {
 	struct spdk_bs_dev bs_dev;
@@ -339,7 +382,9 @@ struct spdk_blob_md_descriptor_extent_page {
 #define SPDK_BLOB_THIN_PROV (1ULL << 0)
 #define SPDK_BLOB_INTERNAL_XATTR (1ULL << 1)
 #define SPDK_BLOB_EXTENT_TABLE (1ULL << 2)
-#define SPDK_BLOB_INVALID_FLAGS_MASK	(SPDK_BLOB_THIN_PROV | SPDK_BLOB_INTERNAL_XATTR | SPDK_BLOB_EXTENT_TABLE)
+#define SPDK_BLOB_EXTERNAL_SNAPSHOT (1ULL << 3)
+#define SPDK_BLOB_INVALID_FLAGS_MASK	(SPDK_BLOB_THIN_PROV | SPDK_BLOB_INTERNAL_XATTR | \
+					 SPDK_BLOB_EXTENT_TABLE | SPDK_BLOB_EXTERNAL_SNAPSHOT)
 
 #define SPDK_BLOB_READ_ONLY (1ULL << 0)
 #define SPDK_BLOB_DATA_RO_FLAGS_MASK	SPDK_BLOB_READ_ONLY
@@ -437,6 +482,9 @@ SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_super_block) == 0x1000, "Invalid super
 
 struct spdk_bs_dev *bs_create_zeroes_dev(void);
 struct spdk_bs_dev *bs_create_blob_bs_dev(struct spdk_blob *blob);
+struct spdk_io_channel *bs_back_dev_channel(struct spdk_bs_channel *channel,
+		struct spdk_bs_dev *bs_dev);
+void blob_chain_map_init(struct spdk_blob *blob);
 
 /* Unit Conversions
  *
@@ -85,6 +85,7 @@ bs_request_set_complete(struct spdk_bs_request_set *set)
 	struct spdk_bs_cpl cpl = set->cpl;
 	int bserrno = set->bserrno;
 
+	set->blob = NULL;
 	TAILQ_INSERT_TAIL(&set->channel->reqs, set, link);
 
 	bs_call_cpl(&cpl, bserrno);
@@ -132,6 +133,7 @@ bs_sequence_read_bs_dev(spdk_bs_sequence_t *seq, struct spdk_bs_dev *bs_dev,
 {
 	struct spdk_bs_request_set      *set = (struct spdk_bs_request_set *)seq;
 	struct spdk_bs_channel       *channel = set->channel;
+	struct spdk_io_channel		*back_channel;
 
 	SPDK_DEBUGLOG(blob_rw, "Reading %" PRIu32 " blocks from LBA %" PRIu64 "\n", lba_count,
 		      lba);
@@ -139,7 +141,13 @@ bs_sequence_read_bs_dev(spdk_bs_sequence_t *seq, struct spdk_bs_dev *bs_dev,
 	set->u.sequence.cb_fn = cb_fn;
 	set->u.sequence.cb_arg = cb_arg;
 
-	bs_dev->read(bs_dev, spdk_io_channel_from_ctx(channel), payload, lba, lba_count, &set->cb_args);
+	back_channel = bs_back_dev_channel(channel, bs_dev);
+	if (back_channel == NULL) {
+		set->cb_args.cb_fn(set->cb_args.channel, set->cb_args.cb_arg, -ENOMEM);
+		return;
+	}
+
+	bs_dev->read(bs_dev, back_channel, payload, lba, lba_count, &set->cb_args);
 }
 
 void
@@ -184,6 +192,7 @@ bs_sequence_readv_bs_dev(spdk_bs_sequence_t *seq, struct spdk_bs_dev *bs_dev,
 {
 	struct spdk_bs_request_set      *set = (struct spdk_bs_request_set *)seq;
 	struct spdk_bs_channel       *channel = set->channel;
+	struct spdk_io_channel		*back_channel;
 
 	SPDK_DEBUGLOG(blob_rw, "Reading %" PRIu32 " blocks from LBA %" PRIu64 "\n", lba_count,
 		      lba);
@@ -191,8 +200,13 @@ bs_sequence_readv_bs_dev(spdk_bs_sequence_t *seq, struct spdk_bs_dev *bs_dev,
 	set->u.sequence.cb_fn = cb_fn;
 	set->u.sequence.cb_arg = cb_arg;
 
-	bs_dev->readv(bs_dev, spdk_io_channel_from_ctx(channel), iov, iovcnt, lba, lba_count,
-		      &set->cb_args);
+	back_channel = bs_back_dev_channel(channel, bs_dev);
+	if (back_channel == NULL) {
+		set->cb_args.cb_fn(set->cb_args.channel, set->cb_args.cb_arg, -ENOMEM);
+		return;
+	}
+
+	bs_dev->readv(bs_dev, back_channel, iov, iovcnt, lba, lba_count, &set->cb_args);
 }
 
 void
@@ -322,12 +336,20 @@ bs_batch_read_bs_dev(spdk_bs_batch_t *batch, struct spdk_bs_dev *bs_dev,
 {
 	struct spdk_bs_request_set	*set = (struct spdk_bs_request_set *)batch;
 	struct spdk_bs_channel		*channel = set->channel;
+	struct spdk_io_channel		*back_channel;
 
 	SPDK_DEBUGLOG(blob_rw, "Reading %" PRIu32 " blocks from LBA %" PRIu64 "\n", lba_count,
 		      lba);
 
 	set->u.batch.outstanding_ops++;
-	bs_dev->read(bs_dev, spdk_io_channel_from_ctx(channel), payload, lba, lba_count, &set->cb_args);
+
+	back_channel = bs_back_dev_channel(channel, bs_dev);
+	if (back_channel == NULL) {
+		set->cb_args.cb_fn(set->cb_args.channel, set->cb_args.cb_arg, -ENOMEM);
+		return;
+	}
+
+	bs_dev->read(bs_dev, back_channel, payload, lba, lba_count, &set->cb_args);
 }
 
 void
@@ -113,6 +113,9 @@ struct spdk_bs_request_set {
 
 	struct spdk_bs_channel		*channel;
 
+	/* Blob whose data this set is reading or writing, NULL for other requests */
+	struct spdk_blob		*blob;
+
 	struct spdk_bs_dev_cb_args	cb_args;
 
 	union {
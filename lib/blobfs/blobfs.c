@@ -59,10 +59,12 @@
 
 static uint64_t g_fs_cache_size = BLOBFS_DEFAULT_CACHE_SIZE;
 static struct spdk_mempool *g_cache_pool;
-static TAILQ_HEAD(, spdk_file) g_caches = TAILQ_HEAD_INITIALIZER(g_caches);
+static TAILQ_HEAD(spdk_file_cache_list, spdk_file) g_caches = TAILQ_HEAD_INITIALIZER(g_caches);
 static struct spdk_poller *g_cache_pool_mgmt_poller;
 static struct spdk_thread *g_cache_pool_thread;
 #define BLOBFS_CACHE_POOL_POLL_PERIOD_IN_US 1000ULL
+/* Maximum number of cache buffers freed from a file by a single reclaim */
+#define BLOBFS_CACHE_RECLAIM_BATCH 64
 static int g_fs_count = 0;
 static pthread_mutex_t g_cache_init_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -112,6 +114,13 @@ cache_buffer_free(struct cache_buffer *cache_buffer)
 }
 
 #define CACHE_READAHEAD_THRESHOLD	(128 * 1024)
+/* Number of cache buffers read ahead once a file is read sequentially. It grows by
+ * one buffer every CACHE_READAHEAD_THRESHOLD bytes read in sequence, up to the max. */
+#define CACHE_READAHEAD_MIN_BUFFERS	2
+#define CACHE_READAHEAD_MAX_BUFFERS	8
+/* Maximum number of cache buffer writes in flight for a file. They are retired
+ * in submission order, so length_flushed always describes a contiguous range. */
+#define CACHE_FLUSH_QUEUE_DEPTH		4
 
 struct spdk_file {
 	struct spdk_filesystem	*fs;
@@ -134,6 +143,8 @@ struct spdk_file {
 	struct cache_tree	*tree;
 	TAILQ_HEAD(open_requests_head, spdk_fs_request) open_requests;
 	TAILQ_HEAD(sync_requests_head, spdk_fs_request) sync_requests;
+	TAILQ_HEAD(flush_requests_head, spdk_fs_request) flush_requests;
+	uint32_t		flushes_in_flight;
 	TAILQ_ENTRY(spdk_file)	cache_tailq;
 };
 
@@ -206,7 +217,10 @@ struct spdk_fs_cb_args {
 		} rename;
 		struct {
 			struct cache_buffer	*cache_buffer;
+			uint64_t		offset;
 			uint64_t		length;
+			TAILQ_ENTRY(spdk_fs_request)	tailq;
+			bool			done;
 		} flush;
 		struct {
 			struct cache_buffer	*cache_buffer;
@@ -653,6 +667,7 @@ file_alloc(struct spdk_filesystem *fs)
 	file->fs = fs;
 	TAILQ_INIT(&file->open_requests);
 	TAILQ_INIT(&file->sync_requests);
+	TAILQ_INIT(&file->flush_requests);
 	TAILQ_INSERT_TAIL(&fs->files, file, tailq);
 	file->priority = SPDK_FILE_PRIORITY_LOW;
 	return file;
@@ -2038,11 +2053,13 @@ spdk_fs_get_cache_size(void)
 
 static void __file_flush(void *ctx);
 
-/* Try to free some cache buffers from this file.
+/* Try to free some cache buffers from this file. Buffers that were read since
+ * the previous attempt are kept and get another chance.
  */
 static int
 reclaim_cache_buffers(struct spdk_file *file)
 {
+	uint32_t freed;
 	int rc;
 
 	BLOBFS_TRACE(file, "free=%s\n", file->name);
@@ -2060,7 +2077,13 @@ reclaim_cache_buffers(struct spdk_file *file)
 		pthread_spin_unlock(&file->lock);
 		return -1;
 	}
-	tree_free_buffers(file->tree);
+	/* The buffer being appended to stays in place */
+	freed = tree_reclaim_buffers(file->tree, file->last, BLOBFS_CACHE_RECLAIM_BATCH);
+	if (freed == 0) {
+		/* Only dirty, in progress or recently read buffers, keep its place in the queue */
+		pthread_spin_unlock(&file->lock);
+		return -1;
+	}
 
 	TAILQ_REMOVE(&g_caches, file, cache_tailq);
 	/* If not freed, put it in the end of the queue */
@@ -2074,52 +2097,52 @@ reclaim_cache_buffers(struct spdk_file *file)
 	return 0;
 }
 
+/* Reclaim buffers from the first file of the cache queue that has some to free.
+ * Only the files that were queued when the pass started are visited, as a file
+ * that buffers were freed from moves to the tail of the queue.
+ */
+static bool
+blobfs_cache_pool_reclaim_pass(bool skip_writing, bool low_priority_only)
+{
+	struct spdk_file *file, *tmp, *last;
+
+	last = TAILQ_LAST(&g_caches, spdk_file_cache_list);
+	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
+		if ((!skip_writing || !file->open_for_writing) &&
+		    (!low_priority_only || file->priority == SPDK_FILE_PRIORITY_LOW) &&
+		    reclaim_cache_buffers(file) == 0) {
+			return true;
+		}
+		if (file == last) {
+			break;
+		}
+	}
+
+	return false;
+}
+
 static int
 _blobfs_cache_pool_reclaim(void *arg)
 {
-	struct spdk_file *file, *tmp;
-	int rc;
+	bool reclaimed;
 
 	if (!blobfs_cache_pool_need_reclaim()) {
 		return SPDK_POLLER_IDLE;
 	}
 
-	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
-		if (!file->open_for_writing &&
-		    file->priority == SPDK_FILE_PRIORITY_LOW) {
-			rc = reclaim_cache_buffers(file);
-			if (rc < 0) {
-				continue;
-			}
-			if (!blobfs_cache_pool_need_reclaim()) {
-				return SPDK_POLLER_BUSY;
-			}
-			break;
-		}
+	reclaimed = blobfs_cache_pool_reclaim_pass(true, true);
+	if (reclaimed && !blobfs_cache_pool_need_reclaim()) {
+		return SPDK_POLLER_BUSY;
 	}
 
-	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
-		if (!file->open_for_writing) {
-			rc = reclaim_cache_buffers(file);
-			if (rc < 0) {
-				continue;
-			}
-			if (!blobfs_cache_pool_need_reclaim()) {
-				return SPDK_POLLER_BUSY;
-			}
-			break;
-		}
+	reclaimed = blobfs_cache_pool_reclaim_pass(true, false) || reclaimed;
+	if (reclaimed && !blobfs_cache_pool_need_reclaim()) {
+		return SPDK_POLLER_BUSY;
 	}
 
-	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
-		rc = reclaim_cache_buffers(file);
-		if (rc < 0) {
-			continue;
-		}
-		break;
-	}
+	reclaimed = blobfs_cache_pool_reclaim_pass(false, false) || reclaimed;
 
-	return SPDK_POLLER_BUSY;
+	return reclaimed ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
 static void
@@ -2167,6 +2190,7 @@ cache_insert_buffer(struct spdk_file *file, uint64_t offset)
 
 	buf->buf_size = CACHE_BUFFER_SIZE;
 	buf->offset = offset;
+	buf->referenced = true;
 
 	if (file->tree->present_mask == 0) {
 		need_update = true;
@@ -2260,28 +2284,49 @@ __file_flush_done(void *ctx, int bserrno)
 	struct spdk_fs_request *req = ctx;
 	struct spdk_fs_cb_args *args = &req->args;
 	struct spdk_file *file = args->file;
-	struct cache_buffer *next = args->op.flush.cache_buffer;
+	struct spdk_fs_request *first;
+	struct cache_buffer *next;
 
 	BLOBFS_TRACE(file, "length=%jx\n", args->op.flush.length);
 
 	pthread_spin_lock(&file->lock);
-	next->in_progress = false;
-	next->bytes_flushed += args->op.flush.length;
-	file->length_flushed += args->op.flush.length;
-	if (file->length_flushed > file->length) {
-		file->length = file->length_flushed;
-	}
-	if (next->bytes_flushed == next->buf_size) {
-		BLOBFS_TRACE(file, "write buffer fully flushed 0x%jx\n", file->length_flushed);
-		next = tree_find_buffer(file->tree, file->length_flushed);
+	args->op.flush.done = true;
+	if (TAILQ_FIRST(&file->flush_requests) != req) {
+		/*
+		 * A flush submitted earlier is still in flight.  This one gets retired
+		 *  together with it, so that length_flushed never skips over data that
+		 *  has not reached the disk yet.
+		 */
+		pthread_spin_unlock(&file->lock);
+		return;
 	}
 
-	/*
-	 * Assert that there is no cached data that extends past the end of the underlying
-	 *  blob.
-	 */
-	assert(next == NULL || next->offset < __file_get_blob_size(file) ||
-	       next->bytes_filled == 0);
+	while ((first = TAILQ_FIRST(&file->flush_requests)) != NULL &&
+	       first->args.op.flush.done) {
+		TAILQ_REMOVE(&file->flush_requests, first, args.op.flush.tailq);
+		file->flushes_in_flight--;
+
+		next = first->args.op.flush.cache_buffer;
+		next->in_progress = false;
+		next->bytes_flushed += first->args.op.flush.length;
+		file->length_flushed += first->args.op.flush.length;
+		if (file->length_flushed > file->length) {
+			file->length = file->length_flushed;
+		}
+		if (next->bytes_flushed == next->buf_size) {
+			BLOBFS_TRACE(file, "write buffer fully flushed 0x%jx\n", file->length_flushed);
+		}
+
+		/*
+		 * Assert that there is no cached data that extends past the end of the underlying
+		 *  blob.
+		 */
+		assert(next->offset < __file_get_blob_size(file) || next->bytes_filled == 0);
+
+		if (first != req) {
+			free_fs_request(first);
+		}
+	}
 
 	pthread_spin_unlock(&file->lock);
 
@@ -2296,12 +2341,29 @@ __file_flush(void *ctx)
 	struct spdk_fs_request *req = ctx;
 	struct spdk_fs_cb_args *args = &req->args;
 	struct spdk_file *file = args->file;
+	struct spdk_fs_request *tail;
 	struct cache_buffer *next;
 	uint64_t offset, length, start_lba, num_lba;
 	uint32_t lba_size;
+	bool more;
 
 	pthread_spin_lock(&file->lock);
-	next = tree_find_buffer(file->tree, file->length_flushed);
+	if (file->flushes_in_flight >= CACHE_FLUSH_QUEUE_DEPTH) {
+		/* The next flush is submitted once the oldest one in flight is retired. */
+		free_fs_request(req);
+		pthread_spin_unlock(&file->lock);
+		return;
+	}
+
+	/* Continue from the end of the last flush in flight, if there is one. */
+	tail = TAILQ_LAST(&file->flush_requests, flush_requests_head);
+	if (tail != NULL) {
+		offset = tail->args.op.flush.offset + tail->args.op.flush.length;
+	} else {
+		offset = file->length_flushed;
+	}
+
+	next = tree_find_buffer(file->tree, offset);
 	if (next == NULL || next->in_progress ||
 	    ((next->bytes_filled < next->buf_size) && TAILQ_EMPTY(&file->sync_requests))) {
 		/*
@@ -2313,6 +2375,14 @@ __file_flush(void *ctx)
 		 *  when it is either filled or the file is synced.
 		 */
 		free_fs_request(req);
+		if (next == NULL && tail != NULL) {
+			/*
+			 * Flushes are still in flight - the last of them to be retired
+			 *  will look at the file again.
+			 */
+			pthread_spin_unlock(&file->lock);
+			return;
+		}
 		if (next == NULL) {
 			/*
 			 * For cases where a file's cache was evicted, and then the
@@ -2345,18 +2415,37 @@ __file_flush(void *ctx)
 		__check_sync_reqs(file);
 		return;
 	}
+	args->op.flush.offset = offset;
 	args->op.flush.length = length;
 	args->op.flush.cache_buffer = next;
+	args->op.flush.done = false;
+	TAILQ_INSERT_TAIL(&file->flush_requests, req, args.op.flush.tailq);
+	file->flushes_in_flight++;
 
 	__get_page_parameters(file, offset, length, &start_lba, &lba_size, &num_lba);
 
 	next->in_progress = true;
+	/* Only a completely filled buffer can be followed by more data to flush. */
+	more = next->bytes_filled == next->buf_size &&
+	       file->flushes_in_flight < CACHE_FLUSH_QUEUE_DEPTH;
 	BLOBFS_TRACE(file, "offset=0x%jx length=0x%jx page start=0x%jx num=0x%jx\n",
 		     offset, length, start_lba, num_lba);
 	pthread_spin_unlock(&file->lock);
 	spdk_blob_io_write(file->blob, file->fs->sync_target.sync_fs_channel->bs_channel,
 			   next->buf + (start_lba * lba_size) - next->offset,
 			   start_lba, num_lba, __file_flush_done, req);
+
+	if (more) {
+		/*
+		 * Keep the following buffers flushing in parallel instead of waiting
+		 *  for this write to complete.
+		 */
+		req = alloc_fs_request(file->fs->sync_target.sync_fs_channel);
+		if (req != NULL) {
+			req->args.file = file;
+			__file_flush(req);
+		}
+	}
 }
 
 static void
@@ -2651,7 +2740,7 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 	uint64_t final_offset, final_length;
 	uint32_t sub_reads = 0;
 	struct cache_buffer *buf;
-	uint64_t read_len;
+	uint64_t read_len, readahead_buffers, i;
 	struct rw_from_file_arg arg = {};
 
 	pthread_spin_lock(&file->lock);
@@ -2675,8 +2764,14 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 	file->seq_byte_count += length;
 	file->next_seq_offset = offset + length;
 	if (file->seq_byte_count >= CACHE_READAHEAD_THRESHOLD) {
-		check_readahead(file, offset, channel);
-		check_readahead(file, offset + CACHE_BUFFER_SIZE, channel);
+		readahead_buffers = CACHE_READAHEAD_MIN_BUFFERS;
+		if (!blobfs_cache_pool_need_reclaim()) {
+			readahead_buffers = spdk_min(CACHE_READAHEAD_MAX_BUFFERS,
+						     file->seq_byte_count / CACHE_READAHEAD_THRESHOLD + 1);
+		}
+		for (i = 0; i < readahead_buffers; i++) {
+			check_readahead(file, offset + i * CACHE_BUFFER_SIZE, channel);
+		}
 	}
 
 	arg.channel = channel;
@@ -2705,6 +2800,7 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 			}
 			BLOBFS_TRACE(file, "read %p offset=%ju length=%ju\n", payload, offset, read_len);
 			memcpy(payload, &buf->buf[offset - buf->offset], read_len);
+			buf->referenced = true;
 			if ((offset + read_len) % CACHE_BUFFER_SIZE == 0) {
 				tree_remove_buffer(file->tree, buf);
 				if (file->tree->present_mask == 0) {
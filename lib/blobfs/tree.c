@@ -179,3 +179,46 @@ tree_free_buffers(struct cache_tree *tree)
 		}
 	}
 }
+
+/* Free up to count clean buffers that were not referenced since the previous call,
+ * clearing the referenced flag of the others, and return the number of buffers freed.
+ */
+uint32_t
+tree_reclaim_buffers(struct cache_tree *tree, struct cache_buffer *skip, uint32_t count)
+{
+	struct cache_buffer *buffer;
+	struct cache_tree *child;
+	uint32_t i, freed = 0;
+
+	if (tree->level == 0) {
+		for (i = 0; i < CACHE_TREE_WIDTH && freed < count; i++) {
+			buffer = tree->u.buffer[i];
+			if (buffer == NULL || buffer == skip || buffer->in_progress ||
+			    buffer->bytes_filled != buffer->bytes_flushed) {
+				continue;
+			}
+			if (buffer->referenced) {
+				buffer->referenced = false;
+				continue;
+			}
+			cache_buffer_free(buffer);
+			tree->u.buffer[i] = NULL;
+			tree->present_mask &= ~(1ULL << i);
+			freed++;
+		}
+	} else {
+		for (i = 0; i < CACHE_TREE_WIDTH && freed < count; i++) {
+			child = tree->u.tree[i];
+			if (child != NULL) {
+				freed += tree_reclaim_buffers(child, skip, count - freed);
+				if (child->present_mask == 0) {
+					free(child);
+					tree->u.tree[i] = NULL;
+					tree->present_mask &= ~(1ULL << i);
+				}
+			}
+		}
+	}
+
+	return freed;
+}
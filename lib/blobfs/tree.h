@@ -41,6 +41,8 @@ struct cache_buffer {
 	uint32_t		bytes_filled;
 	uint32_t		bytes_flushed;
 	bool			in_progress;
+	/* Set when the buffer is inserted or read from, cleared by reclaim */
+	bool			referenced;
 };
 
 #define CACHE_BUFFER_SHIFT (18)
@@ -68,6 +70,7 @@ void cache_buffer_free(struct cache_buffer *cache_buffer);
 
 struct cache_tree *tree_insert_buffer(struct cache_tree *root, struct cache_buffer *buffer);
 void tree_free_buffers(struct cache_tree *tree);
+uint32_t tree_reclaim_buffers(struct cache_tree *tree, struct cache_buffer *skip, uint32_t count);
 struct cache_buffer *tree_find_buffer(struct cache_tree *tree, uint64_t offset);
 struct cache_buffer *tree_find_filled_buffer(struct cache_tree *tree, uint64_t offset);
 void tree_remove_buffer(struct cache_tree *tree, struct cache_buffer *buffer);
@@ -93,7 +93,8 @@ spdk_idxd_get_channel(struct spdk_idxd_device *idxd)
 	struct idxd_batch *batch;
 	struct idxd_hw_desc *desc;
 	struct idxd_ops *op;
-	int i, j, num_batches, num_descriptors, rc;
+	int i, num_batches, num_descriptors, rc;
+	uint32_t j;
 
 	assert(idxd != NULL);
 
@@ -162,7 +163,7 @@ spdk_idxd_get_channel(struct spdk_idxd_device *idxd)
 	}
 	batch = chan->batch_base;
 	for (i = 0 ; i < num_batches ; i++) {
-		batch->user_desc = desc = spdk_zmalloc(DESC_PER_BATCH * sizeof(struct idxd_hw_desc),
+		batch->user_desc = desc = spdk_zmalloc(idxd->batch_size * sizeof(struct idxd_hw_desc),
 						       0x40, NULL,
 						       SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
 		if (batch->user_desc == NULL) {
@@ -171,13 +172,13 @@ spdk_idxd_get_channel(struct spdk_idxd_device *idxd)
 		}
 
 		rc = _vtophys(batch->user_desc, &batch->user_desc_addr,
-			      DESC_PER_BATCH * sizeof(struct idxd_hw_desc));
+			      idxd->batch_size * sizeof(struct idxd_hw_desc));
 		if (rc) {
 			SPDK_ERRLOG("Failed to translate batch descriptor memory\n");
 			goto err_user_desc_or_op;
 		}
 
-		batch->user_ops = op = spdk_zmalloc(DESC_PER_BATCH * sizeof(struct idxd_ops),
+		batch->user_ops = op = spdk_zmalloc(idxd->batch_size * sizeof(struct idxd_ops),
 						    0x40, NULL,
 						    SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
 		if (batch->user_ops == NULL) {
@@ -185,7 +186,7 @@ spdk_idxd_get_channel(struct spdk_idxd_device *idxd)
 			goto err_user_desc_or_op;
 		}
 
-		for (j = 0; j < DESC_PER_BATCH; j++) {
+		for (j = 0; j < idxd->batch_size; j++) {
 			rc = _vtophys(&op->hw, &desc->completion_addr, sizeof(struct idxd_hw_comp_record));
 			if (rc) {
 				SPDK_ERRLOG("Failed to translate batch entry completion memory\n");
@@ -366,7 +367,7 @@ _idxd_prep_batch_cmd(struct spdk_idxd_io_channel *chan, spdk_idxd_req_cb cb_fn,
 	}
 
 	assert(batch != NULL); /* suppress scan-build warning. */
-	if (batch->index == DESC_PER_BATCH) {
+	if (batch->index == chan->idxd->batch_size) {
 		return -EBUSY;
 	}
 
@@ -504,7 +505,7 @@ idxd_batch_submit(struct spdk_idxd_io_channel *chan, struct idxd_batch *batch,
 		desc->desc_list_addr = batch->user_desc_addr;
 		desc->desc_count = batch->index;
 		op->batch = batch;
-		assert(batch->index <= DESC_PER_BATCH);
+		assert(batch->index <= chan->idxd->batch_size);
 
 		/* Add the batch elements completion contexts to the outstanding list to be polled. */
 		for (i = 0 ; i < batch->index; i++) {
@@ -546,7 +547,7 @@ _idxd_flush_batch(struct spdk_idxd_io_channel *chan)
 {
 	int rc;
 
-	if (chan->batch != NULL && chan->batch->index >= DESC_PER_BATCH) {
+	if (chan->batch != NULL && chan->batch->index >= chan->idxd->batch_size) {
 		assert(chan->batch->transparent);
 
 		/* Close out the full batch */
@@ -61,7 +61,9 @@ static inline void movdir64b(void *dst, const void *src)
 
 /* TODO: consider setting the max per batch limit via RPC. */
 
-/* The following sets up a max desc count per batch of 32 */
+/* The following sets up a max desc count per batch of 32, devices supporting
+ * smaller batches get their own limit in spdk_idxd_device.batch_size.
+ */
 #define LOG2_WQ_MAX_BATCH	5  /* 2^5 = 32 */
 #define DESC_PER_BATCH		(1 << LOG2_WQ_MAX_BATCH)
 
@@ -152,6 +154,8 @@ struct spdk_idxd_device {
 	uint32_t			num_channels;
 	uint32_t			total_wq_size;
 	uint32_t			chan_per_device;
+	/* Descriptors per batch, 1 if the device can't batch */
+	uint32_t			batch_size;
 	pthread_mutex_t			num_channels_lock;
 };
 
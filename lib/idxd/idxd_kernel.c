@@ -143,6 +143,12 @@ dsa_setup_single_wq(struct spdk_kernel_idxd_device *kernel_idxd, struct accfg_wq
 	/* Update the active_wq_num of the kernel device */
 	kernel_idxd->wq_active_num++;
 	kernel_idxd->idxd.total_wq_size += wq_ctx->wq_size;
+	/* Batch as many descriptors as every work queue allows, up to our own limit. */
+	if (kernel_idxd->idxd.batch_size == 0) {
+		kernel_idxd->idxd.batch_size = DESC_PER_BATCH;
+	}
+	kernel_idxd->idxd.batch_size = spdk_min(kernel_idxd->idxd.batch_size,
+						spdk_max(wq_ctx->wq_max_batch_size, 1));
 	kernel_idxd->idxd.socket_id = accfg_device_get_numa_node(dev);
 
 	return 0;
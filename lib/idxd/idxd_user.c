@@ -225,10 +225,13 @@ idxd_wq_config(struct spdk_user_idxd_device *user_idxd)
 	uint32_t i;
 	struct spdk_idxd_device *idxd = &user_idxd->idxd;
 	union idxd_wqcap_register wqcap;
+	union idxd_gencap_register gencap;
 	union idxd_offsets_register table_offsets;
 	union idxd_wqcfg *wqcfg;
+	uint32_t batch_shift;
 
 	wqcap.raw = spdk_mmio_read_8(&user_idxd->registers->wqcap.raw);
+	gencap.raw = spdk_mmio_read_8(&user_idxd->registers->gencap.raw);
 
 	SPDK_DEBUGLOG(idxd, "Total ring slots available 0x%x\n", wqcap.total_wq_size);
 
@@ -238,6 +241,11 @@ idxd_wq_config(struct spdk_user_idxd_device *user_idxd)
 	 */
 	idxd->chan_per_device = (idxd->total_wq_size >= 128) ? 8 : 4;
 
+	/* Batch as many descriptors as the device allows, up to our own limit. */
+	batch_shift = spdk_min(gencap.max_batch_shift, LOG2_WQ_MAX_BATCH);
+	idxd->batch_size = 1 << batch_shift;
+	SPDK_DEBUGLOG(idxd, "Descriptors per batch %u\n", idxd->batch_size);
+
 	table_offsets.raw[0] = spdk_mmio_read_8(&user_idxd->registers->offsets.raw[0]);
 	table_offsets.raw[1] = spdk_mmio_read_8(&user_idxd->registers->offsets.raw[1]);
 
@@ -250,7 +258,7 @@ idxd_wq_config(struct spdk_user_idxd_device *user_idxd)
 
 	wqcfg->wq_size = wqcap.total_wq_size;
 	wqcfg->mode = WQ_MODE_DEDICATED;
-	wqcfg->max_batch_shift = LOG2_WQ_MAX_BATCH;
+	wqcfg->max_batch_shift = batch_shift;
 	wqcfg->max_xfer_shift = LOG2_WQ_MAX_XFER;
 	wqcfg->wq_state = WQ_ENABLED;
 	wqcfg->priority = WQ_PRIORITY_1;
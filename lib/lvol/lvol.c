@@ -361,24 +361,17 @@ lvs_load_cb(void *cb_arg, struct spdk_blob_store *bs, int lvolerrno)
 
 	if (lvolerrno != 0) {
 		req->cb_fn(req->cb_arg, NULL, lvolerrno);
+		lvs_free(req->lvol_store);
 		free(req);
 		return;
 	}
 
-	lvs = calloc(1, sizeof(*lvs));
-	if (lvs == NULL) {
-		SPDK_ERRLOG("Cannot alloc memory for lvol store\n");
-		spdk_bs_unload(bs, bs_unload_with_error_cb, req);
-		return;
-	}
-
+	lvs = req->lvol_store;
 	lvs->blobstore = bs;
 	lvs->bs_dev = req->bs_dev;
 	TAILQ_INIT(&lvs->lvols);
 	TAILQ_INIT(&lvs->pending_lvols);
 
-	req->lvol_store = lvs;
-
 	spdk_bs_get_super(bs, lvs_open_super, req);
 }
 
@@ -390,7 +383,8 @@ lvs_bs_opts_init(struct spdk_bs_opts *opts)
 }
 
 void
-spdk_lvs_load(struct spdk_bs_dev *bs_dev, spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
+spdk_lvs_load_ext(struct spdk_bs_dev *bs_dev, const struct spdk_lvs_opts *o,
+		  spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvs_with_handle_req *req;
 	struct spdk_bs_opts opts = {};
@@ -410,16 +404,37 @@ spdk_lvs_load(struct spdk_bs_dev *bs_dev, spdk_lvs_op_with_handle_complete cb_fn
 		return;
 	}
 
+	/* Allocated up front, as it is the context of external snapshot callbacks
+	 * made while the blobstore loads. */
+	req->lvol_store = calloc(1, sizeof(*req->lvol_store));
+	if (req->lvol_store == NULL) {
+		SPDK_ERRLOG("Cannot alloc memory for lvol store\n");
+		free(req);
+		cb_fn(cb_arg, NULL, -ENOMEM);
+		return;
+	}
+
 	req->cb_fn = cb_fn;
 	req->cb_arg = cb_arg;
 	req->bs_dev = bs_dev;
 
 	lvs_bs_opts_init(&opts);
 	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "LVOLSTORE");
+	if (o != NULL) {
+		opts.channel_reserved_clusters = o->channel_reserved_clusters;
+		opts.esnap_bs_dev_create = o->esnap_bs_dev_create;
+		opts.esnap_ctx = req->lvol_store;
+	}
 
 	spdk_bs_load(bs_dev, &opts, lvs_load_cb, req);
 }
 
+void
+spdk_lvs_load(struct spdk_bs_dev *bs_dev, spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	spdk_lvs_load_ext(bs_dev, NULL, cb_fn, cb_arg);
+}
+
 static void
 remove_bs_on_error_cb(void *cb_arg, int bserrno)
 {
@@ -561,6 +576,8 @@ spdk_lvs_opts_init(struct spdk_lvs_opts *o)
 	o->cluster_sz = SPDK_LVS_OPTS_CLUSTER_SZ;
 	o->clear_method = LVS_CLEAR_WITH_UNMAP;
 	memset(o->name, 0, sizeof(o->name));
+	o->channel_reserved_clusters = 0;
+	o->esnap_bs_dev_create = NULL;
 }
 
 static void
@@ -570,6 +587,7 @@ setup_lvs_opts(struct spdk_bs_opts *bs_opts, struct spdk_lvs_opts *o)
 	lvs_bs_opts_init(bs_opts);
 	bs_opts->cluster_sz = o->cluster_sz;
 	bs_opts->clear_method = (enum bs_clear_method)o->clear_method;
+	bs_opts->channel_reserved_clusters = o->channel_reserved_clusters;
 }
 
 int
@@ -634,6 +652,8 @@ spdk_lvs_init(struct spdk_bs_dev *bs_dev, struct spdk_lvs_opts *o,
 	lvs->destruct = false;
 
 	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "LVOLSTORE");
+	opts.esnap_bs_dev_create = o->esnap_bs_dev_create;
+	opts.esnap_ctx = lvs;
 
 	SPDK_INFOLOG(lvol, "Initializing lvol store\n");
 	spdk_bs_init(bs_dev, &opts, lvs_init_cb, lvs_req);
@@ -1082,6 +1102,83 @@ spdk_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 	return 0;
 }
 
+int
+spdk_lvol_create_esnap_clone(const void *esnap_id, uint32_t id_len, uint64_t size_bytes,
+			     struct spdk_lvol_store *lvs, const char *clone_name,
+			     spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	struct spdk_lvol_with_handle_req *req;
+	struct spdk_blob_store *bs;
+	struct spdk_lvol *lvol;
+	struct spdk_blob_opts opts;
+	uint64_t cluster_sz;
+	char *xattr_names[] = {LVOL_NAME, "uuid"};
+	int rc;
+
+	if (lvs == NULL) {
+		SPDK_ERRLOG("lvol store does not exist\n");
+		return -EINVAL;
+	}
+
+	if (esnap_id == NULL || id_len == 0) {
+		SPDK_ERRLOG("external snapshot id not provided\n");
+		return -EINVAL;
+	}
+
+	rc = lvs_verify_lvol_name(lvs, clone_name);
+	if (rc < 0) {
+		return rc;
+	}
+
+	bs = lvs->blobstore;
+
+	/* The last cluster is copied whole from the external snapshot on first write */
+	cluster_sz = spdk_bs_get_cluster_size(bs);
+	if (size_bytes == 0 || size_bytes % cluster_sz != 0) {
+		SPDK_ERRLOG("External snapshot size %" PRIu64 " is not a multiple of cluster size %"
+			    PRIu64 "\n", size_bytes, cluster_sz);
+		return -EINVAL;
+	}
+
+	req = calloc(1, sizeof(*req));
+	if (!req) {
+		SPDK_ERRLOG("Cannot alloc memory for lvol request pointer\n");
+		return -ENOMEM;
+	}
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+
+	lvol = calloc(1, sizeof(*lvol));
+	if (!lvol) {
+		free(req);
+		SPDK_ERRLOG("Cannot alloc memory for lvol base pointer\n");
+		return -ENOMEM;
+	}
+	lvol->lvol_store = lvs;
+	lvol->thin_provision = true;
+	lvol->clear_method = BLOB_CLEAR_WITH_DEFAULT;
+	snprintf(lvol->name, sizeof(lvol->name), "%s", clone_name);
+	TAILQ_INSERT_TAIL(&lvol->lvol_store->pending_lvols, lvol, link);
+	spdk_uuid_generate(&lvol->uuid);
+	spdk_uuid_fmt_lower(lvol->uuid_str, sizeof(lvol->uuid_str), &lvol->uuid);
+	req->lvol = lvol;
+
+	spdk_blob_opts_init(&opts, sizeof(opts));
+	opts.esnap_id = esnap_id;
+	opts.esnap_id_len = id_len;
+	opts.thin_provision = true;
+	opts.num_clusters = size_bytes / cluster_sz;
+	opts.clear_method = lvol->clear_method;
+	opts.xattrs.count = SPDK_COUNTOF(xattr_names);
+	opts.xattrs.names = xattr_names;
+	opts.xattrs.ctx = lvol;
+	opts.xattrs.get_value = lvol_get_xattr_value;
+
+	spdk_bs_create_blob_ext(lvs->blobstore, &opts, lvol_create_cb, req);
+
+	return 0;
+}
+
 void
 spdk_lvol_create_snapshot(struct spdk_lvol *origlvol, const char *snapshot_name,
 			  spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
@@ -1512,3 +1609,141 @@ spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, v
 	spdk_bs_blob_decouple_parent(lvol->lvol_store->blobstore, req->channel, blob_id,
 				     lvol_inflate_cb, req);
 }
+
+static void
+lvol_shallow_copy_cb(void *cb_arg, int lvolerrno)
+{
+	struct spdk_lvol_req *req = cb_arg;
+
+	spdk_bs_free_io_channel(req->channel);
+
+	if (lvolerrno < 0) {
+		SPDK_ERRLOG("Could not make a shallow copy of lvol\n");
+	}
+
+	req->cb_fn(req->cb_arg, lvolerrno);
+	free(req);
+}
+
+void
+spdk_lvol_shallow_copy(struct spdk_lvol *lvol, struct spdk_bs_dev *ext_dev,
+		       spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+		       spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_lvol_req *req;
+	spdk_blob_id blob_id;
+
+	assert(cb_fn != NULL);
+
+	if (lvol == NULL) {
+		SPDK_ERRLOG("Lvol does not exist\n");
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	if (ext_dev == NULL) {
+		SPDK_ERRLOG("External device does not exist\n");
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	req = calloc(1, sizeof(*req));
+	if (!req) {
+		SPDK_ERRLOG("Cannot alloc memory for lvol request pointer\n");
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+	req->channel = spdk_bs_alloc_io_channel(lvol->lvol_store->blobstore);
+	if (req->channel == NULL) {
+		SPDK_ERRLOG("Cannot alloc io channel for lvol shallow copy request\n");
+		free(req);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	blob_id = spdk_blob_get_id(lvol->blob);
+	spdk_bs_blob_shallow_copy(lvol->lvol_store->blobstore, req->channel, blob_id, ext_dev,
+				  status_cb_fn, status_cb_arg, lvol_shallow_copy_cb, req);
+}
+
+void
+spdk_lvol_get_changed_clusters(struct spdk_lvol *base, struct spdk_lvol *lvol,
+			       spdk_blob_changed_clusters_cb extent_cb_fn, void *extent_cb_arg,
+			       spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	spdk_blob_id base_id = SPDK_BLOBID_INVALID;
+
+	assert(cb_fn != NULL);
+
+	if (lvol == NULL) {
+		SPDK_ERRLOG("Lvol does not exist\n");
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	if (base != NULL) {
+		if (base->lvol_store != lvol->lvol_store) {
+			SPDK_ERRLOG("Lvols %s and %s are in different lvol stores\n",
+				    base->unique_id, lvol->unique_id);
+			cb_fn(cb_arg, -EINVAL);
+			return;
+		}
+		base_id = spdk_blob_get_id(base->blob);
+	}
+
+	spdk_bs_get_changed_clusters(lvol->lvol_store->blobstore, base_id, spdk_blob_get_id(lvol->blob),
+				     extent_cb_fn, extent_cb_arg, cb_fn, cb_arg);
+}
+
+static void
+lvol_dedup_cb(void *cb_arg, int lvolerrno)
+{
+	struct spdk_lvol_req *req = cb_arg;
+
+	spdk_bs_free_io_channel(req->channel);
+
+	if (lvolerrno < 0) {
+		SPDK_ERRLOG("Could not deduplicate lvol\n");
+	}
+
+	req->cb_fn(req->cb_arg, lvolerrno);
+	free(req);
+}
+
+void
+spdk_lvol_dedup(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_lvol_req *req;
+	spdk_blob_id blob_id;
+
+	assert(cb_fn != NULL);
+
+	if (lvol == NULL) {
+		SPDK_ERRLOG("Lvol does not exist\n");
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	req = calloc(1, sizeof(*req));
+	if (!req) {
+		SPDK_ERRLOG("Cannot alloc memory for lvol request pointer\n");
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+	req->channel = spdk_bs_alloc_io_channel(lvol->lvol_store->blobstore);
+	if (req->channel == NULL) {
+		SPDK_ERRLOG("Cannot alloc io channel for lvol dedup request\n");
+		free(req);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	blob_id = spdk_blob_get_id(lvol->blob);
+	spdk_bs_blob_dedup(lvol->lvol_store->blobstore, req->channel, blob_id, lvol_dedup_cb, req);
+}
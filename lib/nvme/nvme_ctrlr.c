@@ -377,6 +377,10 @@ spdk_nvme_ctrlr_get_default_io_qpair_opts(struct spdk_nvme_ctrlr *ctrlr,
 		opts->async_mode = false;
 	}
 
+	if (FIELD_OK(delay_cmd_submit_threshold)) {
+		opts->delay_cmd_submit_threshold = 0;
+	}
+
 #undef FIELD_OK
 }
 
@@ -329,7 +329,8 @@ struct nvme_request {
 
 	/*
 	 * The value of spdk_get_ticks() when the request was submitted to the hardware.
-	 * Only set if ctrlr->timeout_enabled is true.
+	 * Only set if ctrlr->timeout_enabled is true or latency tracking is enabled
+	 * on the qpair.
 	 */
 	uint64_t			submit_tick;
 
@@ -409,6 +410,24 @@ struct nvme_async_event_request {
 	struct spdk_nvme_cpl		cpl;
 };
 
+struct nvme_ns_latency {
+	uint32_t			nsid;
+	struct spdk_histogram_data	*histogram;
+};
+
+/* Command latency data collected on a qpair, see spdk_nvme_qpair_set_latency_tracking(). */
+struct nvme_qpair_latency {
+	uint32_t				num_ns;
+	struct nvme_ns_latency			*ns;
+
+	uint32_t				max_outliers;
+	uint32_t				num_outliers;
+	/* Index and latency of the fastest recorded outlier once all slots are used. */
+	uint32_t				min_outlier;
+	uint64_t				min_outlier_ticks;
+	struct spdk_nvme_latency_outlier	*outliers;
+};
+
 enum nvme_qpair_state {
 	NVME_QPAIR_DISCONNECTED,
 	NVME_QPAIR_DISCONNECTING,
@@ -475,6 +494,9 @@ struct spdk_nvme_qpair {
 
 	const struct spdk_nvme_transport	*transport;
 
+	/* Set only while latency tracking is enabled. */
+	struct nvme_qpair_latency		*latency;
+
 	/* Entries below here are not touched in the main I/O path. */
 
 	struct nvme_completion_poll_status	*poll_status;
@@ -1203,6 +1225,11 @@ void	nvme_qpair_abort_all_queued_reqs(struct spdk_nvme_qpair *qpair, uint32_t dn
 uint32_t nvme_qpair_abort_queued_reqs_with_cbarg(struct spdk_nvme_qpair *qpair, void *cmd_cb_arg);
 void	nvme_qpair_abort_queued_reqs(struct spdk_nvme_qpair *qpair, uint32_t dnr);
 void	nvme_qpair_resubmit_requests(struct spdk_nvme_qpair *qpair, uint32_t num_requests);
+void	nvme_qpair_record_latency(struct spdk_nvme_qpair *qpair, struct nvme_request *req,
+				  const struct spdk_nvme_cpl *cpl);
+int	nvme_qpair_get_latency_stat(struct spdk_nvme_qpair *qpair,
+				    struct spdk_nvme_qpair_latency_stat *stat);
+void	nvme_qpair_free_latency_stat(struct spdk_nvme_qpair_latency_stat *stat);
 int	nvme_ctrlr_identify_active_ns(struct spdk_nvme_ctrlr *ctrlr);
 void	nvme_ns_set_identify_data(struct spdk_nvme_ns *ns);
 void	nvme_ns_set_id_desc_list_data(struct spdk_nvme_ns *ns);
@@ -1343,6 +1370,10 @@ nvme_complete_request(spdk_nvme_cmd_cb cb_fn, void *cb_arg, struct spdk_nvme_qpa
 		}
 	}
 
+	if (spdk_unlikely(qpair->latency != NULL && req->submit_tick != 0)) {
+		nvme_qpair_record_latency(qpair, req, cpl);
+	}
+
 	if (cb_fn) {
 		cb_fn(cb_arg, cpl);
 	}
@@ -71,6 +71,7 @@ nvme_pcie_qpair_reset(struct spdk_nvme_qpair *qpair)
 
 	/* all head/tail vals are set to 0 */
 	pqpair->last_sq_tail = pqpair->sq_tail = pqpair->sq_head = pqpair->cq_head = 0;
+	pqpair->num_submits_in_poll = 0;
 
 	/*
 	 * First time through the completion queue, HW will set phase
@@ -676,6 +677,15 @@ nvme_pcie_qpair_submit_tracker(struct spdk_nvme_qpair *qpair, struct nvme_tracke
 
 	if (!pqpair->flags.delay_cmd_submit) {
 		nvme_pcie_qpair_ring_sq_doorbell(qpair);
+	} else if (pqpair->num_submits_in_poll < pqpair->delay_cmd_submit_threshold) {
+		/* Only a few commands were submitted in this poll iteration so far.
+		 * Ring the doorbell now rather than adding latency to them.
+		 */
+		pqpair->num_submits_in_poll++;
+		nvme_pcie_qpair_ring_sq_doorbell(qpair);
+		pqpair->last_sq_tail = pqpair->sq_tail;
+	} else {
+		pqpair->db_stat.delayed_submissions++;
 	}
 }
 
@@ -968,6 +978,7 @@ nvme_pcie_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 			nvme_pcie_qpair_ring_sq_doorbell(qpair);
 			pqpair->last_sq_tail = pqpair->sq_tail;
 		}
+		pqpair->num_submits_in_poll = 0;
 	}
 
 	if (spdk_unlikely(ctrlr->timeout_enabled)) {
@@ -1059,6 +1070,7 @@ nvme_pcie_ctrlr_create_io_qpair(struct spdk_nvme_ctrlr *ctrlr, uint16_t qid,
 
 	pqpair->num_entries = opts->io_queue_size;
 	pqpair->flags.delay_cmd_submit = opts->delay_cmd_submit;
+	pqpair->delay_cmd_submit_threshold = opts->delay_cmd_submit_threshold;
 
 	qpair = &pqpair->qpair;
 
@@ -1782,6 +1794,23 @@ nvme_pcie_poll_group_destroy(struct spdk_nvme_transport_poll_group *tgroup)
 	return 0;
 }
 
+int
+spdk_nvme_pcie_qpair_get_doorbell_stat(struct spdk_nvme_qpair *qpair,
+				       struct spdk_nvme_pcie_qpair_doorbell_stat *stat)
+{
+	struct nvme_pcie_qpair *pqpair;
+
+	if (qpair->trtype != SPDK_NVME_TRANSPORT_PCIE &&
+	    qpair->trtype != SPDK_NVME_TRANSPORT_VFIOUSER) {
+		return -EINVAL;
+	}
+
+	pqpair = nvme_pcie_qpair(qpair);
+	*stat = pqpair->db_stat;
+
+	return 0;
+}
+
 SPDK_TRACE_REGISTER_FN(nvme_pcie, "nvme_pcie", TRACE_GROUP_NVME_PCIE)
 {
 	struct spdk_trace_tpoint_opts opts[] = {
@@ -184,6 +184,10 @@ struct nvme_pcie_qpair {
 	uint16_t cq_head;
 	uint16_t sq_head;
 
+	/* Adaptive doorbell batching for delay_cmd_submit */
+	uint16_t delay_cmd_submit_threshold;
+	uint16_t num_submits_in_poll;
+
 	struct {
 		uint8_t phase			: 1;
 		uint8_t delay_cmd_submit	: 1;
@@ -213,6 +217,8 @@ struct nvme_pcie_qpair {
 		volatile uint32_t *cq_eventidx;
 	} shadow_doorbell;
 
+	struct spdk_nvme_pcie_qpair_doorbell_stat db_stat;
+
 	/*
 	 * Fields below this point should not be touched on the normal I/O path.
 	 */
@@ -285,6 +291,7 @@ nvme_pcie_qpair_ring_sq_doorbell(struct spdk_nvme_qpair *qpair)
 
 	if (spdk_unlikely(pqpair->flags.has_shadow_doorbell)) {
 		pqpair->stat->sq_shadow_doorbell_updates++;
+		pqpair->db_stat.sq_shadow_doorbell_updates++;
 		need_mmio = nvme_pcie_qpair_update_mmio_required(
 				    pqpair->sq_tail,
 				    pqpair->shadow_doorbell.sq_tdbl,
@@ -294,6 +301,7 @@ nvme_pcie_qpair_ring_sq_doorbell(struct spdk_nvme_qpair *qpair)
 	if (spdk_likely(need_mmio)) {
 		spdk_wmb();
 		pqpair->stat->sq_mmio_doorbell_updates++;
+		pqpair->db_stat.sq_mmio_doorbell_updates++;
 		g_thread_mmio_ctrlr = pctrlr;
 		spdk_mmio_write_4(pqpair->sq_tdbl, pqpair->sq_tail);
 		g_thread_mmio_ctrlr = NULL;
@@ -309,6 +317,7 @@ nvme_pcie_qpair_ring_cq_doorbell(struct spdk_nvme_qpair *qpair)
 
 	if (spdk_unlikely(pqpair->flags.has_shadow_doorbell)) {
 		pqpair->stat->cq_shadow_doorbell_updates++;
+		pqpair->db_stat.cq_shadow_doorbell_updates++;
 		need_mmio = nvme_pcie_qpair_update_mmio_required(
 				    pqpair->cq_head,
 				    pqpair->shadow_doorbell.cq_hdbl,
@@ -317,6 +326,7 @@ nvme_pcie_qpair_ring_cq_doorbell(struct spdk_nvme_qpair *qpair)
 
 	if (spdk_likely(need_mmio)) {
 		pqpair->stat->cq_mmio_doorbell_updates++;
+		pqpair->db_stat.cq_mmio_doorbell_updates++;
 		g_thread_mmio_ctrlr = pctrlr;
 		spdk_mmio_write_4(pqpair->cq_hdbl, pqpair->cq_head);
 		g_thread_mmio_ctrlr = NULL;
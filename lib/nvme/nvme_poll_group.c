@@ -194,6 +194,73 @@ spdk_nvme_poll_group_destroy(struct spdk_nvme_poll_group *group)
 	return 0;
 }
 
+static int
+nvme_poll_group_get_latency_stats(struct spdk_nvme_poll_group *group,
+				  struct spdk_nvme_poll_group_stat *stat)
+{
+	struct spdk_nvme_transport_poll_group *tgroup;
+	struct spdk_nvme_qpair *qpair;
+	uint32_t count = 0;
+	int rc;
+
+	STAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+			count += qpair->latency != NULL;
+		}
+		STAILQ_FOREACH(qpair, &tgroup->disconnected_qpairs, poll_group_stailq) {
+			count += qpair->latency != NULL;
+		}
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	stat->qpair_latency_stats = calloc(count, sizeof(*stat->qpair_latency_stats));
+	if (stat->qpair_latency_stats == NULL) {
+		return -ENOMEM;
+	}
+
+	STAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+			if (qpair->latency == NULL) {
+				continue;
+			}
+			rc = nvme_qpair_get_latency_stat(qpair,
+							 &stat->qpair_latency_stats[stat->num_qpair_latency_stats]);
+			if (rc != 0) {
+				return rc;
+			}
+			stat->num_qpair_latency_stats++;
+		}
+		STAILQ_FOREACH(qpair, &tgroup->disconnected_qpairs, poll_group_stailq) {
+			if (qpair->latency == NULL) {
+				continue;
+			}
+			rc = nvme_qpair_get_latency_stat(qpair,
+							 &stat->qpair_latency_stats[stat->num_qpair_latency_stats]);
+			if (rc != 0) {
+				return rc;
+			}
+			stat->num_qpair_latency_stats++;
+		}
+	}
+
+	return 0;
+}
+
+static void
+nvme_poll_group_free_latency_stats(struct spdk_nvme_poll_group_stat *stat)
+{
+	uint32_t i;
+
+	for (i = 0; i < stat->num_qpair_latency_stats; i++) {
+		nvme_qpair_free_latency_stat(&stat->qpair_latency_stats[i]);
+	}
+
+	free(stat->qpair_latency_stats);
+}
+
 int
 spdk_nvme_poll_group_get_stats(struct spdk_nvme_poll_group *group,
 			       struct spdk_nvme_poll_group_stat **stats)
@@ -232,14 +299,22 @@ spdk_nvme_poll_group_get_stats(struct spdk_nvme_poll_group *group,
 		}
 	}
 
-	if (reported_stats_count == 0) {
+	result->num_transports = reported_stats_count;
+
+	rc = nvme_poll_group_get_latency_stats(group, result);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to allocate memory for qpair latency statistics\n");
+		spdk_nvme_poll_group_free_stats(group, result);
+		return rc;
+	}
+
+	if (reported_stats_count == 0 && result->num_qpair_latency_stats == 0) {
 		free(result->transport_stat);
 		free(result);
 		SPDK_DEBUGLOG(nvme, "No transport statistics available\n");
 		return -ENOTSUP;
 	}
 
-	result->num_transports = reported_stats_count;
 	*stats = result;
 
 	return 0;
@@ -268,6 +343,8 @@ spdk_nvme_poll_group_free_stats(struct spdk_nvme_poll_group *group,
 
 	assert(freed_stats == stat->num_transports);
 
+	nvme_poll_group_free_latency_stats(stat);
+
 	free(stat->transport_stat);
 	free(stat);
 }
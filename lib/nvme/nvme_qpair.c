@@ -879,6 +879,8 @@ nvme_qpair_deinit(struct spdk_nvme_qpair *qpair)
 		spdk_free(cmd);
 	}
 
+	spdk_nvme_qpair_set_latency_tracking(qpair, false, 0);
+
 	spdk_free(qpair->req_buf);
 }
 
@@ -973,6 +975,8 @@ _nvme_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *r
 			req->submit_tick = spdk_get_ticks();
 			req->timed_out = false;
 		}
+	} else if (spdk_unlikely(qpair->latency != NULL)) {
+		req->submit_tick = spdk_get_ticks();
 	} else {
 		req->submit_tick = 0;
 	}
@@ -1157,3 +1161,234 @@ spdk_nvme_qpair_get_id(struct spdk_nvme_qpair *qpair)
 {
 	return qpair->id;
 }
+
+static void
+nvme_qpair_latency_free(struct nvme_qpair_latency *latency)
+{
+	uint32_t i;
+
+	for (i = 0; i < latency->num_ns; i++) {
+		spdk_histogram_data_free(latency->ns[i].histogram);
+	}
+
+	free(latency->ns);
+	free(latency->outliers);
+	free(latency);
+}
+
+int
+spdk_nvme_qpair_set_latency_tracking(struct spdk_nvme_qpair *qpair, bool enable,
+				     uint32_t num_outliers)
+{
+	struct nvme_qpair_latency *latency;
+
+	if (num_outliers > SPDK_NVME_QPAIR_MAX_LATENCY_OUTLIERS) {
+		return -EINVAL;
+	}
+
+	if (qpair->latency != NULL) {
+		nvme_qpair_latency_free(qpair->latency);
+		qpair->latency = NULL;
+	}
+
+	if (!enable) {
+		return 0;
+	}
+
+	latency = calloc(1, sizeof(*latency));
+	if (latency == NULL) {
+		return -ENOMEM;
+	}
+
+	if (num_outliers != 0) {
+		latency->outliers = calloc(num_outliers, sizeof(*latency->outliers));
+		if (latency->outliers == NULL) {
+			free(latency);
+			return -ENOMEM;
+		}
+	}
+
+	latency->max_outliers = num_outliers;
+	qpair->latency = latency;
+
+	return 0;
+}
+
+static struct spdk_histogram_data *
+nvme_qpair_latency_get_histogram(struct nvme_qpair_latency *latency, uint32_t nsid)
+{
+	struct nvme_ns_latency *ns;
+	struct spdk_histogram_data *histogram;
+	uint32_t i;
+
+	for (i = 0; i < latency->num_ns; i++) {
+		if (latency->ns[i].nsid == nsid) {
+			return latency->ns[i].histogram;
+		}
+	}
+
+	/* First completion for this namespace on this qpair. */
+	ns = realloc(latency->ns, (latency->num_ns + 1) * sizeof(*ns));
+	if (ns == NULL) {
+		return NULL;
+	}
+	latency->ns = ns;
+
+	histogram = spdk_histogram_data_alloc();
+	if (histogram == NULL) {
+		return NULL;
+	}
+
+	ns[latency->num_ns].nsid = nsid;
+	ns[latency->num_ns].histogram = histogram;
+	latency->num_ns++;
+
+	return histogram;
+}
+
+static void
+nvme_qpair_latency_add_outlier(struct nvme_qpair_latency *latency, struct spdk_nvme_qpair *qpair,
+			       struct nvme_request *req, const struct spdk_nvme_cpl *cpl,
+			       uint64_t ticks)
+{
+	struct spdk_nvme_latency_outlier *outlier;
+	uint32_t i;
+
+	if (latency->num_outliers < latency->max_outliers) {
+		outlier = &latency->outliers[latency->num_outliers++];
+	} else if (ticks > latency->min_outlier_ticks) {
+		/* Replace the fastest of the recorded commands. */
+		outlier = &latency->outliers[latency->min_outlier];
+	} else {
+		return;
+	}
+
+	outlier->latency_ticks = ticks;
+	outlier->nsid = req->cmd.nsid;
+	outlier->cid = req->cmd.cid;
+	outlier->opc = req->cmd.opc;
+	outlier->sct = cpl->status.sct;
+	outlier->sc = cpl->status.sc;
+
+	outlier->lba = 0;
+	outlier->lba_count = 0;
+	if (!nvme_qpair_is_admin_queue(qpair)) {
+		switch ((int)req->cmd.opc) {
+		case SPDK_NVME_OPC_WRITE:
+		case SPDK_NVME_OPC_READ:
+		case SPDK_NVME_OPC_WRITE_UNCORRECTABLE:
+		case SPDK_NVME_OPC_COMPARE:
+		case SPDK_NVME_OPC_WRITE_ZEROES:
+			outlier->lba = ((uint64_t)req->cmd.cdw11 << 32) + req->cmd.cdw10;
+			outlier->lba_count = (req->cmd.cdw12 & 0xFFFF) + 1;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (latency->num_outliers < latency->max_outliers) {
+		return;
+	}
+
+	latency->min_outlier = 0;
+	for (i = 1; i < latency->num_outliers; i++) {
+		if (latency->outliers[i].latency_ticks <
+		    latency->outliers[latency->min_outlier].latency_ticks) {
+			latency->min_outlier = i;
+		}
+	}
+	latency->min_outlier_ticks = latency->outliers[latency->min_outlier].latency_ticks;
+}
+
+void
+nvme_qpair_record_latency(struct spdk_nvme_qpair *qpair, struct nvme_request *req,
+			  const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_qpair_latency *latency = qpair->latency;
+	struct spdk_histogram_data *histogram;
+	uint64_t ticks;
+
+	ticks = spdk_get_ticks() - req->submit_tick;
+
+	histogram = nvme_qpair_latency_get_histogram(latency, req->cmd.nsid);
+	if (histogram != NULL) {
+		spdk_histogram_data_tally(histogram, ticks);
+	}
+
+	if (latency->max_outliers != 0) {
+		nvme_qpair_latency_add_outlier(latency, qpair, req, cpl, ticks);
+	}
+}
+
+static int
+nvme_latency_outlier_cmp(const void *a, const void *b)
+{
+	const struct spdk_nvme_latency_outlier *oa = a, *ob = b;
+
+	if (oa->latency_ticks == ob->latency_ticks) {
+		return 0;
+	}
+
+	return oa->latency_ticks > ob->latency_ticks ? -1 : 1;
+}
+
+int
+nvme_qpair_get_latency_stat(struct spdk_nvme_qpair *qpair,
+			    struct spdk_nvme_qpair_latency_stat *stat)
+{
+	struct nvme_qpair_latency *latency = qpair->latency;
+	struct spdk_nvme_ns_latency_stat *ns_stat;
+	uint32_t i;
+
+	assert(latency != NULL);
+
+	memset(stat, 0, sizeof(*stat));
+	stat->qpair = qpair;
+	stat->qid = qpair->id;
+
+	if (latency->num_ns != 0) {
+		stat->ns_stats = calloc(latency->num_ns, sizeof(*stat->ns_stats));
+		if (stat->ns_stats == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < latency->num_ns; i++) {
+		ns_stat = &stat->ns_stats[stat->num_ns];
+		ns_stat->nsid = latency->ns[i].nsid;
+		ns_stat->histogram = spdk_histogram_data_alloc();
+		if (ns_stat->histogram == NULL) {
+			nvme_qpair_free_latency_stat(stat);
+			return -ENOMEM;
+		}
+		spdk_histogram_data_merge(ns_stat->histogram, latency->ns[i].histogram);
+		stat->num_ns++;
+	}
+
+	if (latency->num_outliers != 0) {
+		stat->outliers = calloc(latency->num_outliers, sizeof(*stat->outliers));
+		if (stat->outliers == NULL) {
+			nvme_qpair_free_latency_stat(stat);
+			return -ENOMEM;
+		}
+		memcpy(stat->outliers, latency->outliers, latency->num_outliers * sizeof(*stat->outliers));
+		stat->num_outliers = latency->num_outliers;
+		qsort(stat->outliers, stat->num_outliers, sizeof(*stat->outliers), nvme_latency_outlier_cmp);
+	}
+
+	return 0;
+}
+
+void
+nvme_qpair_free_latency_stat(struct spdk_nvme_qpair_latency_stat *stat)
+{
+	uint32_t i;
+
+	for (i = 0; i < stat->num_ns; i++) {
+		spdk_histogram_data_free(stat->ns_stats[i].histogram);
+	}
+
+	free(stat->ns_stats);
+	free(stat->outliers);
+}
@@ -40,6 +40,7 @@
 #include "spdk/bit_array.h"
 #include "spdk/util.h"
 #include "spdk/log.h"
+#include "spdk/crc32.h"
 
 #include "libpmem.h"
 
@@ -51,13 +52,15 @@
 
 #define REDUCE_EMPTY_MAP_ENTRY	-1ULL
 
-#define REDUCE_NUM_VOL_REQUESTS	256
+/* Requests are allocated in slabs as they are needed, up to REDUCE_MAX_VOL_REQUESTS. */
+#define REDUCE_VOL_REQUESTS_PER_SLAB	32
+#define REDUCE_MAX_VOL_REQUESTS		256
 
 /* Structure written to offset 0 of both the pm file and the backing device. */
 struct spdk_reduce_vol_superblock {
 	uint8_t				signature[8];
 	struct spdk_reduce_vol_params	params;
-	uint8_t				reserved[4048];
+	uint8_t				reserved[4040];
 };
 SPDK_STATIC_ASSERT(sizeof(struct spdk_reduce_vol_superblock) == 4096, "size incorrect");
 
@@ -83,10 +86,19 @@ struct spdk_reduce_pm_file {
 
 #define REDUCE_IO_READV		1
 #define REDUCE_IO_WRITEV	2
+#define REDUCE_IO_COMPACT	3
+
+/* Number of shared io units a packed volume can be filling or writing at once. */
+#define REDUCE_NUM_PACK_UNITS	4
 
 struct spdk_reduce_chunk_map {
 	uint32_t		compressed_size;
-	uint32_t		reserved;
+	/**
+	 * Packed volumes only: byte offset of the chunk's tail (the compressed data
+	 *  past the last whole io unit) within the shared io unit recorded as the
+	 *  chunk's last io_unit_index entry.
+	 */
+	uint32_t		packed_offset;
 	uint64_t		io_unit_index[0];
 };
 
@@ -137,6 +149,107 @@ struct spdk_reduce_vol_request {
 	void					*cb_arg;
 	TAILQ_ENTRY(spdk_reduce_vol_request)	tailq;
 	struct spdk_reduce_vol_cb_args		backing_cb_args;
+
+	/* Packed volumes: called once the shared io unit holding the chunk's tail is written. */
+	void					(*pack_next_fn)(void *_req, int reduce_errno);
+	TAILQ_ENTRY(spdk_reduce_vol_request)	pack_tailq;
+
+	/* Volumes without a pm file: chunk map being replaced and the journal slots involved. */
+	uint64_t				old_chunk_map_index;
+	bool					free_old_io_units;
+	uint64_t				journal_slot;
+	uint64_t				old_journal_slot;
+	TAILQ_ENTRY(spdk_reduce_vol_request)	journal_tailq;
+};
+
+/*
+ * Volumes created without a pm file keep their logical map and chunk maps in DRAM and record
+ *  every chunk map update in a journal at the end of the backing device.  The journal is an
+ *  array of fixed size slots, one entry per slot, grouped in blocks of one backing io unit.
+ *  Only the latest entry of each chunk is kept - its slot is released once a newer entry for
+ *  the same chunk has been written.  New entries are only placed in released slots, and the
+ *  block they are in is rewritten from a copy read off the disk, so the entries that are
+ *  still needed never change on disk.  On load, the entry with the highest sequence number
+ *  for each chunk wins.
+ */
+struct reduce_journal_entry {
+	uint64_t				seq;
+	uint64_t				logical_map_index;
+	/* CRC-32C of the entry, seeded from the volume's uuid, computed with this field zeroed. */
+	uint32_t				crc;
+	uint32_t				reserved;
+	/* Followed by a struct spdk_reduce_chunk_map. */
+};
+SPDK_STATIC_ASSERT(sizeof(struct reduce_journal_entry) == 24, "size incorrect");
+
+/* Number of journal blocks read at once when loading a volume. */
+#define REDUCE_JOURNAL_LOAD_BLOCKS	64
+
+struct reduce_journal {
+	uint32_t				entry_size;
+	uint32_t				entries_per_block;
+	uint64_t				num_blocks;
+	/* Offset of the journal on the backing device, in backing io units. */
+	uint64_t				start_io_unit;
+	uint32_t				crc_seed;
+	uint64_t				seq;
+	/* Slots holding the latest entry of a chunk, written or not. */
+	struct spdk_bit_array			*slots;
+	/* Slot of the latest entry for each chunk of the logical map. */
+	uint64_t				*chunk_slot;
+
+	/* Block new entries are added to.  buf holds what's on disk plus the new entries. */
+	uint8_t					*buf;
+	uint64_t				block;
+	bool					block_ready;
+	bool					reading;
+	bool					writing;
+	struct iovec				iov;
+	struct spdk_reduce_vol_cb_args		backing_cb_args;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	pending;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	writing_reqs;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	waiting;
+};
+
+/**
+ * Backing io unit that tails of compressed chunks are being packed into.  The
+ *  whole io unit is rewritten each time new tails are appended, so only one write
+ *  may be outstanding at a time - tails appended while a write is in flight wait
+ *  on the pending list for the next one.  Previously written tails never change,
+ *  so rewriting the io unit doesn't put already committed chunks at risk.
+ */
+struct reduce_pack_unit {
+	struct spdk_reduce_vol			*vol;
+	uint8_t					*buf;
+	struct iovec				iov;
+	uint64_t				io_unit_index;
+	uint32_t				used;
+	bool					in_use;
+	bool					sealed;
+	bool					writing;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	pending;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	writing_reqs;
+	struct spdk_reduce_vol_cb_args		backing_cb_args;
+	TAILQ_ENTRY(reduce_pack_unit)		tailq;
+};
+
+struct reduce_request_slab {
+	struct spdk_reduce_vol_request		*request_mem;
+	/* Single contiguous buffer used for all request buffers in this slab. */
+	uint8_t					*buf_mem;
+	struct iovec				*buf_iov_mem;
+	TAILQ_ENTRY(reduce_request_slab)	tailq;
+};
+
+/*
+ * Internal operation waiting for a request to be given back to the volume.  Unlike user
+ *  requests, which fail with -ENOMEM when the pool is exhausted, these can't be retried by
+ *  the caller, so they are resumed from _reduce_vol_complete_req() instead.
+ */
+struct reduce_request_waiter {
+	void					(*cb_fn)(void *cb_arg);
+	void					*cb_arg;
+	TAILQ_ENTRY(reduce_request_waiter)	tailq;
 };
 
 struct spdk_reduce_vol {
@@ -154,14 +267,24 @@ struct spdk_reduce_vol {
 	struct spdk_bit_array			*allocated_chunk_maps;
 	struct spdk_bit_array			*allocated_backing_io_units;
 
-	struct spdk_reduce_vol_request		*request_mem;
+	TAILQ_HEAD(, reduce_request_slab)	request_slabs;
+	uint32_t				num_requests;
 	TAILQ_HEAD(, spdk_reduce_vol_request)	free_requests;
 	TAILQ_HEAD(, spdk_reduce_vol_request)	executing_requests;
 	TAILQ_HEAD(, spdk_reduce_vol_request)	queued_requests;
-
-	/* Single contiguous buffer used for all request buffers for this volume. */
-	uint8_t					*buf_mem;
-	struct iovec				*buf_iov_mem;
+	TAILQ_HEAD(, reduce_request_waiter)	request_waiters;
+
+	/* Packed volumes only. */
+	uint32_t				*io_unit_packed_bytes;
+	struct reduce_pack_unit			*pack_units;
+	uint8_t					*pack_buf_mem;
+	struct reduce_pack_unit			*open_pack_unit;
+	TAILQ_HEAD(, reduce_pack_unit)		free_pack_units;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	pack_waiting;
+	struct reduce_compact_ctx		*compact_ctx;
+
+	/* Only for volumes without a pm file. */
+	struct reduce_journal			*journal;
 };
 
 static void _start_readv_request(struct spdk_reduce_vol_request *req);
@@ -180,6 +303,11 @@ static int g_vol_count = 0;
 static void
 _reduce_persist(struct spdk_reduce_vol *vol, const void *addr, size_t len)
 {
+	if (vol->journal != NULL) {
+		/* Metadata is in DRAM - updates are persisted through the journal. */
+		return;
+	}
+
 	if (vol->pm_file.pm_is_pmem) {
 		pmem_persist(addr, len);
 	} else {
@@ -245,6 +373,75 @@ _reduce_vol_get_chunk_map(struct spdk_reduce_vol *vol, uint64_t chunk_map_index)
 	return (struct spdk_reduce_chunk_map *)chunk_map_addr;
 }
 
+/* Number of bytes of a chunk's compressed data stored in a shared io unit. */
+static inline uint32_t
+_reduce_vol_get_packed_tail_size(struct spdk_reduce_vol *vol, struct spdk_reduce_chunk_map *chunk)
+{
+	if (!vol->params.packed || chunk->compressed_size == vol->params.chunk_size) {
+		return 0;
+	}
+
+	return chunk->compressed_size % vol->params.backing_io_unit_size;
+}
+
+static bool
+_reduce_vol_io_unit_is_packing(struct spdk_reduce_vol *vol, uint64_t io_unit_index)
+{
+	uint32_t i;
+
+	for (i = 0; i < REDUCE_NUM_PACK_UNITS; i++) {
+		if (vol->pack_units[i].in_use && vol->pack_units[i].io_unit_index == io_unit_index) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+_reduce_vol_release_packed_bytes(struct spdk_reduce_vol *vol, uint64_t io_unit_index,
+				 uint32_t size)
+{
+	assert(vol->io_unit_packed_bytes[io_unit_index] >= size);
+	vol->io_unit_packed_bytes[io_unit_index] -= size;
+
+	/* The io unit still being packed is freed once it's no longer needed for packing. */
+	if (vol->io_unit_packed_bytes[io_unit_index] == 0 &&
+	    !_reduce_vol_io_unit_is_packing(vol, io_unit_index)) {
+		assert(spdk_bit_array_get(vol->allocated_backing_io_units, io_unit_index) == true);
+		spdk_bit_array_clear(vol->allocated_backing_io_units, io_unit_index);
+	}
+}
+
+/*
+ * Release a chunk map along with its share of any packed io unit.  When moving a chunk's tail
+ *  to another io unit, the whole io units are handed over to the new chunk map, so they are
+ *  only released if free_io_units is set.
+ */
+static void
+_reduce_vol_free_chunk_map(struct spdk_reduce_vol *vol, uint64_t chunk_map_index,
+			   bool free_io_units)
+{
+	struct spdk_reduce_chunk_map *chunk;
+	uint32_t i, tail_size;
+
+	chunk = _reduce_vol_get_chunk_map(vol, chunk_map_index);
+	tail_size = _reduce_vol_get_packed_tail_size(vol, chunk);
+	for (i = 0; i < vol->backing_io_units_per_chunk; i++) {
+		if (chunk->io_unit_index[i] == REDUCE_EMPTY_MAP_ENTRY) {
+			break;
+		}
+		if (tail_size != 0 && i == chunk->compressed_size / vol->params.backing_io_unit_size) {
+			_reduce_vol_release_packed_bytes(vol, chunk->io_unit_index[i], tail_size);
+		} else if (free_io_units) {
+			assert(spdk_bit_array_get(vol->allocated_backing_io_units, chunk->io_unit_index[i]) == true);
+			spdk_bit_array_clear(vol->allocated_backing_io_units, chunk->io_unit_index[i]);
+		}
+		chunk->io_unit_index[i] = REDUCE_EMPTY_MAP_ENTRY;
+	}
+	spdk_bit_array_clear(vol->allocated_chunk_maps, chunk_map_index);
+}
+
 static int
 _validate_vol_params(struct spdk_reduce_vol_params *params)
 {
@@ -300,6 +497,52 @@ _get_pm_file_size(struct spdk_reduce_vol_params *params)
 	return total_pm_size;
 }
 
+static uint32_t
+_get_journal_entry_size(uint64_t chunk_size, uint64_t backing_io_unit_size)
+{
+	return sizeof(struct reduce_journal_entry) +
+	       _reduce_vol_get_chunk_struct_size(chunk_size / backing_io_unit_size);
+}
+
+static uint64_t
+_get_journal_num_blocks(uint64_t vol_size, uint64_t chunk_size, uint64_t backing_io_unit_size)
+{
+	uint64_t num_slots, entries_per_block;
+
+	entries_per_block = backing_io_unit_size /
+			    _get_journal_entry_size(chunk_size, backing_io_unit_size);
+	assert(entries_per_block > 0);
+
+	/* Twice as many slots as chunk maps, so there are always released slots to fill a
+	 *  journal block with.
+	 */
+	num_slots = 2 * _get_total_chunks(vol_size, chunk_size);
+
+	return spdk_divide_round_up(num_slots, entries_per_block);
+}
+
+/* The journal follows the last backing io unit that can be allocated to a chunk. */
+static uint64_t
+_get_journal_vol_size(uint64_t chunk_size, uint64_t backing_io_unit_size, uint64_t backing_dev_size)
+{
+	uint64_t vol_size, needed_size;
+
+	vol_size = _get_vol_size(chunk_size, backing_dev_size);
+	while (vol_size > 0) {
+		needed_size = _get_total_chunks(vol_size, chunk_size) * chunk_size;
+		needed_size += _get_journal_num_blocks(vol_size, chunk_size, backing_io_unit_size) *
+			       backing_io_unit_size;
+		if (needed_size <= backing_dev_size) {
+			break;
+		}
+
+		vol_size -= spdk_min(vol_size, spdk_divide_round_up(needed_size - backing_dev_size,
+				     chunk_size) * chunk_size);
+	}
+
+	return vol_size;
+}
+
 const struct spdk_uuid *
 spdk_reduce_vol_get_uuid(struct spdk_reduce_vol *vol)
 {
@@ -332,74 +575,233 @@ struct reduce_init_load_ctx {
 	void					*cb_arg;
 	struct iovec				iov[LOAD_IOV_COUNT];
 	void					*path;
+
+	/* Used to replay the journal of volumes without a pm file. */
+	uint8_t					*journal_buf;
+	uint64_t				journal_block;
+	uint64_t				*journal_seq;
 };
 
+static void
+_free_request_slab(struct reduce_request_slab *slab)
+{
+	free(slab->request_mem);
+	free(slab->buf_iov_mem);
+	spdk_free(slab->buf_mem);
+	free(slab);
+}
+
+/* Add another slab of requests to the volume's pool. */
 static int
 _allocate_vol_requests(struct spdk_reduce_vol *vol)
 {
+	struct reduce_request_slab *slab;
 	struct spdk_reduce_vol_request *req;
 	int i;
 
+	slab = calloc(1, sizeof(*slab));
+	if (slab == NULL) {
+		return -ENOMEM;
+	}
+
 	/* Allocate 2x since we need buffers for both read/write and compress/decompress
 	 *  intermediate buffers.
 	 */
-	vol->buf_mem = spdk_malloc(2 * REDUCE_NUM_VOL_REQUESTS * vol->params.chunk_size,
-				   64, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
-	if (vol->buf_mem == NULL) {
+	slab->buf_mem = spdk_malloc(2 * REDUCE_VOL_REQUESTS_PER_SLAB * vol->params.chunk_size,
+				    64, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	slab->request_mem = calloc(REDUCE_VOL_REQUESTS_PER_SLAB, sizeof(*req));
+	/* Allocate 2x since we need iovs for both read/write and compress/decompress intermediate
+	 *  buffers.
+	 */
+	slab->buf_iov_mem = calloc(REDUCE_VOL_REQUESTS_PER_SLAB,
+				   2 * sizeof(struct iovec) * vol->backing_io_units_per_chunk);
+	if (slab->buf_mem == NULL || slab->request_mem == NULL || slab->buf_iov_mem == NULL) {
+		_free_request_slab(slab);
 		return -ENOMEM;
 	}
 
-	vol->request_mem = calloc(REDUCE_NUM_VOL_REQUESTS, sizeof(*req));
-	if (vol->request_mem == NULL) {
-		spdk_free(vol->buf_mem);
-		vol->buf_mem = NULL;
+	for (i = 0; i < REDUCE_VOL_REQUESTS_PER_SLAB; i++) {
+		req = &slab->request_mem[i];
+		TAILQ_INSERT_HEAD(&vol->free_requests, req, tailq);
+		req->decomp_buf_iov = &slab->buf_iov_mem[(2 * i) * vol->backing_io_units_per_chunk];
+		req->decomp_buf = slab->buf_mem + (2 * i) * vol->params.chunk_size;
+		req->comp_buf_iov = &slab->buf_iov_mem[(2 * i + 1) * vol->backing_io_units_per_chunk];
+		req->comp_buf = slab->buf_mem + (2 * i + 1) * vol->params.chunk_size;
+	}
+
+	TAILQ_INSERT_TAIL(&vol->request_slabs, slab, tailq);
+	vol->num_requests += REDUCE_VOL_REQUESTS_PER_SLAB;
+
+	return 0;
+}
+
+static struct spdk_reduce_vol_request *
+_reduce_vol_get_request(struct spdk_reduce_vol *vol)
+{
+	struct spdk_reduce_vol_request *req;
+
+	if (TAILQ_EMPTY(&vol->free_requests) && vol->num_requests < REDUCE_MAX_VOL_REQUESTS) {
+		/* If this fails, the caller gets -ENOMEM just like when the pool is at its limit. */
+		_allocate_vol_requests(vol);
+	}
+
+	req = TAILQ_FIRST(&vol->free_requests);
+	if (req != NULL) {
+		TAILQ_REMOVE(&vol->free_requests, req, tailq);
+	}
+
+	return req;
+}
+
+/*
+ * Call the waiter back once a request is free.  That is only guaranteed to happen while some
+ *  other request is executing, so -ENOMEM is returned when none is.
+ */
+static int
+_reduce_vol_wait_for_request(struct spdk_reduce_vol *vol, struct reduce_request_waiter *waiter)
+{
+	if (TAILQ_EMPTY(&vol->executing_requests)) {
 		return -ENOMEM;
 	}
 
-	/* Allocate 2x since we need iovs for both read/write and compress/decompress intermediate
-	 *  buffers.
-	 */
-	vol->buf_iov_mem = calloc(REDUCE_NUM_VOL_REQUESTS,
-				  2 * sizeof(struct iovec) * vol->backing_io_units_per_chunk);
-	if (vol->buf_iov_mem == NULL) {
-		free(vol->request_mem);
-		spdk_free(vol->buf_mem);
-		vol->request_mem = NULL;
-		vol->buf_mem = NULL;
+	TAILQ_INSERT_TAIL(&vol->request_waiters, waiter, tailq);
+	return 0;
+}
+
+static int
+_allocate_pack_units(struct spdk_reduce_vol *vol)
+{
+	struct reduce_pack_unit *pu;
+	int i;
+
+	if (!vol->params.packed) {
+		return 0;
+	}
+
+	vol->pack_buf_mem = spdk_zmalloc(REDUCE_NUM_PACK_UNITS * vol->params.backing_io_unit_size,
+					 64, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (vol->pack_buf_mem == NULL) {
 		return -ENOMEM;
 	}
 
-	for (i = 0; i < REDUCE_NUM_VOL_REQUESTS; i++) {
-		req = &vol->request_mem[i];
-		TAILQ_INSERT_HEAD(&vol->free_requests, req, tailq);
-		req->decomp_buf_iov = &vol->buf_iov_mem[(2 * i) * vol->backing_io_units_per_chunk];
-		req->decomp_buf = vol->buf_mem + (2 * i) * vol->params.chunk_size;
-		req->comp_buf_iov = &vol->buf_iov_mem[(2 * i + 1) * vol->backing_io_units_per_chunk];
-		req->comp_buf = vol->buf_mem + (2 * i + 1) * vol->params.chunk_size;
+	vol->pack_units = calloc(REDUCE_NUM_PACK_UNITS, sizeof(*pu));
+	if (vol->pack_units == NULL) {
+		spdk_free(vol->pack_buf_mem);
+		vol->pack_buf_mem = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < REDUCE_NUM_PACK_UNITS; i++) {
+		pu = &vol->pack_units[i];
+		pu->vol = vol;
+		pu->buf = vol->pack_buf_mem + i * vol->params.backing_io_unit_size;
+		TAILQ_INIT(&pu->pending);
+		TAILQ_INIT(&pu->writing_reqs);
+		TAILQ_INSERT_TAIL(&vol->free_pack_units, pu, tailq);
+	}
+
+	return 0;
+}
+
+static int
+_allocate_journal(struct spdk_reduce_vol *vol)
+{
+	struct reduce_journal *journal;
+	uint64_t i, num_chunks;
+
+	journal = calloc(1, sizeof(*journal));
+	if (journal == NULL) {
+		return -ENOMEM;
+	}
+	vol->journal = journal;
+
+	journal->entry_size = _get_journal_entry_size(vol->params.chunk_size,
+			      vol->params.backing_io_unit_size);
+	journal->entries_per_block = vol->params.backing_io_unit_size / journal->entry_size;
+	journal->num_blocks = _get_journal_num_blocks(vol->params.vol_size, vol->params.chunk_size,
+			      vol->params.backing_io_unit_size);
+	journal->start_io_unit = _get_total_chunks(vol->params.vol_size, vol->params.chunk_size) *
+				 vol->backing_io_units_per_chunk;
+	journal->crc_seed = spdk_crc32c_update(&vol->params.uuid, sizeof(vol->params.uuid), ~0);
+	journal->seq = 1;
+	/* The first block used is block 0. */
+	journal->block = journal->num_blocks - 1;
+	TAILQ_INIT(&journal->pending);
+	TAILQ_INIT(&journal->writing_reqs);
+	TAILQ_INIT(&journal->waiting);
+
+	journal->slots = spdk_bit_array_create(journal->num_blocks * journal->entries_per_block);
+	num_chunks = vol->params.vol_size / vol->params.chunk_size;
+	journal->chunk_slot = calloc(num_chunks, sizeof(uint64_t));
+	journal->buf = spdk_zmalloc(vol->params.backing_io_unit_size, 64, NULL,
+				    SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (journal->slots == NULL || journal->chunk_slot == NULL || journal->buf == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_chunks; i++) {
+		journal->chunk_slot[i] = REDUCE_EMPTY_MAP_ENTRY;
 	}
 
 	return 0;
 }
 
+static void
+_free_journal(struct reduce_journal *journal)
+{
+	if (journal == NULL) {
+		return;
+	}
+
+	spdk_bit_array_free(&journal->slots);
+	free(journal->chunk_slot);
+	spdk_free(journal->buf);
+	free(journal);
+}
+
+/* Volumes without a pm file keep the same metadata layout in DRAM instead. */
+static int
+_allocate_dram_md(struct spdk_reduce_vol *vol)
+{
+	vol->pm_file.size = _get_pm_file_size(&vol->params);
+	vol->pm_file.pm_buf = malloc(vol->pm_file.size);
+	if (vol->pm_file.pm_buf == NULL) {
+		return -ENOMEM;
+	}
+
+	return _allocate_journal(vol);
+}
+
 static void
 _init_load_cleanup(struct spdk_reduce_vol *vol, struct reduce_init_load_ctx *ctx)
 {
+	struct reduce_request_slab *slab;
+
 	if (ctx != NULL) {
 		spdk_free(ctx->path);
+		spdk_free(ctx->journal_buf);
+		free(ctx->journal_seq);
 		free(ctx);
 	}
 
 	if (vol != NULL) {
-		if (vol->pm_file.pm_buf != NULL) {
+		if (vol->journal != NULL) {
+			free(vol->pm_file.pm_buf);
+			_free_journal(vol->journal);
+		} else if (vol->pm_file.pm_buf != NULL) {
 			pmem_unmap(vol->pm_file.pm_buf, vol->pm_file.size);
 		}
 
 		spdk_free(vol->backing_super);
 		spdk_bit_array_free(&vol->allocated_chunk_maps);
 		spdk_bit_array_free(&vol->allocated_backing_io_units);
-		free(vol->request_mem);
-		free(vol->buf_iov_mem);
-		spdk_free(vol->buf_mem);
+		free(vol->io_unit_packed_bytes);
+		while ((slab = TAILQ_FIRST(&vol->request_slabs)) != NULL) {
+			TAILQ_REMOVE(&vol->request_slabs, slab, tailq);
+			_free_request_slab(slab);
+		}
+		free(vol->pack_units);
+		spdk_free(vol->pack_buf_mem);
 		free(vol);
 	}
 }
@@ -437,6 +839,13 @@ _init_write_super_cpl(void *cb_arg, int reduce_errno)
 		return;
 	}
 
+	rc = _allocate_pack_units(init_ctx->vol);
+	if (rc != 0) {
+		init_ctx->cb_fn(init_ctx->cb_arg, NULL, rc);
+		_init_load_cleanup(init_ctx->vol, init_ctx);
+		return;
+	}
+
 	rc = _alloc_zero_buff();
 	if (rc != 0) {
 		init_ctx->cb_fn(init_ctx->cb_arg, NULL, rc);
@@ -481,6 +890,14 @@ _allocate_bit_arrays(struct spdk_reduce_vol *vol)
 		return -ENOMEM;
 	}
 
+	if (vol->params.packed) {
+		/* Bytes of chunk tails stored in each io unit, so shared io units can be freed. */
+		vol->io_unit_packed_bytes = calloc(total_backing_io_units, sizeof(uint32_t));
+		if (vol->io_unit_packed_bytes == NULL) {
+			return -ENOMEM;
+		}
+	}
+
 	/* Set backing io unit bits associated with metadata. */
 	num_metadata_io_units = (sizeof(*vol->backing_super) + REDUCE_PATH_MAX) /
 				vol->backing_dev->blocklen;
@@ -501,23 +918,25 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 	struct reduce_init_load_ctx *init_ctx;
 	uint64_t backing_dev_size;
 	size_t mapped_len;
-	int dir_len, max_dir_len, rc;
+	int dir_len = 0, max_dir_len, rc;
 
-	/* We need to append a path separator and the UUID to the supplied
-	 * path.
-	 */
-	max_dir_len = REDUCE_PATH_MAX - SPDK_UUID_STRING_LEN - 1;
-	dir_len = strnlen(pm_file_dir, max_dir_len);
-	/* Strip trailing slash if the user provided one - we will add it back
-	 * later when appending the filename.
-	 */
-	if (pm_file_dir[dir_len - 1] == '/') {
-		dir_len--;
-	}
-	if (dir_len == max_dir_len) {
-		SPDK_ERRLOG("pm_file_dir (%s) too long\n", pm_file_dir);
-		cb_fn(cb_arg, NULL, -EINVAL);
-		return;
+	if (pm_file_dir != NULL) {
+		/* We need to append a path separator and the UUID to the supplied
+		 * path.
+		 */
+		max_dir_len = REDUCE_PATH_MAX - SPDK_UUID_STRING_LEN - 1;
+		dir_len = strnlen(pm_file_dir, max_dir_len);
+		/* Strip trailing slash if the user provided one - we will add it back
+		 * later when appending the filename.
+		 */
+		if (pm_file_dir[dir_len - 1] == '/') {
+			dir_len--;
+		}
+		if (dir_len == max_dir_len) {
+			SPDK_ERRLOG("pm_file_dir (%s) too long\n", pm_file_dir);
+			cb_fn(cb_arg, NULL, -EINVAL);
+			return;
+		}
 	}
 
 	rc = _validate_vol_params(params);
@@ -528,7 +947,19 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 	}
 
 	backing_dev_size = backing_dev->blockcnt * backing_dev->blocklen;
-	params->vol_size = _get_vol_size(params->chunk_size, backing_dev_size);
+	if (pm_file_dir != NULL) {
+		params->vol_size = _get_vol_size(params->chunk_size, backing_dev_size);
+	} else {
+		/* Each journal entry has to fit in one backing io unit. */
+		if (_get_journal_entry_size(params->chunk_size, params->backing_io_unit_size) >
+		    params->backing_io_unit_size) {
+			SPDK_ERRLOG("backing io unit size too small to journal chunk maps\n");
+			cb_fn(cb_arg, NULL, -EINVAL);
+			return;
+		}
+		params->vol_size = _get_journal_vol_size(params->chunk_size, params->backing_io_unit_size,
+				   backing_dev_size);
+	}
 	if (params->vol_size == 0) {
 		SPDK_ERRLOG("backing device is too small\n");
 		cb_fn(cb_arg, NULL, -EINVAL);
@@ -548,9 +979,13 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 		return;
 	}
 
+	TAILQ_INIT(&vol->request_slabs);
 	TAILQ_INIT(&vol->free_requests);
 	TAILQ_INIT(&vol->executing_requests);
 	TAILQ_INIT(&vol->queued_requests);
+	TAILQ_INIT(&vol->request_waiters);
+	TAILQ_INIT(&vol->free_pack_units);
+	TAILQ_INIT(&vol->pack_waiting);
 
 	vol->backing_super = spdk_zmalloc(sizeof(*vol->backing_super), 0, NULL,
 					  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
@@ -579,28 +1014,30 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 		spdk_uuid_generate(&params->uuid);
 	}
 
-	memcpy(vol->pm_file.path, pm_file_dir, dir_len);
-	vol->pm_file.path[dir_len] = '/';
-	spdk_uuid_fmt_lower(&vol->pm_file.path[dir_len + 1], SPDK_UUID_STRING_LEN,
-			    &params->uuid);
-	vol->pm_file.size = _get_pm_file_size(params);
-	vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, vol->pm_file.size,
-					    PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0600,
-					    &mapped_len, &vol->pm_file.pm_is_pmem);
-	if (vol->pm_file.pm_buf == NULL) {
-		SPDK_ERRLOG("could not pmem_map_file(%s): %s\n",
-			    vol->pm_file.path, strerror(errno));
-		cb_fn(cb_arg, NULL, -errno);
-		_init_load_cleanup(vol, init_ctx);
-		return;
-	}
+	if (pm_file_dir != NULL) {
+		memcpy(vol->pm_file.path, pm_file_dir, dir_len);
+		vol->pm_file.path[dir_len] = '/';
+		spdk_uuid_fmt_lower(&vol->pm_file.path[dir_len + 1], SPDK_UUID_STRING_LEN,
+				    &params->uuid);
+		vol->pm_file.size = _get_pm_file_size(params);
+		vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, vol->pm_file.size,
+						    PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0600,
+						    &mapped_len, &vol->pm_file.pm_is_pmem);
+		if (vol->pm_file.pm_buf == NULL) {
+			SPDK_ERRLOG("could not pmem_map_file(%s): %s\n",
+				    vol->pm_file.path, strerror(errno));
+			cb_fn(cb_arg, NULL, -errno);
+			_init_load_cleanup(vol, init_ctx);
+			return;
+		}
 
-	if (vol->pm_file.size != mapped_len) {
-		SPDK_ERRLOG("could not map entire pmem file (size=%" PRIu64 " mapped=%" PRIu64 ")\n",
-			    vol->pm_file.size, mapped_len);
-		cb_fn(cb_arg, NULL, -ENOMEM);
-		_init_load_cleanup(vol, init_ctx);
-		return;
+		if (vol->pm_file.size != mapped_len) {
+			SPDK_ERRLOG("could not map entire pmem file (size=%" PRIu64 " mapped=%" PRIu64 ")\n",
+				    vol->pm_file.size, mapped_len);
+			cb_fn(cb_arg, NULL, -ENOMEM);
+			_init_load_cleanup(vol, init_ctx);
+			return;
+		}
 	}
 
 	vol->backing_io_units_per_chunk = params->chunk_size / params->backing_io_unit_size;
@@ -610,6 +1047,16 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 
 	vol->backing_dev = backing_dev;
 
+	if (pm_file_dir == NULL) {
+		/* The empty path written to the backing device marks the volume as journaled. */
+		rc = _allocate_dram_md(vol);
+		if (rc != 0) {
+			cb_fn(cb_arg, NULL, rc);
+			_init_load_cleanup(vol, init_ctx);
+			return;
+		}
+	}
+
 	rc = _allocate_bit_arrays(vol);
 	if (rc != 0) {
 		cb_fn(cb_arg, NULL, rc);
@@ -653,34 +1100,212 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 static void destroy_load_cb(void *cb_arg, struct spdk_reduce_vol *vol, int reduce_errno);
 
 static void
-_load_read_super_and_path_cpl(void *cb_arg, int reduce_errno)
+_load_complete(struct reduce_init_load_ctx *load_ctx)
 {
-	struct reduce_init_load_ctx *load_ctx = cb_arg;
 	struct spdk_reduce_vol *vol = load_ctx->vol;
-	uint64_t backing_dev_size;
 	uint64_t i, num_chunks, logical_map_index;
 	struct spdk_reduce_chunk_map *chunk;
-	size_t mapped_len;
-	uint32_t j;
-	int rc;
+	uint32_t j, tail_size;
 
-	rc = _alloc_zero_buff();
-	if (rc) {
-		goto error;
+	num_chunks = vol->params.vol_size / vol->params.chunk_size;
+	for (i = 0; i < num_chunks; i++) {
+		logical_map_index = vol->pm_logical_map[i];
+		if (logical_map_index == REDUCE_EMPTY_MAP_ENTRY) {
+			continue;
+		}
+		spdk_bit_array_set(vol->allocated_chunk_maps, logical_map_index);
+		chunk = _reduce_vol_get_chunk_map(vol, logical_map_index);
+		tail_size = _reduce_vol_get_packed_tail_size(vol, chunk);
+		for (j = 0; j < vol->backing_io_units_per_chunk; j++) {
+			if (chunk->io_unit_index[j] != REDUCE_EMPTY_MAP_ENTRY) {
+				spdk_bit_array_set(vol->allocated_backing_io_units, chunk->io_unit_index[j]);
+				if (tail_size != 0 && j == chunk->compressed_size / vol->params.backing_io_unit_size) {
+					vol->io_unit_packed_bytes[chunk->io_unit_index[j]] += tail_size;
+				}
+			}
+		}
 	}
 
-	if (memcmp(vol->backing_super->signature,
-		   SPDK_REDUCE_SIGNATURE,
-		   sizeof(vol->backing_super->signature)) != 0) {
-		/* This backing device isn't a libreduce backing device. */
-		rc = -EILSEQ;
-		goto error;
+	load_ctx->cb_fn(load_ctx->cb_arg, vol, 0);
+	/* Only clean up the ctx - the vol has been passed to the application
+	 *  for use now that volume load was successful.
+	 */
+	_init_load_cleanup(NULL, load_ctx);
+}
+
+static bool
+_load_journal_entry_is_valid(struct spdk_reduce_vol *vol, struct reduce_journal_entry *entry)
+{
+	struct reduce_journal *journal = vol->journal;
+	struct spdk_reduce_chunk_map *chunk = (struct spdk_reduce_chunk_map *)(entry + 1);
+	uint64_t total_io_units;
+	uint32_t crc, i;
+
+	if (entry->seq == 0 ||
+	    entry->logical_map_index >= vol->params.vol_size / vol->params.chunk_size) {
+		return false;
 	}
 
-	/* If the cb_fn is destroy_load_cb, it means we are wanting to destroy this compress bdev.
-	 *  So don't bother getting the volume ready to use - invoke the callback immediately
-	 *  so destroy_load_cb can delete the metadata off of the block device and delete the
-	 *  persistent memory file if it exists.
+	crc = entry->crc;
+	entry->crc = 0;
+	if (spdk_crc32c_update(entry, journal->entry_size, journal->crc_seed) != crc) {
+		return false;
+	}
+
+	if (chunk->compressed_size == 0 || chunk->compressed_size > vol->params.chunk_size) {
+		return false;
+	}
+
+	total_io_units = spdk_bit_array_capacity(vol->allocated_backing_io_units);
+	for (i = 0; i < vol->backing_io_units_per_chunk; i++) {
+		if (chunk->io_unit_index[i] != REDUCE_EMPTY_MAP_ENTRY &&
+		    chunk->io_unit_index[i] >= total_io_units) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+_load_journal_entry(struct reduce_init_load_ctx *load_ctx, uint64_t slot,
+		    struct reduce_journal_entry *entry)
+{
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_journal *journal = vol->journal;
+	uint64_t logical_map_index, chunk_map_index;
+
+	if (!_load_journal_entry_is_valid(vol, entry)) {
+		return;
+	}
+
+	logical_map_index = entry->logical_map_index;
+	if (entry->seq <= load_ctx->journal_seq[logical_map_index]) {
+		/* Superseded by an entry we've already seen. */
+		return;
+	}
+
+	if (journal->chunk_slot[logical_map_index] != REDUCE_EMPTY_MAP_ENTRY) {
+		spdk_bit_array_clear(journal->slots, journal->chunk_slot[logical_map_index]);
+	}
+	journal->chunk_slot[logical_map_index] = slot;
+	spdk_bit_array_set(journal->slots, slot);
+	load_ctx->journal_seq[logical_map_index] = entry->seq;
+	journal->seq = spdk_max(journal->seq, entry->seq + 1);
+
+	chunk_map_index = vol->pm_logical_map[logical_map_index];
+	if (chunk_map_index == REDUCE_EMPTY_MAP_ENTRY) {
+		chunk_map_index = spdk_bit_array_find_first_clear(vol->allocated_chunk_maps, 0);
+		assert(chunk_map_index != UINT32_MAX);
+		spdk_bit_array_set(vol->allocated_chunk_maps, chunk_map_index);
+		vol->pm_logical_map[logical_map_index] = chunk_map_index;
+	}
+	memcpy(_reduce_vol_get_chunk_map(vol, chunk_map_index), entry + 1,
+	       _reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk));
+}
+
+static void _load_journal_read(struct reduce_init_load_ctx *load_ctx);
+
+static void
+_load_journal_read_cpl(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *load_ctx = cb_arg;
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_journal *journal = vol->journal;
+	uint64_t num_blocks, slot, i;
+	uint8_t *entry;
+	uint32_t j;
+
+	if (reduce_errno != 0) {
+		load_ctx->cb_fn(load_ctx->cb_arg, NULL, reduce_errno);
+		_init_load_cleanup(vol, load_ctx);
+		return;
+	}
+
+	num_blocks = spdk_min(REDUCE_JOURNAL_LOAD_BLOCKS, journal->num_blocks - load_ctx->journal_block);
+	for (i = 0; i < num_blocks; i++) {
+		entry = load_ctx->journal_buf + i * vol->params.backing_io_unit_size;
+		slot = (load_ctx->journal_block + i) * journal->entries_per_block;
+		for (j = 0; j < journal->entries_per_block; j++) {
+			_load_journal_entry(load_ctx, slot + j, (struct reduce_journal_entry *)entry);
+			entry += journal->entry_size;
+		}
+	}
+
+	load_ctx->journal_block += num_blocks;
+	if (load_ctx->journal_block < journal->num_blocks) {
+		_load_journal_read(load_ctx);
+		return;
+	}
+
+	_load_complete(load_ctx);
+}
+
+static void
+_load_journal_read(struct reduce_init_load_ctx *load_ctx)
+{
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_journal *journal = vol->journal;
+	uint64_t num_blocks;
+
+	num_blocks = spdk_min(REDUCE_JOURNAL_LOAD_BLOCKS, journal->num_blocks - load_ctx->journal_block);
+	load_ctx->iov[0].iov_base = load_ctx->journal_buf;
+	load_ctx->iov[0].iov_len = num_blocks * vol->params.backing_io_unit_size;
+	load_ctx->backing_cb_args.cb_fn = _load_journal_read_cpl;
+	load_ctx->backing_cb_args.cb_arg = load_ctx;
+	vol->backing_dev->readv(vol->backing_dev, load_ctx->iov, 1,
+				(journal->start_io_unit + load_ctx->journal_block) * vol->backing_lba_per_io_unit,
+				num_blocks * vol->backing_lba_per_io_unit, &load_ctx->backing_cb_args);
+}
+
+/* Rebuild the DRAM logical map and chunk maps from the latest journal entry of each chunk. */
+static int
+_load_journal(struct reduce_init_load_ctx *load_ctx)
+{
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+
+	memcpy(vol->pm_super, vol->backing_super, sizeof(*vol->backing_super));
+	memset(vol->pm_logical_map, 0xFF, vol->pm_file.size - sizeof(*vol->backing_super));
+
+	load_ctx->journal_buf = spdk_malloc(REDUCE_JOURNAL_LOAD_BLOCKS * vol->params.backing_io_unit_size,
+					    64, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	load_ctx->journal_seq = calloc(vol->params.vol_size / vol->params.chunk_size, sizeof(uint64_t));
+	if (load_ctx->journal_buf == NULL || load_ctx->journal_seq == NULL) {
+		return -ENOMEM;
+	}
+
+	load_ctx->journal_block = 0;
+	_load_journal_read(load_ctx);
+
+	return 0;
+}
+
+static void
+_load_read_super_and_path_cpl(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *load_ctx = cb_arg;
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	uint64_t backing_dev_size, expected_vol_size;
+	size_t mapped_len;
+	int rc;
+
+	rc = _alloc_zero_buff();
+	if (rc) {
+		goto error;
+	}
+
+	if (memcmp(vol->backing_super->signature,
+		   SPDK_REDUCE_SIGNATURE,
+		   sizeof(vol->backing_super->signature)) != 0) {
+		/* This backing device isn't a libreduce backing device. */
+		rc = -EILSEQ;
+		goto error;
+	}
+
+	/* If the cb_fn is destroy_load_cb, it means we are wanting to destroy this compress bdev.
+	 *  So don't bother getting the volume ready to use - invoke the callback immediately
+	 *  so destroy_load_cb can delete the metadata off of the block device and delete the
+	 *  persistent memory file if it exists.
 	 */
 	memcpy(vol->pm_file.path, load_ctx->path, sizeof(vol->pm_file.path));
 	if (load_ctx->cb_fn == (*destroy_load_cb)) {
@@ -700,56 +1325,63 @@ _load_read_super_and_path_cpl(void *cb_arg, int reduce_errno)
 	}
 
 	backing_dev_size = vol->backing_dev->blockcnt * vol->backing_dev->blocklen;
-	if (_get_vol_size(vol->params.chunk_size, backing_dev_size) < vol->params.vol_size) {
+	if (vol->pm_file.path[0] == '\0') {
+		expected_vol_size = _get_journal_vol_size(vol->params.chunk_size,
+				    vol->params.backing_io_unit_size, backing_dev_size);
+	} else {
+		expected_vol_size = _get_vol_size(vol->params.chunk_size, backing_dev_size);
+	}
+	if (expected_vol_size < vol->params.vol_size) {
 		SPDK_ERRLOG("backing device size %" PRIi64 " smaller than expected\n",
 			    backing_dev_size);
 		rc = -EILSEQ;
 		goto error;
 	}
 
-	vol->pm_file.size = _get_pm_file_size(&vol->params);
-	vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, 0, 0, 0, &mapped_len,
-					    &vol->pm_file.pm_is_pmem);
-	if (vol->pm_file.pm_buf == NULL) {
-		SPDK_ERRLOG("could not pmem_map_file(%s): %s\n", vol->pm_file.path, strerror(errno));
-		rc = -errno;
-		goto error;
+	if (vol->pm_file.path[0] == '\0') {
+		rc = _allocate_dram_md(vol);
+		if (rc != 0) {
+			goto error;
+		}
+	} else {
+		vol->pm_file.size = _get_pm_file_size(&vol->params);
+		vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, 0, 0, 0, &mapped_len,
+						    &vol->pm_file.pm_is_pmem);
+		if (vol->pm_file.pm_buf == NULL) {
+			SPDK_ERRLOG("could not pmem_map_file(%s): %s\n", vol->pm_file.path, strerror(errno));
+			rc = -errno;
+			goto error;
+		}
+
+		if (vol->pm_file.size != mapped_len) {
+			SPDK_ERRLOG("could not map entire pmem file (size=%" PRIu64 " mapped=%" PRIu64 ")\n",
+				    vol->pm_file.size, mapped_len);
+			rc = -ENOMEM;
+			goto error;
+		}
 	}
 
-	if (vol->pm_file.size != mapped_len) {
-		SPDK_ERRLOG("could not map entire pmem file (size=%" PRIu64 " mapped=%" PRIu64 ")\n",
-			    vol->pm_file.size, mapped_len);
-		rc = -ENOMEM;
+	rc = _allocate_vol_requests(vol);
+	if (rc != 0) {
 		goto error;
 	}
 
-	rc = _allocate_vol_requests(vol);
+	rc = _allocate_pack_units(vol);
 	if (rc != 0) {
 		goto error;
 	}
 
 	_initialize_vol_pm_pointers(vol);
 
-	num_chunks = vol->params.vol_size / vol->params.chunk_size;
-	for (i = 0; i < num_chunks; i++) {
-		logical_map_index = vol->pm_logical_map[i];
-		if (logical_map_index == REDUCE_EMPTY_MAP_ENTRY) {
-			continue;
-		}
-		spdk_bit_array_set(vol->allocated_chunk_maps, logical_map_index);
-		chunk = _reduce_vol_get_chunk_map(vol, logical_map_index);
-		for (j = 0; j < vol->backing_io_units_per_chunk; j++) {
-			if (chunk->io_unit_index[j] != REDUCE_EMPTY_MAP_ENTRY) {
-				spdk_bit_array_set(vol->allocated_backing_io_units, chunk->io_unit_index[j]);
-			}
+	if (vol->journal != NULL) {
+		rc = _load_journal(load_ctx);
+		if (rc != 0) {
+			goto error;
 		}
+		return;
 	}
 
-	load_ctx->cb_fn(load_ctx->cb_arg, vol, 0);
-	/* Only clean up the ctx - the vol has been passed to the application
-	 *  for use now that volume load was successful.
-	 */
-	_init_load_cleanup(NULL, load_ctx);
+	_load_complete(load_ctx);
 	return;
 
 error:
@@ -777,9 +1409,13 @@ spdk_reduce_vol_load(struct spdk_reduce_backing_dev *backing_dev,
 		return;
 	}
 
+	TAILQ_INIT(&vol->request_slabs);
 	TAILQ_INIT(&vol->free_requests);
 	TAILQ_INIT(&vol->executing_requests);
 	TAILQ_INIT(&vol->queued_requests);
+	TAILQ_INIT(&vol->request_waiters);
+	TAILQ_INIT(&vol->free_pack_units);
+	TAILQ_INIT(&vol->pack_waiting);
 
 	vol->backing_super = spdk_zmalloc(sizeof(*vol->backing_super), 64, NULL,
 					  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
@@ -857,7 +1493,8 @@ destroy_unload_cpl(void *cb_arg, int reduce_errno)
 {
 	struct reduce_destroy_ctx *destroy_ctx = cb_arg;
 
-	if (destroy_ctx->reduce_errno == 0) {
+	/* A volume without a pm file keeps all of its metadata on the backing device. */
+	if (destroy_ctx->reduce_errno == 0 && destroy_ctx->pm_path[0] != '\0') {
 		if (unlink(destroy_ctx->pm_path)) {
 			SPDK_ERRLOG("%s could not be unlinked: %s\n",
 				    destroy_ctx->pm_path, strerror(errno));
@@ -948,6 +1585,7 @@ _reduce_vol_complete_req(struct spdk_reduce_vol_request *req, int reduce_errno)
 {
 	struct spdk_reduce_vol_request *next_req;
 	struct spdk_reduce_vol *vol = req->vol;
+	struct reduce_request_waiter *waiter;
 
 	req->cb_fn(req->cb_arg, reduce_errno);
 	TAILQ_REMOVE(&vol->executing_requests, req, tailq);
@@ -966,43 +1604,292 @@ _reduce_vol_complete_req(struct spdk_reduce_vol_request *req, int reduce_errno)
 	}
 
 	TAILQ_INSERT_HEAD(&vol->free_requests, req, tailq);
+
+	while (!TAILQ_EMPTY(&vol->free_requests) &&
+	       (waiter = TAILQ_FIRST(&vol->request_waiters)) != NULL) {
+		TAILQ_REMOVE(&vol->request_waiters, waiter, tailq);
+		waiter->cb_fn(waiter->cb_arg);
+	}
 }
 
 static void
-_write_write_done(void *_req, int reduce_errno)
+_reduce_vol_commit_done(struct spdk_reduce_vol_request *req, int reduce_errno)
 {
-	struct spdk_reduce_vol_request *req = _req;
 	struct spdk_reduce_vol *vol = req->vol;
-	uint64_t old_chunk_map_index;
-	struct spdk_reduce_chunk_map *old_chunk;
-	uint32_t i;
 
 	if (reduce_errno != 0) {
-		req->reduce_errno = reduce_errno;
+		/* Nothing on disk refers to the new chunk map, so put the old one back. */
+		vol->pm_logical_map[req->logical_map_index] = req->old_chunk_map_index;
+		_reduce_vol_free_chunk_map(vol, req->chunk_map_index, req->free_old_io_units);
+		_reduce_vol_complete_req(req, reduce_errno);
+		return;
 	}
 
-	assert(req->num_backing_ops > 0);
-	if (--req->num_backing_ops > 0) {
+	/* Only now that the new chunk map is on disk can the old one's io units be reused. */
+	if (req->old_chunk_map_index != REDUCE_EMPTY_MAP_ENTRY) {
+		_reduce_vol_free_chunk_map(vol, req->old_chunk_map_index, req->free_old_io_units);
+	}
+	_reduce_vol_complete_req(req, 0);
+}
+
+static uint64_t
+_reduce_journal_find_slot(struct reduce_journal *journal)
+{
+	uint64_t slot;
+
+	if (!journal->block_ready) {
+		return REDUCE_EMPTY_MAP_ENTRY;
+	}
+
+	slot = spdk_bit_array_find_first_clear(journal->slots,
+					       journal->block * journal->entries_per_block);
+	if (slot == UINT32_MAX || slot >= (journal->block + 1) * journal->entries_per_block) {
+		return REDUCE_EMPTY_MAP_ENTRY;
+	}
+
+	return slot;
+}
+
+static void _reduce_journal_write(struct spdk_reduce_vol *vol);
+
+static void
+_reduce_journal_add(struct spdk_reduce_vol_request *req, uint64_t slot)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	struct reduce_journal *journal = vol->journal;
+	struct reduce_journal_entry *entry;
+
+	entry = (struct reduce_journal_entry *)(journal->buf +
+						(slot % journal->entries_per_block) * journal->entry_size);
+	memset(entry, 0, journal->entry_size);
+	entry->seq = journal->seq++;
+	entry->logical_map_index = req->logical_map_index;
+	memcpy(entry + 1, req->chunk, _reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk));
+	entry->crc = spdk_crc32c_update(entry, journal->entry_size, journal->crc_seed);
+
+	spdk_bit_array_set(journal->slots, slot);
+	req->journal_slot = slot;
+	req->old_journal_slot = journal->chunk_slot[req->logical_map_index];
+	journal->chunk_slot[req->logical_map_index] = slot;
+
+	TAILQ_INSERT_TAIL(&journal->pending, req, journal_tailq);
+	if (!journal->writing) {
+		_reduce_journal_write(vol);
+	}
+}
+
+/* Pick the next journal block with released slots, preferring ones with plenty of them. */
+static uint64_t
+_reduce_journal_next_block(struct reduce_journal *journal)
+{
+	uint64_t i, block, fallback = REDUCE_EMPTY_MAP_ENTRY;
+	uint32_t j, num_free, threshold;
+
+	threshold = spdk_max(journal->entries_per_block / 2, 1);
+	for (i = 1; i <= journal->num_blocks; i++) {
+		block = (journal->block + i) % journal->num_blocks;
+		num_free = 0;
+		for (j = 0; j < journal->entries_per_block; j++) {
+			if (!spdk_bit_array_get(journal->slots, block * journal->entries_per_block + j)) {
+				num_free++;
+			}
+		}
+		if (num_free >= threshold) {
+			return block;
+		}
+		if (num_free > 0 && fallback == REDUCE_EMPTY_MAP_ENTRY) {
+			fallback = block;
+		}
+	}
+
+	return fallback;
+}
+
+static void
+_reduce_journal_fail_waiting(struct spdk_reduce_vol *vol, int reduce_errno)
+{
+	struct reduce_journal *journal = vol->journal;
+	struct spdk_reduce_vol_request *req;
+
+	while ((req = TAILQ_FIRST(&journal->waiting)) != NULL) {
+		TAILQ_REMOVE(&journal->waiting, req, journal_tailq);
+		_reduce_vol_commit_done(req, reduce_errno);
+	}
+}
+
+static void _reduce_journal_switch_block(struct spdk_reduce_vol *vol);
+
+static void
+_reduce_journal_resume(struct spdk_reduce_vol *vol)
+{
+	struct reduce_journal *journal = vol->journal;
+	struct spdk_reduce_vol_request *req;
+	uint64_t slot;
+
+	while ((req = TAILQ_FIRST(&journal->waiting)) != NULL) {
+		slot = _reduce_journal_find_slot(journal);
+		if (slot == REDUCE_EMPTY_MAP_ENTRY) {
+			_reduce_journal_switch_block(vol);
+			break;
+		}
+		TAILQ_REMOVE(&journal->waiting, req, journal_tailq);
+		_reduce_journal_add(req, slot);
+	}
+}
+
+static void
+_reduce_journal_read_done(void *_vol, int reduce_errno)
+{
+	struct spdk_reduce_vol *vol = _vol;
+	struct reduce_journal *journal = vol->journal;
+
+	journal->reading = false;
+	if (reduce_errno != 0) {
+		_reduce_journal_fail_waiting(vol, reduce_errno);
 		return;
 	}
 
-	if (req->reduce_errno != 0) {
-		_reduce_vol_complete_req(req, req->reduce_errno);
+	journal->block_ready = true;
+	_reduce_journal_resume(vol);
+}
+
+/*
+ * Move on to the next journal block.  Its current contents are read first so the entries
+ *  that are still needed are rewritten unchanged.
+ */
+static void
+_reduce_journal_switch_block(struct spdk_reduce_vol *vol)
+{
+	struct reduce_journal *journal = vol->journal;
+	uint64_t block;
+
+	if (journal->reading || journal->writing || !TAILQ_EMPTY(&journal->pending)) {
+		/* Switch once the current block is idle. */
+		return;
+	}
+
+	block = _reduce_journal_next_block(journal);
+	if (block == REDUCE_EMPTY_MAP_ENTRY) {
+		/* This can't happen - there are twice as many slots as chunk maps. */
+		assert(false);
+		_reduce_journal_fail_waiting(vol, -ENOSPC);
+		return;
+	}
+
+	journal->block = block;
+	journal->block_ready = false;
+	journal->reading = true;
+	journal->iov.iov_base = journal->buf;
+	journal->iov.iov_len = vol->params.backing_io_unit_size;
+	journal->backing_cb_args.cb_fn = _reduce_journal_read_done;
+	journal->backing_cb_args.cb_arg = vol;
+	vol->backing_dev->readv(vol->backing_dev, &journal->iov, 1,
+				(journal->start_io_unit + block) * vol->backing_lba_per_io_unit,
+				vol->backing_lba_per_io_unit, &journal->backing_cb_args);
+}
+
+static void
+_reduce_journal_write_done(void *_vol, int reduce_errno)
+{
+	struct spdk_reduce_vol *vol = _vol;
+	struct reduce_journal *journal = vol->journal;
+	struct spdk_reduce_vol_request *req;
+	TAILQ_HEAD(, spdk_reduce_vol_request) done;
+
+	TAILQ_INIT(&done);
+	TAILQ_CONCAT(&done, &journal->writing_reqs, journal_tailq);
+	journal->writing = false;
+
+	TAILQ_FOREACH(req, &done, journal_tailq) {
+		if (reduce_errno != 0) {
+			/* Drop the rejected entry from the block before it is written again.  Its
+			 *  chunk map is freed below, and a later write of the block would otherwise
+			 *  persist an entry that replay prefers over the chunk's previous one.
+			 */
+			memset(journal->buf + (req->journal_slot % journal->entries_per_block) *
+			       journal->entry_size, 0, journal->entry_size);
+			spdk_bit_array_clear(journal->slots, req->journal_slot);
+			journal->chunk_slot[req->logical_map_index] = req->old_journal_slot;
+		} else if (req->old_journal_slot != REDUCE_EMPTY_MAP_ENTRY) {
+			spdk_bit_array_clear(journal->slots, req->old_journal_slot);
+		}
+	}
+
+	/* Entries added while this write was in flight go out with the next one. */
+	if (!TAILQ_EMPTY(&journal->pending)) {
+		_reduce_journal_write(vol);
+	}
+
+	while ((req = TAILQ_FIRST(&done)) != NULL) {
+		TAILQ_REMOVE(&done, req, journal_tailq);
+		_reduce_vol_commit_done(req, reduce_errno);
+	}
+
+	_reduce_journal_resume(vol);
+}
+
+static void
+_reduce_journal_write(struct spdk_reduce_vol *vol)
+{
+	struct reduce_journal *journal = vol->journal;
+
+	assert(!journal->writing);
+	TAILQ_CONCAT(&journal->writing_reqs, &journal->pending, journal_tailq);
+	journal->writing = true;
+
+	journal->iov.iov_base = journal->buf;
+	journal->iov.iov_len = vol->params.backing_io_unit_size;
+	journal->backing_cb_args.cb_fn = _reduce_journal_write_done;
+	journal->backing_cb_args.cb_arg = vol;
+	vol->backing_dev->writev(vol->backing_dev, &journal->iov, 1,
+				 (journal->start_io_unit + journal->block) * vol->backing_lba_per_io_unit,
+				 vol->backing_lba_per_io_unit, &journal->backing_cb_args);
+}
+
+static void
+_reduce_journal_append(struct spdk_reduce_vol_request *req)
+{
+	struct reduce_journal *journal = req->vol->journal;
+	uint64_t slot = REDUCE_EMPTY_MAP_ENTRY;
+
+	/* Don't let this entry overtake ones still waiting for a slot. */
+	if (TAILQ_EMPTY(&journal->waiting)) {
+		slot = _reduce_journal_find_slot(journal);
+	}
+
+	if (slot != REDUCE_EMPTY_MAP_ENTRY) {
+		_reduce_journal_add(req, slot);
 		return;
 	}
 
+	TAILQ_INSERT_TAIL(&journal->waiting, req, journal_tailq);
+	_reduce_journal_switch_block(req->vol);
+}
+
+/*
+ * Make req's new chunk map the one the logical map refers to, and release the chunk map it
+ *  replaces.  free_io_units is false if the new chunk map took over the whole io units of the
+ *  old one.
+ */
+static void
+_reduce_vol_commit_chunk_map(struct spdk_reduce_vol_request *req, bool free_io_units)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	uint64_t old_chunk_map_index;
+
 	old_chunk_map_index = vol->pm_logical_map[req->logical_map_index];
+
+	if (vol->journal != NULL) {
+		/* Reads can use the new chunk map right away - its data is already written. */
+		req->old_chunk_map_index = old_chunk_map_index;
+		req->free_old_io_units = free_io_units;
+		vol->pm_logical_map[req->logical_map_index] = req->chunk_map_index;
+		_reduce_journal_append(req);
+		return;
+	}
+
 	if (old_chunk_map_index != REDUCE_EMPTY_MAP_ENTRY) {
-		old_chunk = _reduce_vol_get_chunk_map(vol, old_chunk_map_index);
-		for (i = 0; i < vol->backing_io_units_per_chunk; i++) {
-			if (old_chunk->io_unit_index[i] == REDUCE_EMPTY_MAP_ENTRY) {
-				break;
-			}
-			assert(spdk_bit_array_get(vol->allocated_backing_io_units, old_chunk->io_unit_index[i]) == true);
-			spdk_bit_array_clear(vol->allocated_backing_io_units, old_chunk->io_unit_index[i]);
-			old_chunk->io_unit_index[i] = REDUCE_EMPTY_MAP_ENTRY;
-		}
-		spdk_bit_array_clear(vol->allocated_chunk_maps, old_chunk_map_index);
+		_reduce_vol_free_chunk_map(vol, old_chunk_map_index, free_io_units);
 	}
 
 	/*
@@ -1022,6 +1909,219 @@ _write_write_done(void *_req, int reduce_errno)
 	_reduce_vol_complete_req(req, 0);
 }
 
+static void
+_write_write_done(void *_req, int reduce_errno)
+{
+	struct spdk_reduce_vol_request *req = _req;
+
+	if (reduce_errno != 0) {
+		req->reduce_errno = reduce_errno;
+	}
+
+	assert(req->num_backing_ops > 0);
+	if (--req->num_backing_ops > 0) {
+		return;
+	}
+
+	if (req->reduce_errno != 0) {
+		_reduce_vol_complete_req(req, req->reduce_errno);
+		return;
+	}
+
+	_reduce_vol_commit_chunk_map(req, true);
+}
+
+static void _reduce_pack_unit_write(struct reduce_pack_unit *pu);
+
+/* Returns true if the pack unit was released. */
+static bool
+_reduce_pack_unit_put(struct reduce_pack_unit *pu)
+{
+	struct spdk_reduce_vol *vol = pu->vol;
+
+	if (!pu->in_use || !pu->sealed || pu->writing || !TAILQ_EMPTY(&pu->pending)) {
+		return false;
+	}
+
+	pu->in_use = false;
+	if (vol->io_unit_packed_bytes[pu->io_unit_index] == 0) {
+		spdk_bit_array_clear(vol->allocated_backing_io_units, pu->io_unit_index);
+	}
+	TAILQ_INSERT_TAIL(&vol->free_pack_units, pu, tailq);
+
+	return true;
+}
+
+static struct reduce_pack_unit *
+_reduce_vol_get_pack_unit(struct spdk_reduce_vol *vol, uint32_t size)
+{
+	struct reduce_pack_unit *pu = vol->open_pack_unit;
+	uint64_t io_unit_index;
+
+	if (pu != NULL) {
+		if (pu->used + size <= vol->params.backing_io_unit_size) {
+			return pu;
+		}
+
+		/* This io unit is full - finish it off and start packing into a new one. */
+		vol->open_pack_unit = NULL;
+		pu->sealed = true;
+		_reduce_pack_unit_put(pu);
+	}
+
+	pu = TAILQ_FIRST(&vol->free_pack_units);
+	if (pu == NULL) {
+		return NULL;
+	}
+
+	io_unit_index = spdk_bit_array_find_first_clear(vol->allocated_backing_io_units, 0);
+	assert(io_unit_index != UINT32_MAX);
+	spdk_bit_array_set(vol->allocated_backing_io_units, io_unit_index);
+
+	TAILQ_REMOVE(&vol->free_pack_units, pu, tailq);
+	pu->io_unit_index = io_unit_index;
+	pu->used = 0;
+	pu->in_use = true;
+	pu->sealed = false;
+	memset(pu->buf, 0, vol->params.backing_io_unit_size);
+	vol->open_pack_unit = pu;
+
+	return pu;
+}
+
+static void
+_reduce_pack_unit_append(struct reduce_pack_unit *pu, struct spdk_reduce_vol_request *req)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	struct spdk_reduce_chunk_map *chunk = req->chunk;
+	uint32_t slot, tail_size;
+
+	slot = chunk->compressed_size / vol->params.backing_io_unit_size;
+	tail_size = _reduce_vol_get_packed_tail_size(vol, chunk);
+	assert(pu->used + tail_size <= vol->params.backing_io_unit_size);
+
+	memcpy(pu->buf + pu->used, req->comp_buf + slot * vol->params.backing_io_unit_size, tail_size);
+	chunk->io_unit_index[slot] = pu->io_unit_index;
+	chunk->packed_offset = pu->used;
+	pu->used += tail_size;
+	vol->io_unit_packed_bytes[pu->io_unit_index] += tail_size;
+
+	TAILQ_INSERT_TAIL(&pu->pending, req, pack_tailq);
+	if (!pu->writing) {
+		_reduce_pack_unit_write(pu);
+	}
+}
+
+static void
+_reduce_vol_pack_resume(struct spdk_reduce_vol *vol)
+{
+	struct spdk_reduce_vol_request *req;
+	struct reduce_pack_unit *pu;
+
+	while ((req = TAILQ_FIRST(&vol->pack_waiting)) != NULL) {
+		pu = _reduce_vol_get_pack_unit(vol, _reduce_vol_get_packed_tail_size(vol, req->chunk));
+		if (pu == NULL) {
+			break;
+		}
+		TAILQ_REMOVE(&vol->pack_waiting, req, pack_tailq);
+		_reduce_pack_unit_append(pu, req);
+	}
+}
+
+static void
+_reduce_pack_unit_write_done(void *_pu, int reduce_errno)
+{
+	struct reduce_pack_unit *pu = _pu;
+	struct spdk_reduce_vol *vol = pu->vol;
+	struct spdk_reduce_vol_request *req;
+	TAILQ_HEAD(, spdk_reduce_vol_request) done;
+
+	TAILQ_INIT(&done);
+	TAILQ_CONCAT(&done, &pu->writing_reqs, pack_tailq);
+	pu->writing = false;
+
+	/* Tails appended while this write was in flight go out with the next one. */
+	if (!TAILQ_EMPTY(&pu->pending)) {
+		_reduce_pack_unit_write(pu);
+	}
+
+	while ((req = TAILQ_FIRST(&done)) != NULL) {
+		TAILQ_REMOVE(&done, req, pack_tailq);
+		if (reduce_errno != 0) {
+			/* The chunk map is never published, so nothing references this tail. */
+			assert(vol->io_unit_packed_bytes[pu->io_unit_index] >=
+			       _reduce_vol_get_packed_tail_size(vol, req->chunk));
+			vol->io_unit_packed_bytes[pu->io_unit_index] -=
+				_reduce_vol_get_packed_tail_size(vol, req->chunk);
+		}
+		req->pack_next_fn(req, reduce_errno);
+	}
+
+	if (_reduce_pack_unit_put(pu)) {
+		_reduce_vol_pack_resume(vol);
+	}
+}
+
+static void
+_reduce_pack_unit_write(struct reduce_pack_unit *pu)
+{
+	struct spdk_reduce_vol *vol = pu->vol;
+
+	assert(!pu->writing);
+	TAILQ_CONCAT(&pu->writing_reqs, &pu->pending, pack_tailq);
+	pu->writing = true;
+
+	pu->iov.iov_base = pu->buf;
+	pu->iov.iov_len = vol->params.backing_io_unit_size;
+	pu->backing_cb_args.cb_fn = _reduce_pack_unit_write_done;
+	pu->backing_cb_args.cb_arg = pu;
+	vol->backing_dev->writev(vol->backing_dev, &pu->iov, 1,
+				 pu->io_unit_index * vol->backing_lba_per_io_unit,
+				 vol->backing_lba_per_io_unit, &pu->backing_cb_args);
+}
+
+/*
+ * Store the tail of req's compressed chunk in a shared io unit.  next_fn is called once the
+ *  io unit holding the tail has been written.
+ */
+static void
+_reduce_vol_pack_tail(struct spdk_reduce_vol_request *req, reduce_request_fn next_fn)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	struct reduce_pack_unit *pu;
+
+	req->pack_next_fn = next_fn;
+
+	/* Don't let this tail overtake ones still waiting for a free pack unit. */
+	if (TAILQ_EMPTY(&vol->pack_waiting)) {
+		pu = _reduce_vol_get_pack_unit(vol, _reduce_vol_get_packed_tail_size(vol, req->chunk));
+		if (pu != NULL) {
+			_reduce_pack_unit_append(pu, req);
+			return;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&vol->pack_waiting, req, pack_tailq);
+}
+
+/* Move a packed tail read from its shared io unit to directly follow the chunk's whole io units. */
+static void
+_reduce_vol_unpack_tail(struct spdk_reduce_vol_request *req)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	uint32_t tail_size;
+	uint8_t *tail;
+
+	tail_size = _reduce_vol_get_packed_tail_size(vol, req->chunk);
+	if (tail_size == 0) {
+		return;
+	}
+
+	tail = req->comp_buf + (req->chunk->compressed_size / vol->params.backing_io_unit_size) *
+	       vol->params.backing_io_unit_size;
+	memmove(tail, tail + req->chunk->packed_offset, tail_size);
+}
+
 static void
 _issue_backing_ops(struct spdk_reduce_vol_request *req, struct spdk_reduce_vol *vol,
 		   reduce_request_fn next_fn, bool is_write)
@@ -1042,6 +2142,12 @@ _issue_backing_ops(struct spdk_reduce_vol_request *req, struct spdk_reduce_vol *
 	req->backing_cb_args.cb_fn = next_fn;
 	req->backing_cb_args.cb_arg = req;
 	for (i = 0; i < req->num_io_units; i++) {
+		if (is_write && i == req->num_io_units - 1 &&
+		    _reduce_vol_get_packed_tail_size(vol, req->chunk) != 0) {
+			/* The request may complete before this returns, so it must be the last op. */
+			_reduce_vol_pack_tail(req, next_fn);
+			break;
+		}
 		iov[i].iov_base = buf + i * vol->params.backing_io_unit_size;
 		iov[i].iov_len = vol->params.backing_io_unit_size;
 		if (is_write) {
@@ -1061,7 +2167,7 @@ _reduce_vol_write_chunk(struct spdk_reduce_vol_request *req, reduce_request_fn n
 			uint32_t compressed_size)
 {
 	struct spdk_reduce_vol *vol = req->vol;
-	uint32_t i;
+	uint32_t i, num_whole_io_units;
 	uint64_t chunk_offset, remainder, total_len = 0;
 	uint8_t *buf;
 	int j;
@@ -1109,7 +2215,13 @@ _reduce_vol_write_chunk(struct spdk_reduce_vol_request *req, reduce_request_fn n
 		assert(total_len == vol->params.chunk_size);
 	}
 
-	for (i = 0; i < req->num_io_units; i++) {
+	/* A packed tail's io unit is picked when the tail is appended to it. */
+	num_whole_io_units = req->num_io_units;
+	if (_reduce_vol_get_packed_tail_size(vol, req->chunk) != 0) {
+		num_whole_io_units--;
+	}
+
+	for (i = 0; i < num_whole_io_units; i++) {
 		req->chunk->io_unit_index[i] = spdk_bit_array_find_first_clear(vol->allocated_backing_io_units, 0);
 		/* TODO: fail if no backing block found - but really this should also not
 		 * happen (see comment above).
@@ -1371,6 +2483,7 @@ _write_read_done(void *_req, int reduce_errno)
 	}
 
 	if (req->chunk_is_compressed) {
+		_reduce_vol_unpack_tail(req);
 		_reduce_vol_decompress_chunk_scratch(req, _write_decompress_done);
 	} else {
 		_write_decompress_done(req, req->chunk->compressed_size);
@@ -1436,6 +2549,7 @@ _read_read_done(void *_req, int reduce_errno)
 	}
 
 	if (req->chunk_is_compressed) {
+		_reduce_vol_unpack_tail(req);
 		_reduce_vol_decompress_chunk(req, _read_decompress_done);
 	} else {
 
@@ -1508,31 +2622,20 @@ _start_readv_request(struct spdk_reduce_vol_request *req)
 	_reduce_vol_read_chunk(req, _read_read_done);
 }
 
-void
-spdk_reduce_vol_readv(struct spdk_reduce_vol *vol,
-		      struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
-		      spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+/*
+ * Returns -ENOMEM without calling cb_fn if no request is available, so the caller decides
+ *  whether to fail or wait.
+ */
+static int
+_reduce_vol_readv_chunk(struct spdk_reduce_vol *vol,
+			struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
+			spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_reduce_vol_request *req;
 	uint64_t logical_map_index;
 	bool overlapped;
 	int i;
 
-	if (length == 0) {
-		cb_fn(cb_arg, 0);
-		return;
-	}
-
-	if (_request_spans_chunk_boundary(vol, offset, length)) {
-		cb_fn(cb_arg, -EINVAL);
-		return;
-	}
-
-	if (!_iov_array_is_valid(vol, iov, iovcnt, length)) {
-		cb_fn(cb_arg, -EINVAL);
-		return;
-	}
-
 	logical_map_index = offset / vol->logical_blocks_per_chunk;
 	overlapped = _check_overlap(vol, logical_map_index);
 
@@ -1546,16 +2649,14 @@ spdk_reduce_vol_readv(struct spdk_reduce_vol *vol,
 			memset(iov[i].iov_base, 0, iov[i].iov_len);
 		}
 		cb_fn(cb_arg, 0);
-		return;
+		return 0;
 	}
 
-	req = TAILQ_FIRST(&vol->free_requests);
+	req = _reduce_vol_get_request(vol);
 	if (req == NULL) {
-		cb_fn(cb_arg, -ENOMEM);
-		return;
+		return -ENOMEM;
 	}
 
-	TAILQ_REMOVE(&vol->free_requests, req, tailq);
 	req->type = REDUCE_IO_READV;
 	req->vol = vol;
 	req->iov = iov;
@@ -1572,6 +2673,8 @@ spdk_reduce_vol_readv(struct spdk_reduce_vol *vol,
 	} else {
 		TAILQ_INSERT_TAIL(&vol->queued_requests, req, tailq);
 	}
+
+	return 0;
 }
 
 static void
@@ -1597,40 +2700,24 @@ _start_writev_request(struct spdk_reduce_vol_request *req)
 	_reduce_vol_compress_chunk(req, _write_compress_done);
 }
 
-void
-spdk_reduce_vol_writev(struct spdk_reduce_vol *vol,
-		       struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
-		       spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+/* Like _reduce_vol_readv_chunk(), returns -ENOMEM without calling cb_fn. */
+static int
+_reduce_vol_writev_chunk(struct spdk_reduce_vol *vol,
+			 struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
+			 spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_reduce_vol_request *req;
 	uint64_t logical_map_index;
 	bool overlapped;
 
-	if (length == 0) {
-		cb_fn(cb_arg, 0);
-		return;
-	}
-
-	if (_request_spans_chunk_boundary(vol, offset, length)) {
-		cb_fn(cb_arg, -EINVAL);
-		return;
-	}
-
-	if (!_iov_array_is_valid(vol, iov, iovcnt, length)) {
-		cb_fn(cb_arg, -EINVAL);
-		return;
-	}
-
 	logical_map_index = offset / vol->logical_blocks_per_chunk;
 	overlapped = _check_overlap(vol, logical_map_index);
 
-	req = TAILQ_FIRST(&vol->free_requests);
+	req = _reduce_vol_get_request(vol);
 	if (req == NULL) {
-		cb_fn(cb_arg, -ENOMEM);
-		return;
+		return -ENOMEM;
 	}
 
-	TAILQ_REMOVE(&vol->free_requests, req, tailq);
 	req->type = REDUCE_IO_WRITEV;
 	req->vol = vol;
 	req->iov = iov;
@@ -1647,6 +2734,401 @@ spdk_reduce_vol_writev(struct spdk_reduce_vol *vol,
 	} else {
 		TAILQ_INSERT_TAIL(&vol->queued_requests, req, tailq);
 	}
+
+	return 0;
+}
+
+/*
+ * A request spanning several chunks - each chunk gets a request of its own.  Chunks are
+ *  submitted in order for as long as there are free requests.  When there are none, the
+ *  rest wait for requests to be given back rather than failing the whole request with
+ *  chunks already written.
+ */
+struct reduce_split_ctx {
+	struct spdk_reduce_vol		*vol;
+	int				type;
+	spdk_reduce_vol_op_complete	cb_fn;
+	void				*cb_arg;
+	uint32_t			outstanding;
+	int				reduce_errno;
+	struct reduce_request_waiter	request_waiter;
+	/* Next chunk to submit and where its data starts in the caller's iovs. */
+	uint64_t			offset;
+	uint64_t			length;
+	struct iovec			*src_iov;
+	int				src_iov_index;
+	uint64_t			src_iov_offset;
+	struct iovec			*chunk_iov;
+	/* The caller's iovs, split at the chunk boundaries. */
+	struct iovec			iov[];
+};
+
+static void
+_reduce_vol_split_cpl(void *_ctx, int reduce_errno)
+{
+	struct reduce_split_ctx *ctx = _ctx;
+
+	if (reduce_errno != 0 && ctx->reduce_errno == 0) {
+		ctx->reduce_errno = reduce_errno;
+	}
+
+	if (--ctx->outstanding == 0) {
+		ctx->cb_fn(ctx->cb_arg, ctx->reduce_errno);
+		free(ctx);
+	}
+}
+
+static void
+_reduce_vol_split_next(void *_ctx)
+{
+	struct reduce_split_ctx *ctx = _ctx;
+	struct spdk_reduce_vol *vol = ctx->vol;
+	struct iovec *iov = ctx->src_iov;
+	uint64_t chunk_length, remaining, iov_offset, len;
+	int chunk_iovcnt, i, rc = 0;
+
+	while (ctx->length > 0) {
+		chunk_length = spdk_min(ctx->length, vol->logical_blocks_per_chunk -
+					ctx->offset % vol->logical_blocks_per_chunk);
+		remaining = chunk_length * vol->params.logical_block_size;
+		chunk_iovcnt = 0;
+		i = ctx->src_iov_index;
+		iov_offset = ctx->src_iov_offset;
+		while (remaining > 0) {
+			len = spdk_min(remaining, iov[i].iov_len - iov_offset);
+			if (len > 0) {
+				ctx->chunk_iov[chunk_iovcnt].iov_base =
+					(uint8_t *)iov[i].iov_base + iov_offset;
+				ctx->chunk_iov[chunk_iovcnt].iov_len = len;
+				chunk_iovcnt++;
+			}
+			remaining -= len;
+			iov_offset += len;
+			if (iov_offset == iov[i].iov_len) {
+				i++;
+				iov_offset = 0;
+			}
+		}
+
+		ctx->outstanding++;
+		if (ctx->type == REDUCE_IO_READV) {
+			rc = _reduce_vol_readv_chunk(vol, ctx->chunk_iov, chunk_iovcnt, ctx->offset,
+						     chunk_length, _reduce_vol_split_cpl, ctx);
+		} else {
+			assert(ctx->type == REDUCE_IO_WRITEV);
+			rc = _reduce_vol_writev_chunk(vol, ctx->chunk_iov, chunk_iovcnt, ctx->offset,
+						      chunk_length, _reduce_vol_split_cpl, ctx);
+		}
+
+		if (rc != 0) {
+			ctx->outstanding--;
+			/* Submit this chunk again once another request is given back. */
+			if (_reduce_vol_wait_for_request(vol, &ctx->request_waiter) == 0) {
+				return;
+			}
+			break;
+		}
+
+		ctx->chunk_iov += chunk_iovcnt;
+		ctx->src_iov_index = i;
+		ctx->src_iov_offset = iov_offset;
+		ctx->offset += chunk_length;
+		ctx->length -= chunk_length;
+	}
+
+	/* Drop the reference held while submitting. */
+	_reduce_vol_split_cpl(ctx, rc);
+}
+
+static void
+_reduce_vol_split_request(struct spdk_reduce_vol *vol, int type,
+			  struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
+			  spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+{
+	struct reduce_split_ctx *ctx;
+	uint64_t num_chunks;
+
+	num_chunks = (offset + length - 1) / vol->logical_blocks_per_chunk -
+		     offset / vol->logical_blocks_per_chunk + 1;
+
+	/* Each chunk boundary splits at most one of the caller's iovs. */
+	ctx = calloc(1, sizeof(*ctx) + (iovcnt + num_chunks - 1) * sizeof(struct iovec));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->vol = vol;
+	ctx->type = type;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->request_waiter.cb_fn = _reduce_vol_split_next;
+	ctx->request_waiter.cb_arg = ctx;
+	ctx->offset = offset;
+	ctx->length = length;
+	ctx->src_iov = iov;
+	ctx->chunk_iov = ctx->iov;
+	/* Hold a reference until every chunk has been submitted - some complete immediately. */
+	ctx->outstanding = 1;
+
+	_reduce_vol_split_next(ctx);
+}
+
+void
+spdk_reduce_vol_readv(struct spdk_reduce_vol *vol,
+		      struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
+		      spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+{
+	int rc;
+
+	if (length == 0) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
+	if (!_iov_array_is_valid(vol, iov, iovcnt, length)) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	if (_request_spans_chunk_boundary(vol, offset, length)) {
+		_reduce_vol_split_request(vol, REDUCE_IO_READV, iov, iovcnt, offset, length,
+					  cb_fn, cb_arg);
+		return;
+	}
+
+	rc = _reduce_vol_readv_chunk(vol, iov, iovcnt, offset, length, cb_fn, cb_arg);
+	if (rc != 0) {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+void
+spdk_reduce_vol_writev(struct spdk_reduce_vol *vol,
+		       struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
+		       spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+{
+	int rc;
+
+	if (length == 0) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
+	if (!_iov_array_is_valid(vol, iov, iovcnt, length)) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	if (_request_spans_chunk_boundary(vol, offset, length)) {
+		_reduce_vol_split_request(vol, REDUCE_IO_WRITEV, iov, iovcnt, offset, length,
+					  cb_fn, cb_arg);
+		return;
+	}
+
+	rc = _reduce_vol_writev_chunk(vol, iov, iovcnt, offset, length, cb_fn, cb_arg);
+	if (rc != 0) {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+struct reduce_compact_ctx {
+	struct spdk_reduce_vol		*vol;
+	spdk_reduce_vol_op_complete	cb_fn;
+	void				*cb_arg;
+	uint64_t			logical_map_index;
+	struct reduce_request_waiter	request_waiter;
+};
+
+static void _reduce_vol_compact_next(struct reduce_compact_ctx *ctx);
+
+static void
+_reduce_vol_compact_resume(void *_ctx)
+{
+	_reduce_vol_compact_next(_ctx);
+}
+
+static void
+_reduce_vol_compact_done(struct reduce_compact_ctx *ctx, int reduce_errno)
+{
+	ctx->vol->compact_ctx = NULL;
+	ctx->cb_fn(ctx->cb_arg, reduce_errno);
+	free(ctx);
+}
+
+static void
+_reduce_vol_compact_relocate_done(void *_ctx, int reduce_errno)
+{
+	struct reduce_compact_ctx *ctx = _ctx;
+
+	if (reduce_errno != 0) {
+		_reduce_vol_compact_done(ctx, reduce_errno);
+		return;
+	}
+
+	ctx->logical_map_index++;
+	_reduce_vol_compact_next(ctx);
+}
+
+static void
+_reduce_vol_relocate_abort(struct spdk_reduce_vol_request *req, int reduce_errno)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	uint32_t i;
+
+	/* The new chunk map only borrowed the whole io units of the old one. */
+	for (i = 0; i < vol->backing_io_units_per_chunk; i++) {
+		req->chunk->io_unit_index[i] = REDUCE_EMPTY_MAP_ENTRY;
+	}
+	spdk_bit_array_clear(vol->allocated_chunk_maps, req->chunk_map_index);
+	_reduce_vol_complete_req(req, reduce_errno);
+}
+
+static void
+_relocate_write_done(void *_req, int reduce_errno)
+{
+	struct spdk_reduce_vol_request *req = _req;
+
+	if (reduce_errno != 0) {
+		_reduce_vol_relocate_abort(req, reduce_errno);
+		return;
+	}
+
+	_reduce_vol_commit_chunk_map(req, false);
+}
+
+static void
+_relocate_read_done(void *_req, int reduce_errno)
+{
+	struct spdk_reduce_vol_request *req = _req;
+
+	if (reduce_errno != 0) {
+		_reduce_vol_relocate_abort(req, reduce_errno);
+		return;
+	}
+
+	_reduce_vol_unpack_tail(req);
+	_reduce_vol_pack_tail(req, _relocate_write_done);
+}
+
+/*
+ * Move the packed tail of a chunk into the io unit currently being packed.  The rest of the
+ *  chunk stays where it is, so this is done with a copy of the chunk map that only differs
+ *  in where the tail lives.
+ */
+static void
+_reduce_vol_relocate_tail(struct spdk_reduce_vol_request *req)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	struct spdk_reduce_chunk_map *old_chunk;
+	uint32_t slot;
+
+	old_chunk = _reduce_vol_get_chunk_map(vol, vol->pm_logical_map[req->logical_map_index]);
+
+	req->chunk_map_index = spdk_bit_array_find_first_clear(vol->allocated_chunk_maps, 0);
+	assert(req->chunk_map_index != UINT32_MAX);
+	spdk_bit_array_set(vol->allocated_chunk_maps, req->chunk_map_index);
+
+	req->chunk = _reduce_vol_get_chunk_map(vol, req->chunk_map_index);
+	memcpy(req->chunk, old_chunk, _reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk));
+	req->chunk_is_compressed = true;
+
+	slot = old_chunk->compressed_size / vol->params.backing_io_unit_size;
+	req->comp_buf_iov[0].iov_base = req->comp_buf + slot * vol->params.backing_io_unit_size;
+	req->comp_buf_iov[0].iov_len = vol->params.backing_io_unit_size;
+	req->backing_cb_args.cb_fn = _relocate_read_done;
+	req->backing_cb_args.cb_arg = req;
+	vol->backing_dev->readv(vol->backing_dev, &req->comp_buf_iov[0], 1,
+				old_chunk->io_unit_index[slot] * vol->backing_lba_per_io_unit,
+				vol->backing_lba_per_io_unit, &req->backing_cb_args);
+}
+
+static void
+_reduce_vol_compact_next(struct reduce_compact_ctx *ctx)
+{
+	struct spdk_reduce_vol *vol = ctx->vol;
+	struct spdk_reduce_vol_request *req;
+	struct spdk_reduce_chunk_map *chunk;
+	uint64_t num_chunks, chunk_map_index, io_unit_index;
+
+	num_chunks = vol->params.vol_size / vol->params.chunk_size;
+	for (; ctx->logical_map_index < num_chunks; ctx->logical_map_index++) {
+		chunk_map_index = vol->pm_logical_map[ctx->logical_map_index];
+		if (chunk_map_index == REDUCE_EMPTY_MAP_ENTRY) {
+			continue;
+		}
+
+		chunk = _reduce_vol_get_chunk_map(vol, chunk_map_index);
+		if (_reduce_vol_get_packed_tail_size(vol, chunk) == 0) {
+			continue;
+		}
+
+		/* Only empty out io units that are at most half full. */
+		io_unit_index = chunk->io_unit_index[chunk->compressed_size / vol->params.backing_io_unit_size];
+		if (vol->io_unit_packed_bytes[io_unit_index] > vol->params.backing_io_unit_size / 2 ||
+		    _reduce_vol_io_unit_is_packing(vol, io_unit_index) ||
+		    _check_overlap(vol, ctx->logical_map_index)) {
+			continue;
+		}
+
+		req = _reduce_vol_get_request(vol);
+		if (req == NULL) {
+			/* Pick up from this chunk once another request is given back. */
+			if (_reduce_vol_wait_for_request(vol, &ctx->request_waiter) != 0) {
+				_reduce_vol_compact_done(ctx, -ENOMEM);
+			}
+			return;
+		}
+
+		req->type = REDUCE_IO_COMPACT;
+		req->vol = vol;
+		req->iov = NULL;
+		req->iovcnt = 0;
+		req->offset = ctx->logical_map_index * vol->logical_blocks_per_chunk;
+		req->logical_map_index = ctx->logical_map_index;
+		req->length = 0;
+		req->copy_after_decompress = false;
+		req->cb_fn = _reduce_vol_compact_relocate_done;
+		req->cb_arg = ctx;
+
+		TAILQ_INSERT_TAIL(&vol->executing_requests, req, tailq);
+		_reduce_vol_relocate_tail(req);
+		return;
+	}
+
+	_reduce_vol_compact_done(ctx, 0);
+}
+
+void
+spdk_reduce_vol_compact(struct spdk_reduce_vol *vol,
+			spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+{
+	struct reduce_compact_ctx *ctx;
+
+	if (!vol->params.packed) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	if (vol->compact_ctx != NULL) {
+		cb_fn(cb_arg, -EBUSY);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->vol = vol;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->request_waiter.cb_fn = _reduce_vol_compact_resume;
+	ctx->request_waiter.cb_arg = ctx;
+	vol->compact_ctx = ctx;
+
+	_reduce_vol_compact_next(ctx);
 }
 
 const struct spdk_reduce_vol_params *
@@ -1666,6 +3148,7 @@ void spdk_reduce_vol_print_info(struct spdk_reduce_vol *vol)
 	SPDK_NOTICELOG("\tvol->params.logical_block_size = 0x%x\n", vol->params.logical_block_size);
 	SPDK_NOTICELOG("\tvol->params.chunk_size = 0x%x\n", vol->params.chunk_size);
 	SPDK_NOTICELOG("\tvol->params.vol_size = 0x%" PRIx64 "\n", vol->params.vol_size);
+	SPDK_NOTICELOG("\tvol->params.packed = %d\n", vol->params.packed);
 	num_chunks = _get_total_chunks(vol->params.vol_size, vol->params.chunk_size);
 	SPDK_NOTICELOG("\ttotal chunks (including extra) = 0x%" PRIx64 "\n", num_chunks);
 	SPDK_NOTICELOG("\ttotal chunks (excluding extra) = 0x%" PRIx64 "\n",
@@ -474,6 +474,26 @@ spdk_bit_pool_allocate_bit(struct spdk_bit_pool *pool)
 	return bit_index;
 }
 
+uint32_t
+spdk_bit_pool_allocate_bit_hint(struct spdk_bit_pool *pool, uint32_t hint)
+{
+	uint32_t bit_index;
+
+	if (hint <= pool->lowest_free_bit) {
+		return spdk_bit_pool_allocate_bit(pool);
+	}
+
+	bit_index = spdk_bit_array_find_first_clear(pool->array, hint);
+	if (bit_index == UINT32_MAX) {
+		return spdk_bit_pool_allocate_bit(pool);
+	}
+
+	/* The bit is above the lowest free one, so that one stays the same */
+	spdk_bit_array_set(pool->array, bit_index);
+	pool->free_count--;
+	return bit_index;
+}
+
 void
 spdk_bit_pool_free_bit(struct spdk_bit_pool *pool, uint32_t bit_index)
 {
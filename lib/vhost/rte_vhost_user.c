@@ -205,7 +205,7 @@ vhost_vq_avail_ring_get(struct spdk_vhost_virtqueue *virtqueue, uint16_t *reqs,
 
 	spdk_smp_rmb();
 
-	if (virtqueue->vsession && spdk_unlikely(virtqueue->vsession->interrupt_mode)) {
+	if (spdk_unlikely(virtqueue->interrupt_mode)) {
 		/* Read to clear vring's kickfd */
 		rc = read(vring->kickfd, &u64_value, sizeof(u64_value));
 		if (rc < 0) {
@@ -230,7 +230,7 @@ vhost_vq_avail_ring_get(struct spdk_vhost_virtqueue *virtqueue, uint16_t *reqs,
 
 	virtqueue->last_avail_idx += count;
 	/* Check whether there are unprocessed reqs in vq, then kick vq manually */
-	if (virtqueue->vsession && spdk_unlikely(virtqueue->vsession->interrupt_mode)) {
+	if (spdk_unlikely(virtqueue->interrupt_mode)) {
 		/* If avail_idx is larger than virtqueue's last_avail_idx, then there is unprocessed reqs.
 		 * avail_idx should get updated here from memory, in case of race condition with guest.
 		 */
@@ -390,8 +390,12 @@ vhost_vq_used_signal(struct spdk_vhost_session *vsession,
 		      "Queue %td - USED RING: sending IRQ: last used %"PRIu16"\n",
 		      virtqueue - vsession->virtqueue, virtqueue->last_used_idx);
 
+	virtqueue->deferred_req_cnt = 0;
+
 	if (rte_vhost_vring_call(vsession->vid, virtqueue->vring_idx) == 0) {
 		/* interrupt signalled */
+		virtqueue->irq_cnt++;
+		virtqueue->interval_irq_cnt++;
 		return 1;
 	} else {
 		/* interrupt not signalled */
@@ -420,16 +424,52 @@ session_vq_io_stats_update(struct spdk_vhost_session *vsession,
 	virtqueue->next_event_time = now;
 }
 
+static void
+session_vq_adaptive_stats_update(struct spdk_vhost_session *vsession,
+				 struct spdk_vhost_virtqueue *virtqueue, uint64_t now)
+{
+	uint32_t irq_delay_max = vsession->coalescing_delay_time_base;
+	uint32_t req_cnt = virtqueue->req_cnt + virtqueue->used_req_cnt;
+	uint32_t irq_cnt = virtqueue->interval_irq_cnt;
+	uint64_t irq_delay;
+
+	if (req_cnt <= vsession->coalescing_io_rate_threshold) {
+		/* Too few completions to merge any of them */
+		irq_delay = 0;
+	} else if (virtqueue->irq_delay_time > 0 && irq_cnt > 0 &&
+		   req_cnt < irq_cnt * SPDK_VHOST_ADAPTIVE_COALESCING_MIN_BATCH) {
+		/* The delay didn't merge completions, it only added latency */
+		irq_delay = virtqueue->irq_delay_time / 2;
+	} else {
+		/* Aim at a fixed number of completions per interrupt at the current
+		 * rate, at most doubling the delay from one check to the next.
+		 */
+		irq_delay = vsession->stats_check_interval * SPDK_VHOST_ADAPTIVE_COALESCING_BATCH / req_cnt;
+		irq_delay = spdk_min(irq_delay, spdk_max(2ULL * virtqueue->irq_delay_time,
+				     irq_delay_max / 16));
+		irq_delay = spdk_min(irq_delay, irq_delay_max);
+	}
+
+	virtqueue->irq_delay_time = (uint32_t)irq_delay;
+	virtqueue->req_cnt = 0;
+	virtqueue->interval_irq_cnt = 0;
+	virtqueue->next_event_time = now;
+}
+
 static void
 check_session_vq_io_stats(struct spdk_vhost_session *vsession,
 			  struct spdk_vhost_virtqueue *virtqueue, uint64_t now)
 {
-	if (now < vsession->next_stats_check_time) {
+	if (now < virtqueue->next_stats_check_time) {
 		return;
 	}
 
-	vsession->next_stats_check_time = now + vsession->stats_check_interval;
-	session_vq_io_stats_update(vsession, virtqueue, now);
+	virtqueue->next_stats_check_time = now + vsession->stats_check_interval;
+	if (vsession->coalescing_adaptive) {
+		session_vq_adaptive_stats_update(vsession, virtqueue, now);
+	} else {
+		session_vq_io_stats_update(vsession, virtqueue, now);
+	}
 }
 
 static inline bool
@@ -448,6 +488,63 @@ vhost_vq_event_is_suppressed(struct spdk_vhost_virtqueue *vq)
 	return false;
 }
 
+/*
+ * Number of descriptors fetched from the avail ring that haven't been put
+ * on the used ring yet.
+ */
+static inline uint16_t
+vhost_vq_inflight_cnt(struct spdk_vhost_virtqueue *vq)
+{
+	if (spdk_unlikely(vq->packed.packed_ring)) {
+		if (vq->packed.avail_phase == vq->packed.used_phase) {
+			return vq->last_avail_idx - vq->last_used_idx;
+		}
+
+		return vq->vring.size - vq->last_used_idx + vq->last_avail_idx;
+	}
+
+	return vq->last_avail_idx - vq->last_used_idx;
+}
+
+static void
+session_vq_adaptive_used_signal(struct spdk_vhost_session *vsession,
+				struct spdk_vhost_virtqueue *virtqueue)
+{
+	uint64_t now;
+
+	if (virtqueue->vring.desc == NULL || virtqueue->used_req_cnt == 0) {
+		return;
+	}
+
+	now = spdk_get_ticks();
+	check_session_vq_io_stats(vsession, virtqueue, now);
+
+	/* The guest doesn't want an interrupt, so there is none to save */
+	if (vhost_vq_event_is_suppressed(virtqueue)) {
+		return;
+	}
+
+	/* Hold the interrupt back only while other requests are still in flight
+	 * and may complete within the delay. Once the virtqueue drains, e.g. at
+	 * queue depth 1, the guest is signalled right away.
+	 */
+	if (now < virtqueue->next_event_time && vhost_vq_inflight_cnt(virtqueue) > 0) {
+		if (virtqueue->used_req_cnt != virtqueue->deferred_req_cnt) {
+			virtqueue->deferred_req_cnt = virtqueue->used_req_cnt;
+			virtqueue->irq_saved++;
+		}
+		return;
+	}
+
+	if (!vhost_vq_used_signal(vsession, virtqueue)) {
+		return;
+	}
+
+	/* Syscall is quite long so update time */
+	now = spdk_get_ticks();
+	virtqueue->next_event_time = now + virtqueue->irq_delay_time;
+}
+
 void
 vhost_session_vq_used_signal(struct spdk_vhost_virtqueue *virtqueue)
 {
@@ -464,6 +561,8 @@ vhost_session_vq_used_signal(struct spdk_vhost_virtqueue *virtqueue)
 		}
 
 		vhost_vq_used_signal(vsession, virtqueue);
+	} else if (vsession->coalescing_adaptive) {
+		session_vq_adaptive_used_signal(vsession, virtqueue);
 	} else {
 		now = spdk_get_ticks();
 		check_session_vq_io_stats(vsession, virtqueue, now);
@@ -535,7 +634,7 @@ vhost_vq_used_ring_enqueue(struct spdk_vhost_session *vsession,
 
 	virtqueue->used_req_cnt++;
 
-	if (vsession->interrupt_mode) {
+	if (virtqueue->interrupt_mode) {
 		if (virtqueue->vring.desc == NULL || vhost_vq_event_is_suppressed(virtqueue)) {
 			return;
 		}
@@ -937,7 +1036,6 @@ new_connection(int vid)
 	}
 	vsession->started = false;
 	vsession->initialized = false;
-	vsession->next_stats_check_time = 0;
 	vsession->stats_check_interval = SPDK_VHOST_STATS_CHECK_INTERVAL_MS *
 					 spdk_get_ticks_hz() / 1000UL;
 	TAILQ_INSERT_TAIL(&user_dev->vsessions, vsession, tailq);
@@ -979,6 +1077,10 @@ start_device(int vid)
 	packed_ring = ((vsession->negotiated_features & (1ULL << VIRTIO_F_RING_PACKED)) != 0);
 
 	vsession->max_queues = 0;
+	for (i = 0; i < SPDK_VHOST_MAX_VQUEUES; i++) {
+		vsession->irq_cnt += vsession->virtqueue[i].irq_cnt;
+		vsession->irq_saved += vsession->virtqueue[i].irq_saved;
+	}
 	memset(vsession->virtqueue, 0, sizeof(vsession->virtqueue));
 	for (i = 0; i < SPDK_VHOST_MAX_VQUEUES; i++) {
 		struct spdk_vhost_virtqueue *q = &vsession->virtqueue[i];
@@ -1025,15 +1127,11 @@ start_device(int vid)
 			q->packed.used_phase = q->last_used_idx >> 15;
 			q->last_used_idx = q->last_used_idx & 0x7FFF;
 
-			if (!vsession->interrupt_mode) {
-				/* Disable I/O submission notifications, we'll be polling. */
-				q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
-			}
+			/* Disable I/O submission notifications, we'll be polling. */
+			q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
 		} else {
-			if (!vsession->interrupt_mode) {
-				/* Disable I/O submission notifications, we'll be polling. */
-				q->vring.used->flags = VRING_USED_F_NO_NOTIFY;
-			}
+			/* Disable I/O submission notifications, we'll be polling. */
+			q->vring.used->flags = VRING_USED_F_NO_NOTIFY;
 		}
 
 		q->packed.packed_ring = packed_ring;
@@ -1341,51 +1439,41 @@ vhost_user_dev_foreach_session(struct spdk_vhost_dev *vdev,
 }
 
 void
-vhost_user_session_set_interrupt_mode(struct spdk_vhost_session *vsession, bool interrupt_mode)
+vhost_user_vq_set_interrupt_mode(struct spdk_vhost_virtqueue *q, bool interrupt_mode)
 {
-	uint16_t i;
-	bool packed_ring;
-	int rc = 0;
-
-	packed_ring = ((vsession->negotiated_features & (1ULL << VIRTIO_F_RING_PACKED)) != 0);
+	uint64_t num_events = 1;
+	int rc;
 
-	for (i = 0; i < vsession->max_queues; i++) {
-		struct spdk_vhost_virtqueue *q = &vsession->virtqueue[i];
-		uint64_t num_events = 1;
+	/* vring.desc and vring.desc_packed are in a union struct
+	 * so q->vring.desc can replace q->vring.desc_packed.
+	 */
+	if (q->vring.desc == NULL || q->vring.size == 0) {
+		return;
+	}
 
-		/* vring.desc and vring.desc_packed are in a union struct
-		 * so q->vring.desc can replace q->vring.desc_packed.
-		 */
-		if (q->vring.desc == NULL || q->vring.size == 0) {
-			continue;
+	if (interrupt_mode) {
+		/* Enable I/O submission notifications, we'll be interrupting. */
+		if (q->packed.packed_ring) {
+			* (volatile uint16_t *) &q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_ENABLE;
+		} else {
+			* (volatile uint16_t *) &q->vring.used->flags = 0;
 		}
 
-		if (interrupt_mode) {
-			/* Enable I/O submission notifications, we'll be interrupting. */
-			if (packed_ring) {
-				* (volatile uint16_t *) &q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_ENABLE;
-			} else {
-				* (volatile uint16_t *) &q->vring.used->flags = 0;
-			}
-
-			/* In case of race condition, always kick vring when switch to intr */
-			rc = write(q->vring.kickfd, &num_events, sizeof(num_events));
-			if (rc < 0) {
-				SPDK_ERRLOG("failed to kick vring: %s.\n", spdk_strerror(errno));
-			}
-
-			vsession->interrupt_mode = true;
+		/* In case of race condition, always kick vring when switch to intr */
+		rc = write(q->vring.kickfd, &num_events, sizeof(num_events));
+		if (rc < 0) {
+			SPDK_ERRLOG("failed to kick vring: %s.\n", spdk_strerror(errno));
+		}
+	} else {
+		/* Disable I/O submission notifications, we'll be polling. */
+		if (q->packed.packed_ring) {
+			* (volatile uint16_t *) &q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
 		} else {
-			/* Disable I/O submission notifications, we'll be polling. */
-			if (packed_ring) {
-				* (volatile uint16_t *) &q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
-			} else {
-				* (volatile uint16_t *) &q->vring.used->flags = VRING_USED_F_NO_NOTIFY;
-			}
-
-			vsession->interrupt_mode = false;
+			* (volatile uint16_t *) &q->vring.used->flags = VRING_USED_F_NO_NOTIFY;
 		}
 	}
+
+	q->interrupt_mode = interrupt_mode;
 }
 
 
@@ -1664,6 +1752,7 @@ vhost_user_session_set_coalescing(struct spdk_vhost_dev *vdev,
 		to_user_dev(vdev)->coalescing_delay_us * spdk_get_ticks_hz() / 1000000ULL;
 	vsession->coalescing_io_rate_threshold =
 		to_user_dev(vdev)->coalescing_iops_threshold * SPDK_VHOST_STATS_CHECK_INTERVAL_MS / 1000U;
+	vsession->coalescing_adaptive = to_user_dev(vdev)->coalescing_adaptive;
 	return 0;
 }
 
@@ -1697,6 +1786,38 @@ spdk_vhost_get_coalescing(struct spdk_vhost_dev *vdev, uint32_t *delay_base_us,
 	}
 }
 
+void
+spdk_vhost_set_adaptive_coalescing(struct spdk_vhost_dev *vdev, bool adaptive)
+{
+	to_user_dev(vdev)->coalescing_adaptive = adaptive;
+	vhost_user_dev_foreach_session(vdev, vhost_user_session_set_coalescing, NULL, NULL);
+}
+
+bool
+spdk_vhost_get_adaptive_coalescing(struct spdk_vhost_dev *vdev)
+{
+	return to_user_dev(vdev)->coalescing_adaptive;
+}
+
+void
+vhost_user_dev_get_irq_stats(struct spdk_vhost_dev *vdev, uint64_t *irq_cnt,
+			     uint64_t *irq_saved)
+{
+	struct spdk_vhost_session *vsession;
+	uint16_t i;
+
+	*irq_cnt = 0;
+	*irq_saved = 0;
+	TAILQ_FOREACH(vsession, &to_user_dev(vdev)->vsessions, tailq) {
+		*irq_cnt += vsession->irq_cnt;
+		*irq_saved += vsession->irq_saved;
+		for (i = 0; i < vsession->max_queues; i++) {
+			*irq_cnt += vsession->virtqueue[i].irq_cnt;
+			*irq_saved += vsession->virtqueue[i].irq_saved;
+		}
+	}
+}
+
 int
 spdk_vhost_set_socket_path(const char *basename)
 {
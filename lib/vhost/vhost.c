@@ -284,6 +284,9 @@ vhost_user_config_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *
 		spdk_json_write_named_string(w, "ctrlr", vdev->name);
 		spdk_json_write_named_uint32(w, "delay_base_us", delay_base_us);
 		spdk_json_write_named_uint32(w, "iops_threshold", iops_threshold);
+		if (spdk_vhost_get_adaptive_coalescing(vdev)) {
+			spdk_json_write_named_bool(w, "adaptive", true);
+		}
 		spdk_json_write_object_end(w);
 
 		spdk_json_write_object_end(w);
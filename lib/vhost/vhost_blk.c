@@ -65,6 +65,7 @@
 struct spdk_vhost_blk_task {
 	struct spdk_bdev_io *bdev_io;
 	struct spdk_vhost_blk_session *bvsession;
+	struct vhost_blk_queue_group *group;
 	struct spdk_vhost_virtqueue *vq;
 
 	volatile uint8_t *status;
@@ -96,27 +97,62 @@ struct spdk_vhost_blk_dev {
 	/* dummy_io_channel is used to hold a bdev reference */
 	struct spdk_io_channel *dummy_io_channel;
 	bool readonly;
+
+	/* Dedicated threads polling the virtqueues of each session. If there
+	 * are none, all virtqueues are polled on the controller thread.
+	 */
+	struct spdk_thread **queue_threads;
+	uint32_t num_queue_threads;
+
+	/* Pending switches to the no-bdev workers after a hot-remove */
+	uint32_t remove_refs;
+	struct spdk_thread *remove_thread;
+};
+
+/*
+ * Virtqueues of a session that are polled together on one thread.
+ * Virtqueue i belongs to group (i % num_groups). Each request is fetched,
+ * submitted, completed and signalled on the thread of its group, so the
+ * used ring and the guest notifications of a virtqueue stay single-threaded.
+ */
+struct vhost_blk_queue_group {
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_thread *thread;
+	struct spdk_poller *requestq_poller;
+	struct spdk_io_channel *io_channel;
+	struct spdk_poller *stop_poller;
+	uint32_t stop_retry_count;
+	int task_cnt;
+	int rc;
+	uint16_t index;
 };
 
 struct spdk_vhost_blk_session {
 	/* The parent session must be the very first field in this struct */
 	struct spdk_vhost_session vsession;
 	struct spdk_vhost_blk_dev *bvdev;
-	struct spdk_poller *requestq_poller;
-	struct spdk_io_channel *io_channel;
-	struct spdk_poller *stop_poller;
+	struct vhost_blk_queue_group groups[SPDK_VHOST_MAX_VQUEUES];
+	uint16_t num_groups;
+
+	/* Groups that haven't finished the current start or stop yet */
+	uint16_t pending_groups;
+	int groups_rc;
+	/* Set while the groups are torn down after a failed start */
+	bool start_failed;
 };
 
 struct rpc_vhost_blk {
 	bool readonly;
 	bool packed_ring;
 	bool packed_ring_recovery;
+	uint32_t queue_threads;
 };
 
 static const struct spdk_json_object_decoder rpc_construct_vhost_blk[] = {
 	{"readonly", offsetof(struct rpc_vhost_blk, readonly), spdk_json_decode_bool, true},
 	{"packed_ring", offsetof(struct rpc_vhost_blk, packed_ring), spdk_json_decode_bool, true},
 	{"packed_ring_recovery", offsetof(struct rpc_vhost_blk, packed_ring_recovery), spdk_json_decode_bool, true},
+	{"queue_threads", offsetof(struct rpc_vhost_blk, queue_threads), spdk_json_decode_uint32, true},
 };
 
 /* forward declaration */
@@ -136,8 +172,8 @@ to_blk_session(struct spdk_vhost_session *vsession)
 static void
 blk_task_finish(struct spdk_vhost_blk_task *task)
 {
-	assert(task->bvsession->vsession.task_cnt > 0);
-	task->bvsession->vsession.task_cnt--;
+	assert(task->group->task_cnt > 0);
+	task->group->task_cnt--;
 	task->used = false;
 }
 
@@ -442,7 +478,7 @@ blk_request_queue_io(struct spdk_vhost_blk_task *task)
 	task->bdev_io_wait.cb_fn = blk_request_resubmit;
 	task->bdev_io_wait.cb_arg = task;
 
-	rc = spdk_bdev_queue_io_wait(bdev, bvsession->io_channel, &task->bdev_io_wait);
+	rc = spdk_bdev_queue_io_wait(bdev, task->group->io_channel, &task->bdev_io_wait);
 	if (rc != 0) {
 		SPDK_ERRLOG("%s: failed to queue I/O, rc=%d\n", bvsession->vsession.name, rc);
 		blk_request_finish(VIRTIO_BLK_S_IOERR, task);
@@ -454,6 +490,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 		    struct spdk_vhost_blk_session *bvsession)
 {
 	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
+	struct spdk_io_channel *ch = task->group->io_channel;
 	struct virtio_blk_outhdr req;
 	struct virtio_blk_discard_write_zeroes *desc;
 	struct iovec *iov;
@@ -510,12 +547,12 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 
 		if (type == VIRTIO_BLK_T_IN) {
 			task->used_len = payload_len + sizeof(*task->status);
-			rc = spdk_bdev_readv(bvdev->bdev_desc, bvsession->io_channel,
+			rc = spdk_bdev_readv(bvdev->bdev_desc, ch,
 					     &task->iovs[1], iovcnt, req.sector * 512,
 					     payload_len, blk_request_complete_cb, task);
 		} else if (!bvdev->readonly) {
 			task->used_len = sizeof(*task->status);
-			rc = spdk_bdev_writev(bvdev->bdev_desc, bvsession->io_channel,
+			rc = spdk_bdev_writev(bvdev->bdev_desc, ch,
 					      &task->iovs[1], iovcnt, req.sector * 512,
 					      payload_len, blk_request_complete_cb, task);
 		} else {
@@ -547,7 +584,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 			return -1;
 		}
 
-		rc = spdk_bdev_unmap(bvdev->bdev_desc, bvsession->io_channel,
+		rc = spdk_bdev_unmap(bvdev->bdev_desc, ch,
 				     desc->sector * 512, desc->num_sectors * 512,
 				     blk_request_complete_cb, task);
 		if (rc) {
@@ -577,7 +614,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 				     (uint64_t)desc->sector * 512, (uint64_t)desc->num_sectors * 512);
 		}
 
-		rc = spdk_bdev_write_zeroes(bvdev->bdev_desc, bvsession->io_channel,
+		rc = spdk_bdev_write_zeroes(bvdev->bdev_desc, ch,
 					    desc->sector * 512, desc->num_sectors * 512,
 					    blk_request_complete_cb, task);
 		if (rc) {
@@ -597,7 +634,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 			blk_request_finish(VIRTIO_BLK_S_IOERR, task);
 			return -1;
 		}
-		rc = spdk_bdev_flush(bvdev->bdev_desc, bvsession->io_channel,
+		rc = spdk_bdev_flush(bvdev->bdev_desc, ch,
 				     0, flush_bytes,
 				     blk_request_complete_cb, task);
 		if (rc) {
@@ -646,7 +683,7 @@ process_blk_task(struct spdk_vhost_virtqueue *vq, uint16_t req_idx)
 		return;
 	}
 
-	task->bvsession->vsession.task_cnt++;
+	task->group->task_cnt++;
 
 	blk_task_init(task);
 
@@ -709,7 +746,7 @@ process_packed_blk_task(struct spdk_vhost_virtqueue *vq, uint16_t req_idx)
 					   req_idx, (req_idx + num_descs - 1) % vq->vring.size,
 					   &task->inflight_head);
 
-	task->bvsession->vsession.task_cnt++;
+	task->group->task_cnt++;
 
 	blk_task_init(task);
 
@@ -767,7 +804,7 @@ process_packed_inflight_blk_task(struct spdk_vhost_virtqueue *vq,
 	/* It's for cleaning inflight entries */
 	task->inflight_head = req_idx;
 
-	task->bvsession->vsession.task_cnt++;
+	task->group->task_cnt++;
 
 	blk_task_init(task);
 
@@ -906,11 +943,12 @@ vdev_vq_worker(void *arg)
 static int
 vdev_worker(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = arg;
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	uint16_t q_idx;
 
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	for (q_idx = group->index; q_idx < vsession->max_queues; q_idx += bvsession->num_groups) {
 		_vdev_vq_worker(&vsession->virtqueue[q_idx]);
 	}
 
@@ -984,6 +1022,7 @@ _no_bdev_vdev_vq_worker(struct spdk_vhost_virtqueue *vq)
 {
 	struct spdk_vhost_session *vsession = vq->vsession;
 	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
+	struct vhost_blk_queue_group *group;
 	bool packed_ring;
 
 	packed_ring = vq->packed.packed_ring;
@@ -995,9 +1034,10 @@ _no_bdev_vdev_vq_worker(struct spdk_vhost_virtqueue *vq)
 
 	vhost_session_vq_used_signal(vq);
 
-	if (vsession->task_cnt == 0 && bvsession->io_channel) {
-		vhost_blk_put_io_channel(bvsession->io_channel);
-		bvsession->io_channel = NULL;
+	group = &bvsession->groups[(vq - vsession->virtqueue) % bvsession->num_groups];
+	if (group->task_cnt == 0 && group->io_channel) {
+		vhost_blk_put_io_channel(group->io_channel);
+		group->io_channel = NULL;
 	}
 
 	return SPDK_POLLER_BUSY;
@@ -1014,11 +1054,12 @@ no_bdev_vdev_vq_worker(void *arg)
 static int
 no_bdev_vdev_worker(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = arg;
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	uint16_t q_idx;
 
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	for (q_idx = group->index; q_idx < vsession->max_queues; q_idx += bvsession->num_groups) {
 		_no_bdev_vdev_vq_worker(&vsession->virtqueue[q_idx]);
 	}
 
@@ -1026,14 +1067,15 @@ no_bdev_vdev_worker(void *arg)
 }
 
 static void
-vhost_blk_session_unregister_interrupts(struct spdk_vhost_blk_session *bvsession)
+vhost_blk_group_unregister_interrupts(struct vhost_blk_queue_group *group)
 {
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	struct spdk_vhost_virtqueue *vq;
 	int i;
 
 	SPDK_DEBUGLOG(vhost_blk, "unregister virtqueues interrupt\n");
-	for (i = 0; i < vsession->max_queues; i++) {
+	for (i = group->index; i < vsession->max_queues; i += bvsession->num_groups) {
 		vq = &vsession->virtqueue[i];
 		if (vq->intr == NULL) {
 			break;
@@ -1046,15 +1088,16 @@ vhost_blk_session_unregister_interrupts(struct spdk_vhost_blk_session *bvsession
 }
 
 static int
-vhost_blk_session_register_interrupts(struct spdk_vhost_blk_session *bvsession,
-				      spdk_interrupt_fn fn, const char *name)
+vhost_blk_group_register_interrupts(struct vhost_blk_queue_group *group,
+				    spdk_interrupt_fn fn, const char *name)
 {
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	struct spdk_vhost_virtqueue *vq = NULL;
 	int i;
 
 	SPDK_DEBUGLOG(vhost_blk, "Register virtqueues interrupt\n");
-	for (i = 0; i < vsession->max_queues; i++) {
+	for (i = group->index; i < vsession->max_queues; i += bvsession->num_groups) {
 		vq = &vsession->virtqueue[i];
 		SPDK_DEBUGLOG(vhost_blk, "Register vq[%d]'s kickfd is %d\n",
 			      i, vq->vring.kickfd);
@@ -1069,7 +1112,7 @@ vhost_blk_session_register_interrupts(struct spdk_vhost_blk_session *bvsession,
 	return 0;
 
 err:
-	vhost_blk_session_unregister_interrupts(bvsession);
+	vhost_blk_group_unregister_interrupts(group);
 
 	return -1;
 }
@@ -1077,9 +1120,20 @@ err:
 static void
 vhost_blk_poller_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg, bool interrupt_mode)
 {
-	struct spdk_vhost_blk_session *bvsession = cb_arg;
+	struct vhost_blk_queue_group *group = cb_arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	uint16_t q_idx;
+
+	for (q_idx = group->index; q_idx < vsession->max_queues; q_idx += bvsession->num_groups) {
+		vhost_user_vq_set_interrupt_mode(&vsession->virtqueue[q_idx], interrupt_mode);
+	}
+}
 
-	vhost_user_session_set_interrupt_mode(&bvsession->vsession, interrupt_mode);
+static inline bool
+vhost_blk_group_has_interrupts(struct vhost_blk_queue_group *group)
+{
+	return group->bvsession->vsession.virtqueue[group->index].intr != NULL;
 }
 
 static struct spdk_vhost_blk_dev *
@@ -1124,43 +1178,72 @@ blk_resize_cb(void *resize_ctx)
 }
 
 static void
-vhost_dev_bdev_remove_cpl_cb(struct spdk_vhost_dev *vdev, void *ctx)
+vhost_blk_bdev_remove_put(void *arg)
 {
+	struct spdk_vhost_blk_dev *bvdev = arg;
 
-	/* All sessions have been notified, time to close the bdev */
-	struct spdk_vhost_blk_dev *bvdev = to_blk_dev(vdev);
+	if (__atomic_sub_fetch(&bvdev->remove_refs, 1, __ATOMIC_SEQ_CST) > 0) {
+		return;
+	}
 
-	assert(bvdev != NULL);
+	/* All queue groups have switched to the no-bdev workers, time to close the bdev */
 	spdk_put_io_channel(bvdev->dummy_io_channel);
 	spdk_bdev_close(bvdev->bdev_desc);
 	bvdev->bdev_desc = NULL;
 	bvdev->bdev = NULL;
 }
 
-static int
-vhost_session_bdev_remove_cb(struct spdk_vhost_dev *vdev,
-			     struct spdk_vhost_session *vsession,
-			     void *ctx)
+static void
+vhost_dev_bdev_remove_cpl_cb(struct spdk_vhost_dev *vdev, void *ctx)
 {
-	struct spdk_vhost_blk_session *bvsession;
+	/* All sessions have been notified, drop the reference held during the iteration */
+	struct spdk_vhost_blk_dev *bvdev = to_blk_dev(vdev);
+
+	assert(bvdev != NULL);
+	vhost_blk_bdev_remove_put(bvdev);
+}
+
+static void
+vhost_blk_group_bdev_remove(void *arg)
+{
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
+	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
 	int rc;
 
-	bvsession = to_blk_session(vsession);
-	if (bvsession->requestq_poller) {
-		spdk_poller_unregister(&bvsession->requestq_poller);
-		if (vsession->virtqueue[0].intr) {
-			vhost_blk_session_unregister_interrupts(bvsession);
-			rc = vhost_blk_session_register_interrupts(bvsession, no_bdev_vdev_vq_worker,
+	if (group->requestq_poller) {
+		spdk_poller_unregister(&group->requestq_poller);
+		if (vhost_blk_group_has_interrupts(group)) {
+			vhost_blk_group_unregister_interrupts(group);
+			rc = vhost_blk_group_register_interrupts(group, no_bdev_vdev_vq_worker,
 					"no_bdev_vdev_vq_worker");
 			if (rc) {
-				SPDK_ERRLOG("%s: Interrupt register failed\n", vsession->name);
-				return rc;
+				SPDK_ERRLOG("%s: Interrupt register failed\n", bvsession->vsession.name);
 			}
 		}
 
-		bvsession->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, bvsession, 0);
-		spdk_poller_register_interrupt(bvsession->requestq_poller, vhost_blk_poller_set_interrupt_mode,
-					       bvsession);
+		group->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, group, 0);
+		spdk_poller_register_interrupt(group->requestq_poller, vhost_blk_poller_set_interrupt_mode,
+					       group);
+	}
+
+	spdk_thread_send_msg(bvdev->remove_thread, vhost_blk_bdev_remove_put, bvdev);
+}
+
+static int
+vhost_session_bdev_remove_cb(struct spdk_vhost_dev *vdev,
+			     struct spdk_vhost_session *vsession,
+			     void *ctx)
+{
+	struct spdk_vhost_blk_session *bvsession;
+	struct vhost_blk_queue_group *group;
+	uint16_t i;
+
+	bvsession = to_blk_session(vsession);
+	for (i = 0; i < bvsession->num_groups; i++) {
+		group = &bvsession->groups[i];
+		__atomic_fetch_add(&bvsession->bvdev->remove_refs, 1, __ATOMIC_SEQ_CST);
+		spdk_thread_send_msg(group->thread, vhost_blk_group_bdev_remove, group);
 	}
 
 	return 0;
@@ -1174,6 +1257,10 @@ bdev_remove_cb(void *remove_ctx)
 	SPDK_WARNLOG("%s: hot-removing bdev - all further requests will fail.\n",
 		     bvdev->vdev.name);
 
+	/* The bdev is closed once the last queue group has stopped submitting to it */
+	bvdev->remove_thread = spdk_get_thread();
+	__atomic_store_n(&bvdev->remove_refs, 1, __ATOMIC_SEQ_CST);
+
 	spdk_vhost_lock();
 	vhost_user_dev_foreach_session(&bvdev->vdev, vhost_session_bdev_remove_cb,
 				       vhost_dev_bdev_remove_cpl_cb, NULL);
@@ -1258,6 +1345,7 @@ alloc_task_pool(struct spdk_vhost_blk_session *bvsession)
 		for (j = 0; j < task_cnt; j++) {
 			task = &((struct spdk_vhost_blk_task *)vq->tasks)[j];
 			task->bvsession = bvsession;
+			task->group = &bvsession->groups[i % bvsession->num_groups];
 			task->req_idx = j;
 			task->vq = vq;
 		}
@@ -1266,40 +1354,103 @@ alloc_task_pool(struct spdk_vhost_blk_session *bvsession)
 	return 0;
 }
 
-static int
-vhost_blk_start_cb(struct spdk_vhost_dev *vdev,
-		   struct spdk_vhost_session *vsession, void *unused)
+static void vhost_blk_group_stop(void *arg);
+
+static void
+vhost_blk_group_stop_done(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
-	struct spdk_vhost_blk_dev *bvdev;
-	int i, rc = 0;
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
 
-	bvdev = to_blk_dev(vdev);
-	assert(bvdev != NULL);
-	bvsession->bvdev = bvdev;
+	if (spdk_vhost_trylock() != 0) {
+		spdk_thread_send_msg(spdk_get_thread(), vhost_blk_group_stop_done, arg);
+		return;
+	}
 
-	/* validate all I/O queues are in a contiguous index range */
-	for (i = 0; i < vsession->max_queues; i++) {
-		/* vring.desc and vring.desc_packed are in a union struct
-		 * so q->vring.desc can replace q->vring.desc_packed.
-		 */
-		if (vsession->virtqueue[i].vring.desc == NULL) {
-			SPDK_ERRLOG("%s: queue %"PRIu32" is empty\n", vsession->name, i);
-			rc = -1;
-			goto out;
-		}
+	if (group->rc != 0 && bvsession->groups_rc == 0) {
+		bvsession->groups_rc = group->rc;
 	}
 
-	rc = alloc_task_pool(bvsession);
-	if (rc != 0) {
-		SPDK_ERRLOG("%s: failed to alloc task pool.\n", vsession->name);
-		goto out;
+	assert(bvsession->pending_groups > 0);
+	if (--bvsession->pending_groups > 0) {
+		spdk_vhost_unlock();
+		return;
+	}
+
+	if (bvsession->groups_rc == 0) {
+		free_task_pool(bvsession);
+		bvsession->num_groups = 0;
+	}
+
+	if (bvsession->start_failed) {
+		bvsession->start_failed = false;
+		vhost_user_session_start_done(vsession, -1);
+	} else {
+		vhost_user_session_stop_done(vsession, bvsession->groups_rc);
 	}
 
+	spdk_vhost_unlock();
+}
+
+static void
+vhost_blk_groups_stop(struct spdk_vhost_blk_session *bvsession)
+{
+	uint16_t i;
+
+	bvsession->pending_groups = bvsession->num_groups;
+	bvsession->groups_rc = 0;
+	for (i = 0; i < bvsession->num_groups; i++) {
+		spdk_thread_send_msg(bvsession->groups[i].thread, vhost_blk_group_stop,
+				     &bvsession->groups[i]);
+	}
+}
+
+static void
+vhost_blk_group_start_done(void *arg)
+{
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+
+	if (spdk_vhost_trylock() != 0) {
+		spdk_thread_send_msg(spdk_get_thread(), vhost_blk_group_start_done, arg);
+		return;
+	}
+
+	if (group->rc != 0 && bvsession->groups_rc == 0) {
+		bvsession->groups_rc = group->rc;
+	}
+
+	assert(bvsession->pending_groups > 0);
+	if (--bvsession->pending_groups > 0) {
+		spdk_vhost_unlock();
+		return;
+	}
+
+	if (bvsession->groups_rc != 0) {
+		/* Tear down the groups that did start before reporting the failure */
+		bvsession->start_failed = true;
+		vhost_blk_groups_stop(bvsession);
+	} else {
+		vhost_user_session_start_done(vsession, 0);
+	}
+
+	spdk_vhost_unlock();
+}
+
+static void
+vhost_blk_group_start(void *arg)
+{
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
+	int rc = 0;
+
 	if (bvdev->bdev) {
-		bvsession->io_channel = vhost_blk_get_io_channel(vdev);
-		if (!bvsession->io_channel) {
-			free_task_pool(bvsession);
+		group->io_channel = vhost_blk_get_io_channel(&bvdev->vdev);
+		if (!group->io_channel) {
 			SPDK_ERRLOG("%s: I/O channel allocation failed\n", vsession->name);
 			rc = -1;
 			goto out;
@@ -1308,11 +1459,11 @@ vhost_blk_start_cb(struct spdk_vhost_dev *vdev,
 
 	if (spdk_interrupt_mode_is_enabled()) {
 		if (bvdev->bdev) {
-			rc = vhost_blk_session_register_interrupts(bvsession,
+			rc = vhost_blk_group_register_interrupts(group,
 					vdev_vq_worker,
 					"vdev_vq_worker");
 		} else {
-			rc = vhost_blk_session_register_interrupts(bvsession,
+			rc = vhost_blk_group_register_interrupts(group,
 					no_bdev_vdev_vq_worker,
 					"no_bdev_vdev_vq_worker");
 		}
@@ -1324,15 +1475,77 @@ vhost_blk_start_cb(struct spdk_vhost_dev *vdev,
 	}
 
 	if (bvdev->bdev) {
-		bvsession->requestq_poller = SPDK_POLLER_REGISTER(vdev_worker, bvsession, 0);
+		group->requestq_poller = SPDK_POLLER_REGISTER(vdev_worker, group, 0);
 	} else {
-		bvsession->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, bvsession, 0);
+		group->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, group, 0);
 	}
-	SPDK_INFOLOG(vhost, "%s: started poller on lcore %d\n",
-		     vsession->name, spdk_env_get_current_core());
+	SPDK_INFOLOG(vhost, "%s: started poller for queue group %"PRIu16" on lcore %d\n",
+		     vsession->name, group->index, spdk_env_get_current_core());
 
-	spdk_poller_register_interrupt(bvsession->requestq_poller, vhost_blk_poller_set_interrupt_mode,
-				       bvsession);
+	spdk_poller_register_interrupt(group->requestq_poller, vhost_blk_poller_set_interrupt_mode,
+				       group);
+
+out:
+	group->rc = rc;
+	spdk_thread_send_msg(vsession->vdev->thread, vhost_blk_group_start_done, group);
+}
+
+static int
+vhost_blk_start_cb(struct spdk_vhost_dev *vdev,
+		   struct spdk_vhost_session *vsession, void *unused)
+{
+	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
+	struct spdk_vhost_blk_dev *bvdev;
+	struct vhost_blk_queue_group *group;
+	int i, rc = 0;
+
+	bvdev = to_blk_dev(vdev);
+	assert(bvdev != NULL);
+	bvsession->bvdev = bvdev;
+
+	/* validate all I/O queues are in a contiguous index range */
+	for (i = 0; i < vsession->max_queues; i++) {
+		/* vring.desc and vring.desc_packed are in a union struct
+		 * so q->vring.desc can replace q->vring.desc_packed.
+		 */
+		if (vsession->virtqueue[i].vring.desc == NULL) {
+			SPDK_ERRLOG("%s: queue %"PRIu32" is empty\n", vsession->name, i);
+			rc = -1;
+			goto out;
+		}
+	}
+
+	/* Spread the virtqueues over the queue threads of the controller, or poll
+	 * all of them on the controller thread if it has none.
+	 */
+	bvsession->num_groups = 1;
+	if (bvdev->num_queue_threads > 0 && vsession->max_queues > 1) {
+		bvsession->num_groups = spdk_min(bvdev->num_queue_threads, vsession->max_queues);
+	}
+
+	for (i = 0; i < bvsession->num_groups; i++) {
+		group = &bvsession->groups[i];
+		memset(group, 0, sizeof(*group));
+		group->bvsession = bvsession;
+		group->index = i;
+		group->thread = bvdev->num_queue_threads > 0 ? bvdev->queue_threads[i] : vdev->thread;
+	}
+
+	rc = alloc_task_pool(bvsession);
+	if (rc != 0) {
+		SPDK_ERRLOG("%s: failed to alloc task pool.\n", vsession->name);
+		goto out;
+	}
+
+	bvsession->pending_groups = bvsession->num_groups;
+	bvsession->groups_rc = 0;
+	for (i = 0; i < bvsession->num_groups; i++) {
+		spdk_thread_send_msg(bvsession->groups[i].thread, vhost_blk_group_start,
+				     &bvsession->groups[i]);
+	}
+
+	/* The session is reported as started once all groups are running */
+	return 0;
 
 out:
 	vhost_user_session_start_done(vsession, rc);
@@ -1347,62 +1560,70 @@ vhost_blk_start(struct spdk_vhost_session *vsession)
 }
 
 static int
-destroy_session_poller_cb(void *arg)
+vhost_blk_group_stop_poller_cb(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = arg;
+	struct vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	int i;
 
-	if (vsession->task_cnt > 0 || spdk_vhost_trylock() != 0) {
-		assert(vsession->stop_retry_count > 0);
-		vsession->stop_retry_count--;
-		if (vsession->stop_retry_count == 0) {
-			SPDK_ERRLOG("%s: Timedout when destroy session (task_cnt %d)\n", vsession->name,
-				    vsession->task_cnt);
-			spdk_poller_unregister(&bvsession->stop_poller);
-			vhost_user_session_stop_done(vsession, -ETIMEDOUT);
+	if (group->task_cnt > 0) {
+		assert(group->stop_retry_count > 0);
+		group->stop_retry_count--;
+		if (group->stop_retry_count == 0) {
+			SPDK_ERRLOG("%s: Timedout when destroy queue group %"PRIu16" (task_cnt %d)\n",
+				    vsession->name, group->index, group->task_cnt);
+			spdk_poller_unregister(&group->stop_poller);
+			group->rc = -ETIMEDOUT;
+			spdk_thread_send_msg(vsession->vdev->thread, vhost_blk_group_stop_done, group);
 		}
 
 		return SPDK_POLLER_BUSY;
 	}
 
-	for (i = 0; i < vsession->max_queues; i++) {
+	for (i = group->index; i < vsession->max_queues; i += bvsession->num_groups) {
 		vsession->virtqueue[i].next_event_time = 0;
 		vhost_vq_used_signal(vsession, &vsession->virtqueue[i]);
 	}
 
-	SPDK_INFOLOG(vhost, "%s: stopping poller on lcore %d\n",
-		     vsession->name, spdk_env_get_current_core());
+	SPDK_INFOLOG(vhost, "%s: stopping poller for queue group %"PRIu16" on lcore %d\n",
+		     vsession->name, group->index, spdk_env_get_current_core());
 
-	if (bvsession->io_channel) {
-		vhost_blk_put_io_channel(bvsession->io_channel);
-		bvsession->io_channel = NULL;
+	if (group->io_channel) {
+		vhost_blk_put_io_channel(group->io_channel);
+		group->io_channel = NULL;
 	}
 
-	free_task_pool(bvsession);
-	spdk_poller_unregister(&bvsession->stop_poller);
-	vhost_user_session_stop_done(vsession, 0);
+	spdk_poller_unregister(&group->stop_poller);
+	group->rc = 0;
+	spdk_thread_send_msg(vsession->vdev->thread, vhost_blk_group_stop_done, group);
 
-	spdk_vhost_unlock();
 	return SPDK_POLLER_BUSY;
 }
 
-static int
-vhost_blk_stop_cb(struct spdk_vhost_dev *vdev,
-		  struct spdk_vhost_session *vsession, void *unused)
+static void
+vhost_blk_group_stop(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
+	struct vhost_blk_queue_group *group = arg;
 
-	spdk_poller_unregister(&bvsession->requestq_poller);
+	spdk_poller_unregister(&group->requestq_poller);
 
-	if (vsession->virtqueue[0].intr) {
-		vhost_blk_session_unregister_interrupts(bvsession);
+	if (vhost_blk_group_has_interrupts(group)) {
+		vhost_blk_group_unregister_interrupts(group);
 	}
 
 	/* vhost_user_session_send_event timeout is 3 seconds, here set retry within 4 seconds */
-	bvsession->vsession.stop_retry_count = 4000;
-	bvsession->stop_poller = SPDK_POLLER_REGISTER(destroy_session_poller_cb,
-				 bvsession, 1000);
+	group->stop_retry_count = 4000;
+	group->stop_poller = SPDK_POLLER_REGISTER(vhost_blk_group_stop_poller_cb, group, 1000);
+}
+
+static int
+vhost_blk_stop_cb(struct spdk_vhost_dev *vdev,
+		  struct spdk_vhost_session *vsession, void *unused)
+{
+	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
+
+	vhost_blk_groups_stop(bvsession);
 	return 0;
 }
 
@@ -1424,6 +1645,7 @@ vhost_blk_dump_info_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx
 	spdk_json_write_named_object_begin(w, "block");
 
 	spdk_json_write_named_bool(w, "readonly", bvdev->readonly);
+	spdk_json_write_named_uint32(w, "queue_threads", bvdev->num_queue_threads);
 
 	spdk_json_write_name(w, "bdev");
 	if (bvdev->bdev) {
@@ -1456,6 +1678,9 @@ vhost_blk_write_config_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_
 	spdk_json_write_named_string(w, "cpumask",
 				     spdk_cpuset_fmt(spdk_thread_get_cpumask(vdev->thread)));
 	spdk_json_write_named_bool(w, "readonly", bvdev->readonly);
+	if (bvdev->num_queue_threads > 0) {
+		spdk_json_write_named_uint32(w, "queue_threads", bvdev->num_queue_threads);
+	}
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -1541,6 +1766,73 @@ static const struct spdk_vhost_dev_backend vhost_blk_device_backend = {
 	.remove_device = vhost_blk_destroy,
 };
 
+static void
+vhost_blk_queue_thread_exit(void *unused)
+{
+	spdk_thread_exit(spdk_get_thread());
+}
+
+static void
+vhost_blk_destroy_queue_threads(struct spdk_vhost_blk_dev *bvdev)
+{
+	uint32_t i;
+
+	for (i = 0; i < bvdev->num_queue_threads; i++) {
+		spdk_thread_send_msg(bvdev->queue_threads[i], vhost_blk_queue_thread_exit, NULL);
+	}
+
+	free(bvdev->queue_threads);
+	bvdev->queue_threads = NULL;
+	bvdev->num_queue_threads = 0;
+}
+
+static int
+vhost_blk_create_queue_threads(struct spdk_vhost_blk_dev *bvdev, uint32_t num_threads)
+{
+	struct spdk_vhost_dev *vdev = &bvdev->vdev;
+	const struct spdk_cpuset *dev_cpumask = spdk_thread_get_cpumask(vdev->thread);
+	struct spdk_cpuset cpumask;
+	uint32_t core = spdk_env_get_last_core();
+	uint32_t i;
+	char *name;
+
+	bvdev->queue_threads = calloc(num_threads, sizeof(*bvdev->queue_threads));
+	if (bvdev->queue_threads == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		/* Pin each queue thread to a single core of the controller, round robin */
+		do {
+			core = spdk_env_get_next_core(core);
+			if (core == UINT32_MAX) {
+				core = spdk_env_get_first_core();
+			}
+		} while (!spdk_cpuset_get_cpu(dev_cpumask, core));
+
+		spdk_cpuset_zero(&cpumask);
+		spdk_cpuset_set_cpu(&cpumask, core, true);
+
+		name = spdk_sprintf_alloc("%s.q%"PRIu32, vdev->name, i);
+		if (name == NULL) {
+			vhost_blk_destroy_queue_threads(bvdev);
+			return -ENOMEM;
+		}
+
+		bvdev->queue_threads[i] = spdk_thread_create(name, &cpumask);
+		free(name);
+		if (bvdev->queue_threads[i] == NULL) {
+			SPDK_ERRLOG("%s: failed to create queue thread %"PRIu32"\n", vdev->name, i);
+			vhost_blk_destroy_queue_threads(bvdev);
+			return -EIO;
+		}
+
+		bvdev->num_queue_threads++;
+	}
+
+	return 0;
+}
+
 int
 spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_name,
 			 const struct spdk_json_val *params)
@@ -1561,6 +1853,13 @@ spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_
 		goto out;
 	}
 
+	if (req.queue_threads > SPDK_VHOST_MAX_VQUEUES) {
+		SPDK_ERRLOG("%s: queue_threads (%"PRIu32") exceeds the number of virtqueues (%d)\n",
+			    name, req.queue_threads, SPDK_VHOST_MAX_VQUEUES);
+		ret = -EINVAL;
+		goto out;
+	}
+
 	bvdev = calloc(1, sizeof(*bvdev));
 	if (bvdev == NULL) {
 		ret = -ENOMEM;
@@ -1621,6 +1920,16 @@ spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_
 		goto out;
 	}
 
+	if (req.queue_threads > 0) {
+		ret = vhost_blk_create_queue_threads(bvdev, req.queue_threads);
+		if (ret != 0) {
+			vhost_dev_unregister(vdev);
+			spdk_put_io_channel(bvdev->dummy_io_channel);
+			spdk_bdev_close(bvdev->bdev_desc);
+			goto out;
+		}
+	}
+
 	SPDK_INFOLOG(vhost, "%s: using bdev '%s'\n", name, dev_name);
 out:
 	if (ret != 0 && bvdev) {
@@ -1643,6 +1952,8 @@ vhost_blk_destroy(struct spdk_vhost_dev *vdev)
 		return rc;
 	}
 
+	vhost_blk_destroy_queue_threads(bvdev);
+
 	/* if the bdev is removed, don't need call spdk_put_io_channel. */
 	if (bvdev->bdev) {
 		spdk_put_io_channel(bvdev->dummy_io_channel);
@@ -69,6 +69,17 @@
  */
 #define SPDK_VHOST_COALESCING_DELAY_BASE_US 0
 
+/*
+ * Number of completions adaptive coalescing aims to report with each interrupt.
+ */
+#define SPDK_VHOST_ADAPTIVE_COALESCING_BATCH 8
+
+/*
+ * Adaptive coalescing backs off when its delay merges fewer completions
+ * than this into each interrupt.
+ */
+#define SPDK_VHOST_ADAPTIVE_COALESCING_MIN_BATCH 2
+
 #define SPDK_VHOST_FEATURES ((1ULL << VHOST_F_LOG_ALL) | \
 	(1ULL << VHOST_USER_F_PROTOCOL_FEATURES) | \
 	(1ULL << VIRTIO_F_VERSION_1) | \
@@ -121,12 +132,28 @@ struct spdk_vhost_virtqueue {
 	/* Next time when we need to send event */
 	uint64_t next_event_time;
 
+	/* Next time when stats for event coalescing will be checked. */
+	uint64_t next_stats_check_time;
+
+	/* Interrupts sent since last stats check */
+	uint32_t interval_irq_cnt;
+
+	/* used_req_cnt when the interrupt was last held back */
+	uint16_t deferred_req_cnt;
+
+	/* Interrupts sent to and held back from the guest */
+	uint64_t irq_cnt;
+	uint64_t irq_saved;
+
 	/* Associated vhost_virtqueue in the virtio device's virtqueue list */
 	uint32_t vring_idx;
 
 	struct spdk_vhost_session *vsession;
 
 	struct spdk_interrupt *intr;
+
+	/* Set when the thread polling this virtqueue relies on kickfd notifications. */
+	bool interrupt_mode;
 } __attribute((aligned(SPDK_CACHE_LINE_SIZE)));
 
 struct spdk_vhost_session {
@@ -144,7 +171,6 @@ struct spdk_vhost_session {
 	bool started;
 	bool needs_restart;
 	bool forced_polling;
-	bool interrupt_mode;
 
 	struct rte_vhost_memory *mem;
 
@@ -157,9 +183,11 @@ struct spdk_vhost_session {
 	/* Local copy of device coalescing settings. */
 	uint32_t coalescing_delay_time_base;
 	uint32_t coalescing_io_rate_threshold;
+	bool coalescing_adaptive;
 
-	/* Next time when stats for event coalescing will be checked. */
-	uint64_t next_stats_check_time;
+	/* Interrupt counters of the virtqueues before the last restart */
+	uint64_t irq_cnt;
+	uint64_t irq_saved;
 
 	/* Interval used for event coalescing checking. */
 	uint64_t stats_check_interval;
@@ -182,6 +210,7 @@ struct spdk_vhost_user_dev {
 	 */
 	uint32_t coalescing_delay_us;
 	uint32_t coalescing_iops_threshold;
+	bool coalescing_adaptive;
 
 	/* Current connections to the device */
 	TAILQ_HEAD(, spdk_vhost_session) vsessions;
@@ -422,10 +451,10 @@ int vhost_dev_unregister(struct spdk_vhost_dev *vdev);
 void vhost_dump_info_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *w);
 
 /*
- * Set vhost session to run in interrupt or poll mode
+ * Set a single virtqueue to run in interrupt or poll mode. Must be called
+ * from the thread that polls this virtqueue.
  */
-void vhost_user_session_set_interrupt_mode(struct spdk_vhost_session *vsession,
-		bool interrupt_mode);
+void vhost_user_vq_set_interrupt_mode(struct spdk_vhost_virtqueue *vq, bool interrupt_mode);
 
 /*
  * Memory registration functions used in start/stop device callbacks
@@ -518,6 +547,8 @@ int vhost_user_session_set_coalescing(struct spdk_vhost_dev *dev,
 				      struct spdk_vhost_session *vsession, void *ctx);
 int vhost_user_dev_set_coalescing(struct spdk_vhost_user_dev *user_dev, uint32_t delay_base_us,
 				  uint32_t iops_threshold);
+void vhost_user_dev_get_irq_stats(struct spdk_vhost_dev *vdev, uint64_t *irq_cnt,
+				  uint64_t *irq_saved);
 int vhost_user_dev_register(struct spdk_vhost_dev *vdev, const char *name,
 			    struct spdk_cpuset *cpumask, const struct spdk_vhost_user_dev_backend *user_backend);
 int vhost_user_dev_unregister(struct spdk_vhost_dev *vdev);
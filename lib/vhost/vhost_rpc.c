@@ -351,8 +351,10 @@ static void
 _rpc_get_vhost_controller(struct spdk_json_write_ctx *w, struct spdk_vhost_dev *vdev)
 {
 	uint32_t delay_base_us, iops_threshold;
+	uint64_t irq_cnt, irq_saved;
 
 	spdk_vhost_get_coalescing(vdev, &delay_base_us, &iops_threshold);
+	vhost_user_dev_get_irq_stats(vdev, &irq_cnt, &irq_saved);
 
 	spdk_json_write_object_begin(w);
 
@@ -361,6 +363,9 @@ _rpc_get_vhost_controller(struct spdk_json_write_ctx *w, struct spdk_vhost_dev *
 					 spdk_cpuset_fmt(spdk_thread_get_cpumask(vdev->thread)));
 	spdk_json_write_named_uint32(w, "delay_base_us", delay_base_us);
 	spdk_json_write_named_uint32(w, "iops_threshold", iops_threshold);
+	spdk_json_write_named_bool(w, "adaptive_coalescing", spdk_vhost_get_adaptive_coalescing(vdev));
+	spdk_json_write_named_uint64(w, "interrupts_sent", irq_cnt);
+	spdk_json_write_named_uint64(w, "interrupts_saved", irq_saved);
 	spdk_json_write_named_string(w, "socket", vdev->path);
 
 	spdk_json_write_named_object_begin(w, "backend_specific");
@@ -447,12 +452,14 @@ struct rpc_vhost_ctrlr_coalescing {
 	char *ctrlr;
 	uint32_t delay_base_us;
 	uint32_t iops_threshold;
+	bool adaptive;
 };
 
 static const struct spdk_json_object_decoder rpc_set_vhost_ctrlr_coalescing[] = {
 	{"ctrlr", offsetof(struct rpc_vhost_ctrlr_coalescing, ctrlr), spdk_json_decode_string },
 	{"delay_base_us", offsetof(struct rpc_vhost_ctrlr_coalescing, delay_base_us), spdk_json_decode_uint32},
 	{"iops_threshold", offsetof(struct rpc_vhost_ctrlr_coalescing, iops_threshold), spdk_json_decode_uint32},
+	{"adaptive", offsetof(struct rpc_vhost_ctrlr_coalescing, adaptive), spdk_json_decode_bool, true},
 };
 
 static void
@@ -476,6 +483,13 @@ rpc_vhost_controller_set_coalescing(struct spdk_jsonrpc_request *request,
 		goto invalid;
 	}
 
+	/* Adaptive coalescing caps the delay at delay_base_us, so it needs one */
+	if (req.adaptive && req.delay_base_us == 0) {
+		SPDK_ERRLOG("adaptive coalescing requires a non-zero delay_base_us\n");
+		rc = -EINVAL;
+		goto invalid;
+	}
+
 	spdk_vhost_lock();
 	vdev = spdk_vhost_dev_find(req.ctrlr);
 	if (vdev == NULL) {
@@ -485,6 +499,9 @@ rpc_vhost_controller_set_coalescing(struct spdk_jsonrpc_request *request,
 	}
 
 	rc = spdk_vhost_set_coalescing(vdev, req.delay_base_us, req.iops_threshold);
+	if (rc == 0) {
+		spdk_vhost_set_adaptive_coalescing(vdev, req.adaptive);
+	}
 	spdk_vhost_unlock();
 	if (rc) {
 		goto invalid;
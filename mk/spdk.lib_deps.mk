@@ -72,7 +72,7 @@ DEPDIRS-nvme += vfio_user
 endif
 
 DEPDIRS-blob := log util thread
-DEPDIRS-accel := log util thread json
+DEPDIRS-accel := log util thread $(JSON_LIBS)
 DEPDIRS-jsonrpc := log util json
 DEPDIRS-virtio := log util json thread
 
@@ -146,7 +146,7 @@ DEPDIRS-bdev_rpc := $(BDEV_DEPS)
 DEPDIRS-bdev_split := $(BDEV_DEPS)
 
 DEPDIRS-bdev_aio := $(BDEV_DEPS_THREAD)
-DEPDIRS-bdev_compress := $(BDEV_DEPS_THREAD) reduce
+DEPDIRS-bdev_compress := $(BDEV_DEPS_THREAD) reduce accel
 DEPDIRS-bdev_crypto := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_delay := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_iscsi := $(BDEV_DEPS_THREAD)
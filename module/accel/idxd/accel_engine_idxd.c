@@ -130,7 +130,7 @@ static void
 idxd_done(void *cb_arg, int status)
 {
 	struct spdk_accel_task *accel_task = cb_arg;
-	struct idxd_io_channel *chan = spdk_io_channel_get_ctx(accel_task->accel_ch->engine_ch);
+	struct idxd_io_channel *chan = spdk_io_channel_get_ctx(accel_task->hw_ch->ch);
 
 	assert(chan->num_outstanding > 0);
 	spdk_trace_record(TRACE_IDXD_OP_COMPLETE, 0, 0, 0, chan->num_outstanding - 1);
@@ -302,7 +302,7 @@ idxd_poll(void *arg)
 
 			TAILQ_INIT(&chan->queued_tasks);
 
-			idxd_submit_tasks(task->accel_ch->engine_ch, task);
+			idxd_submit_tasks(spdk_io_channel_from_ctx(chan), task);
 		}
 	}
 
@@ -332,6 +332,7 @@ idxd_supports_opcode(enum accel_opcode opc)
 }
 
 static struct spdk_accel_engine idxd_accel_engine = {
+	.name			= "idxd",
 	.supports_opcode	= idxd_supports_opcode,
 	.get_io_channel		= idxd_get_io_channel,
 	.submit_tasks		= idxd_submit_tasks,
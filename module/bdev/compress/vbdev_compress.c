@@ -36,6 +36,7 @@
 
 #include "spdk/reduce.h"
 #include "spdk/stdinc.h"
+#include "spdk/accel_engine.h"
 #include "spdk/rpc.h"
 #include "spdk/env.h"
 #include "spdk/endian.h"
@@ -72,10 +73,13 @@ static int g_mbuf_offset;
 #define CHUNK_SIZE (1024 * 16)
 #define COMP_BDEV_NAME "compress"
 #define BACKING_IO_SZ (4 * 1024)
+/* How often packed volumes are compacted. */
+#define COMPACT_PERIOD_US (10 * 1000 * 1000)
 
 #define ISAL_PMD "compress_isal"
 #define QAT_PMD "compress_qat"
 #define MLX5_PMD "mlx5_pci"
+#define ACCEL_PMD "accel"
 #define NUM_MBUFS		8192
 #define POOL_CACHE_SIZE		256
 
@@ -134,12 +138,19 @@ struct vbdev_compress {
 	struct spdk_bdev		comp_bdev;	/* the compression virtual bdev */
 	struct comp_io_channel		*comp_ch;	/* channel associated with this bdev */
 	char				*drv_name;	/* name of the compression device driver */
+	bool				use_accel;	/* compress through the accel framework */
+	struct spdk_io_channel		*accel_channel;	/* accel channel on the reduce thread */
 	struct comp_device_qp		*device_qp;
 	struct spdk_thread		*reduce_thread;
 	pthread_mutex_t			reduce_lock;
 	uint32_t			ch_count;
 	TAILQ_HEAD(, spdk_bdev_io)	pending_comp_ios;	/* outstanding operations to a comp library */
 	struct spdk_poller		*poller;	/* completion poller */
+	struct spdk_poller		*compact_poller;	/* compacts packed volumes */
+	struct spdk_io_channel		*compact_ch;	/* held while compacting */
+	bool				compacting;
+	bool				unloading;
+	spdk_reduce_vol_op_complete	unload_cb_fn;	/* unload deferred until compaction ends */
 	struct spdk_reduce_vol_params	params;		/* params for the reduce volume */
 	struct spdk_reduce_backing_dev	backing_dev;	/* backing device info for the reduce volume */
 	struct spdk_reduce_vol		*vol;		/* the reduce volume */
@@ -528,6 +539,70 @@ _setup_compress_mbuf(struct rte_mbuf **mbufs, int *mbuf_total, uint64_t *total_l
 	return 0;
 }
 
+static int _compress_operation(struct spdk_reduce_backing_dev *backing_dev,
+			       struct iovec *src_iovs, int src_iovcnt, struct iovec *dst_iovs,
+			       int dst_iovcnt, bool compress, void *cb_arg);
+
+static void
+_resubmit_queued_comp_op(struct vbdev_compress *comp_bdev)
+{
+	struct vbdev_comp_op *op_to_resubmit;
+	int rc;
+
+	/* Check if there are any pending comp ops to process, only pull one
+	 * at a time off as _compress_operation() may re-queue the op.
+	 */
+	if (!TAILQ_EMPTY(&comp_bdev->queued_comp_ops)) {
+		op_to_resubmit = TAILQ_FIRST(&comp_bdev->queued_comp_ops);
+		rc = _compress_operation(op_to_resubmit->backing_dev,
+					 op_to_resubmit->src_iovs,
+					 op_to_resubmit->src_iovcnt,
+					 op_to_resubmit->dst_iovs,
+					 op_to_resubmit->dst_iovcnt,
+					 op_to_resubmit->compress,
+					 op_to_resubmit->cb_arg);
+		if (rc == 0) {
+			TAILQ_REMOVE(&comp_bdev->queued_comp_ops, op_to_resubmit, link);
+			free(op_to_resubmit);
+		}
+	}
+}
+
+static void
+_accel_comp_op_done(void *ref, int status)
+{
+	struct spdk_reduce_vol_cb_args *reduce_args = ref;
+
+	if (status == 0) {
+		/* tell reduce this is done and what the bytecount was */
+		reduce_args->cb_fn(reduce_args->cb_arg, reduce_args->output_size);
+	} else {
+		SPDK_NOTICELOG("FYI storing data uncompressed due to accel status %d\n", status);
+
+		/* Reduce will simply store uncompressed on neg errno value. */
+		reduce_args->cb_fn(reduce_args->cb_arg, -EINVAL);
+	}
+}
+
+/* Submit a (de)compress operation to the accel framework.  Unlike the compressdev
+ * PMDs, accel takes the iovecs directly so no mbufs are needed.
+ */
+static int
+_accel_compress_operation(struct vbdev_compress *comp_bdev, struct iovec *src_iovs,
+			  int src_iovcnt, struct iovec *dst_iovs, int dst_iovcnt, bool compress,
+			  struct spdk_reduce_vol_cb_args *reduce_args)
+{
+	if (compress) {
+		return spdk_accel_submit_compress(comp_bdev->accel_channel, dst_iovs, dst_iovcnt,
+						  src_iovs, src_iovcnt, &reduce_args->output_size, 0,
+						  _accel_comp_op_done, reduce_args);
+	} else {
+		return spdk_accel_submit_decompress(comp_bdev->accel_channel, dst_iovs, dst_iovcnt,
+						    src_iovs, src_iovcnt, &reduce_args->output_size, 0,
+						    _accel_comp_op_done, reduce_args);
+	}
+}
+
 static int
 _compress_operation(struct spdk_reduce_backing_dev *backing_dev, struct iovec *src_iovs,
 		    int src_iovcnt, struct iovec *dst_iovs,
@@ -539,7 +614,7 @@ _compress_operation(struct spdk_reduce_backing_dev *backing_dev, struct iovec *s
 	struct rte_comp_op *comp_op;
 	struct rte_mbuf *src_mbufs[MAX_MBUFS_PER_OP];
 	struct rte_mbuf *dst_mbufs[MAX_MBUFS_PER_OP];
-	uint8_t cdev_id = comp_bdev->device_qp->device->cdev_id;
+	uint8_t cdev_id;
 	uint64_t total_length = 0;
 	int rc = 0;
 	struct vbdev_comp_op *op_to_queue;
@@ -547,6 +622,16 @@ _compress_operation(struct spdk_reduce_backing_dev *backing_dev, struct iovec *s
 	int dst_mbuf_total = dst_iovcnt;
 	bool device_error = false;
 
+	if (comp_bdev->use_accel) {
+		rc = _accel_compress_operation(comp_bdev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt,
+					       compress, reduce_cb_arg);
+		if (rc != -ENOMEM) {
+			return rc;
+		}
+		goto queue_op;
+	}
+
+	cdev_id = comp_bdev->device_qp->device->cdev_id;
 	assert(src_iovcnt < MAX_MBUFS_PER_OP);
 
 #ifdef DEBUG
@@ -663,6 +748,7 @@ error_get_op:
 		return rc;
 	}
 
+queue_op:
 	op_to_queue = calloc(1, sizeof(struct vbdev_comp_op));
 	if (op_to_queue == NULL) {
 		SPDK_ERRLOG("unable to allocate operation for queueing.\n");
@@ -690,8 +776,7 @@ comp_dev_poller(void *args)
 	struct rte_comp_op *deq_ops[NUM_MAX_INFLIGHT_OPS];
 	uint16_t num_deq;
 	struct spdk_reduce_vol_cb_args *reduce_args;
-	struct vbdev_comp_op *op_to_resubmit;
-	int rc, i;
+	int i;
 
 	num_deq = rte_compressdev_dequeue_burst(cdev_id, comp_bdev->device_qp->qp, deq_ops,
 						NUM_MAX_INFLIGHT_OPS);
@@ -723,27 +808,27 @@ comp_dev_poller(void *args)
 		 */
 		rte_comp_op_free(deq_ops[i]);
 
-		/* Check if there are any pending comp ops to process, only pull one
-		 * at a time off as _compress_operation() may re-queue the op.
-		 */
-		if (!TAILQ_EMPTY(&comp_bdev->queued_comp_ops)) {
-			op_to_resubmit = TAILQ_FIRST(&comp_bdev->queued_comp_ops);
-			rc = _compress_operation(op_to_resubmit->backing_dev,
-						 op_to_resubmit->src_iovs,
-						 op_to_resubmit->src_iovcnt,
-						 op_to_resubmit->dst_iovs,
-						 op_to_resubmit->dst_iovcnt,
-						 op_to_resubmit->compress,
-						 op_to_resubmit->cb_arg);
-			if (rc == 0) {
-				TAILQ_REMOVE(&comp_bdev->queued_comp_ops, op_to_resubmit, link);
-				free(op_to_resubmit);
-			}
-		}
+		_resubmit_queued_comp_op(comp_bdev);
 	}
 	return num_deq == 0 ? SPDK_POLLER_IDLE : SPDK_POLLER_BUSY;
 }
 
+/* Poller used instead of comp_dev_poller() when compressing through accel.  Accel
+ * completes operations through their callbacks, so only the queued ones are left.
+ */
+static int
+comp_accel_poller(void *args)
+{
+	struct vbdev_compress *comp_bdev = args;
+
+	if (TAILQ_EMPTY(&comp_bdev->queued_comp_ops)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	_resubmit_queued_comp_op(comp_bdev);
+	return SPDK_POLLER_BUSY;
+}
+
 /* Entry point for reduce lib to issue a compress operation. */
 static void
 _comp_reduce_compress(struct spdk_reduce_backing_dev *dev,
@@ -932,6 +1017,78 @@ _device_unregister_cb(void *io_device)
 	free(comp_bdev);
 }
 
+static void
+_vbdev_compress_unload_deferred(void *ctx)
+{
+	struct vbdev_compress *comp_bdev = ctx;
+
+	spdk_reduce_vol_unload(comp_bdev->vol, comp_bdev->unload_cb_fn, comp_bdev);
+}
+
+static void
+vbdev_compress_compact_cb(void *cb_arg, int reduce_errno)
+{
+	struct vbdev_compress *comp_bdev = cb_arg;
+	bool unloading;
+
+	if (reduce_errno) {
+		SPDK_ERRLOG("compaction of %s failed: %d\n", comp_bdev->comp_bdev.name,
+			    reduce_errno);
+	}
+
+	spdk_put_io_channel(comp_bdev->compact_ch);
+	comp_bdev->compact_ch = NULL;
+
+	pthread_mutex_lock(&comp_bdev->reduce_lock);
+	comp_bdev->compacting = false;
+	unloading = comp_bdev->unloading;
+	pthread_mutex_unlock(&comp_bdev->reduce_lock);
+
+	if (unloading) {
+		spdk_thread_send_msg(comp_bdev->thread, _vbdev_compress_unload_deferred, comp_bdev);
+	}
+}
+
+/* Runs on the reduce thread while there are channels, see comp_bdev_ch_create_cb(). */
+static int
+comp_compact_poller(void *arg)
+{
+	struct vbdev_compress *comp_bdev = arg;
+
+	pthread_mutex_lock(&comp_bdev->reduce_lock);
+	if (comp_bdev->compacting || comp_bdev->unloading || comp_bdev->vol == NULL) {
+		pthread_mutex_unlock(&comp_bdev->reduce_lock);
+		return SPDK_POLLER_IDLE;
+	}
+	comp_bdev->compacting = true;
+	pthread_mutex_unlock(&comp_bdev->reduce_lock);
+
+	/* Keep our channel, and with it the reduce thread and base channel, until we're done. */
+	comp_bdev->compact_ch = spdk_get_io_channel(comp_bdev);
+	spdk_reduce_vol_compact(comp_bdev->vol, vbdev_compress_compact_cb, comp_bdev);
+
+	return SPDK_POLLER_BUSY;
+}
+
+/* Unload the volume, after the compaction in progress if there is one. */
+static void
+vbdev_compress_unload_vol(struct vbdev_compress *comp_bdev, spdk_reduce_vol_op_complete cb_fn)
+{
+	bool compacting;
+
+	pthread_mutex_lock(&comp_bdev->reduce_lock);
+	comp_bdev->unloading = true;
+	compacting = comp_bdev->compacting;
+	if (compacting) {
+		comp_bdev->unload_cb_fn = cb_fn;
+	}
+	pthread_mutex_unlock(&comp_bdev->reduce_lock);
+
+	if (!compacting) {
+		spdk_reduce_vol_unload(comp_bdev->vol, cb_fn, comp_bdev);
+	}
+}
+
 static void
 _vbdev_compress_destruct_cb(void *ctx)
 {
@@ -1076,7 +1233,7 @@ vbdev_compress_destruct(void *ctx)
 
 	if (comp_bdev->vol != NULL) {
 		/* Tell reducelib that we're done with this volume. */
-		spdk_reduce_vol_unload(comp_bdev->vol, vbdev_compress_destruct_cb, comp_bdev);
+		vbdev_compress_unload_vol(comp_bdev, vbdev_compress_destruct_cb);
 	} else {
 		vbdev_compress_destruct_cb(comp_bdev, 0);
 	}
@@ -1112,6 +1269,7 @@ vbdev_compress_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&comp_bdev->comp_bdev));
 	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(comp_bdev->base_bdev));
 	spdk_json_write_named_string(w, "compression_pmd", comp_bdev->drv_name);
+	spdk_json_write_named_bool(w, "packed", comp_bdev->params.packed);
 	spdk_json_write_object_end(w);
 
 	return 0;
@@ -1302,7 +1460,7 @@ vbdev_compress_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
 	TAILQ_FOREACH_SAFE(comp_bdev, &g_vbdev_comp, link, tmp) {
 		if (bdev_find == comp_bdev->base_bdev) {
 			/* Tell reduceLib that we're done with this volume. */
-			spdk_reduce_vol_unload(comp_bdev->vol, bdev_hotremove_vol_unload_cb, comp_bdev);
+			vbdev_compress_unload_vol(comp_bdev, bdev_hotremove_vol_unload_cb);
 		}
 	}
 }
@@ -1372,7 +1530,11 @@ _prepare_for_load_init(struct spdk_bdev_desc *bdev_desc, uint32_t lb_size)
 static bool
 _set_pmd(struct vbdev_compress *comp_dev)
 {
-	if (g_opts == COMPRESS_PMD_AUTO) {
+	comp_dev->use_accel = false;
+	if (g_opts == COMPRESS_PMD_ACCEL) {
+		comp_dev->drv_name = ACCEL_PMD;
+		comp_dev->use_accel = true;
+	} else if (g_opts == COMPRESS_PMD_AUTO) {
 		if (g_qat_available) {
 			comp_dev->drv_name = QAT_PMD;
 		} else if (g_mlx5_pci_available) {
@@ -1396,7 +1558,7 @@ _set_pmd(struct vbdev_compress *comp_dev)
 
 /* Call reducelib to initialize a new volume */
 static int
-vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size)
+vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size, bool packed)
 {
 	struct spdk_bdev_desc *bdev_desc = NULL;
 	struct vbdev_compress *meta_ctx;
@@ -1414,6 +1576,7 @@ vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size)
 		spdk_bdev_close(bdev_desc);
 		return -EINVAL;
 	}
+	meta_ctx->params.packed = packed;
 
 	if (_set_pmd(meta_ctx) == false) {
 		SPDK_ERRLOG("could not find required pmd\n");
@@ -1434,6 +1597,31 @@ vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size)
 	return 0;
 }
 
+/* Assign a q pair of the selected PMD to the comp_bdev, preferring one already used
+ * on this thread.
+ */
+static void
+comp_bdev_assign_qp(struct vbdev_compress *comp_bdev)
+{
+	struct comp_device_qp *device_qp;
+
+	pthread_mutex_lock(&g_comp_device_qp_lock);
+	TAILQ_FOREACH(device_qp, &g_comp_device_qp, link) {
+		if (strcmp(device_qp->device->cdev_info.driver_name, comp_bdev->drv_name) == 0) {
+			if (device_qp->thread == spdk_get_thread()) {
+				comp_bdev->device_qp = device_qp;
+				break;
+			}
+			if (device_qp->thread == NULL) {
+				comp_bdev->device_qp = device_qp;
+				device_qp->thread = spdk_get_thread();
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&g_comp_device_qp_lock);
+}
+
 /* We provide this callback for the SPDK channel code to create a channel using
  * the channel struct we provided in our module get_io_channel() entry point. Here
  * we get and save off an underlying base channel of the device below us so that
@@ -1444,7 +1632,6 @@ static int
 comp_bdev_ch_create_cb(void *io_device, void *ctx_buf)
 {
 	struct vbdev_compress *comp_bdev = io_device;
-	struct comp_device_qp *device_qp;
 
 	/* Now set the reduce channel if it's not already set. */
 	pthread_mutex_lock(&comp_bdev->reduce_lock);
@@ -1457,27 +1644,33 @@ comp_bdev_ch_create_cb(void *io_device, void *ctx_buf)
 
 		comp_bdev->base_ch = spdk_bdev_get_io_channel(comp_bdev->base_desc);
 		comp_bdev->reduce_thread = spdk_get_thread();
-		comp_bdev->poller = SPDK_POLLER_REGISTER(comp_dev_poller, comp_bdev, 0);
-		/* Now assign a q pair */
-		pthread_mutex_lock(&g_comp_device_qp_lock);
-		TAILQ_FOREACH(device_qp, &g_comp_device_qp, link) {
-			if (strcmp(device_qp->device->cdev_info.driver_name, comp_bdev->drv_name) == 0) {
-				if (device_qp->thread == spdk_get_thread()) {
-					comp_bdev->device_qp = device_qp;
-					break;
-				}
-				if (device_qp->thread == NULL) {
-					comp_bdev->device_qp = device_qp;
-					device_qp->thread = spdk_get_thread();
-					break;
-				}
-			}
+		if (comp_bdev->use_accel) {
+			/* Operations go to the accel framework, no q pair is needed. */
+			comp_bdev->accel_channel = spdk_accel_engine_get_io_channel();
+			comp_bdev->poller = SPDK_POLLER_REGISTER(comp_accel_poller, comp_bdev, 0);
+		} else {
+			comp_bdev->poller = SPDK_POLLER_REGISTER(comp_dev_poller, comp_bdev, 0);
+			comp_bdev_assign_qp(comp_bdev);
+		}
+		if (comp_bdev->params.packed) {
+			comp_bdev->compact_poller = SPDK_POLLER_REGISTER(comp_compact_poller,
+						    comp_bdev, COMPACT_PERIOD_US);
 		}
-		pthread_mutex_unlock(&g_comp_device_qp_lock);
 	}
 	comp_bdev->ch_count++;
 	pthread_mutex_unlock(&comp_bdev->reduce_lock);
 
+	if (comp_bdev->use_accel) {
+		if (comp_bdev->accel_channel == NULL) {
+			SPDK_ERRLOG("could not get accel channel for comp_bdev %p\n", comp_bdev);
+			return -ENOMEM;
+		}
+		/* Accel takes iovecs on both sides of an operation. */
+		comp_bdev->backing_dev.sgl_in = true;
+		comp_bdev->backing_dev.sgl_out = true;
+		return 0;
+	}
+
 	if (comp_bdev->device_qp != NULL) {
 		uint64_t comp_feature_flags =
 			comp_bdev->device_qp->device->cdev_info.capabilities[RTE_COMP_ALGO_DEFLATE].comp_feature_flags;
@@ -1504,8 +1697,13 @@ _channel_cleanup(struct vbdev_compress *comp_bdev)
 	 * alone for this comp_bdev and just clear the reduce thread.
 	 */
 	spdk_put_io_channel(comp_bdev->base_ch);
+	if (comp_bdev->accel_channel != NULL) {
+		spdk_put_io_channel(comp_bdev->accel_channel);
+		comp_bdev->accel_channel = NULL;
+	}
 	comp_bdev->reduce_thread = NULL;
 	spdk_poller_unregister(&comp_bdev->poller);
+	spdk_poller_unregister(&comp_bdev->compact_poller);
 }
 
 /* Used to reroute destroy_ch to the correct thread */
@@ -1544,7 +1742,7 @@ comp_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
 
 /* RPC entry point for compression vbdev creation. */
 int
-create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size)
+create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size, bool packed)
 {
 	struct vbdev_compress *comp_bdev = NULL;
 
@@ -1559,7 +1757,7 @@ create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_siz
 			return -EBUSY;
 		}
 	}
-	return vbdev_init_reduce(bdev_name, pm_path, lb_size);
+	return vbdev_init_reduce(bdev_name, pm_path, lb_size, packed);
 }
 
 /* On init, just init the compress drivers. All metadata is stored on disk. */
@@ -1671,7 +1869,11 @@ vbdev_compress_claim(struct vbdev_compress *comp_bdev)
 	comp_bdev->comp_bdev.optimal_io_boundary =
 		comp_bdev->params.chunk_size / comp_bdev->params.logical_block_size;
 
-	comp_bdev->comp_bdev.split_on_optimal_io_boundary = true;
+	/* reducelib splits I/O spanning several chunks itself and works on the chunks in
+	 *  parallel, holding chunks back while it's out of requests, so only its iovec limit
+	 *  has to be enforced here.
+	 */
+	comp_bdev->comp_bdev.max_num_segments = REDUCE_MAX_IOVECS;
 
 	comp_bdev->comp_bdev.blocklen = comp_bdev->params.logical_block_size;
 	comp_bdev->comp_bdev.blockcnt = comp_bdev->params.vol_size / comp_bdev->comp_bdev.blocklen;
@@ -1778,7 +1980,7 @@ bdev_compress_delete(const char *name, spdk_delete_compress_complete cb_fn, void
 
 	/* Tell reducelib that we're done with this volume. */
 	if (comp_bdev->orphaned == false) {
-		spdk_reduce_vol_unload(comp_bdev->vol, delete_vol_unload_cb, comp_bdev);
+		vbdev_compress_unload_vol(comp_bdev, delete_vol_unload_cb);
 	} else {
 		delete_vol_unload_cb(comp_bdev, 0);
 	}
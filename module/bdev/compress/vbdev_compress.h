@@ -78,6 +78,7 @@ enum compress_pmd {
 	COMPRESS_PMD_QAT_ONLY,
 	COMPRESS_PMD_ISAL_ONLY,
 	COMPRESS_PMD_MLX5_PCI_ONLY,
+	COMPRESS_PMD_ACCEL,
 	COMPRESS_PMD_MAX
 };
 
@@ -89,11 +90,15 @@ typedef void (*spdk_delete_compress_complete)(void *cb_arg, int bdeverrno);
  * Create new compression bdev.
  *
  * \param bdev_name Bdev on which compression bdev will be created.
- * \param pm_path Path to persistent memory.
+ * \param pm_path Path to persistent memory.  If NULL, the metadata is kept in DRAM and
+ *  journaled on the base bdev instead.
  * \param lb_size Logical block size for the compressed volume in bytes. Must be 4K or 512.
+ * \param packed Pack the tails of compressed chunks into shared backing io units.  Packed
+ *  volumes are compacted periodically to free sparsely used io units.
  * \return 0 on success, other on failure.
  */
-int create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size);
+int create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size,
+			 bool packed);
 
 /**
  * Delete compress bdev.
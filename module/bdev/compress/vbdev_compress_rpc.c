@@ -146,6 +146,7 @@ struct rpc_construct_compress {
 	char *base_bdev_name;
 	char *pm_path;
 	uint32_t lb_size;
+	bool packed;
 };
 
 /* Free the allocated memory resource after the RPC handling. */
@@ -159,8 +160,9 @@ free_rpc_construct_compress(struct rpc_construct_compress *r)
 /* Structure to decode the input parameters for this RPC method. */
 static const struct spdk_json_object_decoder rpc_construct_compress_decoders[] = {
 	{"base_bdev_name", offsetof(struct rpc_construct_compress, base_bdev_name), spdk_json_decode_string},
-	{"pm_path", offsetof(struct rpc_construct_compress, pm_path), spdk_json_decode_string},
+	{"pm_path", offsetof(struct rpc_construct_compress, pm_path), spdk_json_decode_string, true},
 	{"lb_size", offsetof(struct rpc_construct_compress, lb_size), spdk_json_decode_uint32},
+	{"packed", offsetof(struct rpc_construct_compress, packed), spdk_json_decode_bool, true},
 };
 
 /* Decode the parameters for this RPC method and properly construct the compress
@@ -184,7 +186,7 @@ rpc_bdev_compress_create(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
-	rc = create_compress_bdev(req.base_bdev_name, req.pm_path, req.lb_size);
+	rc = create_compress_bdev(req.base_bdev_name, req.pm_path, req.lb_size, req.packed);
 	if (rc != 0) {
 		if (rc == -EBUSY) {
 			spdk_jsonrpc_send_error_response(request, rc, "Base bdev already in use for compression.");
@@ -220,9 +220,82 @@ end:
 	return;
 }
 
+static void
+vbdev_lvol_esnap_remove_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_lvol *lvol = cb_arg;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Cannot detach external snapshot of lvol %s: %s\n", lvol->unique_id,
+			    spdk_strerror(-bserrno));
+	}
+}
+
+static void
+vbdev_lvol_esnap_hotremove_cb(struct spdk_lvol_store *lvs, struct spdk_bdev *bdev)
+{
+	char uuid_str[SPDK_UUID_STRING_LEN];
+	struct spdk_lvol *lvol;
+	const void *esnap_id;
+	size_t id_len;
+
+	spdk_uuid_fmt_lower(uuid_str, sizeof(uuid_str), spdk_bdev_get_uuid(bdev));
+
+	/* Every lvol reading from the bdev holds its own descriptor, close all of them,
+	 * so that the removal can complete. The lvols stay open, but degraded. */
+	TAILQ_FOREACH(lvol, &lvs->lvols, link) {
+		if (lvol->blob == NULL ||
+		    spdk_blob_get_esnap_id(lvol->blob, &esnap_id, &id_len) != 0 ||
+		    id_len != sizeof(uuid_str) || memcmp(esnap_id, uuid_str, id_len) != 0) {
+			continue;
+		}
+		spdk_blob_remove_esnap_dev(lvol->blob, vbdev_lvol_esnap_remove_cpl, lvol);
+	}
+}
+
+static void
+vbdev_lvol_esnap_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			  void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_lvol_esnap_hotremove_cb(event_ctx, bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d on external snapshot %s\n", type,
+			       spdk_bdev_get_name(bdev));
+		break;
+	}
+}
+
+static int
+vbdev_lvol_esnap_dev_create(void *bs_ctx, struct spdk_blob *blob, const void *esnap_id,
+			    uint32_t id_len, struct spdk_bs_dev **bs_dev)
+{
+	char uuid_str[SPDK_UUID_STRING_LEN];
+	int rc;
+
+	/* External snapshots are identified by the bdev UUID, stored as a string */
+	if (id_len != SPDK_UUID_STRING_LEN || ((const char *)esnap_id)[id_len - 1] != '\0') {
+		SPDK_ERRLOG("Invalid external snapshot id of length %" PRIu32 "\n", id_len);
+		return -EINVAL;
+	}
+	memcpy(uuid_str, esnap_id, sizeof(uuid_str));
+
+	/* bs_ctx is the lvolstore */
+	rc = spdk_bdev_create_bs_dev_ro(uuid_str, vbdev_lvol_esnap_event_cb, bs_ctx, bs_dev);
+	if (rc != 0) {
+		SPDK_ERRLOG("Cannot open external snapshot bdev %s: %s\n", uuid_str,
+			    spdk_strerror(-rc));
+	}
+
+	return rc;
+}
+
 int
 vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_sz,
-		 enum lvs_clear_method clear_method, spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
+		 enum lvs_clear_method clear_method, uint32_t channel_reserved_clusters,
+		 spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_bs_dev *bs_dev;
 	struct spdk_lvs_with_handle_req *lvs_req;
@@ -244,6 +317,8 @@ vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_
 		opts.clear_method = clear_method;
 	}
 
+	opts.channel_reserved_clusters = channel_reserved_clusters;
+
 	if (name == NULL) {
 		SPDK_ERRLOG("missing name param\n");
 		return -EINVAL;
@@ -256,6 +331,7 @@ vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_
 		return -EINVAL;
 	}
 	snprintf(opts.name, sizeof(opts.name), "%s", name);
+	opts.esnap_bs_dev_create = vbdev_lvol_esnap_dev_create;
 
 	lvs_req = calloc(1, sizeof(*lvs_req));
 	if (!lvs_req) {
@@ -679,6 +755,7 @@ vbdev_lvol_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 	struct lvol_store_bdev *lvs_bdev;
 	struct spdk_bdev *bdev;
 	struct spdk_blob *blob;
+	struct spdk_blob_fragmentation frag;
 	char lvol_store_uuid[SPDK_UUID_STRING_LEN];
 	spdk_blob_id *ids = NULL;
 	size_t count, i;
@@ -705,10 +782,18 @@ vbdev_lvol_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 
 	spdk_json_write_named_bool(w, "thin_provision", spdk_blob_is_thin_provisioned(blob));
 
+	spdk_blob_get_fragmentation(blob, &frag);
+	spdk_json_write_named_uint64(w, "num_allocated_clusters", frag.num_allocated_clusters);
+	spdk_json_write_named_uint64(w, "num_extents", frag.num_extents);
+
 	spdk_json_write_named_bool(w, "snapshot", spdk_blob_is_snapshot(blob));
 
 	spdk_json_write_named_bool(w, "clone", spdk_blob_is_clone(blob));
 
+	spdk_json_write_named_bool(w, "esnap_clone", spdk_blob_is_esnap_clone(blob));
+
+	spdk_json_write_named_bool(w, "degraded", spdk_blob_is_degraded(blob));
+
 	if (spdk_blob_is_clone(blob)) {
 		spdk_blob_id snapshotid = spdk_blob_get_parent_snapshot(lvol->lvol_store->blobstore, lvol->blob_id);
 		if (snapshotid != SPDK_BLOBID_INVALID) {
@@ -1093,6 +1178,176 @@ vbdev_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
 	spdk_lvol_create_clone(lvol, clone_name, _vbdev_lvol_create_cb, req);
 }
 
+int
+vbdev_lvol_create_bdev_clone(const char *esnap_name, struct spdk_lvol_store *lvs,
+			     const char *clone_name, spdk_lvol_op_with_handle_complete cb_fn,
+			     void *cb_arg)
+{
+	struct spdk_lvol_with_handle_req *req;
+	struct spdk_bdev *bdev;
+	char uuid_str[SPDK_UUID_STRING_LEN];
+	uint64_t sz;
+	int rc;
+
+	bdev = spdk_bdev_get_by_name(esnap_name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' could not be opened: does not exist\n", esnap_name);
+		return -ENODEV;
+	}
+
+	sz = spdk_bdev_get_num_blocks(bdev) * spdk_bdev_get_block_size(bdev);
+	if (sz % spdk_bs_get_cluster_size(lvs->blobstore) != 0) {
+		SPDK_ERRLOG("bdev '%s' size %" PRIu64 " is not a multiple of cluster size %" PRIu64 "\n",
+			    esnap_name, sz, spdk_bs_get_cluster_size(lvs->blobstore));
+		return -EINVAL;
+	}
+
+	spdk_uuid_fmt_lower(uuid_str, sizeof(uuid_str), spdk_bdev_get_uuid(bdev));
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		return -ENOMEM;
+	}
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+
+	rc = spdk_lvol_create_esnap_clone(uuid_str, sizeof(uuid_str), sz, lvs, clone_name,
+					  _vbdev_lvol_create_cb, req);
+	if (rc != 0) {
+		free(req);
+	}
+
+	return rc;
+}
+
+struct vbdev_lvol_shallow_copy_req {
+	/* Forwards writes of the copy to ext_dev, until the destination is removed */
+	struct spdk_bs_dev	dev;
+	struct spdk_bs_dev	*ext_dev;
+	bool			removed;
+	spdk_lvol_op_complete	cb_fn;
+	void			*cb_arg;
+};
+
+static void
+vbdev_lvol_shallow_copy_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+		void *event_ctx)
+{
+	struct vbdev_lvol_shallow_copy_req *req = event_ctx;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		/* The copy fails with the next write, then the descriptor is closed */
+		SPDK_NOTICELOG("Shallow copy destination %s removed, failing the copy\n",
+			       spdk_bdev_get_name(bdev));
+		req->removed = true;
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d on shallow copy destination %s\n",
+			       type, spdk_bdev_get_name(bdev));
+		break;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_lvol_shallow_copy_create_channel(struct spdk_bs_dev *dev)
+{
+	struct vbdev_lvol_shallow_copy_req *req;
+
+	req = SPDK_CONTAINEROF(dev, struct vbdev_lvol_shallow_copy_req, dev);
+
+	return req->ext_dev->create_channel(req->ext_dev);
+}
+
+static void
+vbdev_lvol_shallow_copy_destroy_channel(struct spdk_bs_dev *dev, struct spdk_io_channel *channel)
+{
+	struct vbdev_lvol_shallow_copy_req *req;
+
+	req = SPDK_CONTAINEROF(dev, struct vbdev_lvol_shallow_copy_req, dev);
+
+	req->ext_dev->destroy_channel(req->ext_dev, channel);
+}
+
+static void
+vbdev_lvol_shallow_copy_write(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
+			      void *payload, uint64_t lba, uint32_t lba_count,
+			      struct spdk_bs_dev_cb_args *cb_args)
+{
+	struct vbdev_lvol_shallow_copy_req *req;
+
+	req = SPDK_CONTAINEROF(dev, struct vbdev_lvol_shallow_copy_req, dev);
+
+	if (req->removed) {
+		cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -ENODEV);
+		return;
+	}
+
+	req->ext_dev->write(req->ext_dev, channel, payload, lba, lba_count, cb_args);
+}
+
+static void
+vbdev_lvol_shallow_copy_dev_destroy(struct spdk_bs_dev *dev)
+{
+	/* ext_dev is destroyed once the copy completes */
+}
+
+static void
+_vbdev_lvol_shallow_copy_cb(void *cb_arg, int lvolerrno)
+{
+	struct vbdev_lvol_shallow_copy_req *req = cb_arg;
+
+	req->ext_dev->destroy(req->ext_dev);
+	req->cb_fn(req->cb_arg, lvolerrno);
+	free(req);
+}
+
+int
+vbdev_lvol_shallow_copy(struct spdk_lvol *lvol, const char *bdev_name,
+			spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+			spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	struct vbdev_lvol_shallow_copy_req *req;
+	struct spdk_bs_dev *ext_dev;
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_bdev_create_bs_dev_ext(bdev_name, vbdev_lvol_shallow_copy_base_bdev_event_cb,
+					 req, &ext_dev);
+	if (rc != 0) {
+		SPDK_ERRLOG("Cannot create blobstore device for bdev %s\n", bdev_name);
+		free(req);
+		return rc;
+	}
+
+	/* Nothing else may write to the destination while the copy is in progress */
+	rc = spdk_bs_bdev_claim(ext_dev, &g_lvol_if);
+	if (rc != 0) {
+		ext_dev->destroy(ext_dev);
+		free(req);
+		return rc;
+	}
+
+	req->ext_dev = ext_dev;
+	req->dev.blockcnt = ext_dev->blockcnt;
+	req->dev.blocklen = ext_dev->blocklen;
+	req->dev.create_channel = vbdev_lvol_shallow_copy_create_channel;
+	req->dev.destroy_channel = vbdev_lvol_shallow_copy_destroy_channel;
+	req->dev.destroy = vbdev_lvol_shallow_copy_dev_destroy;
+	req->dev.write = vbdev_lvol_shallow_copy_write;
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+
+	spdk_lvol_shallow_copy(lvol, &req->dev, status_cb_fn, status_cb_arg,
+			       _vbdev_lvol_shallow_copy_cb, req);
+
+	return 0;
+}
+
 static void
 _vbdev_lvol_rename_cb(void *cb_arg, int lvolerrno)
 {
@@ -1392,6 +1647,7 @@ vbdev_lvs_examine(struct spdk_bdev *bdev)
 {
 	struct spdk_bs_dev *bs_dev;
 	struct spdk_lvs_with_handle_req *req;
+	struct spdk_lvs_opts opts;
 	int rc;
 
 	req = calloc(1, sizeof(*req));
@@ -1412,7 +1668,10 @@ vbdev_lvs_examine(struct spdk_bdev *bdev)
 
 	req->base_bdev = bdev;
 
-	spdk_lvs_load(bs_dev, _vbdev_lvs_examine_cb, req);
+	spdk_lvs_opts_init(&opts);
+	opts.esnap_bs_dev_create = vbdev_lvol_esnap_dev_create;
+
+	spdk_lvs_load_ext(bs_dev, &opts, _vbdev_lvs_examine_cb, req);
 }
 
 struct spdk_lvol *
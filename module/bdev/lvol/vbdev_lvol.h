@@ -54,7 +54,8 @@ struct lvol_bdev {
 };
 
 int vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_sz,
-		     enum lvs_clear_method clear_method, spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg);
+		     enum lvs_clear_method clear_method, uint32_t channel_reserved_clusters,
+		     spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg);
 void vbdev_lvs_destruct(struct spdk_lvol_store *lvs, spdk_lvs_op_complete cb_fn, void *cb_arg);
 void vbdev_lvs_unload(struct spdk_lvol_store *lvs, spdk_lvs_op_complete cb_fn, void *cb_arg);
 
@@ -69,6 +70,40 @@ void vbdev_lvol_create_snapshot(struct spdk_lvol *lvol, const char *snapshot_nam
 void vbdev_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
 			     spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
 
+/**
+ * \brief Create a clone of a bdev that is not part of the lvolstore
+ *
+ * The bdev is used as a read-only external snapshot of the clone and must
+ * remain present for the lifetime of the clone.
+ *
+ * \param esnap_name Name of the bdev to clone
+ * \param lvs Handle to lvolstore the clone is created in
+ * \param clone_name Name of the clone
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ * \return error
+ */
+int vbdev_lvol_create_bdev_clone(const char *esnap_name, struct spdk_lvol_store *lvs,
+				 const char *clone_name, spdk_lvol_op_with_handle_complete cb_fn,
+				 void *cb_arg);
+
+/**
+ * \brief Copy the clusters allocated by a read-only lvol to a bdev
+ *
+ * The bdev is claimed by the lvol module until the copy completes.
+ *
+ * \param lvol Handle to lvol
+ * \param bdev_name Name of the bdev to copy to
+ * \param status_cb_fn Called each time a cluster has been copied
+ * \param status_cb_arg Argument passed to function status_cb_fn
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ * \return error
+ */
+int vbdev_lvol_shallow_copy(struct spdk_lvol *lvol, const char *bdev_name,
+			    spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+			    spdk_lvol_op_complete cb_fn, void *cb_arg);
+
 /**
  * \brief Change size of lvol
  * \param lvol Handle to lvol
@@ -45,6 +45,7 @@ struct rpc_bdev_lvol_create_lvstore {
 	char *bdev_name;
 	uint32_t cluster_sz;
 	char *clear_method;
+	uint32_t channel_reserved_clusters;
 };
 
 static int
@@ -90,6 +91,7 @@ static const struct spdk_json_object_decoder rpc_bdev_lvol_create_lvstore_decode
 	{"cluster_sz", offsetof(struct rpc_bdev_lvol_create_lvstore, cluster_sz), spdk_json_decode_uint32, true},
 	{"lvs_name", offsetof(struct rpc_bdev_lvol_create_lvstore, lvs_name), spdk_json_decode_string},
 	{"clear_method", offsetof(struct rpc_bdev_lvol_create_lvstore, clear_method), spdk_json_decode_string, true},
+	{"channel_reserved_clusters", offsetof(struct rpc_bdev_lvol_create_lvstore, channel_reserved_clusters), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -148,7 +150,7 @@ rpc_bdev_lvol_create_lvstore(struct spdk_jsonrpc_request *request,
 	}
 
 	rc = vbdev_lvs_create(req.bdev_name, req.lvs_name, req.cluster_sz, clear_method,
-			      rpc_lvol_store_construct_cb, request);
+			      req.channel_reserved_clusters, rpc_lvol_store_construct_cb, request);
 	if (rc < 0) {
 		spdk_jsonrpc_send_error_response(request, -rc, spdk_strerror(rc));
 		goto cleanup;
@@ -553,6 +555,67 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_lvol_clone", rpc_bdev_lvol_clone, SPDK_RPC_RUNTIME)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_lvol_clone, clone_lvol_bdev)
 
+struct rpc_bdev_lvol_clone_bdev {
+	char *bdev_name;
+	char *uuid;
+	char *lvs_name;
+	char *clone_name;
+};
+
+static void
+free_rpc_bdev_lvol_clone_bdev(struct rpc_bdev_lvol_clone_bdev *req)
+{
+	free(req->bdev_name);
+	free(req->uuid);
+	free(req->lvs_name);
+	free(req->clone_name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_clone_bdev_decoders[] = {
+	{"bdev", offsetof(struct rpc_bdev_lvol_clone_bdev, bdev_name), spdk_json_decode_string},
+	{"uuid", offsetof(struct rpc_bdev_lvol_clone_bdev, uuid), spdk_json_decode_string, true},
+	{"lvs_name", offsetof(struct rpc_bdev_lvol_clone_bdev, lvs_name), spdk_json_decode_string, true},
+	{"clone_name", offsetof(struct rpc_bdev_lvol_clone_bdev, clone_name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_lvol_clone_bdev(struct spdk_jsonrpc_request *request,
+			 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_clone_bdev req = {};
+	struct spdk_lvol_store *lvs = NULL;
+	int rc;
+
+	SPDK_INFOLOG(lvol_rpc, "Cloning bdev\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_clone_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_clone_bdev_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = vbdev_get_lvol_store_by_uuid_xor_name(req.uuid, req.lvs_name, &lvs);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	rc = vbdev_lvol_create_bdev_clone(req.bdev_name, lvs, req.clone_name,
+					  rpc_bdev_lvol_clone_cb, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+cleanup:
+	free_rpc_bdev_lvol_clone_bdev(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_clone_bdev", rpc_bdev_lvol_clone_bdev, SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_lvol_rename {
 	char *old_name;
 	char *new_name;
@@ -744,6 +807,437 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_lvol_decouple_parent", rpc_bdev_lvol_decouple_parent, SPDK_RPC_RUNTIME)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_lvol_decouple_parent, decouple_parent_lvol_bdev)
 
+struct rpc_shallow_copy_status {
+	uint32_t				operation_id;
+	bool					done;
+	int					result;
+	uint64_t				copied_clusters;
+	uint64_t				total_clusters;
+	TAILQ_ENTRY(rpc_shallow_copy_status)	link;
+};
+
+/* Finished operations not checked yet are kept up to this many, oldest are dropped first */
+#define RPC_SHALLOW_COPY_MAX_DONE 64
+
+static TAILQ_HEAD(, rpc_shallow_copy_status) g_shallow_copy_status_list = TAILQ_HEAD_INITIALIZER(
+			g_shallow_copy_status_list);
+static uint32_t g_shallow_copy_count;
+static uint32_t g_shallow_copy_done_count;
+
+struct rpc_bdev_lvol_start_shallow_copy {
+	char *src_lvol_name;
+	char *dst_bdev_name;
+};
+
+static void
+free_rpc_bdev_lvol_start_shallow_copy(struct rpc_bdev_lvol_start_shallow_copy *req)
+{
+	free(req->src_lvol_name);
+	free(req->dst_bdev_name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_start_shallow_copy_decoders[] = {
+	{"src_lvol_name", offsetof(struct rpc_bdev_lvol_start_shallow_copy, src_lvol_name), spdk_json_decode_string},
+	{"dst_bdev_name", offsetof(struct rpc_bdev_lvol_start_shallow_copy, dst_bdev_name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_lvol_shallow_copy_status_cb(uint64_t copied_clusters, uint64_t total_clusters,
+				     void *cb_arg)
+{
+	struct rpc_shallow_copy_status *status = cb_arg;
+
+	status->copied_clusters = copied_clusters;
+	status->total_clusters = total_clusters;
+}
+
+static void
+rpc_bdev_lvol_shallow_copy_cb(void *cb_arg, int lvolerrno)
+{
+	struct rpc_shallow_copy_status *status = cb_arg, *tmp;
+
+	status->done = true;
+	status->result = lvolerrno;
+
+	if (++g_shallow_copy_done_count <= RPC_SHALLOW_COPY_MAX_DONE) {
+		return;
+	}
+
+	TAILQ_FOREACH(tmp, &g_shallow_copy_status_list, link) {
+		if (tmp->done) {
+			SPDK_NOTICELOG("Dropping result of shallow copy %" PRIu32 "\n",
+				       tmp->operation_id);
+			TAILQ_REMOVE(&g_shallow_copy_status_list, tmp, link);
+			free(tmp);
+			g_shallow_copy_done_count--;
+			break;
+		}
+	}
+}
+
+static void
+rpc_bdev_lvol_start_shallow_copy(struct spdk_jsonrpc_request *request,
+				 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_start_shallow_copy req = {};
+	struct rpc_shallow_copy_status *status;
+	struct spdk_blob_fragmentation frag;
+	struct spdk_json_write_ctx *w;
+	struct spdk_bdev *bdev;
+	struct spdk_lvol *lvol;
+	int rc;
+
+	SPDK_INFOLOG(lvol_rpc, "Shallow copying lvol\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_start_shallow_copy_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_start_shallow_copy_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.src_lvol_name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.src_lvol_name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	lvol = vbdev_lvol_get_from_bdev(bdev);
+	if (lvol == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	status = calloc(1, sizeof(*status));
+	if (status == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		goto cleanup;
+	}
+
+	spdk_blob_get_fragmentation(lvol->blob, &frag);
+	status->operation_id = ++g_shallow_copy_count;
+	status->total_clusters = frag.num_allocated_clusters;
+	TAILQ_INSERT_TAIL(&g_shallow_copy_status_list, status, link);
+
+	rc = vbdev_lvol_shallow_copy(lvol, req.dst_bdev_name, rpc_bdev_lvol_shallow_copy_status_cb,
+				     status, rpc_bdev_lvol_shallow_copy_cb, status);
+	if (rc != 0) {
+		TAILQ_REMOVE(&g_shallow_copy_status_list, status, link);
+		free(status);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint32(w, "operation_id", status->operation_id);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_lvol_start_shallow_copy(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_start_shallow_copy", rpc_bdev_lvol_start_shallow_copy,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_lvol_check_shallow_copy {
+	uint32_t operation_id;
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_check_shallow_copy_decoders[] = {
+	{"operation_id", offsetof(struct rpc_bdev_lvol_check_shallow_copy, operation_id), spdk_json_decode_uint32},
+};
+
+static void
+rpc_bdev_lvol_check_shallow_copy(struct spdk_jsonrpc_request *request,
+				 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_check_shallow_copy req = {};
+	struct rpc_shallow_copy_status *status;
+	struct spdk_json_write_ctx *w;
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_check_shallow_copy_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_check_shallow_copy_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	TAILQ_FOREACH(status, &g_shallow_copy_status_list, link) {
+		if (status->operation_id == req.operation_id) {
+			break;
+		}
+	}
+
+	if (status == NULL) {
+		SPDK_ERRLOG("shallow copy operation %" PRIu32 " does not exist\n", req.operation_id);
+		spdk_jsonrpc_send_error_response(request, -ENOENT, spdk_strerror(ENOENT));
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	if (!status->done) {
+		spdk_json_write_named_string(w, "state", "in progress");
+	} else if (status->result == 0) {
+		spdk_json_write_named_string(w, "state", "complete");
+	} else {
+		spdk_json_write_named_string(w, "state", "error");
+		spdk_json_write_named_string(w, "error", spdk_strerror(-status->result));
+	}
+	spdk_json_write_named_uint64(w, "copied_clusters", status->copied_clusters);
+	spdk_json_write_named_uint64(w, "total_clusters", status->total_clusters);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+	/* The outcome of a finished operation is reported only once */
+	if (status->done) {
+		TAILQ_REMOVE(&g_shallow_copy_status_list, status, link);
+		free(status);
+		g_shallow_copy_done_count--;
+	}
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_check_shallow_copy", rpc_bdev_lvol_check_shallow_copy,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_lvol_get_changed_clusters {
+	char *name;
+	char *base_name;
+};
+
+static void
+free_rpc_bdev_lvol_get_changed_clusters(struct rpc_bdev_lvol_get_changed_clusters *req)
+{
+	free(req->name);
+	free(req->base_name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_get_changed_clusters_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_lvol_get_changed_clusters, name), spdk_json_decode_string},
+	{"base_name", offsetof(struct rpc_bdev_lvol_get_changed_clusters, base_name), spdk_json_decode_string, true},
+};
+
+struct rpc_changed_clusters_ctx {
+	struct spdk_jsonrpc_request	*request;
+	/* Taken when the call starts, the lvol may go away before it completes */
+	uint64_t			cluster_size;
+	uint64_t			num_clusters;
+	uint64_t			(*extents)[2];
+	uint64_t			num_extents;
+	uint64_t			extents_size;
+	uint64_t			changed_clusters;
+	int				rc;
+};
+
+static void
+rpc_bdev_lvol_changed_clusters_extent_cb(void *cb_arg, uint64_t start_cluster,
+		uint64_t num_clusters)
+{
+	struct rpc_changed_clusters_ctx *ctx = cb_arg;
+	uint64_t (*extents)[2];
+
+	if (ctx->rc != 0) {
+		return;
+	}
+
+	if (ctx->num_extents == ctx->extents_size) {
+		extents = realloc(ctx->extents, sizeof(*extents) * (ctx->extents_size * 2 + 16));
+		if (extents == NULL) {
+			ctx->rc = -ENOMEM;
+			return;
+		}
+		ctx->extents = extents;
+		ctx->extents_size = ctx->extents_size * 2 + 16;
+	}
+
+	ctx->extents[ctx->num_extents][0] = start_cluster;
+	ctx->extents[ctx->num_extents][1] = num_clusters;
+	ctx->num_extents++;
+	ctx->changed_clusters += num_clusters;
+}
+
+static void
+rpc_bdev_lvol_get_changed_clusters_cb(void *cb_arg, int lvolerrno)
+{
+	struct rpc_changed_clusters_ctx *ctx = cb_arg;
+	struct spdk_json_write_ctx *w;
+	uint64_t i;
+
+	if (lvolerrno == 0) {
+		lvolerrno = ctx->rc;
+	}
+
+	if (lvolerrno != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 spdk_strerror(-lvolerrno));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint64(w, "cluster_size", ctx->cluster_size);
+	spdk_json_write_named_uint64(w, "num_clusters", ctx->num_clusters);
+	spdk_json_write_named_uint64(w, "changed_clusters", ctx->changed_clusters);
+	spdk_json_write_named_array_begin(w, "extents");
+	for (i = 0; i < ctx->num_extents; i++) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint64(w, "start", ctx->extents[i][0]);
+		spdk_json_write_named_uint64(w, "count", ctx->extents[i][1]);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(ctx->request, w);
+
+cleanup:
+	free(ctx->extents);
+	free(ctx);
+}
+
+static struct spdk_lvol *
+rpc_bdev_lvol_get_by_name(const char *name)
+{
+	struct spdk_bdev *bdev;
+
+	bdev = spdk_bdev_get_by_name(name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", name);
+		return NULL;
+	}
+
+	return vbdev_lvol_get_from_bdev(bdev);
+}
+
+static void
+rpc_bdev_lvol_get_changed_clusters(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_get_changed_clusters req = {};
+	struct rpc_changed_clusters_ctx *ctx;
+	struct spdk_lvol *lvol, *base = NULL;
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_get_changed_clusters_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_get_changed_clusters_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	lvol = rpc_bdev_lvol_get_by_name(req.name);
+	if (lvol == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	if (req.base_name != NULL) {
+		base = rpc_bdev_lvol_get_by_name(req.base_name);
+		if (base == NULL) {
+			spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+			goto cleanup;
+		}
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		goto cleanup;
+	}
+	ctx->request = request;
+	ctx->cluster_size = spdk_bs_get_cluster_size(lvol->lvol_store->blobstore);
+	ctx->num_clusters = spdk_blob_get_num_clusters(lvol->blob);
+
+	spdk_lvol_get_changed_clusters(base, lvol, rpc_bdev_lvol_changed_clusters_extent_cb, ctx,
+				       rpc_bdev_lvol_get_changed_clusters_cb, ctx);
+
+cleanup:
+	free_rpc_bdev_lvol_get_changed_clusters(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_get_changed_clusters", rpc_bdev_lvol_get_changed_clusters,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_lvol_dedup {
+	char *name;
+};
+
+static void
+free_rpc_bdev_lvol_dedup(struct rpc_bdev_lvol_dedup *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_dedup_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_lvol_dedup, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_lvol_dedup_cb(void *cb_arg, int lvolerrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (lvolerrno != 0) {
+		goto invalid;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+	return;
+
+invalid:
+	spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+					 spdk_strerror(-lvolerrno));
+}
+
+static void
+rpc_bdev_lvol_dedup(struct spdk_jsonrpc_request *request,
+		    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_dedup req = {};
+	struct spdk_bdev *bdev;
+	struct spdk_lvol *lvol;
+
+	SPDK_INFOLOG(lvol_rpc, "Deduplicating lvol\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_dedup_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_dedup_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	lvol = vbdev_lvol_get_from_bdev(bdev);
+	if (lvol == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_lvol_dedup(lvol, rpc_bdev_lvol_dedup_cb, request);
+
+cleanup:
+	free_rpc_bdev_lvol_dedup(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_dedup", rpc_bdev_lvol_dedup, SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_lvol_resize {
 	char *name;
 	uint64_t size;
@@ -142,8 +142,16 @@ static struct spdk_bdev_nvme_opts g_opts = {
 	.ctrlr_loss_timeout_sec = 0,
 	.reconnect_delay_sec = 0,
 	.fast_io_fail_timeout_sec = 0,
+	.io_queues_per_channel = 1,
+	.io_queue_spread = SPDK_BDEV_NVME_IO_SPREAD_ROUND_ROBIN,
+	.delay_cmd_submit_threshold = 0,
 };
 
+/* With SPDK_BDEV_NVME_IO_SPREAD_LBA, each region of 2^NVME_IO_SPREAD_LBA_SHIFT
+ * blocks is mapped to one I/O qpair of a channel.
+ */
+#define NVME_IO_SPREAD_LBA_SHIFT			8
+
 #define NVME_HOTPLUG_POLL_PERIOD_MAX			10000000ULL
 #define NVME_HOTPLUG_POLL_PERIOD_DEFAULT		100000ULL
 
@@ -154,6 +162,8 @@ static struct spdk_thread *g_bdev_nvme_init_thread;
 static struct spdk_poller *g_hotplug_poller;
 static struct spdk_poller *g_hotplug_probe_poller;
 static struct spdk_nvme_probe_ctx *g_hotplug_probe_ctx;
+static bool g_latency_tracking = false;
+static uint32_t g_latency_outliers;
 
 static void nvme_ctrlr_populate_namespaces(struct nvme_ctrlr *nvme_ctrlr,
 		struct nvme_async_probe_ctx *ctx);
@@ -732,6 +742,42 @@ nvme_ns_is_accessible(struct nvme_ns *nvme_ns)
 	return false;
 }
 
+/* Select the I/O qpair to submit a read or write command to. The primary qpair
+ * is used if the selected additional qpair is not connected.
+ */
+static inline struct spdk_nvme_qpair *
+nvme_qpair_select_io_qpair(struct nvme_qpair *nvme_qpair, uint64_t lba)
+{
+	struct spdk_nvme_qpair *qpair;
+	uint32_t num_qpairs, idx;
+
+	if (spdk_likely(nvme_qpair->num_extra_qpairs == 0)) {
+		return nvme_qpair->qpair;
+	}
+
+	num_qpairs = nvme_qpair->num_extra_qpairs + 1;
+
+	if (g_opts.io_queue_spread == SPDK_BDEV_NVME_IO_SPREAD_LBA) {
+		idx = (lba >> NVME_IO_SPREAD_LBA_SHIFT) % num_qpairs;
+	} else {
+		idx = nvme_qpair->next_qpair_idx;
+		if (++nvme_qpair->next_qpair_idx == num_qpairs) {
+			nvme_qpair->next_qpair_idx = 0;
+		}
+	}
+
+	if (idx == 0) {
+		return nvme_qpair->qpair;
+	}
+
+	qpair = nvme_qpair->extra_qpairs[idx - 1];
+	if (spdk_unlikely(qpair == NULL)) {
+		return nvme_qpair->qpair;
+	}
+
+	return qpair;
+}
+
 static inline bool
 nvme_io_path_is_connected(struct nvme_io_path *io_path)
 {
@@ -1124,13 +1170,31 @@ bdev_nvme_clear_io_path_caches(struct nvme_ctrlr *nvme_ctrlr,
 			      cpl);
 }
 
+static bool
+nvme_qpair_has_io_qpair(struct nvme_qpair *nvme_qpair, struct spdk_nvme_qpair *qpair)
+{
+	uint32_t i;
+
+	if (nvme_qpair->qpair == qpair) {
+		return true;
+	}
+
+	for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+		if (nvme_qpair->extra_qpairs[i] == qpair) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static struct nvme_qpair *
 nvme_poll_group_get_qpair(struct nvme_poll_group *group, struct spdk_nvme_qpair *qpair)
 {
 	struct nvme_qpair *nvme_qpair;
 
 	TAILQ_FOREACH(nvme_qpair, &group->qpair_list, tailq) {
-		if (nvme_qpair->qpair == qpair) {
+		if (nvme_qpair_has_io_qpair(nvme_qpair, qpair)) {
 			break;
 		}
 	}
@@ -1138,6 +1202,60 @@ nvme_poll_group_get_qpair(struct nvme_poll_group *group, struct spdk_nvme_qpair
 	return nvme_qpair;
 }
 
+static void
+nvme_qpair_free_io_qpair(struct nvme_qpair *nvme_qpair, struct spdk_nvme_qpair *qpair)
+{
+	uint32_t i;
+
+	spdk_nvme_ctrlr_free_io_qpair(qpair);
+
+	if (nvme_qpair->qpair == qpair) {
+		nvme_qpair->qpair = NULL;
+		return;
+	}
+
+	for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+		if (nvme_qpair->extra_qpairs[i] == qpair) {
+			nvme_qpair->extra_qpairs[i] = NULL;
+			return;
+		}
+	}
+}
+
+static bool
+nvme_qpair_is_disconnected(struct nvme_qpair *nvme_qpair)
+{
+	uint32_t i;
+
+	if (nvme_qpair->qpair != NULL) {
+		return false;
+	}
+
+	for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+		if (nvme_qpair->extra_qpairs[i] != NULL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+nvme_qpair_disconnect(struct nvme_qpair *nvme_qpair)
+{
+	uint32_t i;
+
+	if (nvme_qpair->qpair != NULL) {
+		spdk_nvme_ctrlr_disconnect_io_qpair(nvme_qpair->qpair);
+	}
+
+	for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+		if (nvme_qpair->extra_qpairs[i] != NULL) {
+			spdk_nvme_ctrlr_disconnect_io_qpair(nvme_qpair->extra_qpairs[i]);
+		}
+	}
+}
+
 static void nvme_qpair_delete(struct nvme_qpair *nvme_qpair);
 
 static void
@@ -1152,10 +1270,7 @@ bdev_nvme_disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_
 		return;
 	}
 
-	if (nvme_qpair->qpair != NULL) {
-		spdk_nvme_ctrlr_free_io_qpair(nvme_qpair->qpair);
-		nvme_qpair->qpair = NULL;
-	}
+	nvme_qpair_free_io_qpair(nvme_qpair, qpair);
 
 	_bdev_nvme_clear_io_path_cache(nvme_qpair);
 
@@ -1163,6 +1278,13 @@ bdev_nvme_disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_
 
 	if (ctrlr_ch != NULL) {
 		if (ctrlr_ch->reset_iter != NULL) {
+			if (!nvme_qpair_is_disconnected(nvme_qpair)) {
+				/* Wait until all other I/O qpairs of the ctrlr_channel
+				 * are disconnected.
+				 */
+				return;
+			}
+
 			/* If we are already in a full reset sequence, we do not have
 			 * to restart it. Just move to the next ctrlr_channel.
 			 */
@@ -1175,7 +1297,7 @@ bdev_nvme_disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_
 			SPDK_NOTICELOG("qpair %p was disconnected and freed. reset controller.\n", qpair);
 			bdev_nvme_failover(nvme_qpair->ctrlr, false);
 		}
-	} else {
+	} else if (nvme_qpair_is_disconnected(nvme_qpair)) {
 		/* In this case, ctrlr_channel is already deleted. */
 		SPDK_DEBUGLOG(bdev_nvme, "qpair %p was disconnected and freed. delete nvme_qpair.\n", qpair);
 		nvme_qpair_delete(nvme_qpair);
@@ -1309,7 +1431,7 @@ bdev_nvme_flush(struct nvme_bdev_io *bio, uint64_t offset, uint64_t nbytes)
 }
 
 static int
-bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair)
+_bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair, struct spdk_nvme_qpair **_qpair)
 {
 	struct nvme_ctrlr *nvme_ctrlr;
 	struct spdk_nvme_io_qpair_opts opts;
@@ -1320,6 +1442,7 @@ bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair)
 
 	spdk_nvme_ctrlr_get_default_io_qpair_opts(nvme_ctrlr->ctrlr, &opts, sizeof(opts));
 	opts.delay_cmd_submit = g_opts.delay_cmd_submit;
+	opts.delay_cmd_submit_threshold = g_opts.delay_cmd_submit_threshold;
 	opts.create_only = true;
 	opts.async_mode = true;
 	opts.io_queue_requests = spdk_max(g_opts.io_queue_requests, opts.io_queue_requests);
@@ -1330,6 +1453,13 @@ bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair)
 		return -1;
 	}
 
+	if (g_latency_tracking) {
+		rc = spdk_nvme_qpair_set_latency_tracking(qpair, true, g_latency_outliers);
+		if (rc != 0) {
+			SPDK_WARNLOG("Unable to enable latency tracking on I/O qpair.\n");
+		}
+	}
+
 	SPDK_DTRACE_PROBE3(bdev_nvme_create_qpair, nvme_ctrlr->nbdev_ctrlr->name,
 			   spdk_nvme_qpair_get_id(qpair), spdk_thread_get_id(nvme_ctrlr->thread));
 
@@ -1347,9 +1477,7 @@ bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair)
 		goto err;
 	}
 
-	nvme_qpair->qpair = qpair;
-
-	_bdev_nvme_clear_io_path_cache(nvme_qpair);
+	*_qpair = qpair;
 
 	return 0;
 
@@ -1359,6 +1487,35 @@ err:
 	return rc;
 }
 
+static int
+bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair)
+{
+	uint32_t i;
+	int rc;
+
+	rc = _bdev_nvme_create_qpair(nvme_qpair, &nvme_qpair->qpair);
+	if (rc != 0) {
+		return rc;
+	}
+
+	/* Additional I/O qpairs are optional. If any of them cannot be created,
+	 * its share of I/O is submitted to the primary qpair instead.
+	 */
+	for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+		assert(nvme_qpair->extra_qpairs[i] == NULL);
+
+		rc = _bdev_nvme_create_qpair(nvme_qpair, &nvme_qpair->extra_qpairs[i]);
+		if (rc != 0) {
+			SPDK_WARNLOG("Unable to create additional I/O qpair %u for %s.\n",
+				     i + 1, nvme_qpair->ctrlr->nbdev_ctrlr->name);
+		}
+	}
+
+	_bdev_nvme_clear_io_path_cache(nvme_qpair);
+
+	return 0;
+}
+
 static void
 bdev_nvme_complete_pending_resets(struct spdk_io_channel_iter *i)
 {
@@ -1613,11 +1770,11 @@ bdev_nvme_reset_destroy_qpair(struct spdk_io_channel_iter *i)
 
 	_bdev_nvme_clear_io_path_cache(nvme_qpair);
 
-	if (nvme_qpair->qpair != NULL) {
-		spdk_nvme_ctrlr_disconnect_io_qpair(nvme_qpair->qpair);
+	if (!nvme_qpair_is_disconnected(nvme_qpair)) {
+		nvme_qpair_disconnect(nvme_qpair);
 
 		/* The current full reset sequence will move to the next
-		 * ctrlr_channel after the qpair is actually disconnected.
+		 * ctrlr_channel after all qpairs are actually disconnected.
 		 */
 		assert(ctrlr_ch->reset_iter == NULL);
 		ctrlr_ch->reset_iter = i;
@@ -2187,8 +2344,20 @@ nvme_qpair_create(struct nvme_ctrlr *nvme_ctrlr, struct nvme_ctrlr_channel *ctrl
 	nvme_qpair->ctrlr = nvme_ctrlr;
 	nvme_qpair->ctrlr_ch = ctrlr_ch;
 
+	if (g_opts.io_queues_per_channel > 1) {
+		nvme_qpair->num_extra_qpairs = g_opts.io_queues_per_channel - 1;
+		nvme_qpair->extra_qpairs = calloc(nvme_qpair->num_extra_qpairs,
+						  sizeof(struct spdk_nvme_qpair *));
+		if (!nvme_qpair->extra_qpairs) {
+			SPDK_ERRLOG("Failed to alloc additional I/O qpairs.\n");
+			free(nvme_qpair);
+			return -1;
+		}
+	}
+
 	pg_ch = spdk_get_io_channel(&g_nvme_bdev_ctrlrs);
 	if (!pg_ch) {
+		free(nvme_qpair->extra_qpairs);
 		free(nvme_qpair);
 		return -1;
 	}
@@ -2210,6 +2379,7 @@ nvme_qpair_create(struct nvme_ctrlr *nvme_ctrlr, struct nvme_ctrlr_channel *ctrl
 		 * resubmitted later */
 		if (!nvme_ctrlr->resetting && !nvme_ctrlr->reconnect_is_delayed) {
 			spdk_put_io_channel(pg_ch);
+			free(nvme_qpair->extra_qpairs);
 			free(nvme_qpair);
 			return rc;
 		}
@@ -2248,6 +2418,7 @@ nvme_qpair_delete(struct nvme_qpair *nvme_qpair)
 
 	nvme_ctrlr_release(nvme_qpair->ctrlr);
 
+	free(nvme_qpair->extra_qpairs);
 	free(nvme_qpair);
 }
 
@@ -2262,9 +2433,9 @@ bdev_nvme_destroy_ctrlr_channel_cb(void *io_device, void *ctx_buf)
 
 	_bdev_nvme_clear_io_path_cache(nvme_qpair);
 
-	if (nvme_qpair->qpair != NULL) {
+	if (!nvme_qpair_is_disconnected(nvme_qpair)) {
 		if (ctrlr_ch->reset_iter == NULL) {
-			spdk_nvme_ctrlr_disconnect_io_qpair(nvme_qpair->qpair);
+			nvme_qpair_disconnect(nvme_qpair);
 		} else {
 			/* Skip current ctrlr_channel in a full reset sequence because
 			 * it is being deleted now. The qpair is already being disconnected.
@@ -3794,6 +3965,13 @@ bdev_nvme_validate_opts(const struct spdk_bdev_nvme_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->io_queues_per_channel == 0 ||
+	    opts->io_queues_per_channel > SPDK_BDEV_NVME_MAX_IO_QUEUES_PER_CHANNEL) {
+		SPDK_WARNLOG("Invalid option: io_queues_per_channel has to be between 1 and %u.\n",
+			     SPDK_BDEV_NVME_MAX_IO_QUEUES_PER_CHANNEL);
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -3867,6 +4045,102 @@ bdev_nvme_set_hotplug(bool enabled, uint64_t period_us, spdk_msg_fn cb, void *cb
 	return 0;
 }
 
+struct set_latency_tracking_ctx {
+	bool					enable;
+	uint32_t				num_outliers;
+	bdev_nvme_set_latency_tracking_cb	cb_fn;
+	void					*cb_arg;
+};
+
+static int
+nvme_qpair_set_latency_tracking(struct nvme_qpair *nvme_qpair, bool enable, uint32_t num_outliers)
+{
+	uint32_t i;
+	int rc;
+
+	if (nvme_qpair->qpair != NULL) {
+		rc = spdk_nvme_qpair_set_latency_tracking(nvme_qpair->qpair, enable, num_outliers);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+		if (nvme_qpair->extra_qpairs[i] == NULL) {
+			continue;
+		}
+		rc = spdk_nvme_qpair_set_latency_tracking(nvme_qpair->extra_qpairs[i], enable,
+				num_outliers);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+static void
+set_latency_tracking_per_group(struct spdk_io_channel_iter *i)
+{
+	struct set_latency_tracking_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct nvme_poll_group *group = spdk_io_channel_get_ctx(ch);
+	struct nvme_qpair *nvme_qpair;
+	int rc = 0;
+
+	TAILQ_FOREACH(nvme_qpair, &group->qpair_list, tailq) {
+		rc = nvme_qpair_set_latency_tracking(nvme_qpair, ctx->enable, ctx->num_outliers);
+		if (rc != 0) {
+			break;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
+static void
+set_latency_tracking_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct set_latency_tracking_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	if (ctx->cb_fn != NULL) {
+		ctx->cb_fn(ctx->cb_arg, status);
+	}
+
+	free(ctx);
+}
+
+int
+bdev_nvme_set_latency_tracking(bool enable, uint32_t num_outliers,
+			       bdev_nvme_set_latency_tracking_cb cb_fn, void *cb_arg)
+{
+	struct set_latency_tracking_ctx *ctx;
+
+	if (num_outliers > SPDK_NVME_QPAIR_MAX_LATENCY_OUTLIERS) {
+		return -EINVAL;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->enable = enable;
+	ctx->num_outliers = num_outliers;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	/* I/O qpairs created from now on, e.g. by a reset, pick up the new setting. */
+	g_latency_tracking = enable;
+	g_latency_outliers = num_outliers;
+
+	spdk_for_each_channel(&g_nvme_bdev_ctrlrs,
+			      set_latency_tracking_per_group,
+			      ctx,
+			      set_latency_tracking_done);
+	return 0;
+}
+
 static void
 nvme_ctrlr_populate_namespaces_done(struct nvme_ctrlr *nvme_ctrlr,
 				    struct nvme_async_probe_ctx *ctx)
@@ -5382,7 +5656,7 @@ bdev_nvme_no_pi_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	bio->iov_offset = 0;
 
 	rc = spdk_nvme_ns_cmd_readv_with_md(bio->io_path->nvme_ns->ns,
-					    bio->io_path->qpair->qpair,
+					    nvme_qpair_select_io_qpair(bio->io_path->qpair, lba),
 					    lba, lba_count,
 					    bdev_nvme_no_pi_readv_done, bio, 0,
 					    bdev_nvme_queued_reset_sgl, bdev_nvme_queued_next_sge,
@@ -5400,7 +5674,7 @@ bdev_nvme_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 		struct spdk_bdev_ext_io_opts *ext_opts)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->qpair->qpair;
+	struct spdk_nvme_qpair *qpair = nvme_qpair_select_io_qpair(bio->io_path->qpair, lba);
 	int rc;
 
 	SPDK_DEBUGLOG(bdev_nvme, "read %" PRIu64 " blocks with offset %#" PRIx64 "\n",
@@ -5447,7 +5721,7 @@ bdev_nvme_writev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 		 uint32_t flags, struct spdk_bdev_ext_io_opts *ext_opts)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->qpair->qpair;
+	struct spdk_nvme_qpair *qpair = nvme_qpair_select_io_qpair(bio->io_path->qpair, lba);
 	int rc;
 
 	SPDK_DEBUGLOG(bdev_nvme, "write %" PRIu64 " blocks with offset %#" PRIx64 "\n",
@@ -5540,7 +5814,7 @@ bdev_nvme_comparev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	bio->iov_offset = 0;
 
 	rc = spdk_nvme_ns_cmd_comparev_with_md(bio->io_path->nvme_ns->ns,
-					       bio->io_path->qpair->qpair,
+					       nvme_qpair_select_io_qpair(bio->io_path->qpair, lba),
 					       lba, lba_count,
 					       bdev_nvme_comparev_done, bio, flags,
 					       bdev_nvme_queued_reset_sgl, bdev_nvme_queued_next_sge,
@@ -5648,7 +5922,7 @@ bdev_nvme_unmap(struct nvme_bdev_io *bio, uint64_t offset_blocks, uint64_t num_b
 	range->starting_lba = offset;
 
 	rc = spdk_nvme_ns_cmd_dataset_management(bio->io_path->nvme_ns->ns,
-			bio->io_path->qpair->qpair,
+			nvme_qpair_select_io_qpair(bio->io_path->qpair, offset_blocks),
 			SPDK_NVME_DSM_ATTR_DEALLOCATE,
 			dsm_ranges, num_ranges,
 			bdev_nvme_queued_done, bio);
@@ -5665,7 +5939,7 @@ bdev_nvme_write_zeroes(struct nvme_bdev_io *bio, uint64_t offset_blocks, uint64_
 	}
 
 	return spdk_nvme_ns_cmd_write_zeroes(bio->io_path->nvme_ns->ns,
-					     bio->io_path->qpair->qpair,
+					     nvme_qpair_select_io_qpair(bio->io_path->qpair, offset_blocks),
 					     offset_blocks, num_blocks,
 					     bdev_nvme_queued_done, bio,
 					     0);
@@ -5834,6 +6108,7 @@ bdev_nvme_abort(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio,
 	struct spdk_bdev_io *bdev_io_to_abort;
 	struct nvme_io_path *io_path;
 	struct nvme_ctrlr *nvme_ctrlr;
+	uint32_t i;
 	int rc = 0;
 
 	bio->orig_thread = spdk_get_thread();
@@ -5860,6 +6135,16 @@ bdev_nvme_abort(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio,
 						   io_path->qpair->qpair,
 						   bio_to_abort,
 						   bdev_nvme_abort_done, bio);
+		for (i = 0; rc == -ENOENT && i < io_path->qpair->num_extra_qpairs; i++) {
+			if (io_path->qpair->extra_qpairs[i] == NULL) {
+				continue;
+			}
+
+			rc = spdk_nvme_ctrlr_cmd_abort_ext(nvme_ctrlr->ctrlr,
+							   io_path->qpair->extra_qpairs[i],
+							   bio_to_abort,
+							   bdev_nvme_abort_done, bio);
+		}
 		if (rc == -ENOENT) {
 			/* If no command was found in I/O qpair, the target command may be
 			 * admin command.
@@ -5887,6 +6172,7 @@ static void
 bdev_nvme_opts_config_json(struct spdk_json_write_ctx *w)
 {
 	const char	*action;
+	const char	*spread;
 
 	if (g_opts.action_on_timeout == SPDK_BDEV_NVME_TIMEOUT_ACTION_RESET) {
 		action = "reset";
@@ -5896,6 +6182,12 @@ bdev_nvme_opts_config_json(struct spdk_json_write_ctx *w)
 		action = "none";
 	}
 
+	if (g_opts.io_queue_spread == SPDK_BDEV_NVME_IO_SPREAD_LBA) {
+		spread = "lba";
+	} else {
+		spread = "round_robin";
+	}
+
 	spdk_json_write_object_begin(w);
 
 	spdk_json_write_named_string(w, "method", "bdev_nvme_set_options");
@@ -5919,6 +6211,9 @@ bdev_nvme_opts_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_int32(w, "ctrlr_loss_timeout_sec", g_opts.ctrlr_loss_timeout_sec);
 	spdk_json_write_named_uint32(w, "reconnect_delay_sec", g_opts.reconnect_delay_sec);
 	spdk_json_write_named_uint32(w, "fast_io_fail_timeout_sec", g_opts.fast_io_fail_timeout_sec);
+	spdk_json_write_named_uint32(w, "io_queues_per_channel", g_opts.io_queues_per_channel);
+	spdk_json_write_named_string(w, "io_queue_spread", spread);
+	spdk_json_write_named_uint16(w, "delay_cmd_submit_threshold", g_opts.delay_cmd_submit_threshold);
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -180,6 +180,14 @@ struct nvme_qpair {
 	struct nvme_poll_group		*group;
 	struct nvme_ctrlr_channel	*ctrlr_ch;
 
+	/* Additional I/O qpairs, added to the same poll group as qpair, that read and
+	 * write commands are spread over if io_queues_per_channel is more than one.
+	 * A NULL entry is not connected and its share of I/O goes to qpair.
+	 */
+	struct spdk_nvme_qpair		**extra_qpairs;
+	uint32_t			num_extra_qpairs;
+	uint32_t			next_qpair_idx;
+
 	/* The following is used to update io_path cache of nvme_bdev_channels. */
 	TAILQ_HEAD(, nvme_io_path)	io_path_list;
 
@@ -242,6 +250,15 @@ enum spdk_bdev_timeout_action {
 	SPDK_BDEV_NVME_TIMEOUT_ACTION_ABORT,
 };
 
+enum spdk_bdev_nvme_io_spread {
+	/* Rotate through the I/O qpairs of a channel for each command. */
+	SPDK_BDEV_NVME_IO_SPREAD_ROUND_ROBIN = 0,
+	/* Select the I/O qpair by the LBA region a command starts in. */
+	SPDK_BDEV_NVME_IO_SPREAD_LBA,
+};
+
+#define SPDK_BDEV_NVME_MAX_IO_QUEUES_PER_CHANNEL	16
+
 struct spdk_bdev_nvme_opts {
 	enum spdk_bdev_timeout_action action_on_timeout;
 	uint64_t timeout_us;
@@ -263,6 +280,11 @@ struct spdk_bdev_nvme_opts {
 	int32_t ctrlr_loss_timeout_sec;
 	uint32_t reconnect_delay_sec;
 	uint32_t fast_io_fail_timeout_sec;
+	/* The number of I/O qpairs each channel creates per controller. */
+	uint32_t io_queues_per_channel;
+	enum spdk_bdev_nvme_io_spread io_queue_spread;
+	/* Commands per poll that still ring the doorbell immediately with delay_cmd_submit. */
+	uint16_t delay_cmd_submit_threshold;
 };
 
 struct spdk_nvme_qpair *bdev_nvme_get_io_qpair(struct spdk_io_channel *ctrlr_io_ch);
@@ -270,6 +292,23 @@ void bdev_nvme_get_opts(struct spdk_bdev_nvme_opts *opts);
 int bdev_nvme_set_opts(const struct spdk_bdev_nvme_opts *opts);
 int bdev_nvme_set_hotplug(bool enabled, uint64_t period_us, spdk_msg_fn cb, void *cb_ctx);
 
+typedef void (*bdev_nvme_set_latency_tracking_cb)(void *cb_arg, int rc);
+
+/**
+ * Enable or disable command latency tracking on the I/O qpairs of all NVMe controllers.
+ *
+ * The setting also applies to I/O qpairs created later. Enabling tracking again
+ * discards the data collected so far.
+ *
+ * \param enable true to enable tracking, false to disable it.
+ * \param num_outliers Number of slowest commands to record per I/O qpair.
+ * \param cb_fn Function to be called back when all I/O qpairs are updated.
+ * \param cb_arg Argument for callback function.
+ * \return zero on success, -EINVAL if num_outliers is too large or -ENOMEM.
+ */
+int bdev_nvme_set_latency_tracking(bool enable, uint32_t num_outliers,
+				   bdev_nvme_set_latency_tracking_cb cb_fn, void *cb_arg);
+
 void bdev_nvme_get_default_ctrlr_opts(struct nvme_ctrlr_opts *opts);
 
 int bdev_nvme_create(struct spdk_nvme_transport_id *trid,
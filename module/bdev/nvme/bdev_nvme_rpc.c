@@ -38,6 +38,7 @@
 
 #include "spdk/config.h"
 
+#include "spdk/base64.h"
 #include "spdk/string.h"
 #include "spdk/rpc.h"
 #include "spdk/util.h"
@@ -75,6 +76,23 @@ rpc_decode_action_on_timeout(const struct spdk_json_val *val, void *out)
 	return 0;
 }
 
+static int
+rpc_decode_io_queue_spread(const struct spdk_json_val *val, void *out)
+{
+	enum spdk_bdev_nvme_io_spread *spread = out;
+
+	if (spdk_json_strequal(val, "round_robin") == true) {
+		*spread = SPDK_BDEV_NVME_IO_SPREAD_ROUND_ROBIN;
+	} else if (spdk_json_strequal(val, "lba") == true) {
+		*spread = SPDK_BDEV_NVME_IO_SPREAD_LBA;
+	} else {
+		SPDK_NOTICELOG("Invalid parameter value: io_queue_spread\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static const struct spdk_json_object_decoder rpc_bdev_nvme_options_decoders[] = {
 	{"action_on_timeout", offsetof(struct spdk_bdev_nvme_opts, action_on_timeout), rpc_decode_action_on_timeout, true},
 	{"timeout_us", offsetof(struct spdk_bdev_nvme_opts, timeout_us), spdk_json_decode_uint64, true},
@@ -95,6 +113,9 @@ static const struct spdk_json_object_decoder rpc_bdev_nvme_options_decoders[] =
 	{"ctrlr_loss_timeout_sec", offsetof(struct spdk_bdev_nvme_opts, ctrlr_loss_timeout_sec), spdk_json_decode_int32, true},
 	{"reconnect_delay_sec", offsetof(struct spdk_bdev_nvme_opts, reconnect_delay_sec), spdk_json_decode_uint32, true},
 	{"fast_io_fail_timeout_sec", offsetof(struct spdk_bdev_nvme_opts, fast_io_fail_timeout_sec), spdk_json_decode_uint32, true},
+	{"io_queues_per_channel", offsetof(struct spdk_bdev_nvme_opts, io_queues_per_channel), spdk_json_decode_uint32, true},
+	{"io_queue_spread", offsetof(struct spdk_bdev_nvme_opts, io_queue_spread), rpc_decode_io_queue_spread, true},
+	{"delay_cmd_submit_threshold", offsetof(struct spdk_bdev_nvme_opts, delay_cmd_submit_threshold), spdk_json_decode_uint16, true},
 };
 
 static void
@@ -1296,6 +1317,211 @@ rpc_bdev_nvme_get_transport_statistics(struct spdk_jsonrpc_request *request,
 SPDK_RPC_REGISTER("bdev_nvme_get_transport_statistics", rpc_bdev_nvme_get_transport_statistics,
 		  SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_nvme_set_latency_tracking {
+	bool enable;
+	uint32_t num_outliers;
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_nvme_set_latency_tracking_decoders[] = {
+	{"enable", offsetof(struct rpc_bdev_nvme_set_latency_tracking, enable), spdk_json_decode_bool},
+	{"num_outliers", offsetof(struct rpc_bdev_nvme_set_latency_tracking, num_outliers), spdk_json_decode_uint32, true},
+};
+
+#define RPC_BDEV_NVME_LATENCY_OUTLIERS_DEFAULT	16
+
+static void
+rpc_bdev_nvme_set_latency_tracking_done(void *cb_arg, int rc)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (rc == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+
+static void
+rpc_bdev_nvme_set_latency_tracking(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_bdev_nvme_set_latency_tracking req = {
+		.num_outliers = RPC_BDEV_NVME_LATENCY_OUTLIERS_DEFAULT,
+	};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_nvme_set_latency_tracking_decoders,
+				    SPDK_COUNTOF(rpc_bdev_nvme_set_latency_tracking_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	rc = bdev_nvme_set_latency_tracking(req.enable, req.num_outliers,
+					    rpc_bdev_nvme_set_latency_tracking_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+SPDK_RPC_REGISTER("bdev_nvme_set_latency_tracking", rpc_bdev_nvme_set_latency_tracking,
+		  SPDK_RPC_RUNTIME)
+
+static const char *
+rpc_bdev_nvme_qpair_get_ctrlr_name(struct nvme_poll_group *group, struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_qpair *nvme_qpair;
+	uint32_t i;
+
+	TAILQ_FOREACH(nvme_qpair, &group->qpair_list, tailq) {
+		if (nvme_qpair->qpair == qpair) {
+			return nvme_qpair->ctrlr->nbdev_ctrlr->name;
+		}
+		for (i = 0; i < nvme_qpair->num_extra_qpairs; i++) {
+			if (nvme_qpair->extra_qpairs[i] == qpair) {
+				return nvme_qpair->ctrlr->nbdev_ctrlr->name;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int
+rpc_bdev_nvme_write_histogram(struct spdk_json_write_ctx *w, struct spdk_histogram_data *histogram)
+{
+	char *encoded_histogram;
+	size_t src_len, dst_len;
+	int rc;
+
+	src_len = SPDK_HISTOGRAM_NUM_BUCKETS(histogram) * sizeof(uint64_t);
+	dst_len = spdk_base64_get_encoded_strlen(src_len) + 1;
+
+	encoded_histogram = malloc(dst_len);
+	if (encoded_histogram == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_base64_encode(encoded_histogram, histogram->bucket, src_len);
+	if (rc == 0) {
+		spdk_json_write_named_string(w, "histogram", encoded_histogram);
+		spdk_json_write_named_int64(w, "bucket_shift", histogram->bucket_shift);
+	}
+
+	free(encoded_histogram);
+	return rc;
+}
+
+static void
+rpc_bdev_nvme_latency_stats_per_channel(struct spdk_io_channel_iter *i)
+{
+	struct rpc_bdev_nvme_transport_stat_ctx *ctx;
+	struct spdk_io_channel *ch;
+	struct nvme_poll_group *group;
+	struct spdk_nvme_poll_group_stat *stat;
+	struct spdk_nvme_qpair_latency_stat *qpair_stat;
+	struct spdk_nvme_latency_outlier *outlier;
+	const char *name;
+	uint64_t ticks_hz;
+	uint32_t j, k;
+	int rc;
+
+	ctx = spdk_io_channel_iter_get_ctx(i);
+	ch = spdk_io_channel_iter_get_channel(i);
+	group = spdk_io_channel_get_ctx(ch);
+	ticks_hz = spdk_get_ticks_hz();
+
+	rc = spdk_nvme_poll_group_get_stats(group->group, &stat);
+	if (rc) {
+		spdk_for_each_channel_continue(i, rc);
+		return;
+	}
+
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_string(ctx->w, "thread", spdk_thread_get_name(spdk_get_thread()));
+	spdk_json_write_named_array_begin(ctx->w, "qpairs");
+
+	for (j = 0; j < stat->num_qpair_latency_stats; j++) {
+		qpair_stat = &stat->qpair_latency_stats[j];
+		spdk_json_write_object_begin(ctx->w);
+		name = rpc_bdev_nvme_qpair_get_ctrlr_name(group, qpair_stat->qpair);
+		if (name != NULL) {
+			spdk_json_write_named_string(ctx->w, "name", name);
+		}
+		spdk_json_write_named_uint32(ctx->w, "qid", qpair_stat->qid);
+
+		spdk_json_write_named_array_begin(ctx->w, "namespaces");
+		for (k = 0; k < qpair_stat->num_ns; k++) {
+			spdk_json_write_object_begin(ctx->w);
+			spdk_json_write_named_uint32(ctx->w, "nsid", qpair_stat->ns_stats[k].nsid);
+			rc = rpc_bdev_nvme_write_histogram(ctx->w, qpair_stat->ns_stats[k].histogram);
+			if (rc != 0) {
+				SPDK_ERRLOG("Failed to encode latency histogram: %s\n", spdk_strerror(-rc));
+			}
+			spdk_json_write_object_end(ctx->w);
+		}
+		spdk_json_write_array_end(ctx->w);
+
+		spdk_json_write_named_array_begin(ctx->w, "outliers");
+		for (k = 0; k < qpair_stat->num_outliers; k++) {
+			outlier = &qpair_stat->outliers[k];
+			spdk_json_write_object_begin(ctx->w);
+			spdk_json_write_named_uint64(ctx->w, "latency_us",
+						     outlier->latency_ticks * SPDK_SEC_TO_USEC / ticks_hz);
+			spdk_json_write_named_uint32(ctx->w, "opc", outlier->opc);
+			spdk_json_write_named_uint32(ctx->w, "cid", outlier->cid);
+			spdk_json_write_named_uint32(ctx->w, "nsid", outlier->nsid);
+			spdk_json_write_named_uint64(ctx->w, "lba", outlier->lba);
+			spdk_json_write_named_uint32(ctx->w, "lba_count", outlier->lba_count);
+			spdk_json_write_named_uint32(ctx->w, "sct", outlier->sct);
+			spdk_json_write_named_uint32(ctx->w, "sc", outlier->sc);
+			spdk_json_write_object_end(ctx->w);
+		}
+		spdk_json_write_array_end(ctx->w);
+
+		spdk_json_write_object_end(ctx->w);
+	}
+	/* qpairs array */
+	spdk_json_write_array_end(ctx->w);
+	spdk_json_write_object_end(ctx->w);
+
+	spdk_nvme_poll_group_free_stats(group->group, stat);
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+rpc_bdev_nvme_get_latency_stats(struct spdk_jsonrpc_request *request,
+				const struct spdk_json_val *params)
+{
+	struct rpc_bdev_nvme_transport_stat_ctx *ctx;
+
+	if (params) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "'bdev_nvme_get_latency_stats' requires no arguments");
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Memory allocation error");
+		return;
+	}
+	ctx->request = request;
+	ctx->w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_uint64(ctx->w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_array_begin(ctx->w, "poll_groups");
+
+	spdk_for_each_channel(&g_nvme_bdev_ctrlrs,
+			      rpc_bdev_nvme_latency_stats_per_channel,
+			      ctx,
+			      rpc_bdev_nvme_stats_done);
+}
+SPDK_RPC_REGISTER("bdev_nvme_get_latency_stats", rpc_bdev_nvme_get_latency_stats,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_nvme_reset_controller_req {
 	char *name;
 };
@@ -350,6 +350,67 @@ blob_bdev_init(struct blob_bdev *b, struct spdk_bdev_desc *desc)
 	b->bs_dev.get_base_bdev = bdev_blob_get_base_bdev;
 }
 
+static void
+bdev_blob_ro_write(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
+		   uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -EPERM);
+}
+
+static void
+bdev_blob_ro_writev(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
+		    struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count,
+		    struct spdk_bs_dev_cb_args *cb_args)
+{
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -EPERM);
+}
+
+static void
+bdev_blob_ro_write_zeroes(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
+			  uint64_t lba, uint64_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -EPERM);
+}
+
+static void
+bdev_blob_ro_unmap(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
+		   uint64_t lba, uint64_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, -EPERM);
+}
+
+int
+spdk_bdev_create_bs_dev_ro(const char *bdev_name, spdk_bdev_event_cb_t event_cb,
+			   void *event_ctx, struct spdk_bs_dev **_bs_dev)
+{
+	struct blob_bdev *b;
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	b = calloc(1, sizeof(*b));
+
+	if (b == NULL) {
+		SPDK_ERRLOG("could not allocate blob_bdev\n");
+		return -ENOMEM;
+	}
+
+	rc = spdk_bdev_open_ext(bdev_name, false, event_cb, event_ctx, &desc);
+	if (rc != 0) {
+		free(b);
+		return rc;
+	}
+
+	blob_bdev_init(b, desc);
+	b->bs_dev.write = bdev_blob_ro_write;
+	b->bs_dev.writev = bdev_blob_ro_writev;
+	b->bs_dev.write_zeroes = bdev_blob_ro_write_zeroes;
+	b->bs_dev.unmap = bdev_blob_ro_unmap;
+
+	*_bs_dev = &b->bs_dev;
+
+	return 0;
+}
+
 int
 spdk_bdev_create_bs_dev_ext(const char *bdev_name, spdk_bdev_event_cb_t event_cb,
 			    void *event_ctx, struct spdk_bs_dev **_bs_dev)
@@ -4,6 +4,7 @@ import sys
 
 from io import IOBase as io
 
+from . import accel
 from . import app
 from . import bdev
 from . import blobfs
@@ -0,0 +1,28 @@
+def accel_set_route(client, opcode, engine=None, min_hw_size=None, hw_queue_depth=None):
+    """Route an accel opcode to an engine.
+
+    Args:
+        opcode: name of the opcode, e.g. copy or crc32c
+        engine: name of the engine to pin the opcode to, "software" to never offload it or "auto" (optional)
+        min_hw_size: operations smaller than this are executed in software (optional)
+        hw_queue_depth: operations a thread may have outstanding on an engine before spilling over to software (optional)
+    """
+    params = {'opcode': opcode}
+
+    if engine is not None:
+        params['engine'] = engine
+    if min_hw_size is not None:
+        params['min_hw_size'] = min_hw_size
+    if hw_queue_depth is not None:
+        params['hw_queue_depth'] = hw_queue_depth
+    return client.call('accel_set_route', params)
+
+
+def accel_get_routes(client):
+    """Get the engine each accel opcode is routed to."""
+    return client.call('accel_get_routes')
+
+
+def accel_get_stats(client):
+    """Get the number of operations each engine executed, per accel opcode."""
+    return client.call('accel_get_stats')
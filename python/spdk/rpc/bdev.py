@@ -48,18 +48,23 @@ def bdev_wait_for_examine(client):
 
 
 @deprecated_alias('construct_compress_bdev')
-def bdev_compress_create(client, base_bdev_name, pm_path, lb_size):
+def bdev_compress_create(client, base_bdev_name, pm_path=None, lb_size=0, packed=False):
     """Construct a compress virtual block device.
 
     Args:
         base_bdev_name: name of the underlying base bdev
-        pm_path: path to persistent memory
+        pm_path: path to persistent memory (optional, metadata is journaled on the base bdev if not set)
         lb_size: logical block size for the compressed vol in bytes.  Must be 4K or 512.
+        packed: pack the tails of compressed chunks into shared backing io units (optional)
 
     Returns:
         Name of created virtual block device.
     """
-    params = {'base_bdev_name': base_bdev_name, 'pm_path': pm_path, 'lb_size': lb_size}
+    params = {'base_bdev_name': base_bdev_name, 'lb_size': lb_size}
+    if pm_path:
+        params['pm_path'] = pm_path
+    if packed:
+        params['packed'] = packed
 
     return client.call('bdev_compress_create', params)
 
@@ -81,7 +86,7 @@ def bdev_compress_set_pmd(client, pmd):
     """Set pmd options for the bdev compress.
 
     Args:
-        pmd: 0 = auto-select, 1 = QAT, 2 = ISAL, 3 = mlx5_pci
+        pmd: 0 = auto-select, 1 = QAT, 2 = ISAL, 3 = mlx5_pci, 4 = accel framework
     """
     params = {'pmd': pmd}
 
@@ -465,7 +470,8 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
                           nvme_adminq_poll_period_us=None, nvme_ioq_poll_period_us=None, io_queue_requests=None,
                           delay_cmd_submit=None, transport_retry_count=None, bdev_retry_count=None,
                           transport_ack_timeout=None, ctrlr_loss_timeout_sec=None, reconnect_delay_sec=None,
-                          fast_io_fail_timeout_sec=None):
+                          fast_io_fail_timeout_sec=None, io_queues_per_channel=None, io_queue_spread=None,
+                          delay_cmd_submit_threshold=None):
     """Set options for the bdev nvme. This is startup command.
 
     Args:
@@ -501,6 +507,10 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
         If fast_io_fail_timeout_sec is not zero, it has to be not less than reconnect_delay_sec and less than
         ctrlr_loss_timeout_sec if ctrlr_loss_timeout_sec is not -1.
         This can be overridden by bdev_nvme_attach_controller. (optional)
+        io_queues_per_channel: The number of I/O qpairs each channel creates per NVMe controller. Default: 1 (optional)
+        io_queue_spread: How I/O is spread over the I/O qpairs of a channel. Valid values are: round_robin, lba (optional)
+        delay_cmd_submit_threshold: With delay_cmd_submit, the number of commands per poll that still ring the
+        doorbell immediately. 0 means all commands are delayed. PCIe only. (optional)
 
     """
     params = {}
@@ -563,6 +573,15 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
     if fast_io_fail_timeout_sec is not None:
         params['fast_io_fail_timeout_sec'] = fast_io_fail_timeout_sec
 
+    if io_queues_per_channel is not None:
+        params['io_queues_per_channel'] = io_queues_per_channel
+
+    if io_queue_spread is not None:
+        params['io_queue_spread'] = io_queue_spread
+
+    if delay_cmd_submit_threshold is not None:
+        params['delay_cmd_submit_threshold'] = delay_cmd_submit_threshold
+
     return client.call('bdev_nvme_set_options', params)
 
 
@@ -1447,6 +1466,26 @@ def bdev_nvme_get_transport_statistics(client):
     return client.call('bdev_nvme_get_transport_statistics')
 
 
+def bdev_nvme_set_latency_tracking(client, enable, num_outliers=None):
+    """Enable or disable command latency tracking on NVMe I/O qpairs.
+
+    Args:
+        enable: Enable or disable latency tracking
+        num_outliers: Number of slowest commands to record per I/O qpair (optional)
+    """
+    params = {'enable': enable}
+
+    if num_outliers is not None:
+        params['num_outliers'] = num_outliers
+
+    return client.call('bdev_nvme_set_latency_tracking', params)
+
+
+def bdev_nvme_get_latency_stats(client):
+    """Get command latency histograms and slowest commands of NVMe I/O qpairs"""
+    return client.call('bdev_nvme_get_latency_stats')
+
+
 def bdev_nvme_get_controller_health_info(client, name):
     """Display health log of the required NVMe bdev controller.
 
@@ -2,7 +2,8 @@ from .helpers import deprecated_alias
 
 
 @deprecated_alias('construct_lvol_store')
-def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None, clear_method=None):
+def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None, clear_method=None,
+                             channel_reserved_clusters=None):
     """Construct a logical volume store.
 
     Args:
@@ -10,6 +11,7 @@ def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None, clear
         lvs_name: name of the logical volume store to create
         cluster_sz: cluster size of the logical volume store in bytes (optional)
         clear_method: Change clear method for data region. Available: none, unmap, write_zeroes (optional)
+        channel_reserved_clusters: clusters each I/O channel reserves at once for thin provisioning (optional)
 
     Returns:
         UUID of created logical volume store.
@@ -19,6 +21,8 @@ def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None, clear
         params['cluster_sz'] = cluster_sz
     if clear_method:
         params['clear_method'] = clear_method
+    if channel_reserved_clusters is not None:
+        params['channel_reserved_clusters'] = channel_reserved_clusters
     return client.call('bdev_lvol_create_lvstore', params)
 
 
@@ -104,6 +108,34 @@ def bdev_lvol_clone(client, snapshot_name, clone_name):
     return client.call('bdev_lvol_clone', params)
 
 
+def bdev_lvol_clone_bdev(client, bdev, clone_name, uuid=None, lvs_name=None):
+    """Create a logical volume based on a bdev that is used as an external snapshot.
+
+    Args:
+        bdev: name, alias or UUID of the bdev to clone
+        clone_name: name of logical volume to create
+        uuid: UUID of logical volume store to create the clone on (optional)
+        lvs_name: name of logical volume store to create the clone on (optional)
+
+    Either uuid or lvs_name must be specified, but not both.
+
+    Returns:
+        UUID of created logical volume clone.
+    """
+    if (uuid and lvs_name) or (not uuid and not lvs_name):
+        raise ValueError("Either uuid or lvs_name must be specified, but not both")
+
+    params = {
+        'bdev': bdev,
+        'clone_name': clone_name
+    }
+    if uuid:
+        params['uuid'] = uuid
+    if lvs_name:
+        params['lvs_name'] = lvs_name
+    return client.call('bdev_lvol_clone_bdev', params)
+
+
 @deprecated_alias('rename_lvol_bdev')
 def bdev_lvol_rename(client, old_name, new_name):
     """Rename a logical volume.
@@ -186,6 +218,68 @@ def bdev_lvol_decouple_parent(client, name):
     return client.call('bdev_lvol_decouple_parent', params)
 
 
+def bdev_lvol_start_shallow_copy(client, src_lvol_name, dst_bdev_name):
+    """Start a shallow copy of a read-only logical volume to a bdev.
+
+    Args:
+        src_lvol_name: name of logical volume to copy
+        dst_bdev_name: name of bdev to copy to
+
+    Returns:
+        Id of the shallow copy operation.
+    """
+    params = {
+        'src_lvol_name': src_lvol_name,
+        'dst_bdev_name': dst_bdev_name,
+    }
+    return client.call('bdev_lvol_start_shallow_copy', params)
+
+
+def bdev_lvol_check_shallow_copy(client, operation_id):
+    """Get the progress of a shallow copy operation.
+
+    Args:
+        operation_id: id of the shallow copy operation
+
+    Returns:
+        State and number of copied clusters of the operation.
+    """
+    params = {
+        'operation_id': operation_id,
+    }
+    return client.call('bdev_lvol_check_shallow_copy', params)
+
+
+def bdev_lvol_get_changed_clusters(client, name, base_name=None):
+    """Get the clusters of a logical volume that changed since one of its ancestor snapshots.
+
+    Args:
+        name: name of logical volume
+        base_name: name of an ancestor snapshot of the logical volume (optional)
+
+    Returns:
+        Ranges of changed clusters.
+    """
+    params = {
+        'name': name,
+    }
+    if base_name:
+        params['base_name'] = base_name
+    return client.call('bdev_lvol_get_changed_clusters', params)
+
+
+def bdev_lvol_dedup(client, name):
+    """Release the clusters of a thin provisioned logical volume that hold the same data as its parent.
+
+    Args:
+        name: name of logical volume to deduplicate
+    """
+    params = {
+        'name': name,
+    }
+    return client.call('bdev_lvol_dedup', params)
+
+
 @deprecated_alias('destroy_lvol_store')
 def bdev_lvol_delete_lvstore(client, uuid=None, lvs_name=None):
     """Destroy a logical volume store.
@@ -2,18 +2,21 @@ from .helpers import deprecated_alias
 
 
 @deprecated_alias('set_vhost_controller_coalescing')
-def vhost_controller_set_coalescing(client, ctrlr, delay_base_us, iops_threshold):
+def vhost_controller_set_coalescing(client, ctrlr, delay_base_us, iops_threshold, adaptive=None):
     """Set coalescing for vhost controller.
     Args:
         ctrlr: controller name
         delay_base_us: base delay time
         iops_threshold: IOPS threshold when coalescing is enabled
+        adaptive: adapt the delay to the load of each virtqueue, up to delay_base_us (optional)
     """
     params = {
         'ctrlr': ctrlr,
         'delay_base_us': delay_base_us,
         'iops_threshold': iops_threshold,
     }
+    if adaptive:
+        params['adaptive'] = adaptive
     return client.call('vhost_controller_set_coalescing', params)
 
 
@@ -63,7 +66,8 @@ def vhost_scsi_controller_remove_target(client, ctrlr, scsi_target_num):
 
 
 @deprecated_alias('construct_vhost_blk_controller')
-def vhost_create_blk_controller(client, ctrlr, dev_name, cpumask=None, readonly=None, packed_ring=None, packed_ring_recovery=None):
+def vhost_create_blk_controller(client, ctrlr, dev_name, cpumask=None, readonly=None, packed_ring=None, packed_ring_recovery=None,
+                                queue_threads=None):
     """Create vhost BLK controller.
     Args:
         ctrlr: controller name
@@ -72,6 +76,7 @@ def vhost_create_blk_controller(client, ctrlr, dev_name, cpumask=None, readonly=
         readonly: set controller as read-only
         packed_ring: support controller packed_ring
         packed_ring_recovery: enable packed ring live recovery
+        queue_threads: number of threads polling the virtqueues (optional)
     """
     params = {
         'ctrlr': ctrlr,
@@ -85,6 +90,8 @@ def vhost_create_blk_controller(client, ctrlr, dev_name, cpumask=None, readonly=
         params['packed_ring'] = packed_ring
     if packed_ring_recovery:
         params['packed_ring_recovery'] = packed_ring_recovery
+    if queue_threads:
+        params['queue_threads'] = queue_threads
     return client.call('vhost_create_blk_controller', params)
 
 
@@ -225,13 +225,16 @@ if __name__ == "__main__":
         print_json(rpc.bdev.bdev_compress_create(args.client,
                                                  base_bdev_name=args.base_bdev_name,
                                                  pm_path=args.pm_path,
-                                                 lb_size=args.lb_size))
+                                                 lb_size=args.lb_size,
+                                                 packed=args.packed))
 
     p = subparsers.add_parser('bdev_compress_create', aliases=['construct_compress_bdev'],
                               help='Add a compress vbdev')
     p.add_argument('-b', '--base-bdev-name', help="Name of the base bdev")
-    p.add_argument('-p', '--pm-path', help="Path to persistent memory")
+    p.add_argument('-p', '--pm-path', help="Path to persistent memory (optional, metadata is journaled on the base bdev if not set)")
     p.add_argument('-l', '--lb-size', help="Compressed vol logical block size (optional, if used must be 512 or 4096)", type=int, default=0)
+    p.add_argument('--packed', help="Pack the tails of compressed chunks into shared backing io units",
+                   action='store_true')
     p.set_defaults(func=bdev_compress_create)
 
     def bdev_compress_delete(args):
@@ -248,7 +251,7 @@ if __name__ == "__main__":
                                        pmd=args.pmd)
     p = subparsers.add_parser('bdev_compress_set_pmd', aliases=['set_compress_pmd', 'compress_set_pmd'],
                               help='Set pmd option for a compress disk')
-    p.add_argument('-p', '--pmd', type=int, help='0 = auto-select, 1= QAT only, 2 = ISAL only, 3 = mlx5_pci only')
+    p.add_argument('-p', '--pmd', type=int, help='0 = auto-select, 1= QAT only, 2 = ISAL only, 3 = mlx5_pci only, 4 = accel framework')
     p.set_defaults(func=bdev_compress_set_pmd)
 
     def bdev_compress_get_orphans(args):
@@ -509,7 +512,10 @@ if __name__ == "__main__":
                                        transport_ack_timeout=args.transport_ack_timeout,
                                        ctrlr_loss_timeout_sec=args.ctrlr_loss_timeout_sec,
                                        reconnect_delay_sec=args.reconnect_delay_sec,
-                                       fast_io_fail_timeout_sec=args.fast_io_fail_timeout_sec)
+                                       fast_io_fail_timeout_sec=args.fast_io_fail_timeout_sec,
+                                       io_queues_per_channel=args.io_queues_per_channel,
+                                       io_queue_spread=args.io_queue_spread,
+                                       delay_cmd_submit_threshold=args.delay_cmd_submit_threshold)
 
     p = subparsers.add_parser('bdev_nvme_set_options', aliases=['set_bdev_nvme_options'],
                               help='Set options for the bdev nvme type. This is startup command.')
@@ -570,6 +576,14 @@ if __name__ == "__main__":
                    less than ctrlr_loss_timeout_sec if ctrlr_loss_timeout_sec is not -1.
                    This can be overridden by bdev_nvme_attach_controller.""",
                    type=int)
+    p.add_argument('--io-queues-per-channel',
+                   help='The number of I/O qpairs each channel creates per NVMe controller. Default: 1', type=int)
+    p.add_argument('--io-queue-spread',
+                   help='How I/O is spread over the I/O qpairs of a channel. Valid values are: round_robin, lba',
+                   choices=['round_robin', 'lba'])
+    p.add_argument('--delay-cmd-submit-threshold',
+                   help="""With delayed command submission, the number of commands per poll that still ring the
+                   doorbell immediately. 0 means all commands are delayed. PCIe only.""", type=int)
 
     p.set_defaults(func=bdev_nvme_set_options)
 
@@ -1136,6 +1150,25 @@ if __name__ == "__main__":
                               help='Get bdev_nvme poll group transport statistics')
     p.set_defaults(func=bdev_nvme_get_transport_statistics)
 
+    def bdev_nvme_set_latency_tracking(args):
+        print_json(rpc.bdev.bdev_nvme_set_latency_tracking(args.client,
+                                                           enable=args.enable,
+                                                           num_outliers=args.num_outliers))
+
+    p = subparsers.add_parser('bdev_nvme_set_latency_tracking',
+                              help='Enable or disable command latency tracking on NVMe I/O qpairs')
+    p.add_argument('-e', '--enable', default=True, dest='enable', action='store_true', help='Enable latency tracking')
+    p.add_argument('-d', '--disable', dest='enable', action='store_false', help='Disable latency tracking')
+    p.add_argument('-n', '--num-outliers', help='Number of slowest commands to record per I/O qpair', type=int)
+    p.set_defaults(func=bdev_nvme_set_latency_tracking)
+
+    def bdev_nvme_get_latency_stats(args):
+        print_dict(rpc.bdev.bdev_nvme_get_latency_stats(args.client))
+
+    p = subparsers.add_parser('bdev_nvme_get_latency_stats',
+                              help='Get command latency histograms and slowest commands of NVMe I/O qpairs')
+    p.set_defaults(func=bdev_nvme_get_latency_stats)
+
     def bdev_nvme_get_controller_health_info(args):
         print_dict(rpc.bdev.bdev_nvme_get_controller_health_info(args.client,
                                                                  name=args.name))
@@ -1776,7 +1809,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                                      bdev_name=args.bdev_name,
                                                      lvs_name=args.lvs_name,
                                                      cluster_sz=args.cluster_sz,
-                                                     clear_method=args.clear_method))
+                                                     clear_method=args.clear_method,
+                                                     channel_reserved_clusters=args.channel_reserved_clusters))
 
     p = subparsers.add_parser('bdev_lvol_create_lvstore', aliases=['construct_lvol_store'],
                               help='Add logical volume store on base bdev')
@@ -1785,6 +1819,9 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-c', '--cluster-sz', help='size of cluster (in bytes)', type=int, required=False)
     p.add_argument('--clear-method', help="""Change clear method for data region.
         Available: none, unmap, write_zeroes""", required=False)
+    p.add_argument('--channel-reserved-clusters', help="""Number of clusters each I/O channel reserves
+        at once for thin provisioned allocations. Not persisted across lvol store reloads""",
+                   type=int, required=False)
     p.set_defaults(func=bdev_lvol_create_lvstore)
 
     def bdev_lvol_rename_lvstore(args):
@@ -1840,6 +1877,21 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('clone_name', help='lvol clone name')
     p.set_defaults(func=bdev_lvol_clone)
 
+    def bdev_lvol_clone_bdev(args):
+        print_json(rpc.lvol.bdev_lvol_clone_bdev(args.client,
+                                                 bdev=args.bdev,
+                                                 clone_name=args.clone_name,
+                                                 uuid=args.uuid,
+                                                 lvs_name=args.lvs_name))
+
+    p = subparsers.add_parser('bdev_lvol_clone_bdev',
+                              help='Create a clone of a bdev in an lvol store')
+    p.add_argument('bdev', help='bdev name, alias or UUID')
+    p.add_argument('clone_name', help='lvol clone name')
+    p.add_argument('-u', '--uuid', help='lvol store UUID', required=False)
+    p.add_argument('-l', '--lvs-name', help='lvol store name', required=False)
+    p.set_defaults(func=bdev_lvol_clone_bdev)
+
     def bdev_lvol_rename(args):
         rpc.lvol.bdev_lvol_rename(args.client,
                                   old_name=args.old_name,
@@ -1869,6 +1921,48 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='lvol bdev name')
     p.set_defaults(func=bdev_lvol_decouple_parent)
 
+    def bdev_lvol_start_shallow_copy(args):
+        print_json(rpc.lvol.bdev_lvol_start_shallow_copy(args.client,
+                                                         src_lvol_name=args.src_lvol_name,
+                                                         dst_bdev_name=args.dst_bdev_name))
+
+    p = subparsers.add_parser('bdev_lvol_start_shallow_copy',
+                              help='Start copying the clusters allocated by a read-only lvol to a bdev')
+    p.add_argument('src_lvol_name', help='source lvol name')
+    p.add_argument('dst_bdev_name', help='destination bdev name')
+    p.set_defaults(func=bdev_lvol_start_shallow_copy)
+
+    def bdev_lvol_check_shallow_copy(args):
+        print_json(rpc.lvol.bdev_lvol_check_shallow_copy(args.client,
+                                                         operation_id=args.operation_id))
+
+    p = subparsers.add_parser('bdev_lvol_check_shallow_copy',
+                              help='Get the progress of a shallow copy operation')
+    p.add_argument('operation_id', help='operation id returned by bdev_lvol_start_shallow_copy',
+                   type=int)
+    p.set_defaults(func=bdev_lvol_check_shallow_copy)
+
+    def bdev_lvol_get_changed_clusters(args):
+        print_json(rpc.lvol.bdev_lvol_get_changed_clusters(args.client,
+                                                           name=args.name,
+                                                           base_name=args.base_name))
+
+    p = subparsers.add_parser('bdev_lvol_get_changed_clusters',
+                              help='Get the clusters of an lvol that changed since an ancestor snapshot')
+    p.add_argument('name', help='lvol bdev name')
+    p.add_argument('-b', '--base-name', help='ancestor snapshot lvol bdev name, all allocated '
+                   'clusters are reported if omitted', required=False)
+    p.set_defaults(func=bdev_lvol_get_changed_clusters)
+
+    def bdev_lvol_dedup(args):
+        rpc.lvol.bdev_lvol_dedup(args.client,
+                                 name=args.name)
+
+    p = subparsers.add_parser('bdev_lvol_dedup',
+                              help='Release clusters of a thin provisioned lvol that match its parent')
+    p.add_argument('name', help='lvol bdev name')
+    p.set_defaults(func=bdev_lvol_dedup)
+
     def bdev_lvol_resize(args):
         rpc.lvol.bdev_lvol_resize(args.client,
                                   name=args.name,
@@ -2436,13 +2530,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
         rpc.vhost.vhost_controller_set_coalescing(args.client,
                                                   ctrlr=args.ctrlr,
                                                   delay_base_us=args.delay_base_us,
-                                                  iops_threshold=args.iops_threshold)
+                                                  iops_threshold=args.iops_threshold,
+                                                  adaptive=args.adaptive)
 
     p = subparsers.add_parser('vhost_controller_set_coalescing', aliases=['set_vhost_controller_coalescing'],
                               help='Set vhost controller coalescing')
     p.add_argument('ctrlr', help='controller name')
     p.add_argument('delay_base_us', help='Base delay time', type=int)
     p.add_argument('iops_threshold', help='IOPS threshold when coalescing is enabled', type=int)
+    p.add_argument('-a', '--adaptive', action='store_true',
+                   help='Adapt the delay to the load of each virtqueue, up to delay_base_us. '
+                   'delay_base_us must not be 0')
     p.set_defaults(func=vhost_controller_set_coalescing)
 
     def vhost_create_scsi_controller(args):
@@ -2490,7 +2588,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                               cpumask=args.cpumask,
                                               readonly=args.readonly,
                                               packed_ring=args.packed_ring,
-                                              packed_ring_recovery=args.packed_ring_recovery)
+                                              packed_ring_recovery=args.packed_ring_recovery,
+                                              queue_threads=args.queue_threads)
 
     p = subparsers.add_parser('vhost_create_blk_controller',
                               aliases=['construct_vhost_blk_controller'],
@@ -2501,6 +2600,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument("-r", "--readonly", action='store_true', help='Set controller as read-only')
     p.add_argument("-p", "--packed_ring", action='store_true', help='Set controller as packed ring supported')
     p.add_argument("-l", "--packed_ring_recovery", action='store_true', help='Enable packed ring live recovery')
+    p.add_argument("-q", "--queue-threads", dest='queue_threads', type=int,
+                   help='Number of threads polling the virtqueues, pinned to the cores of cpumask round robin')
     p.set_defaults(func=vhost_create_blk_controller)
 
     def vhost_get_controllers(args):
@@ -2572,6 +2673,32 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                    help='How often the hotplug is processed for insert and remove events', type=int)
     p.set_defaults(func=bdev_virtio_blk_set_hotplug)
 
+    # accel_fw
+    def accel_set_route(args):
+        rpc.accel.accel_set_route(args.client, opcode=args.opcode, engine=args.engine,
+                                  min_hw_size=args.min_hw_size, hw_queue_depth=args.hw_queue_depth)
+
+    p = subparsers.add_parser('accel_set_route', help='Route an accel opcode to an engine.')
+    p.add_argument('opcode', help='Opcode name, e.g. copy or crc32c')
+    p.add_argument('-e', '--engine', help='Engine to pin the opcode to, "software" to never offload it or "auto"')
+    p.add_argument('-m', '--min-hw-size', help='Operations smaller than this many bytes are executed in software',
+                   type=int, dest='min_hw_size')
+    p.add_argument('-q', '--hw-queue-depth', help="""Operations a thread may have outstanding on an engine
+    before the following ones spill over to software""", type=int, dest='hw_queue_depth')
+    p.set_defaults(func=accel_set_route)
+
+    def accel_get_routes(args):
+        print_dict(rpc.accel.accel_get_routes(args.client))
+
+    p = subparsers.add_parser('accel_get_routes', help='Display the engine each accel opcode is routed to.')
+    p.set_defaults(func=accel_get_routes)
+
+    def accel_get_stats(args):
+        print_dict(rpc.accel.accel_get_stats(args.client))
+
+    p = subparsers.add_parser('accel_get_stats', help='Display the accel operations executed by each engine.')
+    p.set_defaults(func=accel_get_stats)
+
     # ioat
     def ioat_scan_accel_engine(args):
         rpc.ioat.ioat_scan_accel_engine(args.client)
@@ -46,6 +46,16 @@ DEFINE_STUB(pmem_is_pmem, int, (const void *addr, size_t len), 0);
 DEFINE_STUB(pmem_memset_persist, void *, (void *pmemdest, int c, size_t len), NULL);
 #endif
 
+DEFINE_STUB(spdk_mem_map_alloc, struct spdk_mem_map *, (uint64_t default_translation,
+		const struct spdk_mem_map_ops *ops, void *cb_ctx), NULL);
+DEFINE_STUB_V(spdk_mem_map_free, (struct spdk_mem_map **pmap));
+DEFINE_STUB(spdk_mem_map_set_translation, int, (struct spdk_mem_map *map, uint64_t vaddr,
+		uint64_t size, uint64_t translation), 0);
+DEFINE_STUB(spdk_mem_map_clear_translation, int, (struct spdk_mem_map *map, uint64_t vaddr,
+		uint64_t size), 0);
+DEFINE_STUB(spdk_mem_map_translate, uint64_t, (const struct spdk_mem_map *map, uint64_t vaddr,
+		uint64_t *size), 1);
+
 /* global vars and setup/cleanup functions used for all test functions */
 struct spdk_accel_engine g_accel_engine = {};
 struct spdk_io_channel *g_ch = NULL;
@@ -85,7 +95,9 @@ test_setup(void)
 		CU_ASSERT(false);
 		return -1;
 	}
-	g_accel_ch->engine_ch = g_engine_ch;
+	g_accel_ch->hw_chs[0].engine = &g_accel_engine;
+	g_accel_ch->hw_chs[0].ch = g_engine_ch;
+	g_accel_ch->num_hw_chs = 1;
 	g_accel_ch->sw_engine_ch = g_engine_ch;
 	g_sw_ch = (struct sw_accel_io_channel *)((char *)g_accel_ch->sw_engine_ch + sizeof(
 				struct spdk_io_channel));
@@ -106,14 +118,29 @@ test_cleanup(void)
 static void
 test_spdk_accel_hw_engine_register(void)
 {
+	struct spdk_accel_engine engines[ACCEL_MAX_HW_ENGINES] = {};
+	uint32_t i;
+
 	/* Run once with no engine assigned, assign it. */
-	g_hw_accel_engine = NULL;
+	g_num_hw_accel_engines = 0;
 	spdk_accel_hw_engine_register(&g_accel_engine);
-	CU_ASSERT(g_hw_accel_engine == &g_accel_engine);
+	CU_ASSERT(g_num_hw_accel_engines == 1);
+	CU_ASSERT(g_hw_accel_engines[0] == &g_accel_engine);
 
-	/* Run with one assigned, should not change. */
+	/* Registering the same engine again doesn't change anything. */
 	spdk_accel_hw_engine_register(&g_accel_engine);
-	CU_ASSERT(g_hw_accel_engine == &g_accel_engine);
+	CU_ASSERT(g_num_hw_accel_engines == 1);
+
+	/* Other engines are added in order, up to the maximum. */
+	for (i = 1; i < ACCEL_MAX_HW_ENGINES; i++) {
+		spdk_accel_hw_engine_register(&engines[i]);
+		CU_ASSERT(g_num_hw_accel_engines == i + 1);
+		CU_ASSERT(g_hw_accel_engines[i] == &engines[i]);
+	}
+	spdk_accel_hw_engine_register(&engines[0]);
+	CU_ASSERT(g_num_hw_accel_engines == ACCEL_MAX_HW_ENGINES);
+
+	g_num_hw_accel_engines = 0;
 }
 
 static int
@@ -247,9 +274,8 @@ test_spdk_accel_submit_copy(void)
 	task.flags = 1;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COPY);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_copy(g_ch, dst, src, nbytes, flags, dummy_submit_cb_fn, cb_arg);
@@ -336,9 +362,8 @@ test_spdk_accel_submit_dualcast(void)
 	task.accel_ch = g_accel_ch;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_DUALCAST);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_dualcast(g_ch, dst1, dst2, src, nbytes, flags, dummy_submit_cb_fn,
@@ -417,9 +442,8 @@ test_spdk_accel_submit_compare(void)
 	task.accel_ch = g_accel_ch;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COMPARE);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_compare(g_ch, src1, src2, nbytes, dummy_submit_cb_fn, cb_arg);
@@ -490,9 +514,8 @@ test_spdk_accel_submit_fill(void)
 	task.accel_ch = g_accel_ch;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_FILL);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_fill(g_ch, dst, fill, nbytes, flags, dummy_submit_cb_fn, cb_arg);
@@ -554,9 +577,8 @@ test_spdk_accel_submit_crc32c(void)
 	task.accel_ch = g_accel_ch;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_CRC32C);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_crc32c(g_ch, &crc_dst, src, seed, nbytes, dummy_submit_cb_fn, cb_arg);
@@ -616,10 +638,9 @@ test_spdk_accel_submit_crc32c_hw_engine_unsupported(void)
 	task.accel_ch = g_accel_ch;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	/* HW engine only supports COPY and does not support CRC */
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COPY);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* Summit to HW engine while eventually handled by SW engine. */
 	rc = spdk_accel_submit_crc32c(g_ch, &crc_dst, src, seed, nbytes, dummy_submit_cb_fn, cb_arg);
@@ -665,9 +686,8 @@ test_spdk_accel_submit_crc32cv(void)
 	task.nbytes = TEST_SUBMIT_SIZE;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_CRC32C);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_crc32cv(g_ch, &crc_dst, iov, iov_cnt, seed, dummy_submit_cb_fn, cb_arg);
@@ -736,9 +756,8 @@ test_spdk_accel_submit_copy_crc32c(void)
 	task.accel_ch = g_accel_ch;
 	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
 
-	g_accel_ch->engine = &g_accel_engine;
 	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COPY_CRC32C);
-	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
 
 	/* HW accel submission OK. */
 	rc = spdk_accel_submit_copy_crc32c(g_ch, dst, src, &crc_dst, seed, nbytes, flags,
@@ -788,6 +807,565 @@ test_spdk_accel_submit_copy_crc32c(void)
 	CU_ASSERT(expected_accel_task == &task);
 }
 
+static void
+test_spdk_accel_submit_compress(void)
+{
+	uint8_t src[TEST_SUBMIT_SIZE], dst[TEST_SUBMIT_SIZE * 2];
+	struct iovec src_iov = { .iov_base = src, .iov_len = sizeof(src) };
+	struct iovec dst_iov = { .iov_base = dst, .iov_len = sizeof(dst) };
+	struct spdk_accel_task task;
+	uint32_t output_size = 0;
+	int rc;
+#ifdef SPDK_CONFIG_ISAL
+	struct spdk_accel_task *expected_accel_task;
+	uint8_t out[TEST_SUBMIT_SIZE];
+	struct iovec cdata_iov = { .iov_base = dst };
+	struct iovec out_iov = { .iov_base = out, .iov_len = sizeof(out) };
+#endif
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
+
+	/* Missing iovs are rejected. */
+	rc = spdk_accel_submit_compress(g_ch, NULL, 0, &src_iov, 1, &output_size, 0,
+					dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 1, &src_iov, 1, &output_size, 0,
+					dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* HW accel submission OK. */
+	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COMPRESS);
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 1, &src_iov, 1, &output_size, 0,
+					dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(task.op_code == ACCEL_OPC_COMPRESS);
+	CU_ASSERT(task.v.iovs == &src_iov);
+	CU_ASSERT(task.v.iovcnt == 1);
+	CU_ASSERT(task.d.iovs == &dst_iov);
+	CU_ASSERT(task.d.iovcnt == 1);
+	CU_ASSERT(task.output_size == &output_size);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	g_dummy_submit_called = false;
+	g_opc_mask = 0;
+
+#ifdef SPDK_CONFIG_ISAL
+	/* SW engine compresses and decompresses the data back with ISA-L. */
+	memset(src, 0x5a, sizeof(src));
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 1, &src_iov, 1, &output_size, 0,
+					dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(output_size > 0 && output_size < sizeof(src));
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	cdata_iov.iov_len = output_size;
+	memset(out, 0, sizeof(out));
+	rc = spdk_accel_submit_decompress(g_ch, &out_iov, 1, &cdata_iov, 1, &output_size, 0,
+					  dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(output_size == sizeof(src));
+	CU_ASSERT(memcmp(out, src, sizeof(src)) == 0);
+	free(g_sw_ch->isal);
+	g_sw_ch->isal = NULL;
+#else
+	/* Without ISA-L the SW engine can't compress and the task is given back. */
+	rc = spdk_accel_submit_decompress(g_ch, &dst_iov, 1, &src_iov, 1, &output_size, 0,
+					  dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == -ENOTSUP);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->task_pool) == &task);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+#endif
+}
+
+static int g_seq_cb_status;
+static int g_seq_cb_called;
+static void
+seq_cb_fn(void *cb_arg, int status)
+{
+	g_seq_cb_called++;
+	g_seq_cb_status = status;
+}
+
+static void
+test_spdk_accel_submit_encrypt(void)
+{
+	/* IEEE P1619 AES-XTS-128 test vector 2 */
+	uint8_t key1[16], key2[16], pt[32], ct[32], out[32];
+	const uint8_t expected[32] = {
+		0xc4, 0x54, 0x18, 0x5e, 0x6a, 0x16, 0x93, 0x6e, 0x39, 0x33, 0x40, 0x38, 0xac, 0xef, 0x83, 0x8b,
+		0xfb, 0x18, 0x6f, 0xff, 0x74, 0x80, 0xad, 0xc4, 0x28, 0x93, 0x82, 0xec, 0xd6, 0xd3, 0x94, 0xf0
+	};
+	const uint64_t iv = 0x3333333333;
+	uint8_t src[2048], dst[2048], clear[2048];
+	struct iovec pt_iov = { .iov_base = pt, .iov_len = sizeof(pt) };
+	struct iovec ct_iov = { .iov_base = ct, .iov_len = sizeof(ct) };
+	struct iovec out_iov = { .iov_base = out, .iov_len = sizeof(out) };
+	struct iovec src_iovs[2], dst_iovs[3];
+	struct spdk_accel_crypto_key *key = NULL;
+	struct spdk_accel_task *expected_accel_task;
+	struct spdk_accel_task task;
+	int rc;
+
+	memset(key1, 0x11, sizeof(key1));
+	memset(key2, 0x22, sizeof(key2));
+	memset(pt, 0x44, sizeof(pt));
+
+	/* Bad key sizes and identical keys are rejected. */
+	rc = spdk_accel_crypto_key_create(key1, key2, 24, &key);
+	CU_ASSERT(rc == -EINVAL);
+	rc = spdk_accel_crypto_key_create(key1, key1, sizeof(key1), &key);
+	CU_ASSERT(rc == -EINVAL);
+	rc = spdk_accel_crypto_key_create(key1, key2, sizeof(key1), &key);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(key != NULL);
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
+
+	/* Lengths that aren't a multiple of the block size are rejected. */
+	rc = spdk_accel_submit_encrypt(g_ch, key, &ct_iov, 1, &pt_iov, 1, iv, 24, 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_encrypt(g_ch, key, &ct_iov, 1, &pt_iov, 1, iv, sizeof(pt), 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* HW accel submission OK. */
+	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_ENCRYPT);
+	rc = spdk_accel_submit_encrypt(g_ch, key, &ct_iov, 1, &pt_iov, 1, iv, sizeof(pt), 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(task.op_code == ACCEL_OPC_ENCRYPT);
+	CU_ASSERT(task.crypto_key == key);
+	CU_ASSERT(task.iv == iv);
+	CU_ASSERT(task.block_size == sizeof(pt));
+	CU_ASSERT(task.nbytes == sizeof(pt));
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	g_dummy_submit_called = false;
+	g_opc_mask = 0;
+
+	/* SW engine matches the known answer. */
+	rc = spdk_accel_submit_encrypt(g_ch, key, &ct_iov, 1, &pt_iov, 1, iv, sizeof(pt), 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(memcmp(ct, expected, sizeof(expected)) == 0);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	rc = spdk_accel_submit_decrypt(g_ch, key, &out_iov, 1, &ct_iov, 1, iv, sizeof(pt), 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(memcmp(out, pt, sizeof(pt)) == 0);
+
+	/* Blocks straddling iovecs round trip, and encrypt the same as a flat buffer. */
+	memset(src, 0xa5, sizeof(src));
+	src_iovs[0].iov_base = src;
+	src_iovs[0].iov_len = 100;
+	src_iovs[1].iov_base = src + 100;
+	src_iovs[1].iov_len = sizeof(src) - 100;
+	dst_iovs[0].iov_base = dst;
+	dst_iovs[0].iov_len = sizeof(dst);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	rc = spdk_accel_submit_encrypt(g_ch, key, dst_iovs, 1, src_iovs, 2, 7, 512, 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(memcmp(dst, src, sizeof(src)) != 0);
+
+	src_iovs[0].iov_base = dst;
+	src_iovs[0].iov_len = sizeof(dst);
+	dst_iovs[0].iov_base = clear;
+	dst_iovs[0].iov_len = 1000;
+	dst_iovs[1].iov_base = clear + 1000;
+	dst_iovs[1].iov_len = 24;
+	dst_iovs[2].iov_base = clear + 1024;
+	dst_iovs[2].iov_len = sizeof(clear) - 1024;
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	rc = spdk_accel_submit_decrypt(g_ch, key, dst_iovs, 3, src_iovs, 1, 7, 512, 0,
+				       dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(memcmp(clear, src, sizeof(src)) == 0);
+
+	EVP_CIPHER_CTX_free(g_sw_ch->crypto->ctx);
+	free(g_sw_ch->crypto->bounce);
+	free(g_sw_ch->crypto);
+	g_sw_ch->crypto = NULL;
+	spdk_accel_crypto_key_destroy(key);
+}
+
+static void
+test_accel_sequence(void)
+{
+	uint8_t src[TEST_SUBMIT_SIZE], dst[TEST_SUBMIT_SIZE], dst2[TEST_SUBMIT_SIZE];
+	uint8_t expected[TEST_SUBMIT_SIZE];
+	struct spdk_accel_task tasks[3], *task;
+	struct spdk_accel_sequence sequence, *seq = NULL;
+	uint32_t crc_dst = 0;
+	int rc, i;
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INIT(&g_accel_ch->seq_pool);
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
+	g_opc_mask = 0;
+
+	/* No sequence available. */
+	rc = spdk_accel_append_copy(&seq, g_ch, dst, src, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == -ENOMEM);
+	CU_ASSERT(seq == NULL);
+
+	/* No task available, the new sequence is given back. */
+	TAILQ_INSERT_TAIL(&g_accel_ch->seq_pool, &sequence, link);
+	rc = spdk_accel_append_copy(&seq, g_ch, dst, src, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == -ENOMEM);
+	CU_ASSERT(seq == NULL);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &sequence);
+
+	for (i = 0; i < 3; i++) {
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[i], link);
+	}
+
+	/* Abort gives the sequence and its tasks back. */
+	rc = spdk_accel_append_copy(&seq, g_ch, dst, src, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(seq == &sequence);
+	CU_ASSERT(TAILQ_EMPTY(&g_accel_ch->seq_pool));
+	spdk_accel_sequence_abort(seq);
+	seq = NULL;
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &sequence);
+	i = 0;
+	TAILQ_FOREACH(task, &g_accel_ch->task_pool, link) {
+		i++;
+	}
+	CU_ASSERT(i == 3);
+
+	/* SW engine: copy + CRC-32C of the copied data are merged, the fill runs after
+	 * it and the sequence completes once, from the completion poller.
+	 */
+	memset(src, 0x5a, sizeof(src));
+	memset(dst, 0, sizeof(dst));
+	memset(dst2, 0, sizeof(dst2));
+	memset(expected, 0xa5, sizeof(expected));
+	g_seq_cb_called = 0;
+	rc = spdk_accel_append_copy(&seq, g_ch, dst, src, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_crc32c(&seq, g_ch, &crc_dst, dst, 0, TEST_SUBMIT_SIZE);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_fill(&seq, g_ch, dst2, 0xa5, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_accel_ch->task_pool));
+
+	spdk_accel_sequence_finish(seq, seq_cb_fn, NULL);
+	CU_ASSERT(memcmp(dst, src, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(crc_dst == spdk_crc32c_update(src, TEST_SUBMIT_SIZE, ~0));
+	CU_ASSERT(memcmp(dst2, expected, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(g_seq_cb_called == 0);
+
+	task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	SPDK_CU_ASSERT_FATAL(task != NULL);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, task, link);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+	spdk_accel_task_complete(task, task->status);
+	CU_ASSERT(g_seq_cb_called == 1);
+	CU_ASSERT(g_seq_cb_status == 0);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &sequence);
+	i = 0;
+	TAILQ_FOREACH(task, &g_accel_ch->task_pool, link) {
+		i++;
+	}
+	CU_ASSERT(i == 3);
+
+	/* HW engine supporting copy + CRC-32C gets the merged operation. */
+	seq = NULL;
+	g_seq_cb_called = 0;
+	g_dummy_submit_called = false;
+	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COPY_CRC32C);
+	rc = spdk_accel_append_copy(&seq, g_ch, dst, src, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_crc32c(&seq, g_ch, &crc_dst, src, 0, TEST_SUBMIT_SIZE);
+	CU_ASSERT(rc == 0);
+	task = TAILQ_FIRST(&seq->tasks);
+
+	spdk_accel_sequence_finish(seq, seq_cb_fn, NULL);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(task->op_code == ACCEL_OPC_COPY_CRC32C);
+	CU_ASSERT(task->crc_dst == &crc_dst);
+	CU_ASSERT(g_seq_cb_called == 0);
+
+	/* A failed operation completes the sequence with its status. */
+	spdk_accel_task_complete(task, -EIO);
+	CU_ASSERT(g_seq_cb_called == 1);
+	CU_ASSERT(g_seq_cb_status == -EIO);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &sequence);
+
+	g_opc_mask = 0;
+	g_dummy_submit_called = false;
+}
+
+static int g_busy_submit_called;
+static int
+busy_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *first_task)
+{
+	g_busy_submit_called++;
+	return -EBUSY;
+}
+
+static void
+test_accel_sequence_hw_busy(void)
+{
+	uint8_t dst[TEST_SUBMIT_SIZE], dst2[TEST_SUBMIT_SIZE], dst3[TEST_SUBMIT_SIZE];
+	uint8_t expected[TEST_SUBMIT_SIZE];
+	struct spdk_accel_task tasks[3], *task;
+	struct spdk_accel_sequence sequence, *seq = NULL;
+	struct accel_opcode_stats *stats = &g_accel_ch->stats[ACCEL_OPC_COPY];
+	uint32_t outstanding = g_accel_ch->hw_chs[0].outstanding;
+	int rc, i;
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INIT(&g_accel_ch->seq_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->seq_pool, &sequence, link);
+	for (i = 0; i < 3; i++) {
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[i], link);
+	}
+	memset(stats, 0, sizeof(*stats));
+	memset(dst, 0, sizeof(dst));
+	memset(dst2, 0, sizeof(dst2));
+	memset(dst3, 0, sizeof(dst3));
+	memset(expected, 0xa5, sizeof(expected));
+
+	/* The HW engine takes the copy in the middle of the sequence but its queue is full.
+	 * The copy runs in software and the sequence goes on instead of failing.
+	 */
+	g_accel_engine.submit_tasks = busy_submit_tasks;
+	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COPY);
+	g_busy_submit_called = 0;
+	g_seq_cb_called = 0;
+	rc = spdk_accel_append_fill(&seq, g_ch, dst, 0xa5, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_copy(&seq, g_ch, dst2, dst, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_fill(&seq, g_ch, dst3, 0x5a, TEST_SUBMIT_SIZE, 0);
+	CU_ASSERT(rc == 0);
+
+	spdk_accel_sequence_finish(seq, seq_cb_fn, NULL);
+	CU_ASSERT(g_busy_submit_called == 1);
+	CU_ASSERT(g_accel_ch->hw_chs[0].outstanding == outstanding);
+	CU_ASSERT(memcmp(dst, expected, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(memcmp(dst2, expected, TEST_SUBMIT_SIZE) == 0);
+	memset(expected, 0x5a, sizeof(expected));
+	CU_ASSERT(memcmp(dst3, expected, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(stats->hw_ops[0] == 0);
+	CU_ASSERT(stats->sw_ops == 1);
+	CU_ASSERT(stats->spilled_ops == 1);
+	CU_ASSERT(g_seq_cb_called == 0);
+
+	task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	SPDK_CU_ASSERT_FATAL(task != NULL);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, task, link);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+	spdk_accel_task_complete(task, task->status);
+	CU_ASSERT(g_seq_cb_called == 1);
+	CU_ASSERT(g_seq_cb_status == 0);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &sequence);
+
+	memset(stats, 0, sizeof(*stats));
+	g_opc_mask = 0;
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
+}
+
+static bool
+_supports_copy(enum accel_opcode opc)
+{
+	return opc == ACCEL_OPC_COPY;
+}
+
+static int g_engine2_submitted = 0;
+static int
+engine2_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *first_task)
+{
+	g_engine2_submitted++;
+	return 0;
+}
+
+static void
+test_accel_routing(void)
+{
+	struct spdk_accel_engine engine2 = {
+		.name = "hw2",
+		.supports_opcode = _supports_copy,
+		.submit_tasks = engine2_submit_tasks,
+	};
+	struct spdk_io_channel *engine2_ch;
+	struct spdk_accel_task tasks[4], *task;
+	uint8_t src[TEST_SUBMIT_SIZE] = {}, dst[TEST_SUBMIT_SIZE];
+	struct accel_opcode_stats *stats = &g_accel_ch->stats[ACCEL_OPC_COPY];
+	int rc, i;
+
+	engine2_ch = calloc(1, sizeof(*engine2_ch));
+	SPDK_CU_ASSERT_FATAL(engine2_ch != NULL);
+
+	g_accel_engine.name = "hw1";
+	g_accel_engine.submit_tasks = dummy_submit_tasks;
+	g_opc_mask = _accel_op_to_bit(ACCEL_OPC_COPY);
+	g_hw_accel_engines[0] = &g_accel_engine;
+	g_hw_accel_engines[1] = &engine2;
+	g_num_hw_accel_engines = 2;
+	g_sw_accel_engine = &sw_accel_engine;
+	g_accel_ch->hw_chs[1].engine = &engine2;
+	g_accel_ch->hw_chs[1].ch = engine2_ch;
+	g_accel_ch->hw_chs[0].outstanding = 0;
+	g_accel_ch->num_hw_chs = 2;
+	memset(g_accel_ch->stats, 0, sizeof(g_accel_ch->stats));
+	g_dummy_submit_called = false;
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	for (i = 0; i < 4; i++) {
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[i], link);
+	}
+
+	/* Bad opcode and engine names are rejected. */
+	rc = accel_set_route("xor", NULL, 0, 0);
+	CU_ASSERT(rc == -EINVAL);
+	rc = accel_set_route("copy", "hw3", 0, 0);
+	CU_ASSERT(rc == -ENODEV);
+
+	/* Copies below the size threshold are done in software. */
+	rc = accel_set_route("copy", NULL, TEST_SUBMIT_SIZE + 1, 1);
+	CU_ASSERT(rc == 0);
+	memset(src, 0x5a, sizeof(src));
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(memcmp(dst, src, sizeof(src)) == 0);
+	CU_ASSERT(g_dummy_submit_called == false);
+	CU_ASSERT(stats->sw_ops == 1);
+	CU_ASSERT(strcmp(spdk_accel_get_last_engine_name(g_ch), "software") == 0);
+	task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, task, link);
+
+	/* With a queue depth of 1 the copies spread over both engines, then spill over. */
+	rc = accel_set_route("copy", NULL, 0, 1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(g_accel_ch->hw_chs[0].outstanding == 1);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_engine2_submitted == 1);
+	CU_ASSERT(g_accel_ch->hw_chs[1].outstanding == 1);
+	CU_ASSERT(strcmp(spdk_accel_get_last_engine_name(g_ch), "hw2") == 0);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(stats->hw_ops[0] == 1);
+	CU_ASSERT(stats->hw_ops[1] == 1);
+	CU_ASSERT(stats->sw_ops == 2);
+	CU_ASSERT(stats->spilled_ops == 1);
+	task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, task, link);
+
+	/* Completing the first engine's task makes room on it again. */
+	g_dummy_submit_called = false;
+	task = &tasks[1];
+	CU_ASSERT(task->hw_ch == &g_accel_ch->hw_chs[0]);
+	task->cb_fn = dummy_submit_cb_fn;
+	spdk_accel_task_complete(task, 0);
+	CU_ASSERT(g_accel_ch->hw_chs[0].outstanding == 0);
+	CU_ASSERT(task->hw_ch == NULL);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(stats->hw_ops[0] == 2);
+
+	/* Pinned routes only use the given engine, or software. */
+	g_accel_ch->hw_chs[0].outstanding = 0;
+	g_accel_ch->hw_chs[1].outstanding = 0;
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[0], link);
+	rc = accel_set_route("copy", "hw2", 0, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(strcmp(accel_route_get_engine_name(ACCEL_OPC_COPY), "hw2") == 0);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_engine2_submitted == 2);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[0], link);
+	rc = accel_set_route("copy", "software", 0, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(strcmp(accel_route_get_engine_name(ACCEL_OPC_COPY), "software") == 0);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_engine2_submitted == 2);
+	CU_ASSERT(TAILQ_FIRST(&g_sw_ch->tasks_to_complete) == &tasks[0]);
+	TAILQ_INIT(&g_sw_ch->tasks_to_complete);
+
+	rc = accel_set_route("copy", "auto", 0, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(strcmp(accel_route_get_engine_name(ACCEL_OPC_COPY), "hw1") == 0);
+
+	/* Copies of buffers that aren't registered with SPDK are done in software. */
+	g_accel_mem_map = (struct spdk_mem_map *)0xfeedbeef;
+	MOCK_SET(spdk_mem_map_translate, 0);
+	g_dummy_submit_called = false;
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[0], link);
+	memset(dst, 0, sizeof(dst));
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == false);
+	CU_ASSERT(memcmp(dst, src, sizeof(src)) == 0);
+	CU_ASSERT(stats->unregistered_ops == 1);
+	CU_ASSERT(TAILQ_FIRST(&g_sw_ch->tasks_to_complete) == &tasks[0]);
+	TAILQ_INIT(&g_sw_ch->tasks_to_complete);
+
+	/* Registered ones are offloaded. */
+	MOCK_SET(spdk_mem_map_translate, 1);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[0], link);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(stats->unregistered_ops == 1);
+	g_accel_mem_map = NULL;
+
+	g_accel_ch->hw_chs[0].outstanding = 0;
+	g_accel_ch->hw_chs[1].outstanding = 0;
+	g_accel_ch->num_hw_chs = 1;
+	g_num_hw_accel_engines = 0;
+	g_sw_accel_engine = NULL;
+	g_dummy_submit_called = false;
+	g_opc_mask = 0;
+	free(engine2_ch);
+}
+
 int main(int argc, char **argv)
 {
 	CU_pSuite	suite = NULL;
@@ -812,6 +1390,11 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32c_hw_engine_unsupported);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32cv);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_copy_crc32c);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_compress);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_encrypt);
+	CU_ADD_TEST(suite, test_accel_sequence);
+	CU_ADD_TEST(suite, test_accel_sequence_hw_busy);
+	CU_ADD_TEST(suite, test_accel_routing);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -307,6 +307,16 @@ DEFINE_STUB_V(spdk_reduce_vol_init, (struct spdk_reduce_vol_params *params,
 				     spdk_reduce_vol_op_with_handle_complete cb_fn, void *cb_arg));
 DEFINE_STUB_V(spdk_reduce_vol_destroy, (struct spdk_reduce_backing_dev *backing_dev,
 					spdk_reduce_vol_op_complete cb_fn, void *cb_arg));
+DEFINE_STUB_V(spdk_reduce_vol_compact, (struct spdk_reduce_vol *vol,
+					spdk_reduce_vol_op_complete cb_fn, void *cb_arg));
+
+DEFINE_STUB(spdk_accel_engine_get_io_channel, struct spdk_io_channel *, (void), NULL);
+DEFINE_STUB(spdk_accel_submit_compress, int, (struct spdk_io_channel *ch, struct iovec *dst_iovs,
+		uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size,
+		int flags, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_accel_submit_decompress, int, (struct spdk_io_channel *ch, struct iovec *dst_iovs,
+		uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size,
+		int flags, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
 
 /* DPDK stubs */
 #define DPDK_DYNFIELD_OFFSET offsetof(struct rte_mbuf, dynfield1[1])
@@ -210,6 +210,9 @@ DEFINE_STUB(spdk_accel_submit_crc32cv, int, (struct spdk_io_channel *ch, uint32_
 
 DEFINE_STUB_V(spdk_nvme_ctrlr_prepare_for_reset, (struct spdk_nvme_ctrlr *ctrlr));
 
+DEFINE_STUB(spdk_nvme_qpair_set_latency_tracking, int, (struct spdk_nvme_qpair *qpair, bool enable,
+		uint32_t num_outliers), 0);
+
 struct ut_nvme_req {
 	uint16_t			opc;
 	spdk_nvme_cmd_cb		cb_fn;
@@ -5918,6 +5921,141 @@ test_fail_path(void)
 	free(bdev_io);
 }
 
+static void
+test_multi_io_qpairs(void)
+{
+	struct nvme_path_id path = {};
+	struct spdk_nvme_ctrlr *ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr;
+	const int STRING_SIZE = 32;
+	const char *attached_names[STRING_SIZE];
+	struct nvme_bdev *bdev;
+	struct spdk_bdev_io *bdev_io1, *bdev_io2, *bdev_io3;
+	struct spdk_io_channel *ch;
+	struct nvme_bdev_channel *nbdev_ch;
+	struct nvme_qpair *nvme_qpair;
+	int rc;
+
+	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
+	ut_init_trid(&path.trid);
+
+	g_opts.io_queues_per_channel = 3;
+	g_opts.io_queue_spread = SPDK_BDEV_NVME_IO_SPREAD_ROUND_ROBIN;
+
+	set_thread(0);
+
+	ctrlr = ut_attach_ctrlr(&path.trid, 1, false, false);
+	SPDK_CU_ASSERT_FATAL(ctrlr != NULL);
+
+	g_ut_attach_ctrlr_status = 0;
+	g_ut_attach_bdev_count = 1;
+
+	rc = bdev_nvme_create(&path.trid, "nvme0", attached_names, STRING_SIZE,
+			      attach_ctrlr_done, NULL, NULL, NULL, false);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+
+	nvme_ctrlr = nvme_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr != NULL);
+
+	bdev = nvme_ctrlr_get_ns(nvme_ctrlr, 1)->bdev;
+	SPDK_CU_ASSERT_FATAL(bdev != NULL);
+
+	ch = spdk_get_io_channel(bdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	nbdev_ch = spdk_io_channel_get_ctx(ch);
+
+	nvme_qpair = STAILQ_FIRST(&nbdev_ch->io_path_list)->qpair;
+	SPDK_CU_ASSERT_FATAL(nvme_qpair != NULL);
+	CU_ASSERT(nvme_qpair->num_extra_qpairs == 2);
+	SPDK_CU_ASSERT_FATAL(nvme_qpair->qpair != NULL);
+	SPDK_CU_ASSERT_FATAL(nvme_qpair->extra_qpairs[0] != NULL);
+	SPDK_CU_ASSERT_FATAL(nvme_qpair->extra_qpairs[1] != NULL);
+
+	bdev_io1 = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_READ, bdev, ch);
+	ut_bdev_io_set_buf(bdev_io1);
+	bdev_io2 = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_READ, bdev, ch);
+	ut_bdev_io_set_buf(bdev_io2);
+	bdev_io3 = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_READ, bdev, ch);
+	ut_bdev_io_set_buf(bdev_io3);
+
+	/* Round robin spreads consecutive I/Os over all I/O qpairs. */
+	bdev_nvme_submit_request(ch, bdev_io1);
+	bdev_nvme_submit_request(ch, bdev_io2);
+	bdev_nvme_submit_request(ch, bdev_io3);
+
+	CU_ASSERT(nvme_qpair->qpair->num_outstanding_reqs == 1);
+	CU_ASSERT(nvme_qpair->extra_qpairs[0]->num_outstanding_reqs == 1);
+	CU_ASSERT(nvme_qpair->extra_qpairs[1]->num_outstanding_reqs == 1);
+
+	/* All I/O qpairs are polled by the same poll group. */
+	poll_threads();
+
+	CU_ASSERT(bdev_io1->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io2->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io3->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(nvme_qpair->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(nvme_qpair->extra_qpairs[0]->num_outstanding_reqs == 0);
+	CU_ASSERT(nvme_qpair->extra_qpairs[1]->num_outstanding_reqs == 0);
+
+	/* LBA spreading maps I/Os in the same LBA region to the same I/O qpair. */
+	g_opts.io_queue_spread = SPDK_BDEV_NVME_IO_SPREAD_LBA;
+
+	bdev_io1->u.bdev.offset_blocks = 0;
+	bdev_io2->u.bdev.offset_blocks = 1;
+	bdev_io3->u.bdev.offset_blocks = 1 << NVME_IO_SPREAD_LBA_SHIFT;
+
+	bdev_nvme_submit_request(ch, bdev_io1);
+	bdev_nvme_submit_request(ch, bdev_io2);
+	bdev_nvme_submit_request(ch, bdev_io3);
+
+	CU_ASSERT(nvme_qpair->qpair->num_outstanding_reqs == 2);
+	CU_ASSERT(nvme_qpair->extra_qpairs[0]->num_outstanding_reqs == 1);
+	CU_ASSERT(nvme_qpair->extra_qpairs[1]->num_outstanding_reqs == 0);
+
+	poll_threads();
+
+	CU_ASSERT(nvme_qpair->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(nvme_qpair->extra_qpairs[0]->num_outstanding_reqs == 0);
+
+	/* Disconnecting an additional I/O qpair resets the ctrlr, and the reset
+	 * recreates all I/O qpairs.
+	 */
+	nvme_qpair->extra_qpairs[1]->failure_reason = SPDK_NVME_QPAIR_FAILURE_UNKNOWN;
+
+	poll_threads();
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr->resetting == false);
+	CU_ASSERT(nvme_qpair->qpair != NULL);
+	CU_ASSERT(nvme_qpair->extra_qpairs[0] != NULL);
+	CU_ASSERT(nvme_qpair->extra_qpairs[1] != NULL);
+
+	free(bdev_io1);
+	free(bdev_io2);
+	free(bdev_io3);
+
+	spdk_put_io_channel(ch);
+
+	poll_threads();
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
+
+	g_opts.io_queues_per_channel = 1;
+	g_opts.io_queue_spread = SPDK_BDEV_NVME_IO_SPREAD_ROUND_ROBIN;
+}
+
 static void
 test_nvme_ns_cmp(void)
 {
@@ -5978,6 +6116,7 @@ main(int argc, const char **argv)
 	CU_ADD_TEST(suite, test_retry_failover_ctrlr);
 	CU_ADD_TEST(suite, test_fail_path);
 	CU_ADD_TEST(suite, test_nvme_ns_cmp);
+	CU_ADD_TEST(suite, test_multi_io_qpairs);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
@@ -62,6 +62,46 @@ bool g_bdev_alias_already_exists = false;
 bool g_lvs_with_name_already_exists = false;
 
 DEFINE_STUB_V(spdk_bdev_module_fini_start_done, (void));
+DEFINE_STUB(spdk_bdev_create_bs_dev_ro, int, (const char *bdev_name, spdk_bdev_event_cb_t event_cb,
+		void *event_ctx, struct spdk_bs_dev **bs_dev), -ENOTSUP);
+DEFINE_STUB(spdk_lvol_create_esnap_clone, int, (const void *esnap_id, uint32_t id_len,
+		uint64_t size_bytes, struct spdk_lvol_store *lvs, const char *clone_name,
+		spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg), -ENOTSUP);
+DEFINE_STUB(spdk_blob_is_esnap_clone, bool, (const struct spdk_blob *blob), false);
+DEFINE_STUB(spdk_blob_is_degraded, bool, (struct spdk_blob *blob), false);
+
+static struct spdk_blob *g_esnap_blob;
+static struct spdk_blob *g_esnap_removed_blob;
+static uint32_t g_esnap_remove_count;
+
+int
+spdk_blob_get_esnap_id(struct spdk_blob *blob, const void **id, size_t *len)
+{
+	static char uuid_str[SPDK_UUID_STRING_LEN];
+
+	if (blob != g_esnap_blob) {
+		return -EINVAL;
+	}
+
+	spdk_uuid_fmt_lower(uuid_str, sizeof(uuid_str), &g_bdev.uuid);
+	*id = uuid_str;
+	*len = sizeof(uuid_str);
+	return 0;
+}
+
+void
+spdk_blob_remove_esnap_dev(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	g_esnap_removed_blob = blob;
+	g_esnap_remove_count++;
+	cb_fn(cb_arg, 0);
+}
+
+const struct spdk_uuid *
+spdk_bdev_get_uuid(const struct spdk_bdev *bdev)
+{
+	return &bdev->uuid;
+}
 
 const struct spdk_bdev_aliases_list *
 spdk_bdev_get_aliases(const struct spdk_bdev *bdev)
@@ -221,11 +261,17 @@ spdk_blob_is_thin_provisioned(struct spdk_blob *blob)
 	return false;
 }
 
+void
+spdk_blob_get_fragmentation(struct spdk_blob *blob, struct spdk_blob_fragmentation *frag)
+{
+	memset(frag, 0, sizeof(*frag));
+}
+
 static struct spdk_lvol *_lvol_create(struct spdk_lvol_store *lvs);
 
 void
-spdk_lvs_load(struct spdk_bs_dev *dev,
-	      spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
+spdk_lvs_load_ext(struct spdk_bs_dev *dev, const struct spdk_lvs_opts *opts,
+		  spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol_store *lvs = NULL;
 	int i;
@@ -312,6 +358,31 @@ bdev_blob_get_base_bdev(struct spdk_bs_dev *bs_dev)
 	return &g_bdev;
 }
 
+static uint32_t g_bs_dev_writes;
+
+static struct spdk_io_channel *
+bdev_blob_create_channel(struct spdk_bs_dev *bs_dev)
+{
+	return g_ch;
+}
+
+static void
+bdev_blob_destroy_channel(struct spdk_bs_dev *bs_dev, struct spdk_io_channel *channel)
+{
+	CU_ASSERT(channel == g_ch);
+}
+
+static void
+bdev_blob_write(struct spdk_bs_dev *bs_dev, struct spdk_io_channel *channel, void *payload,
+		uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	g_bs_dev_writes++;
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, 0);
+}
+
+static spdk_bdev_event_cb_t g_bs_dev_event_cb;
+static void *g_bs_dev_event_ctx;
+
 int
 spdk_bdev_create_bs_dev_ext(const char *bdev_name, spdk_bdev_event_cb_t event_cb,
 			    void *event_ctx, struct spdk_bs_dev **_bs_dev)
@@ -326,6 +397,11 @@ spdk_bdev_create_bs_dev_ext(const char *bdev_name, spdk_bdev_event_cb_t event_cb
 	SPDK_CU_ASSERT_FATAL(bs_dev != NULL);
 	bs_dev->destroy = bdev_blob_destroy;
 	bs_dev->get_base_bdev = bdev_blob_get_base_bdev;
+	bs_dev->create_channel = bdev_blob_create_channel;
+	bs_dev->destroy_channel = bdev_blob_destroy_channel;
+	bs_dev->write = bdev_blob_write;
+	g_bs_dev_event_cb = event_cb;
+	g_bs_dev_event_ctx = event_ctx;
 
 	*_bs_dev = bs_dev;
 
@@ -701,8 +777,8 @@ ut_lvs_destroy(void)
 	struct spdk_lvol_store *lvs;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -735,8 +811,8 @@ ut_lvol_init(void)
 	int rc;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -770,8 +846,8 @@ ut_lvol_snapshot(void)
 	struct spdk_lvol *lvol = NULL;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -820,8 +896,8 @@ ut_lvol_clone(void)
 	struct spdk_lvol *clone = NULL;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -886,8 +962,8 @@ ut_lvol_hotremove(void)
 	lvol_already_opened = false;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -904,6 +980,126 @@ ut_lvol_hotremove(void)
 
 }
 
+static void
+ut_lvol_esnap_hotremove(void)
+{
+	struct spdk_lvol_store *lvs;
+	struct spdk_lvol *lvol, *clone;
+	int rc;
+
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+	lvs = g_lvol_store;
+
+	rc = vbdev_lvol_create(lvs, "lvol", 10, false, LVOL_CLEAR_WITH_DEFAULT,
+			       vbdev_lvol_create_complete, NULL);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	lvol = g_lvol;
+	lvol->blob = (struct spdk_blob *)0x1000;
+
+	rc = vbdev_lvol_create(lvs, "clone", 10, true, LVOL_CLEAR_WITH_DEFAULT,
+			       vbdev_lvol_create_complete, NULL);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	clone = g_lvol;
+	clone->blob = (struct spdk_blob *)0x2000;
+
+	spdk_uuid_generate(&g_bdev.uuid);
+	g_esnap_blob = clone->blob;
+	g_esnap_removed_blob = NULL;
+	g_esnap_remove_count = 0;
+
+	/* Only the lvol reading from the removed bdev drops its external snapshot */
+	vbdev_lvol_esnap_event_cb(SPDK_BDEV_EVENT_RESIZE, &g_bdev, lvs);
+	CU_ASSERT(g_esnap_remove_count == 0);
+	vbdev_lvol_esnap_event_cb(SPDK_BDEV_EVENT_REMOVE, &g_bdev, lvs);
+	CU_ASSERT(g_esnap_remove_count == 1);
+	CU_ASSERT(g_esnap_removed_blob == clone->blob);
+
+	g_esnap_blob = NULL;
+	lvol->blob = NULL;
+	clone->blob = NULL;
+	g_lvol = clone;
+	vbdev_lvol_destroy(g_lvol, lvol_store_op_complete, NULL);
+	CU_ASSERT(g_lvol == NULL);
+	g_lvol = lvol;
+	vbdev_lvol_destroy(g_lvol, lvol_store_op_complete, NULL);
+	CU_ASSERT(g_lvol == NULL);
+
+	vbdev_lvs_destruct(lvs, lvol_store_op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(g_lvol_store == NULL);
+}
+
+static struct spdk_bs_dev *g_shallow_copy_dev;
+static spdk_lvol_op_complete g_shallow_copy_cb_fn;
+static void *g_shallow_copy_cb_arg;
+
+void
+spdk_lvol_shallow_copy(struct spdk_lvol *lvol, struct spdk_bs_dev *ext_dev,
+		       spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+		       spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	g_shallow_copy_dev = ext_dev;
+	g_shallow_copy_cb_fn = cb_fn;
+	g_shallow_copy_cb_arg = cb_arg;
+}
+
+static int g_shallow_copy_write_rc;
+
+static void
+ut_shallow_copy_write_cpl(struct spdk_io_channel *channel, void *cb_arg, int bserrno)
+{
+	g_shallow_copy_write_rc = bserrno;
+}
+
+static void
+ut_lvol_shallow_copy_hotremove(void)
+{
+	struct spdk_bs_dev_cb_args cb_args = {};
+	struct spdk_io_channel *channel;
+	struct spdk_bs_dev *dev;
+	uint8_t payload[512];
+	int rc;
+
+	lvol_already_opened = false;
+	g_bs_dev_writes = 0;
+
+	rc = vbdev_lvol_shallow_copy(NULL, "bdev", NULL, NULL, lvol_store_op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_shallow_copy_dev != NULL);
+	CU_ASSERT(lvol_already_opened == true);
+	dev = g_shallow_copy_dev;
+
+	channel = dev->create_channel(dev);
+	cb_args.cb_fn = ut_shallow_copy_write_cpl;
+	cb_args.channel = channel;
+
+	/* Writes of the copy reach the destination */
+	g_shallow_copy_write_rc = -1;
+	dev->write(dev, channel, payload, 0, 1, &cb_args);
+	CU_ASSERT(g_shallow_copy_write_rc == 0);
+	CU_ASSERT(g_bs_dev_writes == 1);
+
+	/* Once the destination is removed, the copy fails with the next write */
+	g_bs_dev_event_cb(SPDK_BDEV_EVENT_REMOVE, &g_bdev, g_bs_dev_event_ctx);
+	dev->write(dev, channel, payload, 1, 1, &cb_args);
+	CU_ASSERT(g_shallow_copy_write_rc == -ENODEV);
+	CU_ASSERT(g_bs_dev_writes == 1);
+	dev->destroy_channel(dev, channel);
+
+	/* Completion of the copy closes the destination */
+	g_lvserrno = -1;
+	g_shallow_copy_cb_fn(g_shallow_copy_cb_arg, -ENODEV);
+	CU_ASSERT(g_lvserrno == -ENODEV);
+	CU_ASSERT(lvol_already_opened == false);
+	g_shallow_copy_dev = NULL;
+}
+
 static void
 ut_lvs_examine_check(bool success)
 {
@@ -980,8 +1176,8 @@ ut_lvol_rename(void)
 	int rc;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -1047,7 +1243,7 @@ ut_bdev_finish(void)
 	/* Scenario 1
 	 * Test unload of lvs with no lvols during bdev finish. */
 
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP,
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
 			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
@@ -1070,7 +1266,7 @@ ut_bdev_finish(void)
 	 * then start bdev finish. This should unload the remaining lvol and
 	 * lvol store. */
 
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP,
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
 			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
@@ -1118,8 +1314,8 @@ ut_lvol_resize(void)
 	int rc = 0;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -1164,8 +1360,8 @@ ut_lvol_set_read_only(void)
 	int rc = 0;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -1204,8 +1400,8 @@ ut_lvs_unload(void)
 	struct spdk_lvol_store *lvs;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -1240,8 +1436,8 @@ ut_lvs_init(void)
 	/* spdk_lvs_init() fails */
 	lvol_store_initialize_fail = true;
 
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc != 0);
 	CU_ASSERT(g_lvserrno == 0);
 	CU_ASSERT(g_lvol_store == NULL);
@@ -1251,8 +1447,8 @@ ut_lvs_init(void)
 	/* spdk_lvs_init_cb() fails */
 	lvol_store_initialize_cb_fail = true;
 
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno != 0);
 	CU_ASSERT(g_lvol_store == NULL);
@@ -1260,8 +1456,8 @@ ut_lvs_init(void)
 	lvol_store_initialize_cb_fail = false;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
@@ -1271,8 +1467,8 @@ ut_lvs_init(void)
 	g_lvol_store = NULL;
 
 	/* Bdev with lvol store already claimed */
-	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, lvol_store_op_with_handle_complete,
-			      NULL);
+	rc = vbdev_lvs_create("bdev", "lvs", 0, LVS_CLEAR_WITH_UNMAP, 0,
+			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc != 0);
 	CU_ASSERT(g_lvserrno == 0);
 	CU_ASSERT(g_lvol_store == NULL);
@@ -1405,7 +1601,7 @@ ut_lvs_rename(void)
 	struct spdk_lvol_store *lvs;
 
 	/* Lvol store is successfully created */
-	rc = vbdev_lvs_create("bdev", "old_lvs_name", 0, LVS_CLEAR_WITH_UNMAP,
+	rc = vbdev_lvs_create("bdev", "old_lvs_name", 0, LVS_CLEAR_WITH_UNMAP, 0,
 			      lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
@@ -1471,6 +1667,8 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, ut_lvol_resize);
 	CU_ADD_TEST(suite, ut_lvol_set_read_only);
 	CU_ADD_TEST(suite, ut_lvol_hotremove);
+	CU_ADD_TEST(suite, ut_lvol_esnap_hotremove);
+	CU_ADD_TEST(suite, ut_lvol_shallow_copy_hotremove);
 	CU_ADD_TEST(suite, ut_vbdev_lvol_get_io_channel);
 	CU_ADD_TEST(suite, ut_vbdev_lvol_io_type_supported);
 	CU_ADD_TEST(suite, ut_lvol_read_write);
@@ -4107,273 +4107,406 @@ blob_thin_prov_write_count_io(void)
 }
 
 static void
-blob_thin_prov_rle(void)
+blob_thin_prov_channel_reserved_clusters(void)
 {
-	static const uint8_t zero[10 * 4096] = { 0 };
-	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_store *bs;
 	struct spdk_blob *blob;
-	struct spdk_io_channel *channel;
+	struct spdk_io_channel *ch;
+	struct spdk_bs_channel *bs_ch;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
 	struct spdk_blob_opts opts;
 	spdk_blob_id blobid;
 	uint64_t free_clusters;
 	uint64_t page_size;
-	uint8_t payload_read[10 * 4096];
-	uint8_t payload_write[10 * 4096];
+	uint8_t payload_write[4096];
+	uint8_t payload_read[4096];
 	uint64_t write_bytes;
-	uint64_t read_bytes;
-	uint64_t io_unit;
+	const uint32_t CLUSTER_SZ = 16384;
+	const uint32_t RESERVED_CLUSTERS = 4;
+	uint32_t pages_per_cluster;
+	uint32_t i;
+
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = CLUSTER_SZ;
+	bs_opts.channel_reserved_clusters = RESERVED_CLUSTERS;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	CU_ASSERT(bs->channel_reserved_clusters == RESERVED_CLUSTERS);
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
 	page_size = spdk_bs_get_page_size(bs);
+	pages_per_cluster = CLUSTER_SZ / page_size;
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
-	opts.num_clusters = 5;
+	opts.num_clusters = 8;
 
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
-
-	/* Target specifically second cluster in a blob as first allocation */
-	io_unit = bs_cluster_to_page(bs, 1) * bs_io_unit_per_page(bs);
+	/* Use a channel on thread other than md thread, so it is not shared with md channel */
+	set_thread(1);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	bs_ch = spdk_io_channel_get_ctx(ch);
 
-	/* Payload should be all zeros from unallocated clusters */
-	memset(payload_read, 0xFF, sizeof(payload_read));
-	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
+	/* First allocation reserves a batch of clusters for the channel */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, ch, payload_write, 0, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
+	CU_ASSERT(free_clusters - RESERVED_CLUSTERS == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(bs_ch->num_reserved_clusters - bs_ch->reserved_clusters_head == RESERVED_CLUSTERS - 1);
 
+	/* Allocations of different clusters proceed in parallel and are served from
+	 * the reservation. The second write to cluster 1 waits for its allocation. */
 	write_bytes = g_dev_write_bytes;
-	read_bytes = g_dev_read_bytes;
-
-	/* Issue write to second cluster in a blob */
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, io_unit, 10, blob_op_complete, NULL);
+	for (i = 1; i < RESERVED_CLUSTERS; i++) {
+		spdk_blob_io_write(blob, ch, payload_write, pages_per_cluster * i, 1, blob_op_complete, NULL);
+	}
+	spdk_blob_io_write(blob, ch, payload_write, pages_per_cluster + 1, 1, blob_op_complete, NULL);
+	CU_ASSERT(bs_ch->num_cluster_allocs == RESERVED_CLUSTERS - 1);
+	CU_ASSERT(TAILQ_EMPTY(&bs_ch->need_cluster_alloc));
+	CU_ASSERT(free_clusters - RESERVED_CLUSTERS == spdk_bs_free_cluster_count(bs));
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
-	/* For thin-provisioned blob we need to write 10 pages plus one page metadata and
-	 * read 0 bytes */
+	CU_ASSERT(bs_ch->num_cluster_allocs == 0);
+	CU_ASSERT(bs_ch->num_reserved_clusters == bs_ch->reserved_clusters_head);
+	CU_ASSERT(free_clusters - RESERVED_CLUSTERS == spdk_bs_free_cluster_count(bs));
 	if (g_use_extent_table) {
-		/* Add one more page for EXTENT_PAGE write */
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12);
-	} else {
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11);
+		/* Four data pages, plus the extent page written once for the first
+		 * insert and once more for the two inserts that arrived meanwhile. */
+		CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == RESERVED_CLUSTERS + 2);
 	}
-	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
 
-	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
+	for (i = 0; i < RESERVED_CLUSTERS; i++) {
+		CU_ASSERT(bs_io_unit_is_allocated(blob, pages_per_cluster * i));
+		memset(payload_read, 0, sizeof(payload_read));
+		spdk_blob_io_read(blob, ch, payload_read, pages_per_cluster * i, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_write, payload_read, sizeof(payload_read)) == 0);
+	}
+
+	/* Reservation is exhausted, so next allocation reserves another batch */
+	spdk_blob_io_write(blob, ch, payload_write, pages_per_cluster * RESERVED_CLUSTERS, 1,
+			   blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+	CU_ASSERT(free_clusters - 2 * RESERVED_CLUSTERS == spdk_bs_free_cluster_count(bs));
 
-	spdk_bs_free_io_channel(channel);
+	/* Unused reserved clusters are returned when the channel is freed */
+	spdk_bs_free_io_channel(ch);
 	poll_threads();
+	set_thread(0);
+	CU_ASSERT(free_clusters - RESERVED_CLUSTERS - 1 == spdk_bs_free_cluster_count(bs));
 
+	/* Make sure the allocations were persisted */
 	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-
-	ut_bs_reload(&bs, NULL);
+	ut_bs_reload(&bs, &bs_opts);
+	CU_ASSERT(free_clusters - RESERVED_CLUSTERS - 1 == spdk_bs_free_cluster_count(bs));
 
 	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	blob = g_blob;
+	for (i = 0; i <= RESERVED_CLUSTERS; i++) {
+		CU_ASSERT(bs_io_unit_is_allocated(blob, pages_per_cluster * i));
+	}
 
-	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	g_blob = NULL;
+	g_blobid = 0;
 
-	/* Read second cluster after blob reload to confirm data written */
-	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
+	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+	g_bs = NULL;
+}
 
-	spdk_bs_free_io_channel(channel);
-	poll_threads();
+static void
+ut_bs_init_small_clusters(void)
+{
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
 
-	ut_blob_close_and_delete(bs, blob);
+	/* Use a small cluster size, so that there are enough clusters for blobs
+	 * to be placed away from each other. */
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = 16384;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
 }
 
 static void
-blob_thin_prov_rw_iov(void)
+blob_thin_prov_locality(void)
 {
-	static const uint8_t zero[10 * 4096] = { 0 };
-	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob1, *blob2;
 	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
-	uint64_t free_clusters;
-	uint8_t payload_read[10 * 4096];
-	uint8_t payload_write[10 * 4096];
-	struct iovec iov_read[3];
-	struct iovec iov_write[3];
+	struct spdk_blob_fragmentation frag;
+	uint64_t pages_per_cluster;
+	uint8_t payload[4096];
+	uint64_t cluster1, cluster2;
+	uint64_t i;
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
+	ut_bs_init_small_clusters();
+	bs = g_bs;
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
 
 	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
+	opts.num_clusters = 8;
 
-	blob = ut_blob_create_and_open(bs, &opts);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	blob1 = ut_blob_create_and_open(bs, &opts);
+	blob2 = ut_blob_create_and_open(bs, &opts);
 
-	CU_ASSERT(blob->active.num_clusters == 0);
+	spdk_blob_get_fragmentation(blob1, &frag);
+	CU_ASSERT(frag.num_allocated_clusters == 0);
+	CU_ASSERT(frag.num_extents == 0);
 
-	/* The blob started at 0 clusters. Resize it to be 5, but still unallocated. */
-	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 5);
+	/* Interleave writes to both blobs. Clusters of each blob should still
+	 * end up next to each other on disk. */
+	memset(payload, 0xAA, sizeof(payload));
+	for (i = 0; i < 4; i++) {
+		spdk_blob_io_write(blob1, channel, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		spdk_blob_io_write(blob2, channel, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
 
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	/* Sync must not change anything */
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 5);
+	cluster1 = bs_lba_to_cluster(bs, blob1->active.clusters[0]);
+	cluster2 = bs_lba_to_cluster(bs, blob2->active.clusters[0]);
+	CU_ASSERT(cluster1 != cluster2);
+	for (i = 1; i < 4; i++) {
+		CU_ASSERT(bs_lba_to_cluster(bs, blob1->active.clusters[i]) == cluster1 + i);
+		CU_ASSERT(bs_lba_to_cluster(bs, blob2->active.clusters[i]) == cluster2 + i);
+	}
 
-	/* Payload should be all zeros from unallocated clusters */
-	memset(payload_read, 0xAA, sizeof(payload_read));
-	iov_read[0].iov_base = payload_read;
-	iov_read[0].iov_len = 3 * 4096;
-	iov_read[1].iov_base = payload_read + 3 * 4096;
-	iov_read[1].iov_len = 4 * 4096;
-	iov_read[2].iov_base = payload_read + 7 * 4096;
-	iov_read[2].iov_len = 3 * 4096;
-	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
+	spdk_blob_get_fragmentation(blob1, &frag);
+	CU_ASSERT(frag.num_allocated_clusters == 4);
+	CU_ASSERT(frag.num_extents == 1);
+
+	/* Skipping a cluster leaves room for it, so it can be filled in later
+	 * without breaking the extent. */
+	spdk_blob_io_write(blob1, channel, payload, 6 * pages_per_cluster, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
+	CU_ASSERT(bs_lba_to_cluster(bs, blob1->active.clusters[6]) == cluster1 + 6);
 
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	iov_write[0].iov_base = payload_write;
-	iov_write[0].iov_len = 1 * 4096;
-	iov_write[1].iov_base = payload_write + 1 * 4096;
-	iov_write[1].iov_len = 5 * 4096;
-	iov_write[2].iov_base = payload_write + 6 * 4096;
-	iov_write[2].iov_len = 4 * 4096;
+	spdk_blob_get_fragmentation(blob1, &frag);
+	CU_ASSERT(frag.num_allocated_clusters == 5);
+	CU_ASSERT(frag.num_extents == 2);
 
-	spdk_blob_io_writev(blob, channel, iov_write, 3, 250, 10, blob_op_complete, NULL);
+	spdk_blob_io_write(blob1, channel, payload, 5 * pages_per_cluster, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-
-	memset(payload_read, 0xAA, sizeof(payload_read));
-	iov_read[0].iov_base = payload_read;
-	iov_read[0].iov_len = 3 * 4096;
-	iov_read[1].iov_base = payload_read + 3 * 4096;
-	iov_read[1].iov_len = 4 * 4096;
-	iov_read[2].iov_base = payload_read + 7 * 4096;
-	iov_read[2].iov_len = 3 * 4096;
-	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
+	spdk_blob_io_write(blob1, channel, payload, 4 * pages_per_cluster, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+
+	spdk_blob_get_fragmentation(blob1, &frag);
+	CU_ASSERT(frag.num_allocated_clusters == 7);
+	CU_ASSERT(frag.num_extents == 1);
+
+	ut_blob_close_and_delete(bs, blob1);
+	ut_blob_close_and_delete(bs, blob2);
 
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
 
-	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
 }
 
-struct iter_ctx {
-	int		current_iter;
-	spdk_blob_id	blobid[4];
-};
-
 static void
-test_iter(void *arg, struct spdk_blob *blob, int bserrno)
+blob_preallocate(void)
 {
-	struct iter_ctx *iter_ctx = arg;
-	spdk_blob_id blobid;
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob, *snapshot_blob, *clone;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	struct spdk_blob_fragmentation frag;
+	spdk_blob_id blobid, snapshotid, cloneid;
+	uint64_t free_clusters;
+	uint64_t pages_per_cluster;
+	uint8_t payload_write[4096];
+	uint8_t payload_read[4096];
+	uint8_t zero[4096] = { 0 };
+	uint64_t cluster;
+	uint64_t i;
 
-	CU_ASSERT(bserrno == 0);
-	blobid = spdk_blob_get_id(blob);
-	CU_ASSERT(blobid == iter_ctx->blobid[iter_ctx->current_iter++]);
-}
+	ut_bs_init_small_clusters();
+	bs = g_bs;
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
 
-static void
-bs_load_iter_test(void)
-{
-	struct spdk_blob_store *bs;
-	struct spdk_bs_dev *dev;
-	struct iter_ctx iter_ctx = { 0 };
-	struct spdk_blob *blob;
-	int i, rc;
-	struct spdk_bs_opts opts;
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
+	/* Fill a thick blob with data and delete it, so that clusters on disk are not zeroed */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 10;
+	blob = ut_blob_create_and_open(bs, &opts);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	for (i = 0; i < 10; i++) {
+		spdk_blob_io_write(blob, channel, payload_write, i * pages_per_cluster, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 10;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	spdk_blob_io_write(blob, channel, payload_write, 2 * pages_per_cluster, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	cluster = bs_lba_to_cluster(bs, blob->active.clusters[2]);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
 
-	for (i = 0; i < 4; i++) {
-		blob = ut_blob_create_and_open(bs, NULL);
-		iter_ctx.blobid[i] = spdk_blob_get_id(blob);
+	/* Range outside of the blob */
+	spdk_blob_preallocate(blob, 8, 3, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
 
-		/* Just save the blobid as an xattr for testing purposes. */
-		rc = spdk_blob_set_xattr(blob, "blobid", &iter_ctx.blobid[i], sizeof(spdk_blob_id));
-		CU_ASSERT(rc == 0);
+	/* Preallocate clusters around the written one */
+	spdk_blob_preallocate(blob, 0, 6, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters - 6 == spdk_bs_free_cluster_count(bs));
+	for (i = 0; i < 6; i++) {
+		CU_ASSERT(bs_lba_to_cluster(bs, blob->active.clusters[i]) == cluster - 2 + i);
+	}
+	for (i = 6; i < 10; i++) {
+		CU_ASSERT(blob->active.clusters[i] == 0);
+	}
 
-		/* Resize the blob */
-		spdk_blob_resize(blob, i, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
+	spdk_blob_get_fragmentation(blob, &frag);
+	CU_ASSERT(frag.num_allocated_clusters == 6);
+	CU_ASSERT(frag.num_extents == 1);
 
-		spdk_blob_close(blob, blob_op_complete, NULL);
+	/* Preallocated clusters are zeroed, written data is kept */
+	for (i = 0; i < 6; i++) {
+		memset(payload_read, 0xFF, sizeof(payload_read));
+		spdk_blob_io_read(blob, channel, payload_read, i * pages_per_cluster, 1, blob_op_complete, NULL);
 		poll_threads();
 		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_read, i == 2 ? payload_write : zero, sizeof(payload_read)) == 0);
 	}
 
-	g_bserrno = -1;
-	spdk_bs_unload(bs, bs_op_complete, NULL);
+	/* Nothing to allocate */
+	spdk_blob_preallocate(blob, 0, 6, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters - 6 == spdk_bs_free_cluster_count(bs));
 
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
-	opts.iter_cb_fn = test_iter;
-	opts.iter_cb_arg = &iter_ctx;
+	/* Preallocation was persisted */
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	/* Test blob iteration during load after a clean shutdown. */
-	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
+	if (g_use_extent_table) {
+		struct spdk_bit_array *taken_md_pages;
+		uint32_t page, free_md_pages = 0;
+
+		/* A single md page is claimed for the one missing extent page,
+		 * so preallocation succeeds with only two md pages left */
+		blob = ut_blob_create_and_open(bs, &opts);
+		taken_md_pages = spdk_bit_array_create(spdk_bit_array_capacity(bs->used_md_pages));
+		SPDK_CU_ASSERT_FATAL(taken_md_pages != NULL);
+		for (page = 1; page < spdk_bit_array_capacity(bs->used_md_pages); page++) {
+			if (spdk_bit_array_get(bs->used_md_pages, page)) {
+				continue;
+			}
+			if (free_md_pages++ < 2) {
+				continue;
+			}
+			spdk_bit_array_set(bs->used_md_pages, page);
+			spdk_bit_array_set(taken_md_pages, page);
+		}
+
+		spdk_blob_preallocate(blob, 0, 10, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(free_clusters - 10 == spdk_bs_free_cluster_count(bs));
+
+		for (page = 0; page < spdk_bit_array_capacity(taken_md_pages); page++) {
+			if (spdk_bit_array_get(taken_md_pages, page)) {
+				spdk_bit_array_clear(bs->used_md_pages, page);
+			}
+		}
+		spdk_bit_array_free(&taken_md_pages);
+		ut_blob_close_and_delete(bs, blob);
+		CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	}
+
+	/* Clones are not supported */
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	snapshotid = g_blobid;
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot_blob = g_blob;
 
-	/* Dirty shutdown */
-	bs_free(bs);
+	spdk_bs_create_clone(bs, snapshotid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	cloneid = g_blobid;
+	spdk_bs_open_blob(bs, cloneid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	clone = g_blob;
 
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
-	opts.iter_cb_fn = test_iter;
-	iter_ctx.current_iter = 0;
-	opts.iter_cb_arg = &iter_ctx;
+	spdk_blob_preallocate(clone, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
 
-	/* Test blob iteration during load after a dirty shutdown. */
-	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
+	/* Snapshots are read only */
+	spdk_blob_preallocate(snapshot_blob, 0, 1, blob_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	CU_ASSERT(g_bserrno == -EPERM);
+
+	ut_blob_close_and_delete(bs, clone);
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot_blob);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	g_blob = NULL;
+	g_blobid = 0;
 
 	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
@@ -4382,29 +4515,25 @@ bs_load_iter_test(void)
 }
 
 static void
-blob_snapshot_rw(void)
+blob_thin_prov_rle(void)
 {
 	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob, *snapshot;
+	struct spdk_blob *blob;
 	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
-	spdk_blob_id blobid, snapshotid;
+	spdk_blob_id blobid;
 	uint64_t free_clusters;
-	uint64_t cluster_size;
 	uint64_t page_size;
 	uint8_t payload_read[10 * 4096];
 	uint8_t payload_write[10 * 4096];
 	uint64_t write_bytes;
 	uint64_t read_bytes;
+	uint64_t io_unit;
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
-	cluster_size = spdk_bs_get_cluster_size(bs);
 	page_size = spdk_bs_get_page_size(bs);
 
-	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
-
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
 	opts.num_clusters = 5;
@@ -4413,87 +4542,81 @@ blob_snapshot_rw(void)
 	blobid = spdk_blob_get_id(blob);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* Target specifically second cluster in a blob as first allocation */
+	io_unit = bs_cluster_to_page(bs, 1) * bs_io_unit_per_page(bs);
 
+	/* Payload should be all zeros from unallocated clusters */
 	memset(payload_read, 0xFF, sizeof(payload_read));
-	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
+	write_bytes = g_dev_write_bytes;
+	read_bytes = g_dev_read_bytes;
+
+	/* Issue write to second cluster in a blob */
 	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
+	spdk_blob_io_write(blob, channel, payload_write, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	/* For thin-provisioned blob we need to write 10 pages plus one page metadata and
+	 * read 0 bytes */
+	if (g_use_extent_table) {
+		/* Add one more page for EXTENT_PAGE write */
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12);
+	} else {
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11);
+	}
+	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
 
-	/* Create snapshot from blob */
-	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	snapshotid = g_blobid;
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	spdk_bs_free_io_channel(channel);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot = g_blob;
-	CU_ASSERT(snapshot->data_ro == true);
-	CU_ASSERT(snapshot->md_ro == true);
-
-	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
-
-	write_bytes = g_dev_write_bytes;
-	read_bytes = g_dev_read_bytes;
 
-	memset(payload_write, 0xAA, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
+	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
 
-	/* For a clone we need to allocate and copy one cluster, update one page of metadata
-	 * and then write 10 pages of payload.
-	 */
-	if (g_use_extent_table) {
-		/* Add one more page for EXTENT_PAGE write */
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12 + cluster_size);
-	} else {
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11 + cluster_size);
-	}
-	CU_ASSERT(g_dev_read_bytes - read_bytes == cluster_size);
+	ut_bs_reload(&bs, NULL);
 
-	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
 
-	/* Data on snapshot should not change after write to clone */
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_read(snapshot, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* Read second cluster after blob reload to confirm data written */
+	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	ut_blob_close_and_delete(bs, blob);
-	ut_blob_close_and_delete(bs, snapshot);
-
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
-	g_blob = NULL;
-	g_blobid = 0;
+
+	ut_blob_close_and_delete(bs, blob);
 }
 
 static void
-blob_snapshot_rw_iov(void)
+blob_thin_prov_rw_iov(void)
 {
 	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob, *snapshot;
+	struct spdk_blob *blob;
 	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
-	spdk_blob_id blobid, snapshotid;
 	uint64_t free_clusters;
 	uint8_t payload_read[10 * 4096];
 	uint8_t payload_write[10 * 4096];
@@ -4507,29 +4630,25 @@ blob_snapshot_rw_iov(void)
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
-	opts.num_clusters = 5;
 
 	blob = ut_blob_create_and_open(bs, &opts);
-	blobid = spdk_blob_get_id(blob);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
+	CU_ASSERT(blob->active.num_clusters == 0);
 
-	/* Create snapshot from blob */
-	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	/* The blob started at 0 clusters. Resize it to be 5, but still unallocated. */
+	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	snapshotid = g_blobid;
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 5);
 
-	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot = g_blob;
-	CU_ASSERT(snapshot->data_ro == true);
-	CU_ASSERT(snapshot->md_ro == true);
-	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
+	/* Sync must not change anything */
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 5);
 
 	/* Payload should be all zeros from unallocated clusters */
 	memset(payload_read, 0xAA, sizeof(payload_read));
@@ -4572,86 +4691,128 @@ blob_snapshot_rw_iov(void)
 	poll_threads();
 
 	ut_blob_close_and_delete(bs, blob);
-	ut_blob_close_and_delete(bs, snapshot);
 }
 
-/**
- * Inflate / decouple parent rw unit tests.
- *
- * --------------
- * original blob:         0         1         2         3         4
- *                   ,---------+---------+---------+---------+---------.
- *         snapshot  |xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|    -    |
- *                   +---------+---------+---------+---------+---------+
- *         snapshot2 |    -    |yyyyyyyyy|    -    |yyyyyyyyy|    -    |
- *                   +---------+---------+---------+---------+---------+
- *         blob      |    -    |zzzzzzzzz|    -    |    -    |    -    |
- *                   '---------+---------+---------+---------+---------'
- *                   .         .         .         .         .         .
- * --------          .         .         .         .         .         .
- * inflate:          .         .         .         .         .         .
- *                   ,---------+---------+---------+---------+---------.
- *         blob      |xxxxxxxxx|zzzzzzzzz|xxxxxxxxx|yyyyyyyyy|000000000|
- *                   '---------+---------+---------+---------+---------'
- *
- *         NOTE: needs to allocate 4 clusters, thin provisioning removed, dependency
- *               on snapshot2 and snapshot removed .         .         .
- *                   .         .         .         .         .         .
- * ----------------  .         .         .         .         .         .
- * decouple parent:  .         .         .         .         .         .
- *                   ,---------+---------+---------+---------+---------.
- *         snapshot  |xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|    -    |
- *                   +---------+---------+---------+---------+---------+
- *         blob      |    -    |zzzzzzzzz|    -    |yyyyyyyyy|    -    |
- *                   '---------+---------+---------+---------+---------'
- *
- *         NOTE: needs to allocate 1 cluster, 3 clusters unallocated, dependency
- *               on snapshot2 removed and on snapshot still exists. Snapshot2
- *               should remain a clone of snapshot.
- */
+struct iter_ctx {
+	int		current_iter;
+	spdk_blob_id	blobid[4];
+};
+
 static void
-_blob_inflate_rw(bool decouple_parent)
+test_iter(void *arg, struct spdk_blob *blob, int bserrno)
 {
-	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob, *snapshot, *snapshot2;
-	struct spdk_io_channel *channel;
-	struct spdk_blob_opts opts;
-	spdk_blob_id blobid, snapshotid, snapshot2id;
-	uint64_t free_clusters;
-	uint64_t cluster_size;
+	struct iter_ctx *iter_ctx = arg;
+	spdk_blob_id blobid;
 
-	uint64_t payload_size;
-	uint8_t *payload_read;
-	uint8_t *payload_write;
-	uint8_t *payload_clone;
+	CU_ASSERT(bserrno == 0);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(blobid == iter_ctx->blobid[iter_ctx->current_iter++]);
+}
 
-	uint64_t pages_per_cluster;
-	uint64_t pages_per_payload;
+static void
+bs_load_iter_test(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct iter_ctx iter_ctx = { 0 };
+	struct spdk_blob *blob;
+	int i, rc;
+	struct spdk_bs_opts opts;
 
-	int i;
-	spdk_blob_id ids[2];
-	size_t count;
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
-	cluster_size = spdk_bs_get_cluster_size(bs);
-	pages_per_cluster = cluster_size / spdk_bs_get_page_size(bs);
-	pages_per_payload = pages_per_cluster * 5;
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
 
-	payload_size = cluster_size * 5;
+	for (i = 0; i < 4; i++) {
+		blob = ut_blob_create_and_open(bs, NULL);
+		iter_ctx.blobid[i] = spdk_blob_get_id(blob);
 
-	payload_read = malloc(payload_size);
-	SPDK_CU_ASSERT_FATAL(payload_read != NULL);
+		/* Just save the blobid as an xattr for testing purposes. */
+		rc = spdk_blob_set_xattr(blob, "blobid", &iter_ctx.blobid[i], sizeof(spdk_blob_id));
+		CU_ASSERT(rc == 0);
 
-	payload_write = malloc(payload_size);
-	SPDK_CU_ASSERT_FATAL(payload_write != NULL);
+		/* Resize the blob */
+		spdk_blob_resize(blob, i, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
 
-	payload_clone = malloc(payload_size);
-	SPDK_CU_ASSERT_FATAL(payload_clone != NULL);
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	g_bserrno = -1;
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
+	opts.iter_cb_fn = test_iter;
+	opts.iter_cb_arg = &iter_ctx;
+
+	/* Test blob iteration during load after a clean shutdown. */
+	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	/* Dirty shutdown */
+	bs_free(bs);
+
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
+	opts.iter_cb_fn = test_iter;
+	iter_ctx.current_iter = 0;
+	opts.iter_cb_arg = &iter_ctx;
+
+	/* Test blob iteration during load after a dirty shutdown. */
+	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+blob_snapshot_rw(void)
+{
+	static const uint8_t zero[10 * 4096] = { 0 };
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t free_clusters;
+	uint64_t cluster_size;
+	uint64_t page_size;
+	uint8_t payload_read[10 * 4096];
+	uint8_t payload_write[10 * 4096];
+	uint64_t write_bytes;
+	uint64_t read_bytes;
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	page_size = spdk_bs_get_page_size(bs);
 
 	channel = spdk_bs_alloc_io_channel(bs);
-	SPDK_CU_ASSERT_FATAL(channel != NULL);
+	CU_ASSERT(channel != NULL);
 
-	/* Create blob */
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
 	opts.num_clusters = 5;
@@ -4662,24 +4823,19 @@ _blob_inflate_rw(bool decouple_parent)
 
 	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
 
-	/* 1) Initial read should return zeroed payload */
-	memset(payload_read, 0xFF, payload_size);
-	spdk_blob_io_read(blob, channel, payload_read, 0, pages_per_payload,
-			  blob_op_complete, NULL);
+	memset(payload_read, 0xFF, sizeof(payload_read));
+	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(spdk_mem_all_zero(payload_read, payload_size));
+	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
-	/* Fill whole blob with a pattern, except last cluster (to be sure it
-	 * isn't allocated) */
-	memset(payload_write, 0xE5, payload_size - cluster_size);
-	spdk_blob_io_write(blob, channel, payload_write, 0, pages_per_payload -
-			   pages_per_cluster, blob_op_complete, NULL);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
 
-	/* 2) Create snapshot from blob (first level) */
+	/* Create snapshot from blob */
 	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
@@ -4696,96 +4852,348 @@ _blob_inflate_rw(bool decouple_parent)
 
 	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
 
-	/* Write every second cluster with a pattern.
-	 *
-	 * Last cluster shouldn't be written, to be sure that snapshot nor clone
-	 * doesn't allocate it.
-	 *
-	 * payload_clone stores expected result on "blob" read at the time and
-	 * is used only to check data consistency on clone before and after
-	 * inflation. Initially we fill it with a backing snapshots pattern
-	 * used before.
-	 */
-	memset(payload_clone, 0xE5, payload_size - cluster_size);
-	memset(payload_clone + payload_size - cluster_size, 0x00, cluster_size);
-	memset(payload_write, 0xAA, payload_size);
-	for (i = 1; i < 5; i += 2) {
-		spdk_blob_io_write(blob, channel, payload_write, i * pages_per_cluster,
-				   pages_per_cluster, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
+	write_bytes = g_dev_write_bytes;
+	read_bytes = g_dev_read_bytes;
 
-		/* Update expected result */
-		memcpy(payload_clone + (cluster_size * i), payload_write,
-		       cluster_size);
-	}
+	memset(payload_write, 0xAA, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
 
-	/* Check data consistency on clone */
-	memset(payload_read, 0xFF, payload_size);
-	spdk_blob_io_read(blob, channel, payload_read, 0, pages_per_payload,
-			  blob_op_complete, NULL);
+	/* For a clone we need to allocate and copy one cluster, update one page of metadata
+	 * and then write 10 pages of payload.
+	 */
+	if (g_use_extent_table) {
+		/* Add one more page for EXTENT_PAGE write */
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12 + cluster_size);
+	} else {
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11 + cluster_size);
+	}
+	CU_ASSERT(g_dev_read_bytes - read_bytes == cluster_size);
+
+	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_clone, payload_read, payload_size) == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	/* 3) Create second levels snapshot from blob */
-	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	/* Data on snapshot should not change after write to clone */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_read(snapshot, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	snapshot2id = g_blobid;
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	spdk_bs_open_blob(bs, snapshot2id, blob_op_with_handle_complete, NULL);
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot);
+
+	spdk_bs_free_io_channel(channel);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot2 = g_blob;
-	CU_ASSERT(snapshot2->data_ro == true);
-	CU_ASSERT(snapshot2->md_ro == true);
+	g_blob = NULL;
+	g_blobid = 0;
+}
 
-	CU_ASSERT(spdk_blob_get_num_clusters(snapshot2) == 5);
+static void
+blob_snapshot_rw_iov(void)
+{
+	static const uint8_t zero[10 * 4096] = { 0 };
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t free_clusters;
+	uint8_t payload_read[10 * 4096];
+	uint8_t payload_write[10 * 4096];
+	struct iovec iov_read[3];
+	struct iovec iov_write[3];
 
-	CU_ASSERT(snapshot2->parent_id == snapshotid);
+	free_clusters = spdk_bs_free_cluster_count(bs);
 
-	/* Write one cluster on the top level blob. This cluster (1) covers
-	 * already allocated cluster in the snapshot2, so shouldn't be inflated
-	 * at all */
-	spdk_blob_io_write(blob, channel, payload_write, pages_per_cluster,
-			   pages_per_cluster, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
 
-	/* Update expected result */
-	memcpy(payload_clone + cluster_size, payload_write, cluster_size);
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 5;
 
-	/* Check data consistency on clone */
-	memset(payload_read, 0xFF, payload_size);
-	spdk_blob_io_read(blob, channel, payload_read, 0, pages_per_payload,
-			  blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_clone, payload_read, payload_size) == 0);
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
 
-	/* Close all blobs */
-	spdk_blob_close(blob, blob_op_complete, NULL);
+	/* Create snapshot from blob */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
 
-	spdk_blob_close(snapshot2, blob_op_complete, NULL);
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+	CU_ASSERT(snapshot->data_ro == true);
+	CU_ASSERT(snapshot->md_ro == true);
+	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
 
-	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	/* Payload should be all zeros from unallocated clusters */
+	memset(payload_read, 0xAA, sizeof(payload_read));
+	iov_read[0].iov_base = payload_read;
+	iov_read[0].iov_len = 3 * 4096;
+	iov_read[1].iov_base = payload_read + 3 * 4096;
+	iov_read[1].iov_len = 4 * 4096;
+	iov_read[2].iov_base = payload_read + 7 * 4096;
+	iov_read[2].iov_len = 3 * 4096;
+	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
-	/* Check snapshot-clone relations */
-	count = 2;
-	CU_ASSERT(spdk_blob_get_clones(bs, snapshotid, ids, &count) == 0);
-	CU_ASSERT(count == 1);
-	CU_ASSERT(ids[0] == snapshot2id);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	iov_write[0].iov_base = payload_write;
+	iov_write[0].iov_len = 1 * 4096;
+	iov_write[1].iov_base = payload_write + 1 * 4096;
+	iov_write[1].iov_len = 5 * 4096;
+	iov_write[2].iov_base = payload_write + 6 * 4096;
+	iov_write[2].iov_len = 4 * 4096;
+
+	spdk_blob_io_writev(blob, channel, iov_write, 3, 250, 10, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	memset(payload_read, 0xAA, sizeof(payload_read));
+	iov_read[0].iov_base = payload_read;
+	iov_read[0].iov_len = 3 * 4096;
+	iov_read[1].iov_base = payload_read + 3 * 4096;
+	iov_read[1].iov_len = 4 * 4096;
+	iov_read[2].iov_base = payload_read + 7 * 4096;
+	iov_read[2].iov_len = 3 * 4096;
+	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot);
+}
+
+/**
+ * Inflate / decouple parent rw unit tests.
+ *
+ * --------------
+ * original blob:         0         1         2         3         4
+ *                   ,---------+---------+---------+---------+---------.
+ *         snapshot  |xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|    -    |
+ *                   +---------+---------+---------+---------+---------+
+ *         snapshot2 |    -    |yyyyyyyyy|    -    |yyyyyyyyy|    -    |
+ *                   +---------+---------+---------+---------+---------+
+ *         blob      |    -    |zzzzzzzzz|    -    |    -    |    -    |
+ *                   '---------+---------+---------+---------+---------'
+ *                   .         .         .         .         .         .
+ * --------          .         .         .         .         .         .
+ * inflate:          .         .         .         .         .         .
+ *                   ,---------+---------+---------+---------+---------.
+ *         blob      |xxxxxxxxx|zzzzzzzzz|xxxxxxxxx|yyyyyyyyy|000000000|
+ *                   '---------+---------+---------+---------+---------'
+ *
+ *         NOTE: needs to allocate 4 clusters, thin provisioning removed, dependency
+ *               on snapshot2 and snapshot removed .         .         .
+ *                   .         .         .         .         .         .
+ * ----------------  .         .         .         .         .         .
+ * decouple parent:  .         .         .         .         .         .
+ *                   ,---------+---------+---------+---------+---------.
+ *         snapshot  |xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|xxxxxxxxx|    -    |
+ *                   +---------+---------+---------+---------+---------+
+ *         blob      |    -    |zzzzzzzzz|    -    |yyyyyyyyy|    -    |
+ *                   '---------+---------+---------+---------+---------'
+ *
+ *         NOTE: needs to allocate 1 cluster, 3 clusters unallocated, dependency
+ *               on snapshot2 removed and on snapshot still exists. Snapshot2
+ *               should remain a clone of snapshot.
+ */
+static void
+_blob_inflate_rw(bool decouple_parent)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot, *snapshot2;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid, snapshot2id;
+	uint64_t free_clusters;
+	uint64_t cluster_size;
+
+	uint64_t payload_size;
+	uint8_t *payload_read;
+	uint8_t *payload_write;
+	uint8_t *payload_clone;
+
+	uint64_t pages_per_cluster;
+	uint64_t pages_per_payload;
+
+	int i;
+	spdk_blob_id ids[2];
+	size_t count;
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	pages_per_cluster = cluster_size / spdk_bs_get_page_size(bs);
+	pages_per_payload = pages_per_cluster * 5;
+
+	payload_size = cluster_size * 5;
+
+	payload_read = malloc(payload_size);
+	SPDK_CU_ASSERT_FATAL(payload_read != NULL);
+
+	payload_write = malloc(payload_size);
+	SPDK_CU_ASSERT_FATAL(payload_write != NULL);
+
+	payload_clone = malloc(payload_size);
+	SPDK_CU_ASSERT_FATAL(payload_clone != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	/* Create blob */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 5;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
+
+	/* 1) Initial read should return zeroed payload */
+	memset(payload_read, 0xFF, payload_size);
+	spdk_blob_io_read(blob, channel, payload_read, 0, pages_per_payload,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_mem_all_zero(payload_read, payload_size));
+
+	/* Fill whole blob with a pattern, except last cluster (to be sure it
+	 * isn't allocated) */
+	memset(payload_write, 0xE5, payload_size - cluster_size);
+	spdk_blob_io_write(blob, channel, payload_write, 0, pages_per_payload -
+			   pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
+
+	/* 2) Create snapshot from blob (first level) */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+	CU_ASSERT(snapshot->data_ro == true);
+	CU_ASSERT(snapshot->md_ro == true);
+
+	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
+
+	/* Write every second cluster with a pattern.
+	 *
+	 * Last cluster shouldn't be written, to be sure that snapshot nor clone
+	 * doesn't allocate it.
+	 *
+	 * payload_clone stores expected result on "blob" read at the time and
+	 * is used only to check data consistency on clone before and after
+	 * inflation. Initially we fill it with a backing snapshots pattern
+	 * used before.
+	 */
+	memset(payload_clone, 0xE5, payload_size - cluster_size);
+	memset(payload_clone + payload_size - cluster_size, 0x00, cluster_size);
+	memset(payload_write, 0xAA, payload_size);
+	for (i = 1; i < 5; i += 2) {
+		spdk_blob_io_write(blob, channel, payload_write, i * pages_per_cluster,
+				   pages_per_cluster, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+
+		/* Update expected result */
+		memcpy(payload_clone + (cluster_size * i), payload_write,
+		       cluster_size);
+	}
+	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
+
+	/* Check data consistency on clone */
+	memset(payload_read, 0xFF, payload_size);
+	spdk_blob_io_read(blob, channel, payload_read, 0, pages_per_payload,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_clone, payload_read, payload_size) == 0);
+
+	/* 3) Create second levels snapshot from blob */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshot2id = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshot2id, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot2 = g_blob;
+	CU_ASSERT(snapshot2->data_ro == true);
+	CU_ASSERT(snapshot2->md_ro == true);
+
+	CU_ASSERT(spdk_blob_get_num_clusters(snapshot2) == 5);
+
+	CU_ASSERT(snapshot2->parent_id == snapshotid);
+
+	/* Write one cluster on the top level blob. This cluster (1) covers
+	 * already allocated cluster in the snapshot2, so shouldn't be inflated
+	 * at all */
+	spdk_blob_io_write(blob, channel, payload_write, pages_per_cluster,
+			   pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Update expected result */
+	memcpy(payload_clone + cluster_size, payload_write, cluster_size);
+
+	/* Check data consistency on clone */
+	memset(payload_read, 0xFF, payload_size);
+	spdk_blob_io_read(blob, channel, payload_read, 0, pages_per_payload,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_clone, payload_read, payload_size) == 0);
+
+
+	/* Close all blobs */
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_blob_close(snapshot2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Check snapshot-clone relations */
+	count = 2;
+	CU_ASSERT(spdk_blob_get_clones(bs, snapshotid, ids, &count) == 0);
+	CU_ASSERT(count == 1);
+	CU_ASSERT(ids[0] == snapshot2id);
 
 	count = 2;
 	CU_ASSERT(spdk_blob_get_clones(bs, snapshot2id, ids, &count) == 0);
@@ -6644,417 +7052,1472 @@ blob_io_unit(void)
 
 	CU_ASSERT(g_bserrno == 0);
 
-	test_io_read(dev, clone, channel);
+	test_io_read(dev, clone, channel);
+
+	test_io_unmap(dev, clone, channel);
+
+	test_iov_write(dev, clone, channel);
+	test_iov_read(dev, clone, channel);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	spdk_blob_close(clone, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob = NULL;
+	g_blob = NULL;
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	/* Unload the blob store */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
+static void
+blob_io_unit_compatibility(void)
+{
+	struct spdk_bs_opts bsopts;
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_super_block *super;
+
+	/* Create dev with 512 bytes io unit size */
+
+	spdk_bs_opts_init(&bsopts, sizeof(bsopts));
+	bsopts.cluster_sz = SPDK_BS_PAGE_SIZE * 4;	/* 8 * 4 = 32 io_unit */
+	snprintf(bsopts.bstype.bstype, sizeof(bsopts.bstype.bstype), "TESTTYPE");
+
+	/* Try to initialize a new blob store with unsupported io_unit */
+	dev = init_dev();
+	dev->blocklen = 512;
+	dev->blockcnt =  DEV_BUFFER_SIZE / dev->blocklen;
+
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &bsopts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	CU_ASSERT(spdk_bs_get_io_unit_size(bs) == 512);
+
+	/* Unload the blob store */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Modify super block to behave like older version.
+	 * Check if loaded io unit size equals SPDK_BS_PAGE_SIZE */
+	super = (struct spdk_bs_super_block *)&g_dev_buffer[0];
+	super->io_unit_size = 0;
+	super->crc = blob_md_page_calc_crc(super);
+
+	dev = init_dev();
+	dev->blocklen = 512;
+	dev->blockcnt =  DEV_BUFFER_SIZE / dev->blocklen;
+
+	spdk_bs_load(dev, &bsopts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	CU_ASSERT(spdk_bs_get_io_unit_size(bs) == SPDK_BS_PAGE_SIZE);
+
+	/* Unload the blob store */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	g_bs = NULL;
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
+static void
+first_sync_complete(void *cb_arg, int bserrno)
+{
+	struct spdk_blob *blob = cb_arg;
+	int rc;
+
+	CU_ASSERT(bserrno == 0);
+	rc = spdk_blob_set_xattr(blob, "sync", "second", strlen("second") + 1);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bserrno == -1);
+
+	/* Keep g_bserrno at -1, only the
+	 * second sync completion should set it at 0. */
+}
+
+static void
+second_sync_complete(void *cb_arg, int bserrno)
+{
+	struct spdk_blob *blob = cb_arg;
+	const void *value;
+	size_t value_len;
+	int rc;
+
+	CU_ASSERT(bserrno == 0);
+
+	/* Verify that the first sync completion had a chance to execute */
+	rc = spdk_blob_get_xattr_value(blob, "sync", &value, &value_len);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(value != NULL);
+	CU_ASSERT(value_len == strlen("second") + 1);
+	CU_ASSERT_NSTRING_EQUAL_FATAL(value, "second", value_len);
+
+	CU_ASSERT(g_bserrno == -1);
+	g_bserrno = bserrno;
+}
+
+static void
+blob_simultaneous_operations(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob, *snapshot;
+	spdk_blob_id blobid, snapshotid;
+	struct spdk_io_channel *channel;
+	int rc;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 10;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Create snapshot and try to remove blob in the same time:
+	 * - snapshot should be created successfully
+	 * - delete operation should fail w -EBUSY */
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	CU_ASSERT(blob->locked_operation_in_progress == true);
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	CU_ASSERT(blob->locked_operation_in_progress == true);
+	/* Deletion failure */
+	CU_ASSERT(g_bserrno == -EBUSY);
+	poll_threads();
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	/* Snapshot creation success */
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+
+	/* Inflate blob and try to remove blob in the same time:
+	 * - blob should be inflated successfully
+	 * - delete operation should fail w -EBUSY */
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	spdk_bs_inflate_blob(bs, channel, blobid, blob_op_complete, NULL);
+	CU_ASSERT(blob->locked_operation_in_progress == true);
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	CU_ASSERT(blob->locked_operation_in_progress == true);
+	/* Deletion failure */
+	CU_ASSERT(g_bserrno == -EBUSY);
+	poll_threads();
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	/* Inflation success */
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Clone snapshot and try to remove snapshot in the same time:
+	 * - snapshot should be cloned successfully
+	 * - delete operation should fail w -EBUSY */
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	spdk_bs_create_clone(bs, snapshotid, NULL, blob_op_with_id_complete, NULL);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	/* Deletion failure */
+	CU_ASSERT(g_bserrno == -EBUSY);
+	poll_threads();
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	/* Clone created */
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Resize blob and try to remove blob in the same time:
+	 * - blob should be resized successfully
+	 * - delete operation should fail w -EBUSY */
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	spdk_blob_resize(blob, 50, blob_op_complete, NULL);
+	CU_ASSERT(blob->locked_operation_in_progress == true);
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	CU_ASSERT(blob->locked_operation_in_progress == true);
+	/* Deletion failure */
+	CU_ASSERT(g_bserrno == -EBUSY);
+	poll_threads();
+	CU_ASSERT(blob->locked_operation_in_progress == false);
+	/* Blob resized successfully */
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Issue two consecutive blob syncs, neither should fail.
+	 * Force sync to actually occur by marking blob dirty each time.
+	 * Execution of sync should not be enough to complete the operation,
+	 * since disk I/O is required to complete it. */
+	g_bserrno = -1;
+
+	rc = spdk_blob_set_xattr(blob, "sync", "first", strlen("first") + 1);
+	CU_ASSERT(rc == 0);
+	spdk_blob_sync_md(blob, first_sync_complete, blob);
+	CU_ASSERT(g_bserrno == -1);
+
+	spdk_blob_sync_md(blob, second_sync_complete, blob);
+	CU_ASSERT(g_bserrno == -1);
+
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, snapshot);
+	ut_blob_close_and_delete(bs, blob);
+}
+
+static void
+blob_persist_test(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob;
+	spdk_blob_id blobid;
+	struct spdk_io_channel *channel;
+	char *xattr;
+	size_t xattr_length;
+	int rc;
+	uint32_t page_count_clear, page_count_xattr;
+	uint64_t poller_iterations;
+	bool run_poller;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 10;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Save the amount of md pages used after creation of a blob.
+	 * This should be consistent after removing xattr. */
+	page_count_clear = spdk_bit_array_count_set(bs->used_md_pages);
+	SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_clear);
+	SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_clear);
+
+	/* Add xattr with maximum length of descriptor to exceed single metadata page. */
+	xattr_length = SPDK_BS_MAX_DESC_SIZE - sizeof(struct spdk_blob_md_descriptor_xattr) -
+		       strlen("large_xattr");
+	xattr = calloc(xattr_length, sizeof(char));
+	SPDK_CU_ASSERT_FATAL(xattr != NULL);
+
+	rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_bserrno == 0);
+
+	/* Save the amount of md pages used after adding the large xattr */
+	page_count_xattr = spdk_bit_array_count_set(bs->used_md_pages);
+	SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_xattr);
+	SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_xattr);
+
+	/* Add xattr to a blob and sync it. While sync is occurring, remove the xattr and sync again.
+	 * Interrupt the first sync after increasing number of poller iterations, until it succeeds.
+	 * Expectation is that after second sync completes no xattr is saved in metadata. */
+	poller_iterations = 1;
+	run_poller = true;
+	while (run_poller) {
+		rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
+		SPDK_CU_ASSERT_FATAL(rc == 0);
+		g_bserrno = -1;
+		spdk_blob_sync_md(blob, blob_op_complete, NULL);
+		poll_thread_times(0, poller_iterations);
+		if (g_bserrno == 0) {
+			/* Poller iteration count was high enough for first sync to complete.
+			 * Verify that blob takes up enough of md_pages to store the xattr. */
+			SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_xattr);
+			SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_xattr);
+			SPDK_CU_ASSERT_FATAL(spdk_bit_array_count_set(bs->used_md_pages) == page_count_xattr);
+			run_poller = false;
+		}
+		rc = spdk_blob_remove_xattr(blob, "large_xattr");
+		SPDK_CU_ASSERT_FATAL(rc == 0);
+		spdk_blob_sync_md(blob, blob_op_complete, NULL);
+		poll_threads();
+		SPDK_CU_ASSERT_FATAL(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_clear);
+		SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_clear);
+		SPDK_CU_ASSERT_FATAL(spdk_bit_array_count_set(bs->used_md_pages) == page_count_clear);
+
+		/* Reload bs and re-open blob to verify that xattr was not persisted. */
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+
+		ut_bs_reload(&bs, NULL);
+
+		spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+		blob = g_blob;
+
+		rc = spdk_blob_get_xattr_value(blob, "large_xattr", (const void **)&xattr, &xattr_length);
+		SPDK_CU_ASSERT_FATAL(rc == -ENOENT);
+
+		poller_iterations++;
+		/* Stop at high iteration count to prevent infinite loop.
+		 * This value should be enough for first md sync to complete in any case. */
+		SPDK_CU_ASSERT_FATAL(poller_iterations < 50);
+	}
+
+	free(xattr);
+
+	ut_blob_close_and_delete(bs, blob);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+}
+
+static void
+blob_decouple_snapshot(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob, *snapshot1, *snapshot2;
+	struct spdk_io_channel *channel;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t cluster;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 10;
+	opts.thin_provision = false;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Create first snapshot */
+	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 0);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 1);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot1 = g_blob;
+
+	/* Create the second one */
+	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 1);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 2);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot2 = g_blob;
+	CU_ASSERT_EQUAL(spdk_blob_get_parent_snapshot(bs, snapshot2->id), snapshot1->id);
+
+	/* Now decouple the second snapshot forcing it to copy the written clusters */
+	spdk_bs_blob_decouple_parent(bs, channel, snapshot2->id, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Verify that the snapshot has been decoupled and that the clusters have been copied */
+	CU_ASSERT_EQUAL(spdk_blob_get_parent_snapshot(bs, snapshot2->id), SPDK_BLOBID_INVALID);
+	for (cluster = 0; cluster < snapshot2->active.num_clusters; ++cluster) {
+		CU_ASSERT_NOT_EQUAL(snapshot2->active.clusters[cluster], 0);
+		CU_ASSERT_NOT_EQUAL(snapshot2->active.clusters[cluster],
+				    snapshot1->active.clusters[cluster]);
+	}
+
+	spdk_bs_free_io_channel(channel);
+
+	ut_blob_close_and_delete(bs, snapshot2);
+	ut_blob_close_and_delete(bs, snapshot1);
+	ut_blob_close_and_delete(bs, blob);
+	poll_threads();
+}
+
+#define UT_ESNAP_BLOCKLEN 512
+#define UT_ESNAP_ID "ut_esnap"
+
+static uint32_t g_ut_esnap_devs;
+static uint32_t g_ut_esnap_channels;
+
+static struct spdk_io_channel *
+ut_esnap_create_channel(struct spdk_bs_dev *dev)
+{
+	g_ut_esnap_channels++;
+	return calloc(1, sizeof(struct spdk_io_channel));
+}
+
+static void
+ut_esnap_destroy_channel(struct spdk_bs_dev *dev, struct spdk_io_channel *channel)
+{
+	CU_ASSERT(g_ut_esnap_channels > 0);
+	g_ut_esnap_channels--;
+	free(channel);
+}
+
+static void
+ut_esnap_destroy(struct spdk_bs_dev *dev)
+{
+	CU_ASSERT(g_ut_esnap_devs > 0);
+	g_ut_esnap_devs--;
+	free(dev);
+}
+
+/* Each block of the external snapshot is filled with its own LBA */
+static void
+ut_esnap_fill(void *payload, uint64_t lba, uint32_t lba_count)
+{
+	uint64_t *buf = payload;
+	uint64_t i, j;
+
+	for (i = 0; i < lba_count; i++) {
+		for (j = 0; j < UT_ESNAP_BLOCKLEN / sizeof(uint64_t); j++) {
+			*buf++ = lba + i;
+		}
+	}
+}
+
+static bool
+ut_esnap_check(void *payload, uint64_t lba, uint32_t lba_count)
+{
+	uint64_t *buf = payload;
+	uint64_t i, j;
+
+	for (i = 0; i < lba_count; i++) {
+		for (j = 0; j < UT_ESNAP_BLOCKLEN / sizeof(uint64_t); j++) {
+			if (*buf++ != lba + i) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void
+ut_esnap_read(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
+	      uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	/* External snapshot I/O must use a channel of its own */
+	CU_ASSERT(channel != NULL && channel != &g_io_channel);
+	SPDK_CU_ASSERT_FATAL(lba + lba_count <= dev->blockcnt);
+
+	ut_esnap_fill(payload, lba, lba_count);
+	spdk_thread_send_msg(spdk_get_thread(), dev_complete, cb_args);
+}
+
+static void
+ut_esnap_readv(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
+	       struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count,
+	       struct spdk_bs_dev_cb_args *cb_args)
+{
+	int i;
+
+	CU_ASSERT(channel != NULL && channel != &g_io_channel);
+	SPDK_CU_ASSERT_FATAL(lba + lba_count <= dev->blockcnt);
+
+	for (i = 0; i < iovcnt; i++) {
+		SPDK_CU_ASSERT_FATAL(iov[i].iov_len % UT_ESNAP_BLOCKLEN == 0);
+		ut_esnap_fill(iov[i].iov_base, lba, iov[i].iov_len / UT_ESNAP_BLOCKLEN);
+		lba += iov[i].iov_len / UT_ESNAP_BLOCKLEN;
+	}
+	spdk_thread_send_msg(spdk_get_thread(), dev_complete, cb_args);
+}
+
+static int
+ut_esnap_dev_create(void *bs_ctx, struct spdk_blob *blob, const void *esnap_id,
+		    uint32_t id_len, struct spdk_bs_dev **bs_dev)
+{
+	struct spdk_bs_dev *dev;
+
+	CU_ASSERT(bs_ctx == &g_ctx);
+	if (id_len != sizeof(UT_ESNAP_ID) || memcmp(esnap_id, UT_ESNAP_ID, id_len) != 0) {
+		return -ENOENT;
+	}
+
+	dev = calloc(1, sizeof(*dev));
+	SPDK_CU_ASSERT_FATAL(dev != NULL);
+
+	dev->create_channel = ut_esnap_create_channel;
+	dev->destroy_channel = ut_esnap_destroy_channel;
+	dev->destroy = ut_esnap_destroy;
+	dev->read = ut_esnap_read;
+	dev->readv = ut_esnap_readv;
+	dev->blocklen = UT_ESNAP_BLOCKLEN;
+	dev->blockcnt = DEV_BUFFER_SIZE / UT_ESNAP_BLOCKLEN;
+
+	g_ut_esnap_devs++;
+	*bs_dev = dev;
+	return 0;
+}
+
+static void
+ut_esnap_bs_load(struct spdk_blob_store **bs, bool init)
+{
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = 16384;
+	bs_opts.esnap_bs_dev_create = ut_esnap_dev_create;
+	bs_opts.esnap_ctx = &g_ctx;
+
+	if (init) {
+		spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	} else {
+		spdk_bs_load(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	}
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	*bs = g_bs;
+}
+
+static void
+ut_esnap_read_page(struct spdk_blob *blob, struct spdk_io_channel *channel, uint64_t page,
+		   uint8_t *payload)
+{
+	memset(payload, 0xFF, SPDK_BS_PAGE_SIZE);
+	spdk_blob_io_read(blob, channel, payload, page, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+}
+
+static void
+blob_esnap_clone(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob, *snapshot;
+	struct spdk_io_channel *channel, *channel1;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t blocks_per_page = SPDK_BS_PAGE_SIZE / UT_ESNAP_BLOCKLEN;
+	uint8_t payload_write[SPDK_BS_PAGE_SIZE];
+	uint8_t payload_read[SPDK_BS_PAGE_SIZE];
+	const void *id;
+	size_t id_len;
+
+	ut_esnap_bs_load(&bs, true);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	/* Identifier is mandatory */
+	ut_spdk_blob_opts_init(&opts);
+	opts.esnap_id = UT_ESNAP_ID;
+	opts.esnap_id_len = 0;
+	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.esnap_id = UT_ESNAP_ID;
+	opts.esnap_id_len = sizeof(UT_ESNAP_ID);
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(g_ut_esnap_devs == 1);
+
+	CU_ASSERT(spdk_blob_is_esnap_clone(blob));
+	CU_ASSERT(spdk_blob_is_thin_provisioned(blob));
+	CU_ASSERT(!spdk_blob_is_clone(blob));
+	CU_ASSERT(spdk_blob_get_parent_snapshot(bs, blobid) == SPDK_BLOBID_INVALID);
+	CU_ASSERT(spdk_blob_get_esnap_id(blob, &id, &id_len) == 0);
+	CU_ASSERT(id_len == sizeof(UT_ESNAP_ID));
+	CU_ASSERT(memcmp(id, UT_ESNAP_ID, id_len) == 0);
+
+	/* Unallocated clusters are read from the external snapshot */
+	ut_esnap_read_page(blob, channel, 5, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 5 * blocks_per_page, blocks_per_page));
+	CU_ASSERT(g_ut_esnap_channels == 1);
+	CU_ASSERT(blob->active.clusters[1] == 0);
+
+	/* Each thread gets its own channel to the external snapshot */
+	set_thread(1);
+	channel1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel1 != NULL);
+	ut_esnap_read_page(blob, channel1, 6, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 6 * blocks_per_page, blocks_per_page));
+	CU_ASSERT(g_ut_esnap_channels == 2);
+	spdk_bs_free_io_channel(channel1);
+	poll_threads();
+	CU_ASSERT(g_ut_esnap_channels == 1);
+	set_thread(0);
+
+	/* First write to a cluster copies the rest of it from the external snapshot */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 1, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+	ut_esnap_read_page(blob, channel, 0, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 0, blocks_per_page));
+	ut_esnap_read_page(blob, channel, 1, payload_read);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_write)) == 0);
+
+	/* Snapshot takes over the external snapshot */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+
+	CU_ASSERT(spdk_blob_is_esnap_clone(snapshot));
+	CU_ASSERT(!spdk_blob_is_esnap_clone(blob));
+	CU_ASSERT(spdk_blob_is_clone(blob));
+	CU_ASSERT(spdk_blob_get_parent_snapshot(bs, blobid) == snapshotid);
+	CU_ASSERT(spdk_blob_get_esnap_id(blob, &id, &id_len) == -EINVAL);
+	CU_ASSERT(g_ut_esnap_devs == 1);
+
+	ut_esnap_read_page(blob, channel, 1, payload_read);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_write)) == 0);
+	ut_esnap_read_page(blob, channel, 9, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 9 * blocks_per_page, blocks_per_page));
+
+	/* Removing the snapshot hands the external snapshot back to the clone */
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	CU_ASSERT(spdk_blob_is_esnap_clone(blob));
+	CU_ASSERT(!spdk_blob_is_clone(blob));
+	CU_ASSERT(g_ut_esnap_devs == 1);
+	ut_esnap_read_page(blob, channel, 1, payload_read);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_write)) == 0);
+	ut_esnap_read_page(blob, channel, 10, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 10 * blocks_per_page, blocks_per_page));
+
+	/* Closing the blob releases the device and its channels */
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_ut_esnap_devs == 0);
+	CU_ASSERT(g_ut_esnap_channels == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	/* External snapshot is found again after reload */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	ut_esnap_bs_load(&bs, false);
+	CU_ASSERT(g_ut_esnap_devs == 0);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(spdk_blob_is_esnap_clone(blob));
+
+	ut_esnap_read_page(blob, channel, 1, payload_read);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_write)) == 0);
+	ut_esnap_read_page(blob, channel, 13, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 13 * blocks_per_page, blocks_per_page));
+
+	/* Decoupling copies every cluster and drops the external snapshot */
+	spdk_bs_blob_decouple_parent(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(!spdk_blob_is_esnap_clone(blob));
+	CU_ASSERT(!spdk_blob_is_thin_provisioned(blob));
+	CU_ASSERT(g_ut_esnap_devs == 0);
+	CU_ASSERT(g_ut_esnap_channels == 0);
+
+	ut_esnap_read_page(blob, channel, 1, payload_read);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_write)) == 0);
+	ut_esnap_read_page(blob, channel, 13, payload_read);
+	CU_ASSERT(ut_esnap_check(payload_read, 13 * blocks_per_page, blocks_per_page));
+
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+blob_esnap_remove(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel, *channel1;
+	struct spdk_blob_opts opts;
+	uint64_t esnap_clusters;
+	uint8_t payload_write[SPDK_BS_PAGE_SIZE];
+	uint8_t payload_read[SPDK_BS_PAGE_SIZE];
+
+	ut_esnap_bs_load(&bs, true);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.esnap_id = UT_ESNAP_ID;
+	opts.esnap_id_len = sizeof(UT_ESNAP_ID);
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(!spdk_blob_is_degraded(blob));
+
+	/* Clone cannot grow past the end of the external snapshot */
+	esnap_clusters = DEV_BUFFER_SIZE / spdk_bs_get_cluster_size(bs);
+	spdk_blob_resize(blob, esnap_clusters + 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 4);
+	spdk_blob_resize(blob, esnap_clusters, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == esnap_clusters);
+
+	/* Allocate the first cluster and read the external snapshot on two threads */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	ut_esnap_read_page(blob, channel, 5, payload_read);
+	set_thread(1);
+	channel1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel1 != NULL);
+	ut_esnap_read_page(blob, channel1, 6, payload_read);
+	set_thread(0);
+	CU_ASSERT(g_ut_esnap_devs == 1);
+	CU_ASSERT(g_ut_esnap_channels == 2);
 
-	test_io_unmap(dev, clone, channel);
+	/* Removal releases the channels on every thread and the device */
+	spdk_blob_remove_esnap_dev(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_ut_esnap_channels == 0);
+	CU_ASSERT(g_ut_esnap_devs == 0);
+	CU_ASSERT(spdk_blob_is_degraded(blob));
+	CU_ASSERT(spdk_blob_is_esnap_clone(blob));
 
-	test_iov_write(dev, clone, channel);
-	test_iov_read(dev, clone, channel);
+	/* Allocated clusters are still readable, reads of the others fail */
+	ut_esnap_read_page(blob, channel, 0, payload_read);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_write)) == 0);
+	spdk_blob_io_read(blob, channel, payload_read, 5, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EIO);
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
-	spdk_blob_close(snapshot, blob_op_complete, NULL);
-	spdk_blob_close(clone, blob_op_complete, NULL);
+	/* Nothing left to remove */
+	g_bserrno = -1;
+	spdk_blob_remove_esnap_dev(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	blob = NULL;
-	g_blob = NULL;
 
+	set_thread(1);
+	spdk_bs_free_io_channel(channel1);
+	set_thread(0);
+	ut_blob_close_and_delete(bs, blob);
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
 
-	/* Unload the blob store */
 	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	g_bs = NULL;
-	g_blob = NULL;
-	g_blobid = 0;
+}
+
+static uint8_t *g_ut_copy_buf;
+static uint32_t g_ut_copy_writes;
+static uint64_t g_ut_copy_status_copied;
+static uint64_t g_ut_copy_status_total;
+
+static struct spdk_io_channel *
+ut_copy_create_channel(struct spdk_bs_dev *dev)
+{
+	return (struct spdk_io_channel *)dev;
 }
 
 static void
-blob_io_unit_compatibility(void)
+ut_copy_destroy_channel(struct spdk_bs_dev *dev, struct spdk_io_channel *channel)
 {
-	struct spdk_bs_opts bsopts;
-	struct spdk_blob_store *bs;
-	struct spdk_bs_dev *dev;
-	struct spdk_bs_super_block *super;
+}
 
-	/* Create dev with 512 bytes io unit size */
+static void
+ut_copy_write(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
+	      uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	SPDK_CU_ASSERT_FATAL(lba + lba_count <= dev->blockcnt);
+	memcpy(g_ut_copy_buf + lba * dev->blocklen, payload, lba_count * dev->blocklen);
+	g_ut_copy_writes++;
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, 0);
+}
 
-	spdk_bs_opts_init(&bsopts, sizeof(bsopts));
-	bsopts.cluster_sz = SPDK_BS_PAGE_SIZE * 4;	/* 8 * 4 = 32 io_unit */
-	snprintf(bsopts.bstype.bstype, sizeof(bsopts.bstype.bstype), "TESTTYPE");
+static void
+ut_copy_status(uint64_t copied_clusters, uint64_t total_clusters, void *cb_arg)
+{
+	g_ut_copy_status_copied = copied_clusters;
+	g_ut_copy_status_total = total_clusters;
+}
 
-	/* Try to initialize a new blob store with unsupported io_unit */
-	dev = init_dev();
-	dev->blocklen = 512;
-	dev->blockcnt =  DEV_BUFFER_SIZE / dev->blocklen;
+static void
+blob_shallow_copy(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
+	struct spdk_bs_dev ext_dev = {};
+	struct spdk_blob_fragmentation frag;
+	uint64_t cluster_sz = spdk_bs_get_cluster_size(bs);
+	uint64_t io_units_per_cluster = cluster_sz / spdk_bs_get_io_unit_size(bs);
+	uint64_t written[] = { 1, 4, 5, 8 };
+	uint8_t *payload, *expected;
+	uint64_t i;
 
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &bsopts, bs_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
-	CU_ASSERT(spdk_bs_get_io_unit_size(bs) == 512);
+	payload = calloc(1, cluster_sz);
+	expected = calloc(1, cluster_sz);
+	g_ut_copy_buf = malloc(10 * cluster_sz);
+	SPDK_CU_ASSERT_FATAL(payload != NULL && expected != NULL && g_ut_copy_buf != NULL);
+	memset(g_ut_copy_buf, 0xFF, 10 * cluster_sz);
 
-	/* Unload the blob store */
-	spdk_bs_unload(bs, bs_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
+	ext_dev.create_channel = ut_copy_create_channel;
+	ext_dev.destroy_channel = ut_copy_destroy_channel;
+	ext_dev.write = ut_copy_write;
+	ext_dev.blocklen = 512;
+	ext_dev.blockcnt = 9 * cluster_sz / ext_dev.blocklen;
 
-	/* Modify super block to behave like older version.
-	 * Check if loaded io unit size equals SPDK_BS_PAGE_SIZE */
-	super = (struct spdk_bs_super_block *)&g_dev_buffer[0];
-	super->io_unit_size = 0;
-	super->crc = blob_md_page_calc_crc(super);
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 10;
+	opts.thin_provision = true;
+	blob = ut_blob_create_and_open(bs, &opts);
 
-	dev = init_dev();
-	dev->blocklen = 512;
-	dev->blockcnt =  DEV_BUFFER_SIZE / dev->blocklen;
+	for (i = 0; i < SPDK_COUNTOF(written); i++) {
+		memset(payload, written[i], cluster_sz);
+		spdk_blob_io_write(blob, channel, payload, written[i] * io_units_per_cluster,
+				   io_units_per_cluster, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	spdk_blob_get_fragmentation(blob, &frag);
+	CU_ASSERT(frag.num_allocated_clusters == SPDK_COUNTOF(written));
 
-	spdk_bs_load(dev, &bsopts, bs_op_with_handle_complete, NULL);
+	/* Blob must be read-only */
+	spdk_bs_blob_shallow_copy(bs, channel, blob->id, &ext_dev, ut_copy_status, NULL,
+				  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EPERM);
+	CU_ASSERT(g_ut_copy_writes == 0);
+
+	spdk_blob_set_read_only(blob);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
 
-	CU_ASSERT(spdk_bs_get_io_unit_size(bs) == SPDK_BS_PAGE_SIZE);
+	/* Device must be large enough to hold the whole blob */
+	spdk_bs_blob_shallow_copy(bs, channel, blob->id, &ext_dev, ut_copy_status, NULL,
+				  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(g_ut_copy_writes == 0);
 
-	/* Unload the blob store */
-	spdk_bs_unload(bs, bs_op_complete, NULL);
+	/* Only the allocated clusters are copied, each to its own offset */
+	ext_dev.blockcnt = 10 * cluster_sz / ext_dev.blocklen;
+	spdk_bs_blob_shallow_copy(bs, channel, blob->id, &ext_dev, ut_copy_status, NULL,
+				  blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_ut_copy_writes == SPDK_COUNTOF(written));
+	CU_ASSERT(g_ut_copy_status_copied == SPDK_COUNTOF(written));
+	CU_ASSERT(g_ut_copy_status_total == SPDK_COUNTOF(written));
 
-	g_bs = NULL;
-	g_blob = NULL;
-	g_blobid = 0;
+	memset(expected, 0xFF, cluster_sz);
+	for (i = 0; i < 10; i++) {
+		if (i == 1 || i == 4 || i == 5 || i == 8) {
+			memset(payload, i, cluster_sz);
+			CU_ASSERT(memcmp(g_ut_copy_buf + i * cluster_sz, payload, cluster_sz) == 0);
+		} else {
+			CU_ASSERT(memcmp(g_ut_copy_buf + i * cluster_sz, expected, cluster_sz) == 0);
+		}
+	}
+
+	spdk_bs_free_io_channel(channel);
+	ut_blob_close_and_delete(bs, blob);
+	poll_threads();
+
+	free(g_ut_copy_buf);
+	g_ut_copy_buf = NULL;
+	g_ut_copy_writes = 0;
+	free(expected);
+	free(payload);
 }
 
+static uint64_t g_ut_extents[8][2];
+static uint32_t g_ut_num_extents;
+
 static void
-first_sync_complete(void *cb_arg, int bserrno)
+ut_changed_clusters(void *cb_arg, uint64_t start_cluster, uint64_t num_clusters)
 {
-	struct spdk_blob *blob = cb_arg;
-	int rc;
-
-	CU_ASSERT(bserrno == 0);
-	rc = spdk_blob_set_xattr(blob, "sync", "second", strlen("second") + 1);
-	CU_ASSERT(rc == 0);
-	CU_ASSERT(g_bserrno == -1);
-
-	/* Keep g_bserrno at -1, only the
-	 * second sync completion should set it at 0. */
+	SPDK_CU_ASSERT_FATAL(g_ut_num_extents < SPDK_COUNTOF(g_ut_extents));
+	g_ut_extents[g_ut_num_extents][0] = start_cluster;
+	g_ut_extents[g_ut_num_extents][1] = num_clusters;
+	g_ut_num_extents++;
 }
 
 static void
-second_sync_complete(void *cb_arg, int bserrno)
+ut_blob_write_cluster(struct spdk_blob *blob, struct spdk_io_channel *channel, uint64_t cluster)
 {
-	struct spdk_blob *blob = cb_arg;
-	const void *value;
-	size_t value_len;
-	int rc;
+	uint64_t io_units_per_cluster = spdk_bs_get_cluster_size(blob->bs) /
+					spdk_bs_get_io_unit_size(blob->bs);
+	uint8_t payload[DEV_BUFFER_BLOCKLEN] = {};
 
-	CU_ASSERT(bserrno == 0);
-
-	/* Verify that the first sync completion had a chance to execute */
-	rc = spdk_blob_get_xattr_value(blob, "sync", &value, &value_len);
-	CU_ASSERT(rc == 0);
-	SPDK_CU_ASSERT_FATAL(value != NULL);
-	CU_ASSERT(value_len == strlen("second") + 1);
-	CU_ASSERT_NSTRING_EQUAL_FATAL(value, "second", value_len);
-
-	CU_ASSERT(g_bserrno == -1);
-	g_bserrno = bserrno;
+	spdk_blob_io_write(blob, channel, payload, cluster * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
 }
 
 static void
-blob_simultaneous_operations(void)
+blob_changed_clusters(void)
 {
 	struct spdk_blob_store *bs = g_bs;
 	struct spdk_blob_opts opts;
-	struct spdk_blob *blob, *snapshot;
-	spdk_blob_id blobid, snapshotid;
+	struct spdk_blob *blob, *snapshot1;
 	struct spdk_io_channel *channel;
-	int rc;
+	spdk_blob_id blobid, snapshotid1, snapshotid2;
+	uint32_t snapshot1_open_ref;
 
 	channel = spdk_bs_alloc_io_channel(bs);
 	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.num_clusters = 10;
-
+	opts.thin_provision = true;
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
 
-	/* Create snapshot and try to remove blob in the same time:
-	 * - snapshot should be created successfully
-	 * - delete operation should fail w -EBUSY */
-	CU_ASSERT(blob->locked_operation_in_progress == false);
+	/* snapshot1 gets clusters 0-1, snapshot2 clusters 1-2 and the blob clusters 5-6 */
+	ut_blob_write_cluster(blob, channel, 0);
+	ut_blob_write_cluster(blob, channel, 1);
 	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
-	CU_ASSERT(blob->locked_operation_in_progress == true);
-	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
-	CU_ASSERT(blob->locked_operation_in_progress == true);
-	/* Deletion failure */
-	CU_ASSERT(g_bserrno == -EBUSY);
 	poll_threads();
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	/* Snapshot creation success */
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid1 = g_blobid;
 
-	snapshotid = g_blobid;
+	ut_blob_write_cluster(blob, channel, 1);
+	ut_blob_write_cluster(blob, channel, 2);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid2 = g_blobid;
 
-	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	ut_blob_write_cluster(blob, channel, 5);
+	ut_blob_write_cluster(blob, channel, 6);
+
+	spdk_bs_open_blob(bs, snapshotid1, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot = g_blob;
+	snapshot1 = g_blob;
+	snapshot1_open_ref = snapshot1->open_ref;
 
-	/* Inflate blob and try to remove blob in the same time:
-	 * - blob should be inflated successfully
-	 * - delete operation should fail w -EBUSY */
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	spdk_bs_inflate_blob(bs, channel, blobid, blob_op_complete, NULL);
-	CU_ASSERT(blob->locked_operation_in_progress == true);
-	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
-	CU_ASSERT(blob->locked_operation_in_progress == true);
-	/* Deletion failure */
-	CU_ASSERT(g_bserrno == -EBUSY);
+	/* Between the two snapshots */
+	g_ut_num_extents = 0;
+	spdk_bs_get_changed_clusters(bs, snapshotid1, snapshotid2, ut_changed_clusters, NULL,
+				     blob_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	/* Inflation success */
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_ut_num_extents == 1);
+	CU_ASSERT(g_ut_extents[0][0] == 1 && g_ut_extents[0][1] == 2);
 
-	/* Clone snapshot and try to remove snapshot in the same time:
-	 * - snapshot should be cloned successfully
-	 * - delete operation should fail w -EBUSY */
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	spdk_bs_create_clone(bs, snapshotid, NULL, blob_op_with_id_complete, NULL);
-	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
-	/* Deletion failure */
-	CU_ASSERT(g_bserrno == -EBUSY);
+	/* Changes of every snapshot in between are included */
+	g_ut_num_extents = 0;
+	spdk_bs_get_changed_clusters(bs, snapshotid1, blobid, ut_changed_clusters, NULL,
+				     blob_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	/* Clone created */
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_ut_num_extents == 2);
+	CU_ASSERT(g_ut_extents[0][0] == 1 && g_ut_extents[0][1] == 2);
+	CU_ASSERT(g_ut_extents[1][0] == 5 && g_ut_extents[1][1] == 2);
 
-	/* Resize blob and try to remove blob in the same time:
-	 * - blob should be resized successfully
-	 * - delete operation should fail w -EBUSY */
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	spdk_blob_resize(blob, 50, blob_op_complete, NULL);
-	CU_ASSERT(blob->locked_operation_in_progress == true);
-	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
-	CU_ASSERT(blob->locked_operation_in_progress == true);
-	/* Deletion failure */
-	CU_ASSERT(g_bserrno == -EBUSY);
+	/* Without a base snapshot, everything allocated in the chain */
+	g_ut_num_extents = 0;
+	spdk_bs_get_changed_clusters(bs, SPDK_BLOBID_INVALID, blobid, ut_changed_clusters, NULL,
+				     blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_ut_num_extents == 2);
+	CU_ASSERT(g_ut_extents[0][0] == 0 && g_ut_extents[0][1] == 3);
+	CU_ASSERT(g_ut_extents[1][0] == 5 && g_ut_extents[1][1] == 2);
+
+	/* Base must be an ancestor */
+	g_ut_num_extents = 0;
+	spdk_bs_get_changed_clusters(bs, snapshotid2, snapshotid1, ut_changed_clusters, NULL,
+				     blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(g_ut_num_extents == 0);
+
+	spdk_bs_get_changed_clusters(bs, blobid, blobid, ut_changed_clusters, NULL,
+				     blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+
+	/* All blobs opened along the chain were closed */
+	CU_ASSERT(blob->open_ref == 1);
+	CU_ASSERT(snapshot1->open_ref == snapshot1_open_ref);
+
+	spdk_blob_close(snapshot1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_delete_blob(bs, snapshotid2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_delete_blob(bs, snapshotid1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+}
+
+static void
+ut_blob_fill_io_unit(struct spdk_blob *blob, struct spdk_io_channel *channel, uint64_t cluster,
+		     uint8_t pattern)
+{
+	uint64_t io_units_per_cluster = spdk_bs_get_cluster_size(blob->bs) /
+					spdk_bs_get_io_unit_size(blob->bs);
+	uint8_t payload[DEV_BUFFER_BLOCKLEN];
+
+	memset(payload, pattern, sizeof(payload));
+	spdk_blob_io_write(blob, channel, payload, cluster * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+}
+
+static struct spdk_bs_dev_cb_args *g_held_write;
+static bool g_drain_done;
+
+static void
+ut_dev_write_hold(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
+		  uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args)
+{
+	/* Keep the write in flight until the test completes it */
+	CU_ASSERT(g_held_write == NULL);
+	g_held_write = cb_args;
+}
+
+static void
+blob_drain_complete(void *cb_arg, int bserrno)
+{
+	CU_ASSERT(bserrno == 0);
+	g_drain_done = true;
+}
+
+static void
+blob_drain_io_inflight(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
+	struct spdk_bs_dev_cb_args *cb_args;
+	uint8_t payload[DEV_BUFFER_BLOCKLEN];
+	void (*dev_write)(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payload,
+			  uint64_t lba, uint32_t lba_count, struct spdk_bs_dev_cb_args *cb_args);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 1;
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	/* A write submitted before the freeze is still in flight */
+	dev_write = bs->dev->write;
+	bs->dev->write = ut_dev_write_hold;
+	g_held_write = NULL;
+	memset(payload, 0xAA, sizeof(payload));
+	spdk_blob_io_write(blob, channel, payload, 0, 1, blob_op_complete, NULL);
+	bs->dev->write = dev_write;
+	SPDK_CU_ASSERT_FATAL(g_held_write != NULL);
+
+	blob_freeze_io(blob, blob_op_complete, NULL);
+	g_drain_done = false;
+	blob_drain_io(blob, blob_drain_complete, NULL);
 	poll_threads();
-	CU_ASSERT(blob->locked_operation_in_progress == false);
-	/* Blob resized successfully */
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	spdk_delay_us(BLOB_DRAIN_IO_POLL_PERIOD_US);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_drain_done == false);
 
-	/* Issue two consecutive blob syncs, neither should fail.
-	 * Force sync to actually occur by marking blob dirty each time.
-	 * Execution of sync should not be enough to complete the operation,
-	 * since disk I/O is required to complete it. */
+	/* The drain completes once the write does */
 	g_bserrno = -1;
+	cb_args = g_held_write;
+	g_held_write = NULL;
+	cb_args->cb_fn(cb_args->channel, cb_args->cb_arg, 0);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_delay_us(BLOB_DRAIN_IO_POLL_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(g_drain_done == true);
 
-	rc = spdk_blob_set_xattr(blob, "sync", "first", strlen("first") + 1);
-	CU_ASSERT(rc == 0);
-	spdk_blob_sync_md(blob, first_sync_complete, blob);
-	CU_ASSERT(g_bserrno == -1);
-
-	spdk_blob_sync_md(blob, second_sync_complete, blob);
-	CU_ASSERT(g_bserrno == -1);
+	/* Nothing in flight, the drain completes right away */
+	g_drain_done = false;
+	blob_drain_io(blob, blob_drain_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_drain_done == true);
 
+	blob_unfreeze_io(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->frozen_refcnt == 0);
 
 	spdk_bs_free_io_channel(channel);
-	poll_threads();
-
-	ut_blob_close_and_delete(bs, snapshot);
 	ut_blob_close_and_delete(bs, blob);
 }
 
 static void
-blob_persist_test(void)
+blob_dedup(void)
 {
 	struct spdk_blob_store *bs = g_bs;
 	struct spdk_blob_opts opts;
-	struct spdk_blob *blob;
-	spdk_blob_id blobid;
+	struct spdk_blob *blob, *thick;
 	struct spdk_io_channel *channel;
-	char *xattr;
-	size_t xattr_length;
-	int rc;
-	uint32_t page_count_clear, page_count_xattr;
-	uint64_t poller_iterations;
-	bool run_poller;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t free_clusters;
+	uint8_t payload[DEV_BUFFER_BLOCKLEN];
 
 	channel = spdk_bs_alloc_io_channel(bs);
 	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.num_clusters = 10;
-
+	opts.thin_provision = true;
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
 
-	/* Save the amount of md pages used after creation of a blob.
-	 * This should be consistent after removing xattr. */
-	page_count_clear = spdk_bit_array_count_set(bs->used_md_pages);
-	SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_clear);
-	SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_clear);
-
-	/* Add xattr with maximum length of descriptor to exceed single metadata page. */
-	xattr_length = SPDK_BS_MAX_DESC_SIZE - sizeof(struct spdk_blob_md_descriptor_xattr) -
-		       strlen("large_xattr");
-	xattr = calloc(xattr_length, sizeof(char));
-	SPDK_CU_ASSERT_FATAL(xattr != NULL);
-
-	rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
-	SPDK_CU_ASSERT_FATAL(rc == 0);
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	ut_blob_fill_io_unit(blob, channel, 0, 0xAA);
+	ut_blob_fill_io_unit(blob, channel, 1, 0xBB);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
-	SPDK_CU_ASSERT_FATAL(g_bserrno == 0);
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid = g_blobid;
 
-	/* Save the amount of md pages used after adding the large xattr */
-	page_count_xattr = spdk_bit_array_count_set(bs->used_md_pages);
-	SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_xattr);
-	SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_xattr);
+	/* Cluster 0 is rewritten with the data of the snapshot, cluster 1 with new data
+	 * and cluster 5 with zeroes, which is what the chain reads there */
+	ut_blob_fill_io_unit(blob, channel, 0, 0xAA);
+	ut_blob_fill_io_unit(blob, channel, 1, 0xCC);
+	ut_blob_fill_io_unit(blob, channel, 5, 0x00);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+	CU_ASSERT(blob->active.clusters[5] != 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
 
-	/* Add xattr to a blob and sync it. While sync is occurring, remove the xattr and sync again.
-	 * Interrupt the first sync after increasing number of poller iterations, until it succeeds.
-	 * Expectation is that after second sync completes no xattr is saved in metadata. */
-	poller_iterations = 1;
-	run_poller = true;
-	while (run_poller) {
-		rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
-		SPDK_CU_ASSERT_FATAL(rc == 0);
-		g_bserrno = -1;
-		spdk_blob_sync_md(blob, blob_op_complete, NULL);
-		poll_thread_times(0, poller_iterations);
-		if (g_bserrno == 0) {
-			/* Poller iteration count was high enough for first sync to complete.
-			 * Verify that blob takes up enough of md_pages to store the xattr. */
-			SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_xattr);
-			SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_xattr);
-			SPDK_CU_ASSERT_FATAL(spdk_bit_array_count_set(bs->used_md_pages) == page_count_xattr);
-			run_poller = false;
-		}
-		rc = spdk_blob_remove_xattr(blob, "large_xattr");
-		SPDK_CU_ASSERT_FATAL(rc == 0);
-		spdk_blob_sync_md(blob, blob_op_complete, NULL);
-		poll_threads();
-		SPDK_CU_ASSERT_FATAL(g_bserrno == 0);
-		SPDK_CU_ASSERT_FATAL(blob->active.num_pages + blob->active.num_extent_pages == page_count_clear);
-		SPDK_CU_ASSERT_FATAL(blob->clean.num_pages + blob->clean.num_extent_pages == page_count_clear);
-		SPDK_CU_ASSERT_FATAL(spdk_bit_array_count_set(bs->used_md_pages) == page_count_clear);
+	spdk_bs_blob_dedup(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 2);
+	CU_ASSERT(blob->active.clusters[0] == 0);
+	CU_ASSERT(blob->active.clusters[1] != 0);
+	CU_ASSERT(blob->active.clusters[5] == 0);
+	CU_ASSERT(blob->frozen_refcnt == 0);
 
-		/* Reload bs and re-open blob to verify that xattr was not persisted. */
-		spdk_blob_close(blob, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
+	/* Data is still the same */
+	spdk_blob_io_read(blob, channel, payload, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(payload[0] == 0xAA && payload[DEV_BUFFER_BLOCKLEN - 1] == 0xAA);
 
-		ut_bs_reload(&bs, NULL);
+	/* Nothing else to release */
+	spdk_bs_blob_dedup(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 2);
 
-		spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-		blob = g_blob;
+	/* Snapshots and thick provisioned blobs cannot be deduplicated */
+	spdk_bs_blob_dedup(bs, channel, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EPERM);
 
-		rc = spdk_blob_get_xattr_value(blob, "large_xattr", (const void **)&xattr, &xattr_length);
-		SPDK_CU_ASSERT_FATAL(rc == -ENOENT);
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 1;
+	thick = ut_blob_create_and_open(bs, &opts);
+	spdk_bs_blob_dedup(bs, channel, spdk_blob_get_id(thick), blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	ut_blob_close_and_delete(bs, thick);
 
-		poller_iterations++;
-		/* Stop at high iteration count to prevent infinite loop.
-		 * This value should be enough for first md sync to complete in any case. */
-		SPDK_CU_ASSERT_FATAL(poller_iterations < 50);
-	}
+	/* The released clusters were persisted */
+	spdk_bs_free_io_channel(channel);
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	ut_bs_reload(&bs, NULL);
 
-	free(xattr);
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->active.clusters[0] == 0);
+	CU_ASSERT(blob->active.clusters[1] != 0);
+	CU_ASSERT(blob->active.clusters[5] == 0);
 
 	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = bs;
+}
 
-	spdk_bs_free_io_channel(channel);
+static uint8_t
+ut_blob_read_io_unit(struct spdk_blob *blob, struct spdk_io_channel *channel, uint64_t cluster)
+{
+	uint64_t io_units_per_cluster = spdk_bs_get_cluster_size(blob->bs) /
+					spdk_bs_get_io_unit_size(blob->bs);
+	uint8_t payload[DEV_BUFFER_BLOCKLEN];
+
+	memset(payload, 0xA5, sizeof(payload));
+	spdk_blob_io_read(blob, channel, payload, cluster * io_units_per_cluster, 1,
+			  blob_op_complete, NULL);
 	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(payload[0] == payload[sizeof(payload) - 1]);
+
+	return payload[0];
 }
 
 static void
-blob_decouple_snapshot(void)
+blob_chain_map(void)
 {
 	struct spdk_blob_store *bs = g_bs;
 	struct spdk_blob_opts opts;
-	struct spdk_blob *blob, *snapshot1, *snapshot2;
+	struct spdk_blob *blob, *snapshot1, *snapshot3, *thick;
 	struct spdk_io_channel *channel;
-	spdk_blob_id blobid, snapshotid;
-	uint64_t cluster;
+	spdk_blob_id blobid, snapshotid1, snapshotid2, snapshotid3;
+	uint64_t i;
 
 	channel = spdk_bs_alloc_io_channel(bs);
 	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
 	ut_spdk_blob_opts_init(&opts);
-	opts.num_clusters = 10;
-	opts.thin_provision = false;
-
+	opts.num_clusters = 5;
+	opts.thin_provision = true;
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
 
-	/* Create first snapshot */
-	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 0);
+	/* Chain of three snapshots, each with one cluster allocated */
+	ut_blob_fill_io_unit(blob, channel, 0, 0x11);
 	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 1);
-	snapshotid = g_blobid;
+	snapshotid1 = g_blobid;
 
-	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	ut_blob_fill_io_unit(blob, channel, 1, 0x22);
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot1 = g_blob;
+	snapshotid2 = g_blobid;
 
-	/* Create the second one */
-	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 1);
+	ut_blob_fill_io_unit(blob, channel, 2, 0x33);
 	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	CU_ASSERT_EQUAL(_get_snapshots_count(bs), 2);
-	snapshotid = g_blobid;
+	snapshotid3 = g_blobid;
 
-	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	spdk_bs_open_blob(bs, snapshotid1, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot2 = g_blob;
-	CU_ASSERT_EQUAL(spdk_blob_get_parent_snapshot(bs, snapshot2->id), snapshot1->id);
+	snapshot1 = g_blob;
 
-	/* Now decouple the second snapshot forcing it to copy the written clusters */
-	spdk_bs_blob_decouple_parent(bs, channel, snapshot2->id, blob_op_complete, NULL);
+	spdk_bs_open_blob(bs, snapshotid3, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot3 = g_blob;
 
-	/* Verify that the snapshot has been decoupled and that the clusters have been copied */
-	CU_ASSERT_EQUAL(spdk_blob_get_parent_snapshot(bs, snapshot2->id), SPDK_BLOBID_INVALID);
-	for (cluster = 0; cluster < snapshot2->active.num_clusters; ++cluster) {
-		CU_ASSERT_NOT_EQUAL(snapshot2->active.clusters[cluster], 0);
-		CU_ASSERT_NOT_EQUAL(snapshot2->active.clusters[cluster],
-				    snapshot1->active.clusters[cluster]);
+	/* The snapshot the blob reads through resolves every cluster in one step,
+	 * snapshot1 has no parent blob and needs no map */
+	SPDK_CU_ASSERT_FATAL(snapshot3->chain_map != NULL);
+	CU_ASSERT(snapshot3->chain_map_len == 5);
+	CU_ASSERT(snapshot3->chain_map[0] == snapshot1->active.clusters[0]);
+	CU_ASSERT(snapshot3->chain_map[2] == snapshot3->active.clusters[2]);
+	CU_ASSERT(snapshot3->chain_map[3] == 0);
+	CU_ASSERT(snapshot3->chain_end_dev == snapshot1->back_bs_dev);
+	CU_ASSERT(snapshot1->chain_map == NULL);
+
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 0) == 0x11);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 1) == 0x22);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 2) == 0x33);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 3) == 0x00);
+
+	/* Decouple snapshot3 from snapshot2 and delete snapshot2 */
+	spdk_bs_blob_decouple_parent(bs, channel, snapshotid3, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(snapshot3->chain_map[1] == snapshot3->active.clusters[1]);
+
+	spdk_bs_delete_blob(bs, snapshotid2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Reuse the clusters freed by snapshot2 */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = spdk_bs_free_cluster_count(bs);
+	thick = ut_blob_create_and_open(bs, &opts);
+	for (i = 0; i < opts.num_clusters; i++) {
+		ut_blob_fill_io_unit(thick, channel, i, 0xFF);
 	}
 
-	spdk_bs_free_io_channel(channel);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 0) == 0x11);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 1) == 0x22);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 2) == 0x33);
+	CU_ASSERT(ut_blob_read_io_unit(blob, channel, 3) == 0x00);
 
-	ut_blob_close_and_delete(bs, snapshot2);
-	ut_blob_close_and_delete(bs, snapshot1);
+	ut_blob_close_and_delete(bs, thick);
+	spdk_blob_close(snapshot1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_close(snapshot3, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
 	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_delete_blob(bs, snapshotid3, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_delete_blob(bs, snapshotid1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+}
+
+static void
+bs_recover_read_ahead(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_power_failure_thresholds thresholds = {};
+	struct spdk_blob *blob;
+	spdk_blob_id blobids[5];
+	char name[16], value[1000];
+	const void *val;
+	size_t len;
+	uint32_t md_len = bs->md_len;
+	int i, j, rc;
+
+	memset(value, 'x', sizeof(value));
+	for (i = 0; i < 5; i++) {
+		blob = ut_blob_create_and_open(bs, NULL);
+		blobids[i] = spdk_blob_get_id(blob);
+		/* The last blob needs a chain of several md pages */
+		for (j = 0; j < (i == 4 ? 10 : 1); j++) {
+			snprintf(name, sizeof(name), "xattr%d", j);
+			rc = spdk_blob_set_xattr(blob, name, value, sizeof(value));
+			CU_ASSERT(rc == 0);
+		}
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	/* Replay reads the md region in large chunks rather than page by page */
+	thresholds.read_threshold = UINT64_MAX;
+	dev_set_power_failure_thresholds(thresholds);
+	ut_bs_dirty_load(&bs, NULL);
+	CU_ASSERT(g_power_failure_counters.read_counter < 16);
+	CU_ASSERT(g_power_failure_counters.read_counter < md_len);
+	dev_reset_power_failure_event();
+
+	for (i = 0; i < 5; i++) {
+		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+		blob = g_blob;
+		for (j = 0; j < (i == 4 ? 10 : 1); j++) {
+			snprintf(name, sizeof(name), "xattr%d", j);
+			rc = spdk_blob_get_xattr_value(blob, name, &val, &len);
+			CU_ASSERT(rc == 0);
+			CU_ASSERT(len == sizeof(value));
+		}
+		ut_blob_close_and_delete(bs, blob);
+	}
+
+	g_bs = bs;
+}
+
+static void
+blob_md_write_coalesce(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_power_failure_thresholds thresholds = {};
+	struct spdk_blob *blob;
+	char name[16], value[1000];
+	uint32_t num_pages;
+	int i, rc;
+
+	blob = ut_blob_create_and_open(bs, NULL);
+
+	memset(value, 'x', sizeof(value));
+	for (i = 0; i < 20; i++) {
+		snprintf(name, sizeof(name), "xattr%d", i);
+		rc = spdk_blob_set_xattr(blob, name, value, sizeof(value));
+		CU_ASSERT(rc == 0);
+	}
+
+	/* The chain is written with one I/O per contiguous run of md pages,
+	 * plus one for the root page, rather than one I/O per page. */
+	thresholds.write_threshold = UINT64_MAX;
+	dev_set_power_failure_thresholds(thresholds);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
 	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	num_pages = blob->active.num_pages;
+	CU_ASSERT(num_pages > 4);
+	CU_ASSERT(g_power_failure_counters.write_counter <= 2);
+	dev_reset_power_failure_event();
+
+	ut_blob_close_and_delete(bs, blob);
 }
 
 static void
@@ -7209,6 +8672,9 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_test);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rw);
 	CU_ADD_TEST(suite, blob_thin_prov_write_count_io);
+	CU_ADD_TEST(suite, blob_thin_prov_channel_reserved_clusters);
+	CU_ADD_TEST(suite, blob_thin_prov_locality);
+	CU_ADD_TEST(suite, blob_preallocate);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rle);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rw_iov);
 	CU_ADD_TEST(suite, bs_load_iter_test);
@@ -7229,6 +8695,15 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite_bs, blob_simultaneous_operations);
 	CU_ADD_TEST(suite_bs, blob_persist_test);
 	CU_ADD_TEST(suite_bs, blob_decouple_snapshot);
+	CU_ADD_TEST(suite, blob_esnap_clone);
+	CU_ADD_TEST(suite, blob_esnap_remove);
+	CU_ADD_TEST(suite_bs, blob_shallow_copy);
+	CU_ADD_TEST(suite_bs, blob_changed_clusters);
+	CU_ADD_TEST(suite_bs, bs_recover_read_ahead);
+	CU_ADD_TEST(suite_bs, blob_md_write_coalesce);
+	CU_ADD_TEST(suite_bs, blob_dedup);
+	CU_ADD_TEST(suite_bs, blob_drain_io_inflight);
+	CU_ADD_TEST(suite_bs, blob_chain_map);
 
 	allocate_threads(2);
 	set_thread(0);
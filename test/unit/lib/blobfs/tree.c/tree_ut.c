@@ -130,6 +130,64 @@ blobfs_tree_op_test(void)
 	free(tree);
 }
 
+static void
+blobfs_tree_reclaim_test(void)
+{
+	struct cache_tree *tree;
+	struct cache_buffer *buffer[4];
+	uint32_t freed;
+	int i;
+
+	tree = calloc(1, sizeof(*tree));
+	SPDK_CU_ASSERT_FATAL(tree != NULL);
+
+	for (i = 0; i < 4; i++) {
+		buffer[i] = calloc(1, sizeof(struct cache_buffer));
+		SPDK_CU_ASSERT_FATAL(buffer[i]);
+		buffer[i]->offset = i * CACHE_TREE_LEVEL_SIZE(1);
+		buffer[i]->bytes_filled = buffer[i]->bytes_flushed = 32;
+		buffer[i]->referenced = true;
+		tree = tree_insert_buffer(tree, buffer[i]);
+		SPDK_CU_ASSERT_FATAL(tree != NULL);
+	}
+	CU_ASSERT(tree->level == 1);
+
+	/* buffer[1] is not flushed yet, buffer[2] is being read and buffer[3] is skipped */
+	buffer[1]->bytes_flushed = 0;
+	buffer[2]->in_progress = true;
+
+	/* Referenced buffers get a second chance */
+	freed = tree_reclaim_buffers(tree, buffer[3], 4);
+	CU_ASSERT(freed == 0);
+	CU_ASSERT(buffer[0]->referenced == false);
+	CU_ASSERT(buffer[3]->referenced == true);
+
+	/* Only buffer[0] can be freed, its level 0 tree is freed along with it */
+	freed = tree_reclaim_buffers(tree, buffer[3], 4);
+	CU_ASSERT(freed == 1);
+	CU_ASSERT(tree_find_buffer(tree, 0) == NULL);
+	CU_ASSERT(tree->u.tree[0] == NULL);
+	CU_ASSERT(tree->present_mask == 0xEULL);
+
+	/* A buffer read from again is kept */
+	buffer[1]->bytes_flushed = 32;
+	buffer[2]->in_progress = false;
+	buffer[2]->referenced = false;
+	buffer[3]->referenced = false;
+	freed = tree_reclaim_buffers(tree, NULL, 4);
+	CU_ASSERT(freed == 2);
+	CU_ASSERT(tree_find_buffer(tree, CACHE_TREE_LEVEL_SIZE(1)) == buffer[1]);
+
+	/* At most count buffers are freed */
+	freed = tree_reclaim_buffers(tree, NULL, 0);
+	CU_ASSERT(freed == 0);
+	freed = tree_reclaim_buffers(tree, NULL, 1);
+	CU_ASSERT(freed == 1);
+	CU_ASSERT(tree->present_mask == 0);
+
+	free(tree);
+}
+
 int main(int argc, char **argv)
 {
 	CU_pSuite	suite = NULL;
@@ -140,6 +198,7 @@ int main(int argc, char **argv)
 
 	suite = CU_add_suite("tree", NULL, NULL);
 	CU_ADD_TEST(suite, blobfs_tree_op_test);
+	CU_ADD_TEST(suite, blobfs_tree_reclaim_test);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
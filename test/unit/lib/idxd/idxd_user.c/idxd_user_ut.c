@@ -130,6 +130,7 @@ test_idxd_wq_config(void)
 	CU_ASSERT(wqcfg->max_xfer_shift == LOG2_WQ_MAX_XFER);
 	CU_ASSERT(wqcfg->wq_state == WQ_ENABLED);
 	CU_ASSERT(wqcfg->priority == WQ_PRIORITY_1);
+	CU_ASSERT(user_idxd.idxd.batch_size == DESC_PER_BATCH);
 
 	for (i = 1; i < user_idxd.registers->wqcap.num_wqs; i++) {
 		for (j = 0 ; j < (sizeof(union idxd_wqcfg) / sizeof(uint32_t)); j++) {
@@ -137,6 +138,20 @@ test_idxd_wq_config(void)
 		}
 	}
 
+	/* A device supporting smaller batches than ours limits the batch size. */
+	memset(wqcfg, 0, sizeof(*wqcfg));
+	user_idxd.registers->gencap.max_batch_shift = LOG2_WQ_MAX_BATCH - 2;
+	rc = idxd_wq_config(&user_idxd);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(wqcfg->max_batch_shift == LOG2_WQ_MAX_BATCH - 2);
+	CU_ASSERT(user_idxd.idxd.batch_size == DESC_PER_BATCH / 4);
+
+	/* One that can't batch gets single descriptors. */
+	user_idxd.registers->gencap.max_batch_shift = 0;
+	rc = idxd_wq_config(&user_idxd);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(user_idxd.idxd.batch_size == 1);
+
 	free(user_idxd.registers);
 
 	return 0;
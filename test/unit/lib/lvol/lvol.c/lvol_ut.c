@@ -70,6 +70,7 @@ struct spdk_blob {
 	char			uuid[SPDK_UUID_STRING_LEN];
 	char			name[SPDK_LVS_NAME_MAX];
 	bool			thin_provisioned;
+	bool			esnap_clone;
 };
 
 int g_lvserrno;
@@ -109,6 +110,32 @@ void spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_cha
 	cb_fn(cb_arg, g_inflate_rc);
 }
 
+void spdk_bs_blob_shallow_copy(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			       spdk_blob_id blobid, struct spdk_bs_dev *ext_dev,
+			       spdk_blob_shallow_copy_status status_cb_fn, void *status_cb_arg,
+			       spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	if (g_inflate_rc == 0 && status_cb_fn != NULL) {
+		status_cb_fn(1, 1, status_cb_arg);
+	}
+	cb_fn(cb_arg, g_inflate_rc);
+}
+
+void spdk_bs_get_changed_clusters(struct spdk_blob_store *bs, spdk_blob_id base_id,
+				  spdk_blob_id blobid, spdk_blob_changed_clusters_cb extent_cb_fn,
+				  void *extent_cb_arg, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	/* Report the ids through the extent */
+	extent_cb_fn(extent_cb_arg, base_id, blobid);
+	cb_fn(cb_arg, 0);
+}
+
+void spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	cb_fn(cb_arg, g_inflate_rc);
+}
+
 void
 spdk_bs_iter_next(struct spdk_blob_store *bs, struct spdk_blob *b,
 		  spdk_blob_op_with_handle_complete cb_fn, void *cb_arg)
@@ -176,6 +203,8 @@ spdk_bs_load(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts,
 
 	if (ut_dev->load_status == 0) {
 		bs = ut_dev->bs;
+		bs->bs_opts.esnap_bs_dev_create = opts->esnap_bs_dev_create;
+		bs->bs_opts.esnap_ctx = opts->esnap_ctx;
 	}
 
 	cb_fn(cb_arg, bs, ut_dev->load_status);
@@ -342,6 +371,7 @@ spdk_bs_opts_init(struct spdk_bs_opts *opts, size_t opts_size)
 	opts->num_md_pages = SPDK_BLOB_OPTS_NUM_MD_PAGES;
 	opts->max_md_ops = SPDK_BLOB_OPTS_MAX_MD_OPS;
 	opts->max_channel_ops = SPDK_BLOB_OPTS_MAX_CHANNEL_OPS;
+	opts->channel_reserved_clusters = 0;
 	memset(&opts->bstype, 0, sizeof(opts->bstype));
 }
 
@@ -445,6 +475,9 @@ spdk_bs_create_blob_ext(struct spdk_blob_store *bs, const struct spdk_blob_opts
 	if (opts != NULL && opts->thin_provision) {
 		b->thin_provisioned = true;
 	}
+	if (opts != NULL && opts->esnap_id != NULL) {
+		b->esnap_clone = true;
+	}
 	b->bs = bs;
 
 	TAILQ_INSERT_TAIL(&bs->blobs, b, link);
@@ -592,10 +625,12 @@ lvs_init_opts_success(void)
 	spdk_lvs_opts_init(&opts);
 	snprintf(opts.name, sizeof(opts.name), "lvs");
 	opts.cluster_sz = 8192;
+	opts.channel_reserved_clusters = 4;
 	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	CU_ASSERT(dev.bs->bs_opts.cluster_sz == opts.cluster_sz);
+	CU_ASSERT(dev.bs->bs_opts.channel_reserved_clusters == opts.channel_reserved_clusters);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
 
 	g_lvserrno = -1;
@@ -1951,6 +1986,104 @@ lvol_create_thin_provisioned(void)
 	free_dev(&dev);
 }
 
+static int
+ut_esnap_dev_create(void *bs_ctx, struct spdk_blob *blob, const void *esnap_id,
+		    uint32_t id_len, struct spdk_bs_dev **bs_dev)
+{
+	return -ENOTSUP;
+}
+
+static void
+lvol_esnap_clone(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvs_opts opts;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob *super_blob;
+	const char esnap_id[] = "esnap";
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+	opts.esnap_bs_dev_create = ut_esnap_dev_create;
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+	CU_ASSERT(dev.bs->bs_opts.esnap_bs_dev_create == ut_esnap_dev_create);
+	CU_ASSERT(dev.bs->bs_opts.esnap_ctx == g_lvol_store);
+
+	/* External snapshot id is required */
+	rc = spdk_lvol_create_esnap_clone(NULL, 0, BS_CLUSTER_SIZE, g_lvol_store, "clone",
+					  lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Size must be a multiple of the cluster size */
+	rc = spdk_lvol_create_esnap_clone(esnap_id, sizeof(esnap_id), BS_CLUSTER_SIZE + 512,
+					  g_lvol_store, "clone", lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	g_lvserrno = -1;
+	rc = spdk_lvol_create_esnap_clone(esnap_id, sizeof(esnap_id), 2 * BS_CLUSTER_SIZE,
+					  g_lvol_store, "clone", lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	CU_ASSERT(g_lvol->thin_provision == true);
+	CU_ASSERT(g_lvol->blob->thin_provisioned == true);
+	CU_ASSERT(g_lvol->blob->esnap_clone == true);
+
+	/* Names are shared with other lvols */
+	rc = spdk_lvol_create_esnap_clone(esnap_id, sizeof(esnap_id), BS_CLUSTER_SIZE,
+					  g_lvol_store, "clone", lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == -EEXIST);
+
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+
+	/* The callback is handed to the blobstore on load too */
+	init_dev(&dev);
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	snprintf(bs_opts.bstype.bstype, sizeof(bs_opts.bstype.bstype), "LVOLSTORE");
+	spdk_bs_init(&dev.bs_dev, &bs_opts, null_cb, NULL);
+	super_blob = calloc(1, sizeof(*super_blob));
+	SPDK_CU_ASSERT_FATAL(super_blob != NULL);
+	super_blob->id = 0x100;
+	spdk_blob_set_xattr(super_blob, "uuid", uuid, SPDK_UUID_STRING_LEN);
+	spdk_blob_set_xattr(super_blob, "name", "lvs", strnlen("lvs", SPDK_LVS_NAME_MAX) + 1);
+	TAILQ_INSERT_TAIL(&dev.bs->blobs, super_blob, link);
+	dev.bs->super_blobid = 0x100;
+
+	g_lvserrno = -1;
+	spdk_lvs_load_ext(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+	CU_ASSERT(dev.bs->bs_opts.esnap_bs_dev_create == ut_esnap_dev_create);
+	CU_ASSERT(dev.bs->bs_opts.esnap_ctx == g_lvol_store);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+}
+
 static void
 lvol_inflate(void)
 {
@@ -2051,6 +2184,190 @@ lvol_decouple_parent(void)
 	CU_ASSERT(g_io_channel == NULL);
 }
 
+static void
+ut_shallow_copy_status(uint64_t copied_clusters, uint64_t total_clusters, void *cb_arg)
+{
+	*(uint64_t *)cb_arg = copied_clusters;
+}
+
+static void
+lvol_shallow_copy(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvs_opts opts;
+	struct spdk_bs_dev ext_dev = {};
+	uint64_t copied = 0;
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+
+	spdk_lvol_create(g_lvol_store, "lvol", 10, false, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+
+	/* External device is required */
+	spdk_lvol_shallow_copy(g_lvol, NULL, NULL, NULL, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == -ENODEV);
+
+	g_inflate_rc = -1;
+	spdk_lvol_shallow_copy(g_lvol, &ext_dev, ut_shallow_copy_status, &copied, op_complete, NULL);
+	CU_ASSERT(g_lvserrno != 0);
+	CU_ASSERT(copied == 0);
+
+	g_inflate_rc = 0;
+	spdk_lvol_shallow_copy(g_lvol, &ext_dev, ut_shallow_copy_status, &copied, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(copied == 1);
+
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+
+	CU_ASSERT(g_io_channel == NULL);
+}
+
+static void
+ut_changed_clusters(void *cb_arg, uint64_t start_cluster, uint64_t num_clusters)
+{
+	uint64_t *ids = cb_arg;
+
+	ids[0] = start_cluster;
+	ids[1] = num_clusters;
+}
+
+static void
+lvol_get_changed_clusters(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvs_opts opts;
+	struct spdk_lvol *base, *lvol;
+	uint64_t ids[2] = {};
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+
+	spdk_lvol_create(g_lvol_store, "base", 10, false, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	base = g_lvol;
+
+	spdk_lvol_create(g_lvol_store, "lvol", 10, false, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	lvol = g_lvol;
+
+	spdk_lvol_get_changed_clusters(base, NULL, ut_changed_clusters, ids, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == -ENODEV);
+
+	spdk_lvol_get_changed_clusters(base, lvol, ut_changed_clusters, ids, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(ids[0] == spdk_blob_get_id(base->blob));
+	CU_ASSERT(ids[1] == spdk_blob_get_id(lvol->blob));
+
+	spdk_lvol_get_changed_clusters(NULL, lvol, ut_changed_clusters, ids, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(ids[0] == SPDK_BLOBID_INVALID);
+	CU_ASSERT(ids[1] == spdk_blob_get_id(lvol->blob));
+
+	spdk_lvol_close(lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_close(base, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(base, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+}
+
+static void
+lvol_dedup(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvs_opts opts;
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+
+	spdk_lvol_create(g_lvol_store, "lvol", 10, true, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+
+	spdk_lvol_dedup(NULL, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == -ENODEV);
+
+	g_inflate_rc = -1;
+	spdk_lvol_dedup(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno != 0);
+
+	g_inflate_rc = 0;
+	spdk_lvol_dedup(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+
+	/* The io_channel allocated for the request was released */
+	CU_ASSERT(g_io_channel == NULL);
+}
+
 static void
 lvol_get_xattr(void)
 {
@@ -2135,10 +2452,14 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, lvol_refcnt);
 	CU_ADD_TEST(suite, lvol_names);
 	CU_ADD_TEST(suite, lvol_create_thin_provisioned);
+	CU_ADD_TEST(suite, lvol_esnap_clone);
 	CU_ADD_TEST(suite, lvol_rename);
 	CU_ADD_TEST(suite, lvs_rename);
 	CU_ADD_TEST(suite, lvol_inflate);
 	CU_ADD_TEST(suite, lvol_decouple_parent);
+	CU_ADD_TEST(suite, lvol_shallow_copy);
+	CU_ADD_TEST(suite, lvol_get_changed_clusters);
+	CU_ADD_TEST(suite, lvol_dedup);
 	CU_ADD_TEST(suite, lvol_get_xattr);
 
 	allocate_threads(1);
@@ -78,6 +78,8 @@ DEFINE_STUB(nvme_transport_qpair_iterate_requests, int,
 
 DEFINE_STUB(nvme_qpair_abort_queued_reqs_with_cbarg, uint32_t,
 	    (struct spdk_nvme_qpair *qpair, void *cmd_cb_arg), 0);
+DEFINE_STUB_V(nvme_qpair_record_latency, (struct spdk_nvme_qpair *qpair,
+		struct nvme_request *req, const struct spdk_nvme_cpl *cpl));
 
 static int
 nvme_ns_cmp(struct spdk_nvme_ns *ns1, struct spdk_nvme_ns *ns2)
@@ -76,6 +76,8 @@ DEFINE_STUB(nvme_request_check_timeout, int, (struct nvme_request *req, uint16_t
 DEFINE_STUB(spdk_strerror, const char *, (int errnum), NULL);
 
 DEFINE_STUB_V(nvme_transport_ctrlr_disconnect_qpair_done, (struct spdk_nvme_qpair *qpair));
+DEFINE_STUB_V(nvme_qpair_record_latency, (struct spdk_nvme_qpair *qpair,
+		struct nvme_request *req, const struct spdk_nvme_cpl *cpl));
 
 int nvme_qpair_init(struct spdk_nvme_qpair *qpair, uint16_t id,
 		    struct spdk_nvme_ctrlr *ctrlr,
@@ -568,6 +570,82 @@ test_nvme_pcie_ctrlr_construct_admin_qpair(void)
 	CU_ASSERT(rc == 0);
 }
 
+static void
+test_nvme_pcie_qpair_adaptive_doorbell(void)
+{
+	struct nvme_pcie_ctrlr pctrlr = {};
+	struct nvme_pcie_qpair pqpair = {};
+	struct spdk_nvme_pcie_stat stat = {};
+	struct spdk_nvme_pcie_qpair_doorbell_stat db_stat = {};
+	struct spdk_nvme_cmd cmd[8] = {};
+	struct spdk_nvme_cpl cpl[8] = {};
+	struct nvme_request req = {};
+	struct nvme_tracker tr = {};
+	uint32_t sq_tdbl = 0, cq_hdbl = 0;
+	int i, rc;
+
+	pqpair.qpair.ctrlr = &pctrlr.ctrlr;
+	pqpair.qpair.id = 1;
+	pqpair.qpair.trtype = SPDK_NVME_TRANSPORT_PCIE;
+	pqpair.num_entries = 8;
+	pqpair.max_completions_cap = 4;
+	pqpair.cmd = cmd;
+	pqpair.cpl = cpl;
+	pqpair.sq_tdbl = &sq_tdbl;
+	pqpair.cq_hdbl = &cq_hdbl;
+	pqpair.stat = &stat;
+	pqpair.flags.phase = 1;
+	pqpair.flags.delay_cmd_submit = 1;
+	pqpair.delay_cmd_submit_threshold = 2;
+	tr.req = &req;
+
+	/* The first two commands in a poll iteration ring the doorbell immediately. */
+	for (i = 0; i < 2; i++) {
+		nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+		CU_ASSERT(sq_tdbl == (uint32_t)i + 1);
+	}
+
+	/* Further commands are batched until the next poll. */
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 2);
+	CU_ASSERT(pqpair.sq_tail == 4);
+
+	rc = nvme_pcie_qpair_process_completions(&pqpair.qpair, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(sq_tdbl == 4);
+	CU_ASSERT(pqpair.last_sq_tail == 4);
+	CU_ASSERT(pqpair.num_submits_in_poll == 0);
+
+	/* Nothing is left to ring in the next poll. */
+	rc = nvme_pcie_qpair_process_completions(&pqpair.qpair, 0);
+	CU_ASSERT(rc == 0);
+
+	/* The next poll iteration starts with immediate doorbells again. */
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 5);
+
+	rc = spdk_nvme_pcie_qpair_get_doorbell_stat(&pqpair.qpair, &db_stat);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(db_stat.sq_mmio_doorbell_updates == 4);
+	CU_ASSERT(db_stat.delayed_submissions == 2);
+	CU_ASSERT(db_stat.cq_mmio_doorbell_updates == 0);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 4);
+
+	/* Without a threshold, all commands are batched. */
+	pqpair.delay_cmd_submit_threshold = 0;
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 5);
+
+	rc = nvme_pcie_qpair_process_completions(&pqpair.qpair, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(sq_tdbl == 6);
+
+	pqpair.qpair.trtype = SPDK_NVME_TRANSPORT_TCP;
+	rc = spdk_nvme_pcie_qpair_get_doorbell_stat(&pqpair.qpair, &db_stat);
+	CU_ASSERT(rc == -EINVAL);
+}
+
 int main(int argc, char **argv)
 {
 	CU_pSuite	suite = NULL;
@@ -582,6 +660,7 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_cmd_create_delete_io_queue);
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_connect_qpair);
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_construct_admin_qpair);
+	CU_ADD_TEST(suite, test_nvme_pcie_qpair_adaptive_doorbell);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -75,6 +75,9 @@ DEFINE_STUB(nvme_transport_get_trtype,
 	    enum spdk_nvme_transport_type,
 	    (const struct spdk_nvme_transport *transport),
 	    SPDK_NVME_TRANSPORT_PCIE);
+DEFINE_STUB(nvme_qpair_get_latency_stat, int, (struct spdk_nvme_qpair *qpair,
+		struct spdk_nvme_qpair_latency_stat *stat), 0);
+DEFINE_STUB_V(nvme_qpair_free_latency_stat, (struct spdk_nvme_qpair_latency_stat *stat));
 
 int
 nvme_transport_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
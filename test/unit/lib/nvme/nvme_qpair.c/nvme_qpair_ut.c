@@ -759,6 +759,123 @@ test_nvme_get_sgl_print_info(void)
 			   NVME_CMD_DPTR_STR_SIZE));
 }
 
+static void
+ut_latency_count(void *ctx, uint64_t start, uint64_t end, uint64_t count,
+		 uint64_t total, uint64_t so_far)
+{
+	uint64_t *sum = ctx;
+
+	*sum += count;
+}
+
+static uint64_t
+ut_histogram_count(struct spdk_histogram_data *histogram)
+{
+	uint64_t sum = 0;
+
+	spdk_histogram_data_iterate(histogram, ut_latency_count, &sum);
+
+	return sum;
+}
+
+static void
+test_nvme_qpair_latency_tracking(void)
+{
+	struct spdk_nvme_qpair qpair = {};
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct spdk_nvme_qpair_latency_stat stat;
+	struct spdk_nvme_cpl cpl = {};
+	struct nvme_request *req[3];
+	uint64_t complete_ticks[3] = { 110, 150, 130 };
+	int rc, i;
+
+	prepare_submit_request_test(&qpair, &ctrlr);
+	qpair.state = NVME_QPAIR_ENABLED;
+	MOCK_SET(nvme_transport_qpair_submit_request, 0);
+
+	rc = spdk_nvme_qpair_set_latency_tracking(&qpair, true,
+			SPDK_NVME_QPAIR_MAX_LATENCY_OUTLIERS + 1);
+	CU_ASSERT(rc == -EINVAL);
+	CU_ASSERT(qpair.latency == NULL);
+
+	/* Without tracking, the submit tick is not recorded */
+	MOCK_SET(spdk_get_ticks, 100);
+	req[0] = nvme_allocate_request_null(&qpair, NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(req[0] != NULL);
+	rc = nvme_qpair_submit_request(&qpair, req[0]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(req[0]->submit_tick == 0);
+	nvme_free_request(req[0]);
+
+	rc = spdk_nvme_qpair_set_latency_tracking(&qpair, true, 2);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(qpair.latency != NULL);
+
+	for (i = 0; i < 3; i++) {
+		req[i] = nvme_allocate_request_null(&qpair, NULL, NULL);
+		SPDK_CU_ASSERT_FATAL(req[i] != NULL);
+		req[i]->cmd.opc = SPDK_NVME_OPC_READ;
+		req[i]->cmd.nsid = i == 2 ? 2 : 1;
+		req[i]->cmd.cid = i;
+		req[i]->cmd.cdw10 = 0x1000 * i;
+		req[i]->cmd.cdw12 = 7;
+		rc = nvme_qpair_submit_request(&qpair, req[i]);
+		CU_ASSERT(rc == 0);
+		CU_ASSERT(req[i]->submit_tick == 100);
+	}
+
+	/* The third command is slower than the first one and replaces it as an outlier */
+	for (i = 0; i < 3; i++) {
+		MOCK_SET(spdk_get_ticks, complete_ticks[i]);
+		nvme_complete_request(NULL, NULL, &qpair, req[i], &cpl);
+		nvme_free_request(req[i]);
+	}
+
+	rc = nvme_qpair_get_latency_stat(&qpair, &stat);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(stat.qpair == &qpair);
+	CU_ASSERT(stat.qid == 1);
+	SPDK_CU_ASSERT_FATAL(stat.num_ns == 2);
+	CU_ASSERT(stat.ns_stats[0].nsid == 1);
+	CU_ASSERT(ut_histogram_count(stat.ns_stats[0].histogram) == 2);
+	CU_ASSERT(stat.ns_stats[1].nsid == 2);
+	CU_ASSERT(ut_histogram_count(stat.ns_stats[1].histogram) == 1);
+	SPDK_CU_ASSERT_FATAL(stat.num_outliers == 2);
+	CU_ASSERT(stat.outliers[0].latency_ticks == 50);
+	CU_ASSERT(stat.outliers[0].cid == 1);
+	CU_ASSERT(stat.outliers[0].nsid == 1);
+	CU_ASSERT(stat.outliers[0].lba == 0x1000);
+	CU_ASSERT(stat.outliers[0].lba_count == 8);
+	CU_ASSERT(stat.outliers[0].opc == SPDK_NVME_OPC_READ);
+	CU_ASSERT(stat.outliers[1].latency_ticks == 30);
+	CU_ASSERT(stat.outliers[1].cid == 2);
+	CU_ASSERT(stat.outliers[1].nsid == 2);
+	CU_ASSERT(stat.outliers[1].lba == 0x2000);
+	nvme_qpair_free_latency_stat(&stat);
+
+	/* A faster command than all recorded outliers is only counted in the histogram */
+	MOCK_SET(spdk_get_ticks, 100);
+	req[0] = nvme_allocate_request_null(&qpair, NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(req[0] != NULL);
+	req[0]->cmd.nsid = 1;
+	rc = nvme_qpair_submit_request(&qpair, req[0]);
+	CU_ASSERT(rc == 0);
+	MOCK_SET(spdk_get_ticks, 105);
+	nvme_complete_request(NULL, NULL, &qpair, req[0], &cpl);
+	nvme_free_request(req[0]);
+	CU_ASSERT(qpair.latency->num_outliers == 2);
+	CU_ASSERT(qpair.latency->min_outlier_ticks == 30);
+	CU_ASSERT(ut_histogram_count(qpair.latency->ns[0].histogram) == 3);
+
+	rc = spdk_nvme_qpair_set_latency_tracking(&qpair, false, 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(qpair.latency == NULL);
+
+	MOCK_CLEAR(spdk_get_ticks);
+	MOCK_CLEAR(nvme_transport_qpair_submit_request);
+	cleanup_submit_request_test(&qpair);
+}
+
 int main(int argc, char **argv)
 {
 	CU_pSuite	suite = NULL;
@@ -783,6 +900,7 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_qpair_manual_complete_request);
 	CU_ADD_TEST(suite, test_nvme_qpair_init_deinit);
 	CU_ADD_TEST(suite, test_nvme_get_sgl_print_info);
+	CU_ADD_TEST(suite, test_nvme_qpair_latency_tracking);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -616,6 +616,8 @@ test_nvme_rdma_ctrlr_create_qpair(void)
 DEFINE_STUB(ibv_create_cq, struct ibv_cq *, (struct ibv_context *context, int cqe, void *cq_context,
 		struct ibv_comp_channel *channel, int comp_vector), (struct ibv_cq *)0xFEEDBEEF);
 DEFINE_STUB(ibv_destroy_cq, int, (struct ibv_cq *cq), 0);
+DEFINE_STUB_V(nvme_qpair_record_latency, (struct spdk_nvme_qpair *qpair,
+		struct nvme_request *req, const struct spdk_nvme_cpl *cpl));
 
 static void
 test_nvme_rdma_poller_create(void)
@@ -1207,8 +1207,722 @@ overlapped(void)
 	backing_dev_destroy(&backing_dev);
 }
 
+static void
+compact_cb(void *arg, int reduce_errno)
+{
+	g_reduce_errno = reduce_errno;
+}
+
+static void
+packed_write_chunk(uint64_t chunk, uint8_t init_val, uint32_t repeat)
+{
+	uint8_t buf[16 * 1024];
+	struct iovec iov;
+
+	ut_build_data_buffer(buf, sizeof(buf), init_val, repeat);
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+	g_reduce_errno = -1;
+	spdk_reduce_vol_writev(g_vol, &iov, 1, chunk * g_vol->logical_blocks_per_chunk,
+			       g_vol->logical_blocks_per_chunk, write_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+}
+
+static void
+packed_verify_chunk(uint64_t chunk, uint8_t init_val, uint32_t repeat)
+{
+	uint8_t buf[16 * 1024], compare_buf[16 * 1024];
+	struct iovec iov;
+
+	ut_build_data_buffer(compare_buf, sizeof(compare_buf), init_val, repeat);
+	memset(buf, 0xFF, sizeof(buf));
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+	g_reduce_errno = -1;
+	spdk_reduce_vol_readv(g_vol, &iov, 1, chunk * g_vol->logical_blocks_per_chunk,
+			      g_vol->logical_blocks_per_chunk, read_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(memcmp(buf, compare_buf, sizeof(buf)) == 0);
+}
+
+static struct spdk_reduce_chunk_map *
+packed_get_chunk_map(uint64_t chunk)
+{
+	return _reduce_vol_get_chunk_map(g_vol, g_vol->pm_logical_map[chunk]);
+}
+
+static void
+packed(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	struct spdk_reduce_chunk_map *chunk;
+	uint64_t shared_unit, next_unit;
+	uint32_t i, allocated_units;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	params.packed = true;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	allocated_units = spdk_bit_array_count_set(g_vol->allocated_backing_io_units);
+
+	/* Runs of 7 bytes compress to 4682 bytes - one whole io unit plus a 586 byte tail.
+	 *  The tails of the first 6 chunks all fit in one shared io unit.
+	 */
+	for (i = 0; i < 6; i++) {
+		packed_write_chunk(i, i * 16, 7);
+	}
+
+	chunk = packed_get_chunk_map(0);
+	CU_ASSERT(chunk->compressed_size == 4682);
+	shared_unit = chunk->io_unit_index[1];
+	for (i = 0; i < 6; i++) {
+		chunk = packed_get_chunk_map(i);
+		CU_ASSERT(chunk->io_unit_index[1] == shared_unit);
+		CU_ASSERT(chunk->packed_offset == i * 586);
+		CU_ASSERT(chunk->io_unit_index[2] == REDUCE_EMPTY_MAP_ENTRY);
+	}
+	CU_ASSERT(g_vol->io_unit_packed_bytes[shared_unit] == 6 * 586);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated_units + 7);
+
+	/* The 7th tail doesn't fit, so it starts a new shared io unit. */
+	packed_write_chunk(6, 6 * 16, 7);
+	next_unit = packed_get_chunk_map(6)->io_unit_index[1];
+	CU_ASSERT(next_unit != shared_unit);
+	CU_ASSERT(packed_get_chunk_map(6)->packed_offset == 0);
+
+	for (i = 0; i < 7; i++) {
+		packed_verify_chunk(i, i * 16, 7);
+	}
+
+	/* Overwrite chunks 0-4 with data that compresses to a 130 byte tail and no whole
+	 *  io units.  That leaves only chunk 5's tail in the first shared io unit.
+	 */
+	for (i = 0; i < 5; i++) {
+		packed_write_chunk(i, i, UINT8_MAX);
+		chunk = packed_get_chunk_map(i);
+		CU_ASSERT(chunk->compressed_size == 130);
+		CU_ASSERT(chunk->io_unit_index[0] == next_unit);
+		CU_ASSERT(chunk->io_unit_index[1] == REDUCE_EMPTY_MAP_ENTRY);
+	}
+	CU_ASSERT(g_vol->io_unit_packed_bytes[shared_unit] == 586);
+	CU_ASSERT(g_vol->io_unit_packed_bytes[next_unit] == 586 + 5 * 130);
+	CU_ASSERT(spdk_bit_array_get(g_vol->allocated_backing_io_units, shared_unit) == true);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated_units + 4);
+
+	/* Compaction moves chunk 5's tail next to the others and frees the first shared io unit. */
+	g_reduce_errno = -1;
+	spdk_reduce_vol_compact(g_vol, compact_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	chunk = packed_get_chunk_map(5);
+	CU_ASSERT(chunk->io_unit_index[1] == next_unit);
+	CU_ASSERT(chunk->packed_offset == 586 + 5 * 130);
+	CU_ASSERT(g_vol->io_unit_packed_bytes[shared_unit] == 0);
+	CU_ASSERT(spdk_bit_array_get(g_vol->allocated_backing_io_units, shared_unit) == false);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated_units + 3);
+
+	for (i = 0; i < 7; i++) {
+		if (i < 5) {
+			packed_verify_chunk(i, i, UINT8_MAX);
+		} else {
+			packed_verify_chunk(i, i * 16, 7);
+		}
+	}
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	/* The packed layout and the shared io unit accounting survive a reload. */
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_load(&backing_dev, load_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	CU_ASSERT(g_vol->params.packed == true);
+	CU_ASSERT(g_vol->io_unit_packed_bytes[next_unit] == 2 * 586 + 5 * 130);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated_units + 3);
+
+	for (i = 0; i < 7; i++) {
+		if (i < 5) {
+			packed_verify_chunk(i, i, UINT8_MAX);
+		} else {
+			packed_verify_chunk(i, i * 16, 7);
+		}
+	}
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+packed_defer_bdev_io(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t buf[3][16 * 1024];
+	struct iovec iov[3];
+	uint64_t shared_unit;
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	params.packed = true;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+
+	/* Compaction is only supported on packed volumes, but this one is - and it's empty. */
+	g_reduce_errno = -1;
+	spdk_reduce_vol_compact(g_vol, compact_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	/* Each write has a tail only.  The first one starts writing the shared io unit and
+	 *  the other two wait for it, then go out together in one more write.
+	 */
+	g_defer_bdev_io = true;
+	for (i = 0; i < 3; i++) {
+		ut_build_data_buffer(buf[i], sizeof(buf[i]), i, UINT8_MAX);
+		iov[i].iov_base = buf[i];
+		iov[i].iov_len = sizeof(buf[i]);
+		g_reduce_errno = -100;
+		spdk_reduce_vol_writev(g_vol, &iov[i], 1, i * g_vol->logical_blocks_per_chunk,
+				       g_vol->logical_blocks_per_chunk, write_cb, NULL);
+		CU_ASSERT(g_reduce_errno == -100);
+	}
+	CU_ASSERT(g_pending_bdev_io_count == 1);
+
+	backing_dev_io_execute(1);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(g_pending_bdev_io_count == 1);
+	CU_ASSERT(g_vol->pm_logical_map[1] == REDUCE_EMPTY_MAP_ENTRY);
+
+	g_reduce_errno = -100;
+	backing_dev_io_execute(0);
+	CU_ASSERT(g_reduce_errno == 0);
+	g_defer_bdev_io = false;
+
+	shared_unit = packed_get_chunk_map(0)->io_unit_index[0];
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(packed_get_chunk_map(i)->io_unit_index[0] == shared_unit);
+		CU_ASSERT(packed_get_chunk_map(i)->packed_offset == i * 130);
+		packed_verify_chunk(i, i, UINT8_MAX);
+	}
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+packed_compact_wait(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t buf[16 * 1024];
+	struct iovec iov;
+	uint64_t shared_unit;
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	params.packed = true;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+
+	/* Same layout as in the packed test - chunk 5's tail is left alone in a shared io unit. */
+	for (i = 0; i < 7; i++) {
+		packed_write_chunk(i, i * 16, 7);
+	}
+	shared_unit = packed_get_chunk_map(5)->io_unit_index[1];
+	for (i = 0; i < 5; i++) {
+		packed_write_chunk(i, i, UINT8_MAX);
+	}
+	CU_ASSERT(g_vol->io_unit_packed_bytes[shared_unit] == 586);
+
+	/* Use up every request with overlapping writes to chunk 10.  Only the first one starts. */
+	ut_build_data_buffer(buf, sizeof(buf), 10, UINT8_MAX);
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+	g_defer_bdev_io = true;
+	for (i = 0; i < REDUCE_MAX_VOL_REQUESTS; i++) {
+		g_reduce_errno = -100;
+		spdk_reduce_vol_writev(g_vol, &iov, 1, 10 * g_vol->logical_blocks_per_chunk,
+				       g_vol->logical_blocks_per_chunk, write_cb, NULL);
+		CU_ASSERT(g_reduce_errno == -100);
+	}
+	CU_ASSERT(g_vol->num_requests == REDUCE_MAX_VOL_REQUESTS);
+	CU_ASSERT(TAILQ_EMPTY(&g_vol->free_requests));
+
+	/* Compaction waits for a request instead of failing. */
+	spdk_reduce_vol_compact(g_vol, compact_cb, NULL);
+	CU_ASSERT(g_reduce_errno == -100);
+	CU_ASSERT(!TAILQ_EMPTY(&g_vol->request_waiters));
+
+	backing_dev_io_execute(0);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_vol->request_waiters));
+	CU_ASSERT(g_vol->compact_ctx == NULL);
+	g_defer_bdev_io = false;
+
+	/* The io unit chunk 5's tail was moved out of may have been reused by the writes since. */
+	CU_ASSERT(packed_get_chunk_map(5)->io_unit_index[1] != shared_unit);
+	packed_verify_chunk(5, 5 * 16, 7);
+	packed_verify_chunk(10, 10, UINT8_MAX);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
 #define BUFSIZE 4096
 
+static void
+journal(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t buf[2][16 * 1024];
+	struct iovec iov[2];
+	uint64_t chunk_map_index[4], num_io_units;
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	/* No pm file - the maps live in DRAM and are journaled on the backing device. */
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, NULL, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->journal != NULL);
+	CU_ASSERT(g_volatile_pm_buf == NULL);
+	CU_ASSERT(params.vol_size < _get_vol_size(params.chunk_size,
+			backing_dev.blockcnt * backing_dev.blocklen));
+
+	/* Chunk 3 doesn't compress. */
+	packed_write_chunk(0, 0, UINT8_MAX);
+	packed_write_chunk(1, 1, UINT8_MAX);
+	packed_write_chunk(2, 2, UINT8_MAX);
+	packed_write_chunk(3, 3, 1);
+
+	/* Overwrite chunk 0 until the journal has wrapped around a few times. */
+	for (i = 0; i < 3 * g_vol->journal->num_blocks * g_vol->journal->entries_per_block; i++) {
+		packed_write_chunk(0, i, UINT8_MAX);
+	}
+	packed_write_chunk(0, 0x55, UINT8_MAX);
+
+	/* Two chunk map updates in flight at once share one journal write. */
+	g_defer_bdev_io = true;
+	for (i = 0; i < 2; i++) {
+		ut_build_data_buffer(buf[i], sizeof(buf[i]), 0x10 + i, UINT8_MAX);
+		iov[i].iov_base = buf[i];
+		iov[i].iov_len = sizeof(buf[i]);
+		g_reduce_errno = -100;
+		spdk_reduce_vol_writev(g_vol, &iov[i], 1, (i + 1) * g_vol->logical_blocks_per_chunk,
+				       g_vol->logical_blocks_per_chunk, write_cb, NULL);
+	}
+	backing_dev_io_execute(2);
+	CU_ASSERT(g_pending_bdev_io_count == 1);
+	backing_dev_io_execute(0);
+	CU_ASSERT(g_reduce_errno == 0);
+	g_defer_bdev_io = false;
+
+	for (i = 0; i < 4; i++) {
+		chunk_map_index[i] = g_vol->pm_logical_map[i];
+		CU_ASSERT(chunk_map_index[i] != REDUCE_EMPTY_MAP_ENTRY);
+	}
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_chunk_maps) == 4);
+	num_io_units = spdk_bit_array_count_set(g_vol->allocated_backing_io_units);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->journal->slots) == 4);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	/* Loading replays the journal. */
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_load(&backing_dev, load_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->journal != NULL);
+	CU_ASSERT(g_volatile_pm_buf == NULL);
+	CU_ASSERT(g_vol->params.vol_size == params.vol_size);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_chunk_maps) == 4);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == num_io_units);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->journal->slots) == 4);
+	for (i = 4; i < g_vol->params.vol_size / g_vol->params.chunk_size; i++) {
+		CU_ASSERT(g_vol->pm_logical_map[i] == REDUCE_EMPTY_MAP_ENTRY);
+	}
+
+	packed_verify_chunk(0, 0x55, UINT8_MAX);
+	packed_verify_chunk(1, 0x10, UINT8_MAX);
+	packed_verify_chunk(2, 0x11, UINT8_MAX);
+	packed_verify_chunk(3, 3, 1);
+
+	/* Keep writing after the load and make sure that survives another one. */
+	packed_write_chunk(3, 0x33, UINT8_MAX);
+	packed_write_chunk(4, 0x44, 1);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_load(&backing_dev, load_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_chunk_maps) == 5);
+
+	packed_verify_chunk(0, 0x55, UINT8_MAX);
+	packed_verify_chunk(1, 0x10, UINT8_MAX);
+	packed_verify_chunk(2, 0x11, UINT8_MAX);
+	packed_verify_chunk(3, 0x33, UINT8_MAX);
+	packed_verify_chunk(4, 0x44, 1);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+multi_chunk(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t buf[3 * 16 * 1024], expected[3 * 16 * 1024], chunk_buf[16 * 1024];
+	struct iovec iov[3];
+	struct ut_reduce_bdev_io *ut_bdev_io;
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	CU_ASSERT(g_vol->num_requests == REDUCE_VOL_REQUESTS_PER_SLAB);
+
+	packed_write_chunk(1, 0xAA, UINT8_MAX);
+
+	/* Write from the middle of chunk 0 to the middle of chunk 2, with iovs that cross
+	 *  the chunk boundaries.  Chunk 1 is overwritten completely, so nothing needs to be
+	 *  read - all three chunks go straight to compression and get written in parallel.
+	 */
+	ut_build_data_buffer(buf, 56 * 512, 0x10, UINT8_MAX);
+	iov[0].iov_base = buf;
+	iov[0].iov_len = 20 * 512;
+	iov[1].iov_base = buf + 20 * 512;
+	iov[1].iov_len = 24 * 512;
+	iov[2].iov_base = buf + 44 * 512;
+	iov[2].iov_len = 12 * 512;
+
+	g_defer_bdev_io = true;
+	g_reduce_errno = -100;
+	spdk_reduce_vol_writev(g_vol, iov, 3, 16, 56, write_cb, NULL);
+	CU_ASSERT(g_reduce_errno == -100);
+	CU_ASSERT(g_pending_bdev_io_count >= 3);
+	TAILQ_FOREACH(ut_bdev_io, &g_pending_bdev_io, link) {
+		CU_ASSERT(ut_bdev_io->type == UT_REDUCE_IO_WRITEV);
+	}
+	CU_ASSERT(g_vol->pm_logical_map[0] == REDUCE_EMPTY_MAP_ENTRY);
+	CU_ASSERT(g_vol->pm_logical_map[2] == REDUCE_EMPTY_MAP_ENTRY);
+
+	backing_dev_io_execute(0);
+	CU_ASSERT(g_reduce_errno == 0);
+	g_defer_bdev_io = false;
+
+	memset(expected, 0, sizeof(expected));
+	memcpy(expected + 16 * 512, buf, 56 * 512);
+
+	memset(buf, 0xFF, sizeof(buf));
+	iov[0].iov_base = buf;
+	iov[0].iov_len = sizeof(buf);
+	g_reduce_errno = -1;
+	spdk_reduce_vol_readv(g_vol, iov, 1, 0, 96, read_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(memcmp(buf, expected, sizeof(buf)) == 0);
+
+	/* Chunks that were never written complete right away. */
+	memset(buf, 0xFF, sizeof(buf));
+	g_reduce_errno = -1;
+	spdk_reduce_vol_readv(g_vol, iov, 1, 3 * 32, 96, read_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(spdk_mem_all_zero(buf, sizeof(buf)));
+
+	/* The request pool grows as needed. */
+	g_defer_bdev_io = true;
+	for (i = 0; i < REDUCE_VOL_REQUESTS_PER_SLAB + 8; i++) {
+		ut_build_data_buffer(chunk_buf, sizeof(chunk_buf), i, UINT8_MAX);
+		iov[0].iov_base = chunk_buf;
+		iov[0].iov_len = sizeof(chunk_buf);
+		g_reduce_errno = -100;
+		spdk_reduce_vol_writev(g_vol, iov, 1, (i + 8) * 32, 32, write_cb, NULL);
+		CU_ASSERT(g_reduce_errno == -100);
+	}
+	CU_ASSERT(g_vol->num_requests == 2 * REDUCE_VOL_REQUESTS_PER_SLAB);
+	backing_dev_io_execute(0);
+	CU_ASSERT(g_reduce_errno == 0);
+	g_defer_bdev_io = false;
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+errno_cb(void *arg, int reduce_errno)
+{
+	*(int *)arg = reduce_errno;
+}
+
+static void
+multi_chunk_wait(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t chunk_buf[16 * 1024], *buf, *expected;
+	struct iovec chunk_iov, iov[2];
+	const uint32_t num_chunks = 8;
+	int split_errno;
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+
+	buf = calloc(num_chunks, params.chunk_size);
+	expected = calloc(num_chunks, params.chunk_size);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && expected != NULL);
+
+	/* Leave only 3 requests free with overlapping writes to chunk 10. */
+	ut_build_data_buffer(chunk_buf, sizeof(chunk_buf), 10, UINT8_MAX);
+	chunk_iov.iov_base = chunk_buf;
+	chunk_iov.iov_len = sizeof(chunk_buf);
+	g_defer_bdev_io = true;
+	for (i = 0; i < REDUCE_MAX_VOL_REQUESTS - 3; i++) {
+		g_reduce_errno = -100;
+		spdk_reduce_vol_writev(g_vol, &chunk_iov, 1, 10 * g_vol->logical_blocks_per_chunk,
+				       g_vol->logical_blocks_per_chunk, write_cb, NULL);
+		CU_ASSERT(g_reduce_errno == -100);
+	}
+
+	/* Write chunks 20-27, with an iov boundary in the middle of chunk 23.  The first 3
+	 *  chunks are submitted and the rest wait for requests instead of failing.
+	 */
+	for (i = 0; i < num_chunks; i++) {
+		ut_build_data_buffer(expected + i * params.chunk_size, params.chunk_size, i + 20,
+				     UINT8_MAX);
+	}
+	memcpy(buf, expected, num_chunks * params.chunk_size);
+	iov[0].iov_base = buf;
+	iov[0].iov_len = 3 * params.chunk_size + params.chunk_size / 2;
+	iov[1].iov_base = buf + iov[0].iov_len;
+	iov[1].iov_len = num_chunks * params.chunk_size - iov[0].iov_len;
+	split_errno = -100;
+	spdk_reduce_vol_writev(g_vol, iov, 2, 20 * g_vol->logical_blocks_per_chunk,
+			       num_chunks * g_vol->logical_blocks_per_chunk, errno_cb, &split_errno);
+	CU_ASSERT(split_errno == -100);
+	CU_ASSERT(TAILQ_EMPTY(&g_vol->free_requests));
+	CU_ASSERT(!TAILQ_EMPTY(&g_vol->request_waiters));
+
+	backing_dev_io_execute(0);
+	CU_ASSERT(split_errno == 0);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_vol->request_waiters));
+	g_defer_bdev_io = false;
+
+	for (i = 0; i < num_chunks; i++) {
+		CU_ASSERT(g_vol->pm_logical_map[20 + i] != REDUCE_EMPTY_MAP_ENTRY);
+	}
+
+	memset(buf, 0xFF, num_chunks * params.chunk_size);
+	iov[0].iov_base = buf;
+	iov[0].iov_len = num_chunks * params.chunk_size;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_readv(g_vol, iov, 1, 20 * g_vol->logical_blocks_per_chunk,
+			      num_chunks * g_vol->logical_blocks_per_chunk, read_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(memcmp(buf, expected, num_chunks * params.chunk_size) == 0);
+
+	free(buf);
+	free(expected);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
+/* Run the deferred backing io until a journal write comes up, and fail that one. */
+static void
+backing_dev_fail_journal_write(int reduce_errno)
+{
+	struct ut_reduce_bdev_io *ut_bdev_io;
+	uint64_t journal_lba = g_vol->journal->start_io_unit * g_vol->backing_lba_per_io_unit;
+
+	while ((ut_bdev_io = TAILQ_FIRST(&g_pending_bdev_io)) != NULL) {
+		if (ut_bdev_io->type == UT_REDUCE_IO_WRITEV && ut_bdev_io->lba >= journal_lba) {
+			TAILQ_REMOVE(&g_pending_bdev_io, ut_bdev_io, link);
+			g_pending_bdev_io_count--;
+			ut_bdev_io->args->cb_fn(ut_bdev_io->args->cb_arg, reduce_errno);
+			free(ut_bdev_io);
+			return;
+		}
+		backing_dev_io_execute(1);
+	}
+
+	CU_ASSERT(false);
+}
+
+static void
+journal_write_failure(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	struct spdk_reduce_chunk_map *chunk;
+	uint8_t buf[2][16 * 1024];
+	struct iovec iov[2];
+	uint64_t old_chunk_map_index, old_io_units[4];
+	int rc[2];
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, NULL, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->journal != NULL);
+
+	/* Chunk 0 doesn't compress, so its chunk map uses every io unit. */
+	packed_write_chunk(0, 0, 1);
+	packed_write_chunk(1, 1, UINT8_MAX);
+	old_chunk_map_index = g_vol->pm_logical_map[0];
+	chunk = packed_get_chunk_map(0);
+	for (i = 0; i < 4; i++) {
+		old_io_units[i] = chunk->io_unit_index[i];
+	}
+
+	/* Overwrite chunks 0 and 1 at once.  The journal write holding chunk 0's entry fails,
+	 *  and chunk 1's entry is written to the same journal block right after.
+	 */
+	g_defer_bdev_io = true;
+	for (i = 0; i < 2; i++) {
+		ut_build_data_buffer(buf[i], sizeof(buf[i]), 0x70 + i, 1);
+		iov[i].iov_base = buf[i];
+		iov[i].iov_len = sizeof(buf[i]);
+		rc[i] = -100;
+		spdk_reduce_vol_writev(g_vol, &iov[i], 1, i * g_vol->logical_blocks_per_chunk,
+				       g_vol->logical_blocks_per_chunk, errno_cb, &rc[i]);
+	}
+	backing_dev_fail_journal_write(-EIO);
+	backing_dev_io_execute(0);
+	g_defer_bdev_io = false;
+	CU_ASSERT(rc[0] == -EIO);
+	CU_ASSERT(rc[1] == 0);
+	CU_ASSERT(g_vol->pm_logical_map[0] == old_chunk_map_index);
+
+	/* Reuse the io units freed by the failed write. */
+	packed_write_chunk(2, 0x22, 1);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	/* Replay still maps chunk 0 to the io units it had before the failed write. */
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_load(&backing_dev, load_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->pm_logical_map[0] != REDUCE_EMPTY_MAP_ENTRY);
+	chunk = packed_get_chunk_map(0);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(chunk->io_unit_index[i] == old_io_units[i]);
+	}
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_chunk_maps) == 3);
+
+	packed_verify_chunk(0, 0, 1);
+	packed_verify_chunk(1, 0x71, 1);
+	packed_verify_chunk(2, 0x22, 1);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	backing_dev_destroy(&backing_dev);
+}
+
 static void
 compress_algorithm(void)
 {
@@ -1758,6 +2472,13 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, destroy);
 	CU_ADD_TEST(suite, defer_bdev_io);
 	CU_ADD_TEST(suite, overlapped);
+	CU_ADD_TEST(suite, packed);
+	CU_ADD_TEST(suite, packed_defer_bdev_io);
+	CU_ADD_TEST(suite, packed_compact_wait);
+	CU_ADD_TEST(suite, journal);
+	CU_ADD_TEST(suite, multi_chunk);
+	CU_ADD_TEST(suite, multi_chunk_wait);
+	CU_ADD_TEST(suite, journal_write_failure);
 	CU_ADD_TEST(suite, compress_algorithm);
 	CU_ADD_TEST(suite, test_prepare_compress_chunk);
 	CU_ADD_TEST(suite, test_reduce_decompress_chunk);
@@ -345,6 +345,41 @@ test_mask_clear(void)
 	spdk_bit_array_free(&ba);
 }
 
+static void
+test_pool_allocate_hint(void)
+{
+	struct spdk_bit_pool *pool;
+	uint32_t i;
+
+	pool = spdk_bit_pool_create(TEST_BITS_NUM);
+	SPDK_CU_ASSERT_FATAL(pool != NULL);
+
+	/* Hint to a free bit allocates that bit, lowest free bit is unaffected */
+	CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, 10) == 10);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, 10) == 11);
+	CU_ASSERT(spdk_bit_pool_count_free(pool) == TEST_BITS_NUM - 2);
+	CU_ASSERT(spdk_bit_pool_allocate_bit(pool) == 0);
+
+	/* Hint below lowest free bit allocates the lowest free bit */
+	CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, 0) == 1);
+
+	/* No free bit at or after the hint falls back to the lowest free bit */
+	for (i = TEST_BITS_NUM - 2; i < TEST_BITS_NUM; i++) {
+		CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, i) == i);
+	}
+	CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, TEST_BITS_NUM - 1) == 2);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, TEST_BITS_NUM) == 3);
+
+	/* Allocated bits are skipped when looking from the hint */
+	for (i = 4; i < 10; i++) {
+		CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, 4) == i);
+	}
+	CU_ASSERT(spdk_bit_pool_allocate_bit_hint(pool, 4) == 12);
+	CU_ASSERT(spdk_bit_pool_count_free(pool) == TEST_BITS_NUM - 15);
+
+	spdk_bit_pool_free(&pool);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -364,6 +399,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_count);
 	CU_ADD_TEST(suite, test_mask_store_load);
 	CU_ADD_TEST(suite, test_mask_clear);
+	CU_ADD_TEST(suite, test_pool_allocate_hint);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
@@ -38,12 +38,13 @@
 #include "spdk_cunit.h"
 #include "spdk/thread.h"
 #include "spdk_internal/mock.h"
-#include "common/lib/test_env.c"
+#include "common/lib/ut_multithread.c"
 #include "unit/lib/json_mock.c"
 
 #include "vhost/vhost.c"
 #include <rte_version.h>
 #include "vhost/rte_vhost_user.c"
+#include "vhost/vhost_blk.c"
 
 DEFINE_STUB(rte_vhost_set_vring_base, int, (int vid, uint16_t queue_id,
 		uint16_t last_avail_idx, uint16_t last_used_idx), 0);
@@ -94,6 +95,48 @@ DEFINE_STUB(rte_vhost_get_vring_base_from_inflight, int,
 	    (int vid, uint16_t queue_id, uint16_t *last_avail_idx, uint16_t *last_used_idx), 0);
 DEFINE_STUB(rte_vhost_extern_callback_register, int,
 	    (int vid, struct rte_vhost_user_extern_ops const *const ops, void *ctx), 0);
+DEFINE_STUB(rte_vhost_set_inflight_desc_split, int,
+	    (int vid, uint16_t vring_idx, uint16_t idx), 0);
+DEFINE_STUB(rte_vhost_set_inflight_desc_packed, int,
+	    (int vid, uint16_t vring_idx, uint16_t head, uint16_t last,
+	     uint16_t *inflight_entry), 0);
+
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "ut_bdev");
+DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
+DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), 1024);
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 1);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_readv, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   struct iovec *iov, int iovcnt, uint64_t offset, uint64_t nbytes,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_writev, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				    struct iovec *iov, int iovcnt, uint64_t offset, uint64_t len,
+				    spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_flush, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   uint64_t offset, uint64_t length,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unmap, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   uint64_t offset, uint64_t nbytes,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_zeroes, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset, uint64_t len,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+
+DEFINE_STUB(spdk_json_decode_bool, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
+
+static int g_ut_bdev_io_device;
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(&g_ut_bdev_io_device);
+}
 
 void *
 spdk_call_unaffinitized(void *cb(void *arg), void *arg)
@@ -573,6 +616,468 @@ vq_packed_ring_test(void)
 	CU_ASSERT(guest_avail_phase == guest_used_phase);
 }
 
+static void
+vq_adaptive_coalescing_test(void)
+{
+	struct spdk_vhost_dev vdev = {};
+	struct spdk_vhost_user_dev user_dev = {};
+	struct spdk_vhost_session vs = {};
+	struct spdk_vhost_virtqueue *vq = &vs.virtqueue[0];
+	struct vring_desc descs[32];
+	uint16_t avail_mem[34] = {};
+	uint64_t irq_cnt, irq_saved;
+	uint64_t now;
+
+	vs.coalescing_adaptive = true;
+	vs.coalescing_delay_time_base = 1600;
+	vs.coalescing_io_rate_threshold = 10;
+	vs.stats_check_interval = 10000;
+	vs.max_queues = 1;
+	vq->vsession = &vs;
+	vq->vring.desc = descs;
+	vq->vring.avail = (struct vring_avail *)avail_mem;
+	vq->vring.size = 32;
+
+	/* Too few completions to coalesce */
+	now = spdk_get_ticks();
+	vq->req_cnt = 10;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 0);
+	CU_ASSERT(vq->req_cnt == 0);
+
+	/* 20 completions per interval would need a 4000 tick delay for 8 per interrupt.
+	 * The delay starts at 1/16 of the base and at most doubles at each check.
+	 */
+	vq->req_cnt = 20;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 100);
+
+	vq->req_cnt = 20;
+	vq->interval_irq_cnt = 5;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 200);
+	CU_ASSERT(vq->interval_irq_cnt == 0);
+
+	/* Completions not signalled yet count too */
+	vq->req_cnt = 15;
+	vq->used_req_cnt = 5;
+	vq->interval_irq_cnt = 5;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 400);
+	vq->used_req_cnt = 0;
+
+	vq->req_cnt = 20;
+	vq->interval_irq_cnt = 5;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 800);
+
+	/* The delay never exceeds the base */
+	vq->req_cnt = 20;
+	vq->interval_irq_cnt = 5;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 1600);
+
+	vq->req_cnt = 20;
+	vq->interval_irq_cnt = 5;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 1600);
+
+	/* Fewer than MIN_BATCH completions per interrupt halves the delay */
+	vq->req_cnt = 20;
+	vq->interval_irq_cnt = 11;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 800);
+
+	vq->req_cnt = 20;
+	vq->interval_irq_cnt = 20;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 400);
+
+	/* A faster virtqueue needs a shorter delay */
+	vq->req_cnt = 1000;
+	vq->interval_irq_cnt = 125;
+	session_vq_adaptive_stats_update(&vs, vq, now);
+	CU_ASSERT(vq->irq_delay_time == 80);
+
+	/* Keep the stats check out of the way of the signalling tests */
+	vq->next_stats_check_time = UINT64_MAX;
+	vq->irq_delay_time = 100;
+	vq->next_event_time = now + 100;
+
+	/* A completion with other requests in flight is deferred and counted once */
+	vq->last_avail_idx = 3;
+	vq->last_used_idx = 1;
+	vq->used_req_cnt = 1;
+	vhost_session_vq_used_signal(vq);
+	CU_ASSERT(vq->irq_cnt == 0);
+	CU_ASSERT(vq->irq_saved == 1);
+	CU_ASSERT(vq->deferred_req_cnt == 1);
+
+	vhost_session_vq_used_signal(vq);
+	CU_ASSERT(vq->irq_saved == 1);
+
+	vq->last_used_idx = 2;
+	vq->used_req_cnt = 2;
+	vhost_session_vq_used_signal(vq);
+	CU_ASSERT(vq->irq_cnt == 0);
+	CU_ASSERT(vq->irq_saved == 2);
+
+	/* The delay has passed, signal the guest */
+	spdk_delay_us(100);
+	vhost_session_vq_used_signal(vq);
+	CU_ASSERT(vq->irq_cnt == 1);
+	CU_ASSERT(vq->irq_saved == 2);
+	CU_ASSERT(vq->used_req_cnt == 0);
+	CU_ASSERT(vq->deferred_req_cnt == 0);
+	CU_ASSERT(vq->next_event_time == spdk_get_ticks() + 100);
+
+	/* Queue depth 1: nothing else is in flight, so the guest is signalled
+	 * right away even though the delay hasn't passed.
+	 */
+	vq->last_avail_idx = 4;
+	vq->last_used_idx = 4;
+	vq->used_req_cnt = 1;
+	vhost_session_vq_used_signal(vq);
+	CU_ASSERT(vq->irq_cnt == 2);
+	CU_ASSERT(vq->irq_saved == 2);
+
+	/* A guest that suppressed interrupts saves nothing */
+	vq->last_avail_idx = 6;
+	vq->last_used_idx = 5;
+	vq->used_req_cnt = 1;
+	vq->vring.avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+	vhost_session_vq_used_signal(vq);
+	CU_ASSERT(vq->irq_cnt == 2);
+	CU_ASSERT(vq->irq_saved == 2);
+	vq->vring.avail->flags = 0;
+
+	/* Saved interrupts of the virtqueues and of stopped sessions add up */
+	vs.irq_cnt = 3;
+	vs.irq_saved = 5;
+	vdev.ctxt = &user_dev;
+	TAILQ_INIT(&user_dev.vsessions);
+	TAILQ_INSERT_TAIL(&user_dev.vsessions, &vs, tailq);
+	vhost_user_dev_get_irq_stats(&vdev, &irq_cnt, &irq_saved);
+	CU_ASSERT(irq_cnt == 5);
+	CU_ASSERT(irq_saved == 7);
+}
+
+#define UT_BLK_NUM_QUEUES	4
+#define UT_BLK_VQ_SIZE		4
+
+struct ut_blk_ctx {
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_vhost_user_dev user_dev;
+	struct spdk_thread *queue_threads[2];
+	struct spdk_vhost_blk_session *bvsession;
+	struct vring_desc desc[UT_BLK_NUM_QUEUES][UT_BLK_VQ_SIZE];
+	uint16_t avail_mem[UT_BLK_NUM_QUEUES][UT_BLK_VQ_SIZE + 2];
+	uint32_t used_mem[UT_BLK_NUM_QUEUES][UT_BLK_VQ_SIZE * 2 + 1];
+};
+
+static struct spdk_bdev g_ut_bdev;
+static struct ut_blk_ctx g_ut_blk;
+
+static int
+ut_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+/*
+ * Thread 0 is the controller thread, threads 1 and 2 are its queue threads.
+ * The session has UT_BLK_NUM_QUEUES empty split virtqueues.
+ */
+static void
+ut_blk_setup(bool with_bdev)
+{
+	struct ut_blk_ctx *ctx = &g_ut_blk;
+	struct spdk_vhost_blk_dev *bvdev = NULL;
+	struct spdk_vhost_blk_session *bvsession = NULL;
+	struct spdk_vhost_session *vsession;
+	struct spdk_vhost_virtqueue *vq;
+	uint16_t i;
+	int rc;
+
+	memset(ctx, 0, sizeof(*ctx));
+	allocate_threads(3);
+	set_thread(0);
+	g_vhost_user_init_thread = g_ut_threads[0].thread;
+	spdk_io_device_register(&g_ut_bdev_io_device, ut_bdev_ch_create_cb, ut_bdev_ch_destroy_cb,
+				0, "ut_bdev");
+
+	/* spdk_vhost_dev must be allocated on a cache line boundary. */
+	rc = posix_memalign((void **)&bvdev, 64, sizeof(*bvdev));
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(bvdev != NULL);
+	memset(bvdev, 0, sizeof(*bvdev));
+	bvdev->vdev.name = "ut_blk";
+	bvdev->vdev.backend = &vhost_blk_device_backend;
+	bvdev->vdev.thread = g_ut_threads[0].thread;
+	bvdev->vdev.ctxt = &ctx->user_dev;
+	ctx->user_dev.vdev = &bvdev->vdev;
+	TAILQ_INIT(&ctx->user_dev.vsessions);
+
+	ctx->queue_threads[0] = g_ut_threads[1].thread;
+	ctx->queue_threads[1] = g_ut_threads[2].thread;
+	bvdev->queue_threads = ctx->queue_threads;
+	bvdev->num_queue_threads = 2;
+
+	if (with_bdev) {
+		bvdev->bdev = &g_ut_bdev;
+		bvdev->bdev_desc = (struct spdk_bdev_desc *)0xDEADBEEF;
+		bvdev->dummy_io_channel = spdk_get_io_channel(&g_ut_bdev_io_device);
+	}
+
+	rc = posix_memalign((void **)&bvsession, 64, sizeof(*bvsession));
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(bvsession != NULL);
+	memset(bvsession, 0, sizeof(*bvsession));
+	vsession = &bvsession->vsession;
+	vsession->name = "ut_blk_session";
+	vsession->vdev = &bvdev->vdev;
+	vsession->initialized = true;
+	vsession->max_queues = UT_BLK_NUM_QUEUES;
+	for (i = 0; i < UT_BLK_NUM_QUEUES; i++) {
+		vq = &vsession->virtqueue[i];
+		vq->vsession = vsession;
+		vq->vring_idx = i;
+		vq->vring.desc = ctx->desc[i];
+		vq->vring.avail = (struct vring_avail *)ctx->avail_mem[i];
+		vq->vring.used = (struct vring_used *)ctx->used_mem[i];
+		vq->vring.size = UT_BLK_VQ_SIZE;
+	}
+	TAILQ_INSERT_TAIL(&ctx->user_dev.vsessions, vsession, tailq);
+
+	ctx->bvdev = bvdev;
+	ctx->bvsession = bvsession;
+}
+
+static void
+ut_blk_teardown(void)
+{
+	struct ut_blk_ctx *ctx = &g_ut_blk;
+
+	set_thread(0);
+	spdk_io_device_unregister(&g_ut_bdev_io_device, NULL);
+	free(ctx->bvsession);
+	free(ctx->bvdev);
+	g_vhost_user_init_thread = NULL;
+	free_threads();
+}
+
+/*
+ * The request pollers of running queue groups always report busy, so poll_threads()
+ * would never return. Poll every thread a bounded number of times instead.
+ */
+static void
+ut_blk_poll_threads(void)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < 8; i++) {
+		for (j = 0; j < g_ut_num_threads; j++) {
+			poll_thread_times(j, 1);
+		}
+	}
+}
+
+static void
+ut_blk_start_session(void)
+{
+	struct spdk_vhost_blk_session *bvsession = g_ut_blk.bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	int rc;
+
+	g_dpdk_response = -1;
+	set_thread(0);
+	rc = vhost_blk_start_cb(vsession->vdev, vsession, NULL);
+	CU_ASSERT(rc == 0);
+	ut_blk_poll_threads();
+	CU_ASSERT(g_dpdk_response == 0);
+	CU_ASSERT(vsession->started == true);
+}
+
+static void
+blk_session_multi_group_test(void)
+{
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_vhost_session *vsession;
+	struct spdk_vhost_blk_task *task;
+	struct vhost_blk_queue_group *group;
+	uint16_t i;
+
+	ut_blk_setup(true);
+	bvsession = g_ut_blk.bvsession;
+	vsession = &bvsession->vsession;
+
+	/* Four virtqueues are spread over the two queue threads */
+	ut_blk_start_session();
+	CU_ASSERT(g_ut_blk.user_dev.active_session_num == 1);
+	SPDK_CU_ASSERT_FATAL(bvsession->num_groups == 2);
+	CU_ASSERT(bvsession->pending_groups == 0);
+	for (i = 0; i < bvsession->num_groups; i++) {
+		group = &bvsession->groups[i];
+		CU_ASSERT(group->index == i);
+		CU_ASSERT(group->thread == g_ut_threads[i + 1].thread);
+		CU_ASSERT(group->requestq_poller != NULL);
+		SPDK_CU_ASSERT_FATAL(group->io_channel != NULL);
+		CU_ASSERT(spdk_io_channel_get_thread(group->io_channel) == group->thread);
+	}
+
+	/* Virtqueue i belongs to group i % 2 */
+	for (i = 0; i < UT_BLK_NUM_QUEUES; i++) {
+		SPDK_CU_ASSERT_FATAL(vsession->virtqueue[i].tasks != NULL);
+		task = &((struct spdk_vhost_blk_task *)vsession->virtqueue[i].tasks)[0];
+		CU_ASSERT(task->group == &bvsession->groups[i % 2]);
+	}
+
+	/* Stop waits for the stop poller of every group */
+	g_dpdk_response = -1;
+	set_thread(0);
+	vhost_blk_stop_cb(vsession->vdev, vsession, NULL);
+	ut_blk_poll_threads();
+	CU_ASSERT(g_dpdk_response == -1);
+	CU_ASSERT(vsession->started == true);
+	CU_ASSERT(bvsession->pending_groups == 2);
+
+	spdk_delay_us(1000);
+	ut_blk_poll_threads();
+	CU_ASSERT(g_dpdk_response == 0);
+	CU_ASSERT(vsession->started == false);
+	CU_ASSERT(g_ut_blk.user_dev.active_session_num == 0);
+	CU_ASSERT(bvsession->num_groups == 0);
+	CU_ASSERT(bvsession->pending_groups == 0);
+	for (i = 0; i < 2; i++) {
+		group = &bvsession->groups[i];
+		CU_ASSERT(group->requestq_poller == NULL);
+		CU_ASSERT(group->stop_poller == NULL);
+		CU_ASSERT(group->io_channel == NULL);
+	}
+	for (i = 0; i < UT_BLK_NUM_QUEUES; i++) {
+		CU_ASSERT(vsession->virtqueue[i].tasks == NULL);
+	}
+
+	set_thread(0);
+	spdk_put_io_channel(g_ut_blk.bvdev->dummy_io_channel);
+	ut_blk_poll_threads();
+	ut_blk_teardown();
+}
+
+static void
+blk_session_stop_timeout_test(void)
+{
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_vhost_session *vsession;
+	struct vhost_blk_queue_group *group;
+	uint32_t i;
+
+	ut_blk_setup(true);
+	bvsession = g_ut_blk.bvsession;
+	vsession = &bvsession->vsession;
+	ut_blk_start_session();
+	SPDK_CU_ASSERT_FATAL(bvsession->num_groups == 2);
+
+	/* Group 0 has a request that never completes */
+	group = &bvsession->groups[0];
+	group->task_cnt = 1;
+
+	g_dpdk_response = -1;
+	set_thread(0);
+	vhost_blk_stop_cb(vsession->vdev, vsession, NULL);
+	ut_blk_poll_threads();
+
+	/* Group 1 stops right away, group 0 keeps retrying */
+	spdk_delay_us(1000);
+	ut_blk_poll_threads();
+	CU_ASSERT(g_dpdk_response == -1);
+	CU_ASSERT(bvsession->pending_groups == 1);
+	CU_ASSERT(bvsession->groups[1].stop_poller == NULL);
+	CU_ASSERT(group->stop_poller != NULL);
+
+	for (i = 1; i < 4000; i++) {
+		spdk_delay_us(1000);
+		ut_blk_poll_threads();
+	}
+
+	/* The session stays started and keeps its tasks, since one of them is still in flight */
+	CU_ASSERT(g_dpdk_response == -ETIMEDOUT);
+	CU_ASSERT(group->stop_poller == NULL);
+	CU_ASSERT(bvsession->pending_groups == 0);
+	CU_ASSERT(vsession->started == true);
+	CU_ASSERT(bvsession->num_groups == 2);
+	CU_ASSERT(vsession->virtqueue[0].tasks != NULL);
+
+	group->task_cnt = 0;
+	set_thread(1);
+	spdk_put_io_channel(group->io_channel);
+	group->io_channel = NULL;
+	set_thread(0);
+	spdk_put_io_channel(g_ut_blk.bvdev->dummy_io_channel);
+	ut_blk_poll_threads();
+	free_task_pool(bvsession);
+	ut_blk_teardown();
+}
+
+static void
+blk_bdev_hot_remove_test(void)
+{
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_vhost_session *vsession;
+
+	ut_blk_setup(true);
+	bvdev = g_ut_blk.bvdev;
+	bvsession = g_ut_blk.bvsession;
+	vsession = &bvsession->vsession;
+	ut_blk_start_session();
+	SPDK_CU_ASSERT_FATAL(bvsession->num_groups == 2);
+
+	/* Every group is told to switch to the no-bdev worker */
+	set_thread(0);
+	bdev_remove_cb(bvdev);
+	poll_thread(0);
+	CU_ASSERT(bvdev->remove_refs == 2);
+	CU_ASSERT(bvdev->remove_thread == g_ut_threads[0].thread);
+	CU_ASSERT(g_ut_blk.user_dev.pending_async_op_num == 0);
+
+	/* The bdev stays open until the last group has switched */
+	poll_thread_times(1, 1);
+	poll_thread(0);
+	CU_ASSERT(bvdev->remove_refs == 1);
+	CU_ASSERT(bvdev->bdev_desc != NULL);
+	CU_ASSERT(bvdev->bdev == &g_ut_bdev);
+	CU_ASSERT(bvsession->groups[0].requestq_poller != NULL);
+
+	poll_thread_times(2, 1);
+	poll_thread(0);
+	CU_ASSERT(bvdev->remove_refs == 0);
+	CU_ASSERT(bvdev->bdev_desc == NULL);
+	CU_ASSERT(bvdev->bdev == NULL);
+	CU_ASSERT(bvdev->dummy_io_channel != NULL);
+
+	/* The no-bdev workers drop the bdev channels of idle groups */
+	ut_blk_poll_threads();
+	CU_ASSERT(bvsession->groups[0].io_channel == NULL);
+	CU_ASSERT(bvsession->groups[1].io_channel == NULL);
+
+	g_dpdk_response = -1;
+	set_thread(0);
+	vhost_blk_stop_cb(vsession->vdev, vsession, NULL);
+	ut_blk_poll_threads();
+	spdk_delay_us(1000);
+	ut_blk_poll_threads();
+	CU_ASSERT(g_dpdk_response == 0);
+	CU_ASSERT(vsession->started == false);
+
+	ut_blk_teardown();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -590,6 +1095,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, remove_controller_test);
 	CU_ADD_TEST(suite, vq_avail_ring_get_test);
 	CU_ADD_TEST(suite, vq_packed_ring_test);
+	CU_ADD_TEST(suite, vq_adaptive_coalescing_test);
+	CU_ADD_TEST(suite, blk_session_multi_group_test);
+	CU_ADD_TEST(suite, blk_session_stop_timeout_test);
+	CU_ADD_TEST(suite, blk_bdev_hot_remove_test);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();